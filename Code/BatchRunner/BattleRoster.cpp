@@ -0,0 +1,316 @@
+#include "BatchRunner/BattleRoster.hpp"
+#include "BatchRunner/SimpleXMLReader.hpp"
+#include "Game/BattleAI.hpp"
+#include <string.h>
+
+
+uint32_t NextRandom(uint32_t& randomState)
+{
+	//xorshift32, so a match seed builds the same battle on every platform
+	randomState ^= randomState << 13;
+	randomState ^= randomState >> 17;
+	randomState ^= randomState << 5;
+	return randomState;
+}
+
+int GetRandomIntInRange(uint32_t& randomState, int minInclusive, int maxInclusive)
+{
+	if (maxInclusive <= minInclusive)
+		return minInclusive;
+
+	return minInclusive + (int)(NextRandom(randomState) % (uint32_t)(maxInclusive - minInclusive + 1));
+}
+
+bool StringToStatusEffect(const std::string& effectName, StatusEffectType& out_type)
+{
+	//Same names as AbilityDefinition::StringToStatusEffect
+	if (effectName == "Poison")
+		out_type = STATUS_POISON;
+	else if (effectName == "Charm")
+		out_type = STATUS_CHARM;
+	else if (effectName == "Confuse")
+		out_type = STATUS_CONFUSE;
+	else if (effectName == "Wall")
+		out_type = STATUS_WALL;
+	else
+		return false;
+
+	return true;
+}
+
+bool StringToBehaviorKind(const std::string& behaviorName, BehaviorKind& out_kind)
+{
+	//Same names as Behavior::Create
+	if (behaviorName == "CloseToAttack")
+		out_kind = BEHAVIOR_CLOSE_TO_ATTACK;
+	else if (behaviorName == "Attack")
+		out_kind = BEHAVIOR_ATTACK;
+	else if (behaviorName == "Wait")
+		out_kind = BEHAVIOR_WAIT;
+	else if (behaviorName == "Ability")
+		out_kind = BEHAVIOR_ABILITY;
+	else
+		return false;
+
+	return true;
+}
+
+
+bool BattleRoster::LoadFromDataFolder(const std::string& dataFolder, std::string& out_error)
+{
+	SimpleXMLElement abilitiesRoot;
+	if (!ReadSimpleXMLFile(dataFolder + "/Abilities.xml", abilitiesRoot, out_error) || !LoadAbilities(abilitiesRoot, out_error))
+		return false;
+
+	SimpleXMLElement charactersRoot;
+	if (!ReadSimpleXMLFile(dataFolder + "/Characters.xml", charactersRoot, out_error) || !LoadCharacters(charactersRoot, out_error))
+		return false;
+
+	return true;
+}
+
+bool BattleRoster::LoadAbilities(const SimpleXMLElement& root, std::string& out_error)
+{
+	for (const SimpleXMLElement& element : root.m_children)
+	{
+		RosterAbility rosterAbility;
+		rosterAbility.m_name = element.GetAttributeString("name", "");
+		if (rosterAbility.m_name.empty())
+		{
+			out_error = "AbilityDefinition without a name.";
+			return false;
+		}
+
+		BattleAbility& ability = rosterAbility.m_ability;
+		memset(&ability, 0, sizeof(ability));
+		ability.m_range = (int16_t)element.GetAttributeInt("range", -1);
+		ability.m_radius = (int16_t)element.GetAttributeInt("radius", -1);
+		ability.m_maxHeightDifference = (int16_t)element.GetAttributeInt("maxHeightDifference", -1);
+		ability.m_areaMaxHeightDifference = (int16_t)element.GetAttributeInt("areaMaxHeightDifference", -1);
+		ability.m_power = element.GetAttributeInt("power", 0);
+		ability.m_speed = element.GetAttributeInt("speed", 0);
+		if (ability.m_range < 0 || ability.m_radius < 0 || ability.m_maxHeightDifference < 0 || ability.m_areaMaxHeightDifference < 0)
+		{
+			out_error = "Negative or missing range, radius or height difference for ability " + rosterAbility.m_name + ".";
+			return false;
+		}
+
+		const SimpleXMLElement* statusEffects = element.FindChild("StatusEffects");
+		if (nullptr != statusEffects)
+		{
+			for (const SimpleXMLElement& effectElement : statusEffects->m_children)
+			{
+				StatusEffectType type;
+				if (!StringToStatusEffect(effectElement.m_name, type))
+				{
+					out_error = "Invalid status effect " + effectElement.m_name + " on ability " + rosterAbility.m_name + ".";
+					return false;
+				}
+
+				int duration = effectElement.GetAttributeInt("duration", 0);
+				ability.m_statusEffectDurations[type] = (uint8_t)(duration > 255 ? 255 : duration);
+			}
+		}
+
+		m_abilities[rosterAbility.m_name] = rosterAbility;
+	}
+
+	if ((int)m_abilities.size() > MAX_BATTLE_ABILITIES)
+	{
+		out_error = "Too many abilities for a BattleState.";
+		return false;
+	}
+
+	return true;
+}
+
+bool BattleRoster::LoadCharacters(const SimpleXMLElement& root, std::string& out_error)
+{
+	const char* statAttributeNames[NUM_STATS] = { "Bravery", "Faith", "Move", "Jump", "Speed", "Attack", "Evasion", "HP", "MP" };
+
+	for (const SimpleXMLElement& element : root.m_children)
+	{
+		RosterCharacter character;
+		character.m_name = element.GetAttributeString("name", "");
+		if (character.m_name.empty())
+		{
+			out_error = "Character without a name.";
+			return false;
+		}
+
+		for (int statIndex = 0; statIndex < NUM_STATS; statIndex++)
+		{
+			character.m_minStats[statIndex] = element.GetAttributeInt(std::string("min") + statAttributeNames[statIndex], 0);
+			character.m_maxStats[statIndex] = element.GetAttributeInt(std::string("max") + statAttributeNames[statIndex], 0);
+		}
+
+		character.m_attackRange = element.GetAttributeInt("attackRange", 1);
+		character.m_maxAttackHeightDifference = element.GetAttributeInt("maxAttackHeightDifference", 2);
+
+		const SimpleXMLElement* abilities = element.FindChild("Abilities");
+		if (nullptr != abilities)
+		{
+			for (const SimpleXMLElement& abilityElement : abilities->m_children)
+			{
+				if (m_abilities.find(abilityElement.m_name) == m_abilities.end())
+				{
+					out_error = "Character " + character.m_name + " uses unknown ability " + abilityElement.m_name + ".";
+					return false;
+				}
+
+				character.m_abilityNames.push_back(abilityElement.m_name);
+			}
+		}
+
+		const SimpleXMLElement* behaviors = element.FindChild("Behaviors");
+		if (nullptr != behaviors)
+		{
+			for (const SimpleXMLElement& behaviorElement : behaviors->m_children)
+			{
+				BehaviorKind kind;
+				if (!StringToBehaviorKind(behaviorElement.m_name, kind))
+				{
+					out_error = "Invalid behavior name " + behaviorElement.m_name + ".";
+					return false;
+				}
+
+				character.m_behaviorKinds.push_back(kind);
+			}
+		}
+
+		m_characters.push_back(character);
+	}
+
+	return true;
+}
+
+const RosterCharacter* BattleRoster::FindCharacter(const std::string& characterName) const
+{
+	for (const RosterCharacter& character : m_characters)
+	{
+		if (character.m_name == characterName)
+			return &character;
+	}
+
+	return nullptr;
+}
+
+bool BattleRoster::BuildBattleState(const MatchSetup& setup, uint32_t seed, BattleState& out_state, std::string& out_error) const
+{
+	uint32_t randomState = MixSeed(seed);
+	out_state.Clear();
+
+	if (setup.m_mapWidth * setup.m_mapHeight > MAX_BATTLE_TILES || setup.m_mapWidth < 8 || setup.m_mapHeight < 2)
+	{
+		out_error = "Map dimensions don't fit in a BattleState.";
+		return false;
+	}
+
+	if ((int)(setup.m_teams[0].size() + setup.m_teams[1].size()) > MAX_BATTLE_CHARACTERS || (int)setup.m_teams[0].size() > setup.m_mapHeight || (int)setup.m_teams[1].size() > setup.m_mapHeight)
+	{
+		out_error = "Too many characters for the map.";
+		return false;
+	}
+
+	//Rolling hills from a coarse random lattice, standing in for the game's Perlin heights
+	const int LATTICE_SPACING = 5;
+	int latticeWidth = setup.m_mapWidth / LATTICE_SPACING + 2;
+	int latticeHeight = setup.m_mapHeight / LATTICE_SPACING + 2;
+	std::vector<int> lattice(latticeWidth * latticeHeight);
+	for (int& latticeHeightValue : lattice)
+	{
+		latticeHeightValue = GetRandomIntInRange(randomState, 0, setup.m_maxTerrainHeight);
+	}
+
+	out_state.m_mapWidth = setup.m_mapWidth;
+	out_state.m_mapHeight = setup.m_mapHeight;
+	out_state.m_numTiles = setup.m_mapWidth * setup.m_mapHeight;
+	for (int y = 0; y < setup.m_mapHeight; y++)
+	{
+		for (int x = 0; x < setup.m_mapWidth; x++)
+		{
+			int latticeX = x / LATTICE_SPACING;
+			int latticeY = y / LATTICE_SPACING;
+			float fractionX = (float)(x % LATTICE_SPACING) / (float)LATTICE_SPACING;
+			float fractionY = (float)(y % LATTICE_SPACING) / (float)LATTICE_SPACING;
+			float top = lattice[latticeY * latticeWidth + latticeX] * (1.f - fractionX) + lattice[latticeY * latticeWidth + latticeX + 1] * fractionX;
+			float bottom = lattice[(latticeY + 1) * latticeWidth + latticeX] * (1.f - fractionX) + lattice[(latticeY + 1) * latticeWidth + latticeX + 1] * fractionX;
+
+			int tileIndex = out_state.CalculateTileIndex(x, y);
+			out_state.m_tileHeights[tileIndex] = (int16_t)(top * (1.f - fractionY) + bottom * fractionY);
+			out_state.m_tileFlags[tileIndex] = TILE_FLAG_TRAVERSABLE;
+		}
+	}
+
+	//Sorted by name, the same IDs Map::CaptureBattleState hands out
+	std::map<std::string, uint8_t> abilityIDs;
+	for (std::map<std::string, RosterAbility>::const_iterator abilityIter = m_abilities.begin(); abilityIter != m_abilities.end(); ++abilityIter)
+	{
+		uint8_t abilityID = (uint8_t)out_state.m_numAbilityDefinitions;
+		abilityIDs[abilityIter->first] = abilityID;
+		out_state.m_abilityDefinitions[abilityID] = abilityIter->second.m_ability;
+		out_state.m_numAbilityDefinitions++;
+	}
+
+	//The team built first takes the east column and the lower slots, and rolls its stats first
+	for (int sideIndex = 0; sideIndex < 2; sideIndex++)
+	{
+		int teamIndex = setup.m_areSidesSwapped ? 1 - sideIndex : sideIndex;
+		const std::vector<std::string>& team = setup.m_teams[teamIndex];
+		int column = (sideIndex == 0) ? (setup.m_mapWidth * 3) / 4 : setup.m_mapWidth / 4;
+		int firstRow = (setup.m_mapHeight - (int)team.size()) / 2;
+
+		for (size_t memberIndex = 0; memberIndex < team.size(); memberIndex++)
+		{
+			const RosterCharacter* character = FindCharacter(team[memberIndex]);
+			if (nullptr == character)
+			{
+				out_error = "Unknown character type " + team[memberIndex] + ".";
+				return false;
+			}
+
+			int slot = out_state.m_numCharacters++;
+			int tileIndex = out_state.CalculateTileIndex(column, firstRow + (int)memberIndex);
+
+			out_state.m_characterIndices[slot] = (CharacterID)(slot + 1);
+			out_state.m_owningPlayers[slot] = (uint8_t)teamIndex;
+			out_state.m_factions[slot] = (uint8_t)teamIndex;
+			out_state.m_isAIControlled[slot] = 1;
+			out_state.m_tileIndices[slot] = (uint16_t)tileIndex;
+			out_state.m_tileOccupants[tileIndex] = (uint8_t)slot;
+
+			for (int statIndex = 0; statIndex < NUM_STATS; statIndex++)
+			{
+				out_state.m_stats[statIndex][slot] = GetRandomIntInRange(randomState, character->m_minStats[statIndex], character->m_maxStats[statIndex]);
+			}
+
+			out_state.m_currentHP[slot] = out_state.m_stats[STAT_MAX_HP][slot];
+			out_state.m_attackPower[slot] = out_state.m_stats[STAT_ATTACK][slot];
+			out_state.m_attackRanges[slot] = character->m_attackRange;
+			out_state.m_maxAttackHeightDifferences[slot] = character->m_maxAttackHeightDifference;
+
+			for (size_t abilityIndex = 0; abilityIndex < character->m_abilityNames.size() && abilityIndex < MAX_CHARACTER_ABILITIES; abilityIndex++)
+			{
+				out_state.m_abilities[slot][abilityIndex] = abilityIDs[character->m_abilityNames[abilityIndex]];
+				out_state.m_numAbilities[slot]++;
+			}
+
+			for (size_t behaviorIndex = 0; behaviorIndex < character->m_behaviorKinds.size() && behaviorIndex < MAX_CHARACTER_BEHAVIORS; behaviorIndex++)
+			{
+				out_state.m_behaviorKinds[slot][behaviorIndex] = (uint8_t)character->m_behaviorKinds[behaviorIndex];
+				out_state.m_numBehaviors[slot]++;
+			}
+		}
+	}
+
+	//No weaknesses or resistances in the roster data, so every attack lands at full strength
+	for (int attackerSlot = 0; attackerSlot < out_state.m_numCharacters; attackerSlot++)
+	{
+		for (int defenderSlot = 0; defenderSlot < out_state.m_numCharacters; defenderSlot++)
+		{
+			out_state.m_attackDamageModifiers[attackerSlot][defenderSlot] = 1.f;
+		}
+	}
+
+	return true;
+}
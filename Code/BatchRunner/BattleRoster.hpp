@@ -0,0 +1,53 @@
+#pragma once
+#include "Game/BattleState.hpp"
+#include <string>
+#include <vector>
+#include <map>
+
+struct SimpleXMLElement;
+
+
+struct RosterAbility
+{
+	std::string m_name;
+	BattleAbility m_ability;
+};
+
+struct RosterCharacter
+{
+	std::string m_name;
+	int m_minStats[NUM_STATS];
+	int m_maxStats[NUM_STATS];
+	int m_attackRange;
+	int m_maxAttackHeightDifference;
+	std::vector<std::string> m_abilityNames;
+	std::vector<BehaviorKind> m_behaviorKinds;
+};
+
+struct MatchSetup
+{
+	int m_mapWidth = 20;
+	int m_mapHeight = 20;
+	int m_maxTerrainHeight = 7;
+	std::vector<std::string> m_teams[2];
+
+	//The east column and the first turn-order slots are worth something, so team 2 can be given them instead of team 1
+	bool m_areSidesSwapped = false;
+};
+
+
+//Characters.xml and Abilities.xml read without the engine, for building headless battles.
+class BattleRoster
+{
+public:
+	bool LoadFromDataFolder(const std::string& dataFolder, std::string& out_error);
+	const RosterCharacter* FindCharacter(const std::string& characterName) const;
+	bool BuildBattleState(const MatchSetup& setup, uint32_t seed, BattleState& out_state, std::string& out_error) const;
+
+	std::vector<RosterCharacter> m_characters;
+	std::map<std::string, RosterAbility> m_abilities;
+
+private:
+	bool LoadAbilities(const SimpleXMLElement& root, std::string& out_error);
+	bool LoadCharacters(const SimpleXMLElement& root, std::string& out_error);
+};
@@ -0,0 +1,346 @@
+#include "BatchRunner/BattleRoster.hpp"
+#include "Game/BattleSimulation.hpp"
+#include "Game/BattleReplay.hpp"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+
+struct BatchOptions
+{
+	std::string m_dataFolder = "Run_Win32/Data/Gameplay";
+	std::string m_outputPath = "results.csv";
+	std::string m_replayFolder;
+	int m_numMatches = 1000;
+	int m_numThreads = 0;
+	uint32_t m_baseSeed = 1;
+	int m_maxTurns = 1000;
+	MatchSetup m_setup;
+};
+
+struct MatchResult
+{
+	uint32_t m_seed;
+	int m_team1Side;
+	int m_winningPlayer;
+	int m_numTurns;
+	int m_damageDealt[2];
+	int m_healingDone[2];
+	int m_survivors[2];
+	int m_remainingHP[2];
+	int m_maxHP[2];
+	bool m_succeeded;
+};
+
+
+std::vector<std::string> SplitCommaSeparated(const std::string& text)
+{
+	std::vector<std::string> pieces;
+	size_t start = 0;
+	while (start <= text.size())
+	{
+		size_t comma = text.find(',', start);
+		if (comma == std::string::npos)
+			comma = text.size();
+
+		if (comma > start)
+			pieces.push_back(text.substr(start, comma - start));
+
+		start = comma + 1;
+	}
+
+	return pieces;
+}
+
+void PrintUsage()
+{
+	printf("Usage: TacticsBatch [options]\n");
+	printf("  --data <folder>      Folder holding Characters.xml and Abilities.xml (default Run_Win32/Data/Gameplay)\n");
+	printf("  --matches <count>    Number of matches to run (default 1000)\n");
+	printf("  --threads <count>    Worker threads (default: one per core)\n");
+	printf("  --seed <seed>        Seed of the first match; matches 2N and 2N+1 both use seed + N (default 1)\n");
+	printf("  --max-turns <count>  Turns before a match is called a draw (default 1000)\n");
+	printf("  --map <W>x<H>        Map size (default 20x20)\n");
+	printf("  --team1 <a,b,...>    Character names for player 0 (default: the whole roster)\n");
+	printf("  --team2 <a,b,...>    Character names for player 1 (default: the whole roster)\n");
+	printf("  --out <file>         CSV of per-match results (default results.csv)\n");
+	printf("                       start_side is where team 1 started: 1 east with the first turn-order slots, 2 west\n");
+	printf("  --replays <folder>   Also record every match as <folder>/match_<N>.sav\n");
+}
+
+bool ParseOptions(int argc, char** argv, BatchOptions& out_options)
+{
+	for (int argIndex = 1; argIndex < argc; argIndex++)
+	{
+		std::string option = argv[argIndex];
+		if (option == "--help" || option == "-h")
+			return false;
+
+		if (argIndex + 1 >= argc)
+		{
+			printf("Missing value for %s\n", option.c_str());
+			return false;
+		}
+
+		std::string value = argv[++argIndex];
+		if (option == "--data")
+			out_options.m_dataFolder = value;
+		else if (option == "--out")
+			out_options.m_outputPath = value;
+		else if (option == "--replays")
+			out_options.m_replayFolder = value;
+		else if (option == "--matches")
+			out_options.m_numMatches = atoi(value.c_str());
+		else if (option == "--threads")
+			out_options.m_numThreads = atoi(value.c_str());
+		else if (option == "--seed")
+			out_options.m_baseSeed = (uint32_t)strtoul(value.c_str(), nullptr, 10);
+		else if (option == "--max-turns")
+			out_options.m_maxTurns = atoi(value.c_str());
+		else if (option == "--map")
+		{
+			if (sscanf(value.c_str(), "%dx%d", &out_options.m_setup.m_mapWidth, &out_options.m_setup.m_mapHeight) != 2)
+			{
+				printf("Map size must look like 20x20\n");
+				return false;
+			}
+		}
+		else if (option == "--team1")
+			out_options.m_setup.m_teams[0] = SplitCommaSeparated(value);
+		else if (option == "--team2")
+			out_options.m_setup.m_teams[1] = SplitCommaSeparated(value);
+		else
+		{
+			printf("Unknown option %s\n", option.c_str());
+			return false;
+		}
+	}
+
+	return out_options.m_numMatches > 0 && out_options.m_maxTurns > 0;
+}
+
+MatchResult RunMatch(const BattleRoster& roster, const MatchSetup& setup, uint32_t seed, int maxTurns, const std::string& replayPath)
+{
+	MatchResult result;
+	memset(&result, 0, sizeof(result));
+	result.m_seed = seed;
+	result.m_team1Side = setup.m_areSidesSwapped ? 2 : 1;
+	result.m_winningPlayer = -1;
+
+	BattleState initialState;
+	std::string error;
+	if (!roster.BuildBattleState(setup, seed, initialState, error))
+		return result;
+
+	BattleSimulation simulation(initialState, seed);
+	if (replayPath.empty())
+	{
+		result.m_winningPlayer = simulation.RunToCompletion(maxTurns);
+	}
+	else
+	{
+		ReplayFileWriter replay;
+		if (!replay.Open(replayPath, seed, REPLAY_INFO_EVERY_TURN_RECORDED))
+			return result;
+		replay.WriteSetup(initialState);
+
+		int readySlot;
+		while (simulation.m_numTurns < maxTurns && simulation.StartNextTurn(readySlot))
+		{
+			if (readySlot < 0)
+				continue;
+
+			BattleDecision decision = simulation.m_ai.ChooseAction(simulation.m_state, readySlot);
+			replay.WriteCommand(MakeReplayCommand(simulation.m_state, readySlot, decision));
+			simulation.FinishTurn(readySlot, decision);
+		}
+
+		if (!replay.Close(simulation.m_numTurns))
+			return result;
+		result.m_winningPlayer = simulation.GetWinningPlayer();
+	}
+	result.m_numTurns = simulation.m_numTurns;
+
+	const BattleState& finalState = simulation.m_state;
+	for (int slot = 0; slot < finalState.m_numCharacters; slot++)
+	{
+		int team = finalState.m_owningPlayers[slot];
+		result.m_damageDealt[team] += simulation.m_damageDealt[slot];
+		result.m_healingDone[team] += simulation.m_healingDone[slot];
+		result.m_maxHP[team] += finalState.m_stats[STAT_MAX_HP][slot];
+		if (finalState.IsActive(slot) && !finalState.m_isDead[slot])
+		{
+			result.m_survivors[team]++;
+			result.m_remainingHP[team] += finalState.m_currentHP[slot];
+		}
+	}
+
+	result.m_succeeded = true;
+	return result;
+}
+
+//A draw still says something: whichever team has more of its total HP left when the turns ran out was ahead
+int GetLeadingPlayer(const MatchResult& result)
+{
+	if (result.m_winningPlayer >= 0)
+		return result.m_winningPlayer;
+
+	float remainingFractions[2];
+	for (int team = 0; team < 2; team++)
+	{
+		remainingFractions[team] = (result.m_maxHP[team] > 0) ? (float)result.m_remainingHP[team] / (float)result.m_maxHP[team] : 0.f;
+	}
+
+	if (remainingFractions[0] == remainingFractions[1])
+		return -1;
+
+	return (remainingFractions[0] > remainingFractions[1]) ? 0 : 1;
+}
+
+bool WriteResults(const std::string& outputPath, const std::vector<MatchResult>& results)
+{
+	FILE* file = fopen(outputPath.c_str(), "w");
+	if (nullptr == file)
+		return false;
+
+	fprintf(file, "match,seed,start_side,winner,leader,turns,team1_damage,team2_damage,team1_healing,team2_healing,team1_survivors,team2_survivors,team1_hp,team2_hp\n");
+	for (size_t matchIndex = 0; matchIndex < results.size(); matchIndex++)
+	{
+		const MatchResult& result = results[matchIndex];
+		fprintf(file, "%d,%u,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d\n", (int)matchIndex, result.m_seed, result.m_team1Side, result.m_winningPlayer + 1, GetLeadingPlayer(result) + 1, result.m_numTurns,
+			result.m_damageDealt[0], result.m_damageDealt[1], result.m_healingDone[0], result.m_healingDone[1], result.m_survivors[0], result.m_survivors[1],
+			result.m_remainingHP[0], result.m_remainingHP[1]);
+	}
+
+	fclose(file);
+	return true;
+}
+
+
+int main(int argc, char** argv)
+{
+	BatchOptions options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	BattleRoster roster;
+	std::string error;
+	if (!roster.LoadFromDataFolder(options.m_dataFolder, error))
+	{
+		printf("Failed to load roster: %s\n", error.c_str());
+		return 1;
+	}
+
+	for (int teamIndex = 0; teamIndex < 2; teamIndex++)
+	{
+		if (!options.m_setup.m_teams[teamIndex].empty())
+			continue;
+
+		for (const RosterCharacter& character : roster.m_characters)
+		{
+			options.m_setup.m_teams[teamIndex].push_back(character.m_name);
+		}
+	}
+
+	//Build one battle up front so a bad team or map size fails once instead of in every match
+	BattleState validationState;
+	if (!roster.BuildBattleState(options.m_setup, options.m_baseSeed, validationState, error))
+	{
+		printf("Invalid match setup: %s\n", error.c_str());
+		return 1;
+	}
+
+	int numThreads = options.m_numThreads;
+	if (numThreads <= 0)
+		numThreads = (int)std::thread::hardware_concurrency();
+	if (numThreads <= 0)
+		numThreads = 1;
+	if (numThreads > options.m_numMatches)
+		numThreads = options.m_numMatches;
+
+	std::vector<MatchResult> results(options.m_numMatches);
+	std::atomic<int> nextMatchIndex(0);
+
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+	//Matches are independent, so each worker just claims the next index until they run out
+	std::vector<std::thread> workers;
+	for (int threadIndex = 0; threadIndex < numThreads; threadIndex++)
+	{
+		workers.push_back(std::thread([&]()
+		{
+			for (;;)
+			{
+				int matchIndex = nextMatchIndex.fetch_add(1);
+				if (matchIndex >= options.m_numMatches)
+					return;
+
+				std::string replayPath;
+				if (!options.m_replayFolder.empty())
+					replayPath = options.m_replayFolder + "/match_" + std::to_string(matchIndex) + ".sav";
+
+				//Each seed is played from both sides, so whatever the east side's tie-breaks are worth cancels out between the teams
+				MatchSetup setup = options.m_setup;
+				setup.m_areSidesSwapped = (matchIndex % 2) != 0;
+				results[matchIndex] = RunMatch(roster, setup, options.m_baseSeed + (uint32_t)(matchIndex / 2), options.m_maxTurns, replayPath);
+			}
+		}));
+	}
+
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+
+	double elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+	long long totalTurns = 0;
+	int wins[2] = { 0, 0 };
+	int sideWins[2] = { 0, 0 };
+	int draws = 0;
+	int drawLeaders[3] = { 0, 0, 0 };
+	int failures = 0;
+	for (const MatchResult& result : results)
+	{
+		totalTurns += result.m_numTurns;
+		if (!result.m_succeeded)
+			failures++;
+		else if (result.m_winningPlayer == 0 || result.m_winningPlayer == 1)
+		{
+			wins[result.m_winningPlayer]++;
+			int winningSide = (result.m_winningPlayer == 0) ? result.m_team1Side : 3 - result.m_team1Side;
+			sideWins[winningSide - 1]++;
+		}
+		else
+		{
+			draws++;
+			drawLeaders[GetLeadingPlayer(result) + 1]++;
+		}
+	}
+
+	if (!WriteResults(options.m_outputPath, results))
+	{
+		printf("Failed to write %s\n", options.m_outputPath.c_str());
+		return 1;
+	}
+
+	if (elapsedSeconds <= 0.0)
+		elapsedSeconds = 1e-9;
+
+	printf("%d matches on %d threads in %.3f s\n", options.m_numMatches, numThreads, elapsedSeconds);
+	printf("Team 1 wins: %d, team 2 wins: %d, draws: %d, failed: %d\n", wins[0], wins[1], draws, failures);
+	printf("Wins by starting side: east %d, west %d\n", sideWins[0], sideWins[1]);
+	if (draws > 0)
+		printf("Ahead on HP when the turns ran out: team 1 in %d draws, team 2 in %d, even in %d\n", drawLeaders[1], drawLeaders[2], drawLeaders[0]);
+	printf("%.1f matches/s (%.0f matches/min), %.1f turns/s, %.1f turns per match\n", options.m_numMatches / elapsedSeconds, 60.0 * options.m_numMatches / elapsedSeconds,
+		totalTurns / elapsedSeconds, (double)totalTurns / options.m_numMatches);
+	printf("Results written to %s\n", options.m_outputPath.c_str());
+	return 0;
+}
@@ -0,0 +1,252 @@
+#include "BatchRunner/SimpleXMLReader.hpp"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+
+const std::string* SimpleXMLElement::FindAttribute(const std::string& attributeName) const
+{
+	for (const std::pair<std::string, std::string>& attribute : m_attributes)
+	{
+		if (attribute.first == attributeName)
+			return &attribute.second;
+	}
+
+	return nullptr;
+}
+
+std::string SimpleXMLElement::GetAttributeString(const std::string& attributeName, const std::string& defaultValue) const
+{
+	const std::string* value = FindAttribute(attributeName);
+	return (nullptr != value) ? *value : defaultValue;
+}
+
+int SimpleXMLElement::GetAttributeInt(const std::string& attributeName, int defaultValue) const
+{
+	const std::string* value = FindAttribute(attributeName);
+	return (nullptr != value) ? atoi(value->c_str()) : defaultValue;
+}
+
+float SimpleXMLElement::GetAttributeFloat(const std::string& attributeName, float defaultValue) const
+{
+	const std::string* value = FindAttribute(attributeName);
+	return (nullptr != value) ? (float)atof(value->c_str()) : defaultValue;
+}
+
+const SimpleXMLElement* SimpleXMLElement::FindChild(const std::string& childName) const
+{
+	for (const SimpleXMLElement& child : m_children)
+	{
+		if (child.m_name == childName)
+			return &child;
+	}
+
+	return nullptr;
+}
+
+
+class SimpleXMLParser
+{
+public:
+	SimpleXMLParser(const std::string& text) : m_text(text), m_position(0) {}
+
+	bool ParseDocument(SimpleXMLElement& out_root, std::string& out_error)
+	{
+		SkipMisc();
+		if (!ParseElement(out_root, out_error))
+			return false;
+
+		SkipMisc();
+		if (m_position < m_text.size())
+		{
+			out_error = "Unexpected content after the root element.";
+			return false;
+		}
+
+		return true;
+	}
+
+private:
+	bool StartsWith(const char* prefix) const
+	{
+		return m_text.compare(m_position, strlen(prefix), prefix) == 0;
+	}
+
+	void SkipWhitespace()
+	{
+		while (m_position < m_text.size() && isspace((unsigned char)m_text[m_position]))
+			m_position++;
+	}
+
+	void SkipPast(const char* terminator)
+	{
+		size_t found = m_text.find(terminator, m_position);
+		m_position = (found == std::string::npos) ? m_text.size() : found + strlen(terminator);
+	}
+
+	//Whitespace, comments, the prolog and anything else between tags
+	void SkipMisc()
+	{
+		for (;;)
+		{
+			SkipWhitespace();
+			if (StartsWith("\xEF\xBB\xBF"))
+				m_position += 3;
+			else if (StartsWith("<!--"))
+				SkipPast("-->");
+			else if (StartsWith("<?"))
+				SkipPast("?>");
+			else if (StartsWith("<!"))
+				SkipPast(">");
+			else
+				return;
+		}
+	}
+
+	std::string ParseName()
+	{
+		size_t start = m_position;
+		while (m_position < m_text.size() && (isalnum((unsigned char)m_text[m_position]) || m_text[m_position] == '_' || m_text[m_position] == '-' || m_text[m_position] == ':' || m_text[m_position] == '.'))
+			m_position++;
+
+		return m_text.substr(start, m_position - start);
+	}
+
+	bool ParseElement(SimpleXMLElement& out_element, std::string& out_error)
+	{
+		if (m_position >= m_text.size() || m_text[m_position] != '<')
+		{
+			out_error = "Expected an element.";
+			return false;
+		}
+
+		m_position++;
+		out_element.m_name = ParseName();
+		if (out_element.m_name.empty())
+		{
+			out_error = "Element has no name.";
+			return false;
+		}
+
+		for (;;)
+		{
+			SkipWhitespace();
+			if (m_position >= m_text.size())
+			{
+				out_error = "Unterminated <" + out_element.m_name + ">.";
+				return false;
+			}
+
+			if (StartsWith("/>"))
+			{
+				m_position += 2;
+				return true;
+			}
+
+			if (m_text[m_position] == '>')
+			{
+				m_position++;
+				break;
+			}
+
+			std::string attributeName = ParseName();
+			SkipWhitespace();
+			if (attributeName.empty() || m_position >= m_text.size() || m_text[m_position] != '=')
+			{
+				out_error = "Malformed attribute in <" + out_element.m_name + ">.";
+				return false;
+			}
+
+			m_position++;
+			SkipWhitespace();
+			char quote = (m_position < m_text.size()) ? m_text[m_position] : '\0';
+			if (quote != '"' && quote != '\'')
+			{
+				out_error = "Unquoted attribute " + attributeName + " in <" + out_element.m_name + ">.";
+				return false;
+			}
+
+			size_t valueEnd = m_text.find(quote, m_position + 1);
+			if (valueEnd == std::string::npos)
+			{
+				out_error = "Unterminated attribute " + attributeName + ".";
+				return false;
+			}
+
+			out_element.m_attributes.push_back(std::make_pair(attributeName, m_text.substr(m_position + 1, valueEnd - m_position - 1)));
+			m_position = valueEnd + 1;
+		}
+
+		for (;;)
+		{
+			SkipMisc();
+			size_t nextTag = m_text.find('<', m_position);
+			if (nextTag == std::string::npos)
+			{
+				out_error = "Missing </" + out_element.m_name + ">.";
+				return false;
+			}
+
+			m_position = nextTag;
+			SkipMisc();
+			if (StartsWith("</"))
+			{
+				m_position += 2;
+				std::string closingName = ParseName();
+				if (closingName != out_element.m_name)
+				{
+					out_error = "Expected </" + out_element.m_name + "> but found </" + closingName + ">.";
+					return false;
+				}
+
+				SkipPast(">");
+				return true;
+			}
+
+			if (m_position >= m_text.size() || m_text[m_position] != '<')
+				continue;
+
+			out_element.m_children.push_back(SimpleXMLElement());
+			if (!ParseElement(out_element.m_children.back(), out_error))
+				return false;
+		}
+	}
+
+	const std::string& m_text;
+	size_t m_position;
+};
+
+
+bool ParseSimpleXML(const std::string& text, SimpleXMLElement& out_root, std::string& out_error)
+{
+	SimpleXMLParser parser(text);
+	return parser.ParseDocument(out_root, out_error);
+}
+
+bool ReadSimpleXMLFile(const std::string& filePath, SimpleXMLElement& out_root, std::string& out_error)
+{
+	FILE* file = fopen(filePath.c_str(), "rb");
+	if (nullptr == file)
+	{
+		out_error = "Could not open " + filePath + ".";
+		return false;
+	}
+
+	std::string text;
+	char buffer[4096];
+	size_t bytesRead = 0;
+	while ((bytesRead = fread(buffer, 1, sizeof(buffer), file)) > 0)
+	{
+		text.append(buffer, bytesRead);
+	}
+	fclose(file);
+
+	if (!ParseSimpleXML(text, out_root, out_error))
+	{
+		out_error = filePath + ": " + out_error;
+		return false;
+	}
+
+	return true;
+}
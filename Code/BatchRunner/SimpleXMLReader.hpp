@@ -0,0 +1,23 @@
+#pragma once
+#include <string>
+#include <vector>
+
+
+//Just enough XML for the Data/Gameplay files: elements, quoted attributes, comments and the prolog.
+//Text content is skipped.
+struct SimpleXMLElement
+{
+	std::string m_name;
+	std::vector<std::pair<std::string, std::string>> m_attributes;
+	std::vector<SimpleXMLElement> m_children;
+
+	const std::string* FindAttribute(const std::string& attributeName) const;
+	std::string GetAttributeString(const std::string& attributeName, const std::string& defaultValue) const;
+	int GetAttributeInt(const std::string& attributeName, int defaultValue) const;
+	float GetAttributeFloat(const std::string& attributeName, float defaultValue) const;
+	const SimpleXMLElement* FindChild(const std::string& childName) const;
+};
+
+
+bool ReadSimpleXMLFile(const std::string& filePath, SimpleXMLElement& out_root, std::string& out_error);
+bool ParseSimpleXML(const std::string& text, SimpleXMLElement& out_root, std::string& out_error);
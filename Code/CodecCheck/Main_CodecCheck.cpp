@@ -0,0 +1,266 @@
+#include "Game/CommandBatch.hpp"
+#include "Game/ByteCompression.hpp"
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+
+static int s_numChecks = 0;
+static int s_numFailures = 0;
+
+
+static void Check(bool condition, const char* description)
+{
+	s_numChecks++;
+	if (condition)
+		return;
+
+	s_numFailures++;
+	printf("FAILED: %s\n", description);
+}
+
+//xorshift32, so every run checks the same "random" data
+static uint32_t NextRandom(uint32_t& state)
+{
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+static NetCommand MakeCommand(uint8_t type, CharacterID actingCharacterIndex, uint16_t tileIndex, CharacterID targettedCharacterIndex, uint8_t abilityIndex)
+{
+	NetCommand command;
+	command.m_type = type;
+	command.m_actingCharacterIndex = actingCharacterIndex;
+	command.m_tileIndex = tileIndex;
+	command.m_targettedCharacterIndex = targettedCharacterIndex;
+	command.m_abilityIndex = abilityIndex;
+	return command;
+}
+
+static bool AreCommandsEqual(const NetCommand& first, const NetCommand& second)
+{
+	return first.m_type == second.m_type && first.m_actingCharacterIndex == second.m_actingCharacterIndex && first.m_tileIndex == second.m_tileIndex
+		&& first.m_targettedCharacterIndex == second.m_targettedCharacterIndex && first.m_abilityIndex == second.m_abilityIndex;
+}
+
+static bool DecodeBytes(const uint8_t* bytes, size_t numBytes, size_t numCommands, std::vector<NetCommand>& out_commands)
+{
+	ByteReader reader(bytes, numBytes);
+	return DecodeCommandBatch(reader, numCommands, out_commands);
+}
+
+static bool RoundTripCommands(const std::vector<NetCommand>& commands)
+{
+	ByteBuffer buffer;
+	EncodeCommandBatch(&commands[0], commands.size(), buffer);
+
+	std::vector<NetCommand> decoded;
+	if (!DecodeBytes(buffer.GetData(), buffer.GetSize(), commands.size(), decoded) || decoded.size() != commands.size())
+		return false;
+
+	for (size_t commandIndex = 0; commandIndex < commands.size(); commandIndex++)
+	{
+		if (!AreCommandsEqual(commands[commandIndex], decoded[commandIndex]))
+			return false;
+	}
+
+	return true;
+}
+
+//Every prefix of a valid batch is missing at least part of a command, so none of them may decode
+static bool RejectsEveryTruncation(const std::vector<NetCommand>& commands)
+{
+	ByteBuffer buffer;
+	EncodeCommandBatch(&commands[0], commands.size(), buffer);
+
+	std::vector<NetCommand> decoded;
+	for (size_t numBytes = 0; numBytes < buffer.GetSize(); numBytes++)
+	{
+		if (DecodeBytes(buffer.GetData(), numBytes, commands.size(), decoded))
+			return false;
+	}
+
+	return true;
+}
+
+
+static void CheckCommandBatch()
+{
+	std::vector<NetCommand> edges;
+	edges.push_back(MakeCommand(0, 1, 0, 0, 0));
+	edges.push_back(MakeCommand(1, 1, 0xFFFF, 0, 0));
+	edges.push_back(MakeCommand(2, 0xFFFF, 0, 0xFFFF, 255));
+	edges.push_back(MakeCommand(3, 0xFFFF, 0xFFFF, 0x8000, 1));
+	edges.push_back(MakeCommand(3, 0x7F, 0x7F, 0x80, 0));
+	edges.push_back(MakeCommand(2, 0x80, 0x80, 0x3FFF, 0));
+	edges.push_back(MakeCommand(1, 0x4000, 0, 0x4000, 0));
+	Check(RoundTripCommands(edges), "Command batch round trip with edge tile deltas and 16-bit IDs");
+	Check(RejectsEveryTruncation(edges), "Truncated command batch is rejected");
+
+	std::vector<NetCommand> single(1, MakeCommand(2, 0xFFFF, 0xFFFF, 0xFFFF, 255));
+	Check(RoundTripCommands(single), "Command batch round trip with every field at its maximum");
+	Check(RejectsEveryTruncation(single), "Truncated single-command batch is rejected");
+
+	uint32_t randomState = 0x9E3779B9u;
+	std::vector<NetCommand> full;
+	for (size_t commandIndex = 0; commandIndex < MAX_COMMANDS_PER_BATCH; commandIndex++)
+	{
+		uint32_t random = NextRandom(randomState);
+		CharacterID actingCharacterIndex = (random & 1) ? (full.empty() ? 1 : full.back().m_actingCharacterIndex) : (CharacterID)(NextRandom(randomState) >> 16);
+		full.push_back(MakeCommand((uint8_t)(random >> 1) & 3, actingCharacterIndex, (uint16_t)(NextRandom(randomState) >> 16),
+			(random & 8) ? (CharacterID)(NextRandom(randomState) >> 16) : 0, (random & 16) ? (uint8_t)(random >> 24) : 0));
+	}
+	Check(RoundTripCommands(full), "Full random command batch round trips");
+
+	ByteBuffer buffer;
+	EncodeCommandBatch(&edges[0], edges.size(), buffer);
+	std::vector<uint8_t> trailing = buffer.m_bytes;
+	trailing.push_back(0);
+	std::vector<NetCommand> decoded;
+	Check(!DecodeBytes(&trailing[0], trailing.size(), edges.size(), decoded), "Command batch with a trailing byte is rejected");
+	Check(!DecodeBytes(buffer.GetData(), buffer.GetSize(), edges.size() + 1, decoded), "Command batch shorter than its count is rejected");
+
+	//[flags][tile delta]: reserved flag bits
+	const uint8_t reservedFlags[] = { 0x24, 0x00 };
+	Check(!DecodeBytes(reservedFlags, sizeof(reservedFlags), 1, decoded), "Command with reserved flag bits is rejected");
+
+	//Same character, tile delta of -1 (zigzag 1) from tile 0
+	const uint8_t tileBelowZero[] = { 0x04, 0x01 };
+	Check(!DecodeBytes(tileBelowZero, sizeof(tileBelowZero), 1, decoded), "Tile delta below 0 is rejected");
+
+	//Same character, tile delta of +65536 (zigzag 131072)
+	const uint8_t tileAboveMax[] = { 0x04, 0x80, 0x80, 0x08 };
+	Check(!DecodeBytes(tileAboveMax, sizeof(tileAboveMax), 1, decoded), "Tile delta past 0xFFFF is rejected");
+
+	//New acting character 65536
+	const uint8_t characterAboveMax[] = { 0x00, 0x80, 0x80, 0x04, 0x00 };
+	Check(!DecodeBytes(characterAboveMax, sizeof(characterAboveMax), 1, decoded), "Acting character ID past 16 bits is rejected");
+
+	//Same character, no tile change, target 65536
+	const uint8_t targetAboveMax[] = { 0x0C, 0x00, 0x80, 0x80, 0x04 };
+	Check(!DecodeBytes(targetAboveMax, sizeof(targetAboveMax), 1, decoded), "Target character ID past 16 bits is rejected");
+
+	//Varint that never ends
+	const uint8_t unterminatedVarint[] = { 0x00, 0xFF, 0xFF, 0xFF };
+	Check(!DecodeBytes(unterminatedVarint, sizeof(unterminatedVarint), 1, decoded), "Unterminated varint is rejected");
+}
+
+
+static bool RoundTripBytes(const std::vector<uint8_t>& bytes)
+{
+	ByteBuffer buffer;
+	CompressBytes(bytes.empty() ? nullptr : &bytes[0], bytes.size(), buffer);
+
+	std::vector<uint8_t> decompressed(bytes.size() + 1, 0xCD);
+	ByteReader reader(buffer);
+	if (!DecompressBytes(reader, &decompressed[0], bytes.size()))
+		return false;
+
+	//The byte past the end catches a decoder that writes one too many
+	return std::equal(bytes.begin(), bytes.end(), decompressed.begin()) && decompressed[bytes.size()] == 0xCD;
+}
+
+static bool RejectsEveryTruncatedStream(const std::vector<uint8_t>& bytes)
+{
+	ByteBuffer buffer;
+	CompressBytes(&bytes[0], bytes.size(), buffer);
+
+	std::vector<uint8_t> decompressed(bytes.size());
+	for (size_t numBytes = 0; numBytes < buffer.GetSize(); numBytes++)
+	{
+		ByteReader reader(buffer.GetData(), numBytes);
+		if (DecompressBytes(reader, &decompressed[0], bytes.size()))
+			return false;
+	}
+
+	return true;
+}
+
+static bool DecompressStream(const uint8_t* stream, size_t numStreamBytes, uint8_t* out_data, size_t numBytes)
+{
+	ByteReader reader(stream, numStreamBytes);
+	return DecompressBytes(reader, out_data, numBytes);
+}
+
+
+static void CheckByteCompression()
+{
+	Check(RoundTripBytes(std::vector<uint8_t>()), "Empty input round trips");
+	for (size_t numBytes = 1; numBytes < COMPRESSION_MIN_MATCH * 2; numBytes++)
+	{
+		Check(RoundTripBytes(std::vector<uint8_t>(numBytes, 7)), "Input around the minimum match length round trips");
+	}
+
+	//Mostly zeros with repeated rows, like a BattleSave
+	std::vector<uint8_t> rows(4096, 0);
+	for (size_t rowStart = 0; rowStart < rows.size(); rowStart += 96)
+	{
+		for (size_t byteIndex = 0; byteIndex < 12 && rowStart + byteIndex < rows.size(); byteIndex++)
+		{
+			rows[rowStart + byteIndex] = (uint8_t)(byteIndex * 17 + (rowStart / 96) % 3);
+		}
+	}
+	Check(RoundTripBytes(rows), "Struct-like input round trips");
+	Check(RejectsEveryTruncatedStream(rows), "Truncated stream of struct-like input is rejected");
+
+	uint32_t randomState = 0x2545F491u;
+	std::vector<uint8_t> noise(3000);
+	for (uint8_t& byte : noise)
+	{
+		byte = (uint8_t)(NextRandom(randomState) >> 24);
+	}
+	Check(RoundTripBytes(noise), "Incompressible input round trips");
+	Check(RejectsEveryTruncatedStream(noise), "Truncated stream of incompressible input is rejected");
+
+	std::vector<uint8_t> pattern(1000);
+	for (size_t byteIndex = 0; byteIndex < pattern.size(); byteIndex++)
+	{
+		pattern[byteIndex] = (uint8_t)("abcab"[byteIndex % 5]);
+	}
+	Check(RoundTripBytes(pattern), "Short repeating pattern round trips");
+
+	//[size 10][1 literal 'a'][match length 9][offset 1]: a match copying the bytes it is writing
+	uint8_t output[16];
+	const uint8_t overlappingMatch[] = { 10, 1, 'a', 5, 1, 0 };
+	bool decodedOverlap = DecompressStream(overlappingMatch, sizeof(overlappingMatch), output, 10);
+	Check(decodedOverlap && memcmp(output, "aaaaaaaaaa", 10) == 0, "Overlapping match decodes");
+
+	//[size 8][2 literals "ab"][match length 6][offset 2]
+	const uint8_t overlappingPair[] = { 8, 2, 'a', 'b', 2, 2, 0 };
+	bool decodedPair = DecompressStream(overlappingPair, sizeof(overlappingPair), output, 8);
+	Check(decodedPair && memcmp(output, "abababab", 8) == 0, "Overlapping two-byte match decodes");
+
+	const uint8_t wrongSize[] = { 9, 1, 'a', 5, 1, 0 };
+	Check(!DecompressStream(wrongSize, sizeof(wrongSize), output, 10), "Stream for a different size is rejected");
+
+	const uint8_t zeroOffset[] = { 10, 1, 'a', 5, 0, 0 };
+	Check(!DecompressStream(zeroOffset, sizeof(zeroOffset), output, 10), "Match with offset 0 is rejected");
+
+	const uint8_t offsetBeforeStart[] = { 10, 1, 'a', 5, 2, 0 };
+	Check(!DecompressStream(offsetBeforeStart, sizeof(offsetBeforeStart), output, 10), "Match reaching before the start is rejected");
+
+	const uint8_t matchPastEnd[] = { 10, 1, 'a', 6, 1, 0 };
+	Check(!DecompressStream(matchPastEnd, sizeof(matchPastEnd), output, 10), "Match running past the end is rejected");
+
+	const uint8_t tooManyLiterals[] = { 2, 3, 'a', 'b', 'c' };
+	Check(!DecompressStream(tooManyLiterals, sizeof(tooManyLiterals), output, 2), "Literal run past the end is rejected");
+
+	const uint8_t missingLiterals[] = { 4, 4, 'a', 'b' };
+	Check(!DecompressStream(missingLiterals, sizeof(missingLiterals), output, 4), "Literal run cut short is rejected");
+
+	const uint8_t hugeMatch[] = { 10, 1, 'a', 0xFF, 0xFF, 0xFF, 0xFF, 0x0F, 1, 0 };
+	Check(!DecompressStream(hugeMatch, sizeof(hugeMatch), output, 10), "Huge match length is rejected");
+}
+
+
+//Round trips and malformed input for the command batch and snapshot codecs. Exits non-zero if any check fails.
+int main()
+{
+	CheckCommandBatch();
+	CheckByteCompression();
+
+	printf("%d of %d codec checks passed\n", s_numChecks - s_numFailures, s_numChecks);
+	return (s_numFailures == 0) ? 0 : 1;
+}
@@ -0,0 +1,37 @@
+#include "DedicatedServer/ByteTransport.hpp"
+#include "DedicatedServer/EventLoop.hpp"
+#include <errno.h>
+#include <sys/socket.h>
+
+
+SocketTransport::SocketTransport(int socket)
+	: m_socket(socket)
+{
+
+}
+
+SocketTransport::~SocketTransport()
+{
+	CloseSocket(m_socket);
+}
+
+int SocketTransport::Receive(uint8_t* out_bytes, size_t maxBytes)
+{
+	ssize_t numBytes = recv(m_socket, out_bytes, maxBytes, 0);
+	if (numBytes > 0)
+		return (int)numBytes;
+
+	if (numBytes == 0)
+		return -1;
+
+	return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 0 : -1;
+}
+
+int SocketTransport::Send(const uint8_t* bytes, size_t numBytes)
+{
+	ssize_t numSent = send(m_socket, bytes, numBytes, MSG_NOSIGNAL);
+	if (numSent >= 0)
+		return (int)numSent;
+
+	return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 0 : -1;
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+
+//The byte pipe under a MessageStream: a reliable, ordered stream that never blocks. Receive and Send return how many
+//bytes moved, 0 when none can right now, or -1 once the other end is gone and everything it sent has been read.
+class ByteTransport
+{
+public:
+	virtual ~ByteTransport() {}
+
+	virtual int Receive(uint8_t* out_bytes, size_t maxBytes) = 0;
+	virtual int Send(const uint8_t* bytes, size_t numBytes) = 0;
+
+	//Transports that aren't a socket return -1 and are never added to an EventLoop
+	virtual int GetSocket() const { return -1; }
+};
+
+
+//A connected non-blocking TCP socket, closed when the transport is destroyed
+class SocketTransport : public ByteTransport
+{
+public:
+	explicit SocketTransport(int socket);
+	virtual ~SocketTransport();
+
+	virtual int Receive(uint8_t* out_bytes, size_t maxBytes) override;
+	virtual int Send(const uint8_t* bytes, size_t numBytes) override;
+	virtual int GetSocket() const override { return m_socket; }
+
+private:
+	SocketTransport(const SocketTransport&) = delete;
+	SocketTransport& operator=(const SocketTransport&) = delete;
+
+	int m_socket;
+};
@@ -0,0 +1,267 @@
+#include "DedicatedServer/DedicatedServer.hpp"
+
+
+ServerConnection::ServerConnection(int socket)
+	: m_stream(socket)
+	, m_match(nullptr)
+	, m_playerIndex(-1)
+	, m_isWatchingWrites(false)
+{
+
+}
+
+
+DedicatedServer::DedicatedServer(const BattleRoster& roster, const MatchSetup& setup, uint32_t baseSeed, int maxTurns, SpectatorHub* spectators /*= nullptr*/)
+	: m_roster(roster)
+	, m_setup(setup)
+	, m_baseSeed(baseSeed)
+	, m_maxTurns(maxTurns)
+	, m_spectators(spectators)
+	, m_eventLoop()
+	, m_listenSocket(-1)
+	, m_connections()
+	, m_matches()
+	, m_events()
+	, m_socketsToClose()
+	, m_stats()
+{
+
+}
+
+DedicatedServer::~DedicatedServer()
+{
+	for (std::map<int, ServerConnection*>::iterator connectionIter = m_connections.begin(); connectionIter != m_connections.end(); ++connectionIter)
+	{
+		delete connectionIter->second;
+	}
+	m_connections.clear();
+
+	for (std::map<uint32_t, ServerMatch*>::iterator matchIter = m_matches.begin(); matchIter != m_matches.end(); ++matchIter)
+	{
+		delete matchIter->second;
+	}
+	m_matches.clear();
+
+	CloseSocket(m_listenSocket);
+}
+
+bool DedicatedServer::Start(uint16_t port)
+{
+	if (!m_eventLoop.IsValid())
+		return false;
+
+	m_listenSocket = ListenOnPort(port);
+	return m_listenSocket >= 0 && m_eventLoop.Add(m_listenSocket, SOCKET_EVENT_READ);
+}
+
+void DedicatedServer::RunOnce(int timeoutMS)
+{
+	m_eventLoop.Wait(timeoutMS, m_events);
+
+	for (const SocketEvent& event : m_events)
+	{
+		if (event.m_socket == m_listenSocket)
+		{
+			AcceptConnections();
+			continue;
+		}
+
+		//An earlier event this pass may already have closed it
+		ServerConnection* connection = FindConnection(event.m_socket);
+		if (nullptr == connection)
+			continue;
+
+		if ((event.m_events & (SOCKET_EVENT_READ | SOCKET_EVENT_CLOSED)) != 0 && !HandleMessages(connection))
+		{
+			m_socketsToClose.push_back(event.m_socket);
+			continue;
+		}
+
+		if ((event.m_events & SOCKET_EVENT_WRITE) != 0)
+			Flush(connection);
+	}
+
+	//Closing can hand a match to the AI and flush its other player, which may queue more closes
+	for (size_t closeIndex = 0; closeIndex < m_socketsToClose.size(); closeIndex++)
+	{
+		CloseConnection(m_socketsToClose[closeIndex]);
+	}
+	m_socketsToClose.clear();
+}
+
+void DedicatedServer::AcceptConnections()
+{
+	for (;;)
+	{
+		int socket = AcceptConnection(m_listenSocket);
+		if (socket < 0)
+			return;
+
+		if (!m_eventLoop.Add(socket, SOCKET_EVENT_READ))
+		{
+			CloseSocket(socket);
+			continue;
+		}
+
+		m_connections[socket] = new ServerConnection(socket);
+		m_stats.m_numConnectionsAccepted++;
+	}
+}
+
+bool DedicatedServer::HandleMessages(ServerConnection* connection)
+{
+	//Messages already buffered are still handled when the peer has hung up behind them
+	bool isOpen = connection->m_stream.Receive();
+
+	uint8_t type;
+	ByteReader payload;
+	std::vector<NetCommand> commands;
+	while (connection->m_stream.PopMessage(type, payload))
+	{
+		if (type == SERVER_MESSAGE_JOIN_MATCH)
+		{
+			uint32_t matchID = (uint32_t)payload.ReadVarint();
+			if (payload.HasOverrun() || !JoinMatch(connection, matchID))
+				return false;
+		}
+		else if (type == SERVER_MESSAGE_COMMAND)
+		{
+			uint16_t sequence;
+			if (!ReadCommandMessage(payload, sequence, commands))
+				return false;
+
+			//Commands still in flight when their match ended are harmless
+			ServerMatch* match = connection->m_match;
+			if (nullptr == match)
+				continue;
+
+			for (const NetCommand& command : commands)
+			{
+				if (match->HandleCommand(connection->m_playerIndex, sequence++, command))
+					m_stats.m_numCommandsAccepted++;
+				else
+					m_stats.m_numCommandsRejected++;
+			}
+			UpdateMatch(match);
+		}
+		else
+		{
+			return false;
+		}
+	}
+
+	return isOpen;
+}
+
+bool DedicatedServer::JoinMatch(ServerConnection* connection, uint32_t matchID)
+{
+	if (nullptr != connection->m_match)
+		return false;
+
+	ServerMatch* match = FindOrCreateMatch(matchID);
+	if (nullptr == match)
+		return false;
+
+	int playerIndex = match->AddPlayer(&connection->m_stream);
+	if (playerIndex < 0)
+		return false;
+
+	connection->m_match = match;
+	connection->m_playerIndex = playerIndex;
+	UpdateMatch(match);
+	return true;
+}
+
+ServerMatch* DedicatedServer::FindOrCreateMatch(uint32_t matchID)
+{
+	std::map<uint32_t, ServerMatch*>::iterator matchIter = m_matches.find(matchID);
+	if (matchIter != m_matches.end())
+		return matchIter->second;
+
+	uint32_t seed = m_baseSeed + matchID;
+	BattleState initialState;
+	std::string error;
+	if (!m_roster.BuildBattleState(m_setup, seed, initialState, error))
+		return nullptr;
+
+	ServerMatch* match = new ServerMatch(matchID, initialState, seed, m_maxTurns, m_spectators);
+	m_matches[matchID] = match;
+	m_stats.m_numMatchesStarted++;
+	return match;
+}
+
+void DedicatedServer::UpdateMatch(ServerMatch* match)
+{
+	for (int playerIndex = 0; playerIndex < MATCH_NUM_PLAYERS; playerIndex++)
+	{
+		MessageStream* stream = match->GetPlayerStream(playerIndex);
+		if (nullptr != stream)
+			Flush(FindConnection(stream->GetSocket()));
+	}
+
+	if (match->GetStatus() != MATCH_FINISHED)
+		return;
+
+	//Players stay connected and may join another match
+	for (int playerIndex = 0; playerIndex < MATCH_NUM_PLAYERS; playerIndex++)
+	{
+		MessageStream* stream = match->GetPlayerStream(playerIndex);
+		if (nullptr != stream)
+			FindConnection(stream->GetSocket())->m_match = nullptr;
+	}
+
+	m_stats.m_numMatchesFinished++;
+	m_stats.m_numTurns += (size_t)match->GetNumTurns();
+	m_stats.m_numCommandsRelayed += match->GetNumCommands();
+	m_matches.erase(match->GetMatchID());
+	delete match;
+}
+
+void DedicatedServer::Flush(ServerConnection* connection)
+{
+	if (!connection->m_stream.Send())
+	{
+		m_socketsToClose.push_back(connection->m_stream.GetSocket());
+		return;
+	}
+
+	//Only ask for writability while there's a backlog, or every idle connection would wake the loop
+	bool needsWrites = connection->m_stream.HasUnsent();
+	if (needsWrites != connection->m_isWatchingWrites)
+	{
+		m_eventLoop.Modify(connection->m_stream.GetSocket(), needsWrites ? (SOCKET_EVENT_READ | SOCKET_EVENT_WRITE) : SOCKET_EVENT_READ);
+		connection->m_isWatchingWrites = needsWrites;
+	}
+}
+
+void DedicatedServer::CloseConnection(int socket)
+{
+	std::map<int, ServerConnection*>::iterator connectionIter = m_connections.find(socket);
+	if (connectionIter == m_connections.end())
+		return;
+
+	ServerConnection* connection = connectionIter->second;
+	m_connections.erase(connectionIter);
+	m_eventLoop.Remove(socket);
+	m_stats.m_numConnectionsClosed++;
+	if (connection->m_stream.HasOverflowed())
+		m_stats.m_numConnectionsOverflowed++;
+
+	ServerMatch* match = connection->m_match;
+	if (nullptr != match)
+	{
+		match->RemovePlayer(connection->m_playerIndex);
+		UpdateMatch(match);
+	}
+
+	delete connection;
+}
+
+ServerConnection* DedicatedServer::FindConnection(int socket) const
+{
+	std::map<int, ServerConnection*>::const_iterator connectionIter = m_connections.find(socket);
+	if (connectionIter == m_connections.end())
+		return nullptr;
+
+	return connectionIter->second;
+}
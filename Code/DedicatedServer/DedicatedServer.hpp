@@ -0,0 +1,76 @@
+#pragma once
+#include "DedicatedServer/EventLoop.hpp"
+#include "DedicatedServer/ServerMatch.hpp"
+#include "BatchRunner/BattleRoster.hpp"
+#include <map>
+#include <vector>
+
+class SpectatorHub;
+
+
+struct ServerConnection
+{
+	explicit ServerConnection(int socket);
+
+	MessageStream m_stream;
+	ServerMatch* m_match;
+	int m_playerIndex;
+	bool m_isWatchingWrites;
+};
+
+struct ServerStats
+{
+	size_t m_numConnectionsAccepted = 0;
+	size_t m_numConnectionsClosed = 0;
+	size_t m_numConnectionsOverflowed = 0;
+	size_t m_numMatchesStarted = 0;
+	size_t m_numMatchesFinished = 0;
+	size_t m_numTurns = 0;
+	size_t m_numCommandsAccepted = 0;
+	size_t m_numCommandsRejected = 0;
+	size_t m_numCommandsRelayed = 0;
+};
+
+
+//Hosts any number of matches from one thread. Every connection goes through a single EventLoop; incoming commands
+//are routed to the ServerMatch the connection joined, and whatever that match queued is flushed right after.
+//Matches are created by the first JOIN_MATCH naming them and deleted as soon as they finish.
+class DedicatedServer
+{
+public:
+	DedicatedServer(const BattleRoster& roster, const MatchSetup& setup, uint32_t baseSeed, int maxTurns, SpectatorHub* spectators = nullptr);
+	~DedicatedServer();
+
+	bool Start(uint16_t port);
+	void RunOnce(int timeoutMS);
+
+	size_t GetNumConnections() const { return m_connections.size(); }
+	size_t GetNumMatches() const { return m_matches.size(); }
+	const ServerStats& GetStats() const { return m_stats; }
+
+private:
+	DedicatedServer(const DedicatedServer&) = delete;
+	DedicatedServer& operator=(const DedicatedServer&) = delete;
+
+	void AcceptConnections();
+	bool HandleMessages(ServerConnection* connection);
+	bool JoinMatch(ServerConnection* connection, uint32_t matchID);
+	ServerMatch* FindOrCreateMatch(uint32_t matchID);
+	void UpdateMatch(ServerMatch* match);
+	void Flush(ServerConnection* connection);
+	void CloseConnection(int socket);
+	ServerConnection* FindConnection(int socket) const;
+
+	const BattleRoster& m_roster;
+	MatchSetup m_setup;
+	uint32_t m_baseSeed;
+	int m_maxTurns;
+	SpectatorHub* m_spectators;
+	EventLoop m_eventLoop;
+	int m_listenSocket;
+	std::map<int, ServerConnection*> m_connections;
+	std::map<uint32_t, ServerMatch*> m_matches;
+	std::vector<SocketEvent> m_events;
+	std::vector<int> m_socketsToClose;
+	ServerStats m_stats;
+};
@@ -0,0 +1,154 @@
+#include "DedicatedServer/EventLoop.hpp"
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+
+
+const int MAX_EVENTS_PER_WAIT = 1024;
+
+static uint32_t ToEpollEvents(uint32_t events)
+{
+	uint32_t epollEvents = EPOLLRDHUP;
+	if ((events & SOCKET_EVENT_READ) != 0)
+		epollEvents |= EPOLLIN;
+	if ((events & SOCKET_EVENT_WRITE) != 0)
+		epollEvents |= EPOLLOUT;
+
+	return epollEvents;
+}
+
+
+EventLoop::EventLoop()
+	: m_epollDescriptor(epoll_create1(EPOLL_CLOEXEC))
+	, m_rawEvents(MAX_EVENTS_PER_WAIT)
+{
+
+}
+
+EventLoop::~EventLoop()
+{
+	if (m_epollDescriptor >= 0)
+		close(m_epollDescriptor);
+}
+
+bool EventLoop::Add(int socket, uint32_t events)
+{
+	epoll_event event = {};
+	event.events = ToEpollEvents(events);
+	event.data.fd = socket;
+	return epoll_ctl(m_epollDescriptor, EPOLL_CTL_ADD, socket, &event) == 0;
+}
+
+bool EventLoop::Modify(int socket, uint32_t events)
+{
+	epoll_event event = {};
+	event.events = ToEpollEvents(events);
+	event.data.fd = socket;
+	return epoll_ctl(m_epollDescriptor, EPOLL_CTL_MOD, socket, &event) == 0;
+}
+
+void EventLoop::Remove(int socket)
+{
+	epoll_ctl(m_epollDescriptor, EPOLL_CTL_DEL, socket, nullptr);
+}
+
+int EventLoop::Wait(int timeoutMS, std::vector<SocketEvent>& out_events)
+{
+	out_events.clear();
+
+	int numEvents = epoll_wait(m_epollDescriptor, &m_rawEvents[0], (int)m_rawEvents.size(), timeoutMS);
+	if (numEvents < 0)
+		return (errno == EINTR) ? 0 : -1;
+
+	for (int eventIndex = 0; eventIndex < numEvents; eventIndex++)
+	{
+		const epoll_event& rawEvent = m_rawEvents[eventIndex];
+
+		SocketEvent event;
+		event.m_socket = rawEvent.data.fd;
+		event.m_events = 0;
+		if ((rawEvent.events & EPOLLIN) != 0)
+			event.m_events |= SOCKET_EVENT_READ;
+		if ((rawEvent.events & EPOLLOUT) != 0)
+			event.m_events |= SOCKET_EVENT_WRITE;
+		if ((rawEvent.events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) != 0)
+			event.m_events |= SOCKET_EVENT_CLOSED;
+		out_events.push_back(event);
+	}
+
+	return numEvents;
+}
+
+
+int ListenOnPort(uint16_t port)
+{
+	int listenSocket = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (listenSocket < 0)
+		return -1;
+
+	int reuseAddress = 1;
+	setsockopt(listenSocket, SOL_SOCKET, SO_REUSEADDR, &reuseAddress, sizeof(reuseAddress));
+
+	sockaddr_in address = {};
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_ANY);
+	address.sin_port = htons(port);
+	if (bind(listenSocket, (sockaddr*)&address, sizeof(address)) != 0 || listen(listenSocket, SOMAXCONN) != 0 || !SetNonBlocking(listenSocket))
+	{
+		close(listenSocket);
+		return -1;
+	}
+
+	return listenSocket;
+}
+
+int AcceptConnection(int listenSocket)
+{
+	int connectionSocket = accept4(listenSocket, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+	if (connectionSocket < 0)
+		return -1;
+
+	//Commands are tiny and latency matters more than packet count
+	int noDelay = 1;
+	setsockopt(connectionSocket, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+	return connectionSocket;
+}
+
+int ConnectToLoopback(uint16_t port)
+{
+	int connectionSocket = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (connectionSocket < 0)
+		return -1;
+
+	sockaddr_in address = {};
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	address.sin_port = htons(port);
+
+	//Connecting before going non-blocking keeps callers from having to wait for the handshake themselves
+	if (connect(connectionSocket, (sockaddr*)&address, sizeof(address)) != 0 || !SetNonBlocking(connectionSocket))
+	{
+		close(connectionSocket);
+		return -1;
+	}
+
+	int noDelay = 1;
+	setsockopt(connectionSocket, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+	return connectionSocket;
+}
+
+bool SetNonBlocking(int socket)
+{
+	int flags = fcntl(socket, F_GETFL, 0);
+	return flags >= 0 && fcntl(socket, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+void CloseSocket(int socket)
+{
+	if (socket >= 0)
+		close(socket);
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <stdint.h>
+#include <vector>
+#include <sys/epoll.h>
+
+
+enum SocketEventFlag
+{
+	SOCKET_EVENT_READ = 1 << 0,
+	SOCKET_EVENT_WRITE = 1 << 1,
+	SOCKET_EVENT_CLOSED = 1 << 2
+};
+
+struct SocketEvent
+{
+	int m_socket;
+	uint32_t m_events;
+};
+
+
+//Readiness for any number of non-blocking sockets, waited on together from one thread. Linux only; built on epoll.
+class EventLoop
+{
+public:
+	EventLoop();
+	~EventLoop();
+
+	bool IsValid() const { return m_epollDescriptor >= 0; }
+	bool Add(int socket, uint32_t events);
+	bool Modify(int socket, uint32_t events);
+	void Remove(int socket);
+	int Wait(int timeoutMS, std::vector<SocketEvent>& out_events);
+
+private:
+	EventLoop(const EventLoop&) = delete;
+	EventLoop& operator=(const EventLoop&) = delete;
+
+	int m_epollDescriptor;
+	std::vector<epoll_event> m_rawEvents;
+};
+
+
+int ListenOnPort(uint16_t port);
+int AcceptConnection(int listenSocket);
+int ConnectToLoopback(uint16_t port);
+bool SetNonBlocking(int socket);
+void CloseSocket(int socket);
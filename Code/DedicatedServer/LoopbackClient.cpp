@@ -0,0 +1,206 @@
+#include "DedicatedServer/LoopbackClient.hpp"
+#include "DedicatedServer/LoopbackTransport.hpp"
+#include "Game/BattleSimulation.hpp"
+#include "Game/ReplayFile.hpp"
+
+
+LoopbackClient::LoopbackClient(int socket, uint32_t matchID, bool isSpectator /*= false*/)
+	: m_stream(socket)
+	, m_matchID(matchID)
+	, m_isSpectator(isSpectator)
+	, m_playerIndex(-1)
+	, m_maxTurns(0)
+	, m_simulation(nullptr)
+	, m_scratchPayload()
+	, m_commands()
+	, m_readySlot(-1)
+	, m_hasSentDecision(false)
+	, m_isMirrorFinished(false)
+	, m_nextSequence(0)
+	, m_nextRemoteSequence(0)
+	, m_isFinished(false)
+	, m_isMismatched(false)
+	, m_clock(nullptr)
+	, m_decisionSentTime(0)
+	, m_lastCommandTime(0)
+	, m_hasReceivedCommand(false)
+	, m_roundTripSamples()
+	, m_commandIntervalSamples()
+{
+
+}
+
+LoopbackClient::LoopbackClient(ByteTransport* transport, uint32_t matchID, const LinkClock* clock)
+	: m_stream(transport)
+	, m_matchID(matchID)
+	, m_isSpectator(false)
+	, m_playerIndex(-1)
+	, m_maxTurns(0)
+	, m_simulation(nullptr)
+	, m_scratchPayload()
+	, m_commands()
+	, m_readySlot(-1)
+	, m_hasSentDecision(false)
+	, m_isMirrorFinished(false)
+	, m_nextSequence(0)
+	, m_nextRemoteSequence(0)
+	, m_isFinished(false)
+	, m_isMismatched(false)
+	, m_clock(clock)
+	, m_decisionSentTime(0)
+	, m_lastCommandTime(0)
+	, m_hasReceivedCommand(false)
+	, m_roundTripSamples()
+	, m_commandIntervalSamples()
+{
+
+}
+
+LoopbackClient::~LoopbackClient()
+{
+	delete m_simulation;
+}
+
+void LoopbackClient::JoinMatch()
+{
+	m_scratchPayload.Clear();
+	m_scratchPayload.WriteVarint(m_matchID);
+	m_stream.QueueMessage(m_isSpectator ? SERVER_MESSAGE_SPECTATE_MATCH : SERVER_MESSAGE_JOIN_MATCH, m_scratchPayload);
+}
+
+bool LoopbackClient::Update()
+{
+	bool isOpen = m_stream.Receive();
+
+	uint8_t type;
+	ByteReader payload;
+	while (!m_isFinished && m_stream.PopMessage(type, payload))
+	{
+		bool isValid = false;
+		if (type == SERVER_MESSAGE_MATCH_STARTED && !m_isSpectator)
+			isValid = HandleMatchStarted(payload);
+		else if (type == SERVER_MESSAGE_SPECTATE_SNAPSHOT && m_isSpectator)
+			isValid = HandleSpectateSnapshot(payload);
+		else if (type == SERVER_MESSAGE_COMMAND)
+			isValid = HandleCommand(payload);
+		else if (type == SERVER_MESSAGE_MATCH_ENDED)
+			isValid = HandleMatchEnded(payload);
+
+		if (!isValid)
+		{
+			m_isMismatched = true;
+			m_isFinished = true;
+		}
+	}
+
+	return isOpen || m_isFinished;
+}
+
+bool LoopbackClient::HandleMatchStarted(ByteReader& payload)
+{
+	if (nullptr != m_simulation)
+		return false;
+
+	m_playerIndex = payload.ReadByte();
+	uint32_t seed = (uint32_t)payload.ReadVarint();
+	m_maxTurns = (int)payload.ReadVarint();
+
+	BattleState initialState;
+	if (payload.HasOverrun() || !ReadSetupState(payload, initialState))
+		return false;
+
+	m_simulation = new BattleSimulation(initialState, seed);
+	AdvanceToNextDecision();
+	return true;
+}
+
+bool LoopbackClient::HandleSpectateSnapshot(ByteReader& payload)
+{
+	if (nullptr != m_simulation)
+		return false;
+
+	uint32_t seed = (uint32_t)payload.ReadVarint();
+	m_maxTurns = (int)payload.ReadVarint();
+	int numTurns = (int)payload.ReadVarint();
+	m_nextRemoteSequence = payload.ReadUint16();
+
+	BattleState state;
+	if (payload.HasOverrun() || !ReadSetupState(payload, state))
+		return false;
+
+	m_simulation = new BattleSimulation(state, seed);
+	m_simulation->m_numTurns = numTurns;
+	AdvanceToNextDecision();
+	return true;
+}
+
+bool LoopbackClient::HandleCommand(ByteReader& payload)
+{
+	uint16_t sequence;
+	if (nullptr == m_simulation || !ReadCommandMessage(payload, sequence, m_commands))
+		return false;
+
+	for (const NetCommand& command : m_commands)
+	{
+		//The server relays decisions in the exact order the mirror reaches them
+		const BattleState& state = m_simulation->m_state;
+		if (sequence++ != m_nextRemoteSequence || m_readySlot < 0 || state.m_characterIndices[m_readySlot] != command.m_actingCharacterIndex)
+			return false;
+
+		m_nextRemoteSequence++;
+		RecordCommandTiming();
+		m_simulation->FinishTurn(m_readySlot, MakeBattleDecision(state, m_readySlot, command));
+		m_readySlot = -1;
+		m_hasSentDecision = false;
+		AdvanceToNextDecision();
+	}
+
+	return true;
+}
+
+bool LoopbackClient::HandleMatchEnded(ByteReader& payload)
+{
+	int winningPlayer = (int)payload.ReadByte() - 1;
+	int numTurns = (int)payload.ReadVarint();
+	m_isFinished = true;
+
+	return !payload.HasOverrun() && nullptr != m_simulation && m_isMirrorFinished
+		&& winningPlayer == m_simulation->GetWinningPlayer() && numTurns == m_simulation->m_numTurns;
+}
+
+void LoopbackClient::RecordCommandTiming()
+{
+	if (nullptr == m_clock)
+		return;
+
+	uint64_t now = m_clock->m_nowMicroseconds;
+	if (m_hasSentDecision)
+		m_roundTripSamples.push_back(now - m_decisionSentTime);
+
+	if (m_hasReceivedCommand)
+		m_commandIntervalSamples.push_back(now - m_lastCommandTime);
+
+	m_lastCommandTime = now;
+	m_hasReceivedCommand = true;
+}
+
+void LoopbackClient::AdvanceToNextDecision()
+{
+	while (m_readySlot < 0)
+	{
+		if (m_simulation->m_numTurns >= m_maxTurns || !m_simulation->StartNextTurn(m_readySlot))
+		{
+			m_isMirrorFinished = true;
+			return;
+		}
+	}
+
+	if (m_hasSentDecision || m_simulation->m_state.m_owningPlayers[m_readySlot] != m_playerIndex)
+		return;
+
+	BattleDecision decision = m_simulation->m_ai.ChooseAction(m_simulation->m_state, m_readySlot);
+	WriteCommandMessage(m_scratchPayload, m_nextSequence++, MakeNetCommand(m_simulation->m_state, m_readySlot, decision));
+	m_stream.QueueMessage(SERVER_MESSAGE_COMMAND, m_scratchPayload);
+	m_hasSentDecision = true;
+	m_decisionSentTime = (nullptr != m_clock) ? m_clock->m_nowMicroseconds : 0;
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include "DedicatedServer/ServerProtocol.hpp"
+
+class BattleSimulation;
+struct LinkClock;
+
+
+//Stand-in for a game client when load testing the server. It plays its own characters with BattleAI and keeps a
+//mirror of the battle that only ever applies commands the server relayed, then checks the server's result against it.
+//A spectating client plays nothing and builds its mirror from whatever snapshot the spectator port starts it on.
+//Given a LinkClock, a player also records how long each of its decisions took to come back from the server and how
+//long apart consecutive relayed commands arrived, in microseconds of that clock.
+class LoopbackClient
+{
+public:
+	LoopbackClient(int socket, uint32_t matchID, bool isSpectator = false);
+	LoopbackClient(ByteTransport* transport, uint32_t matchID, const LinkClock* clock);
+	~LoopbackClient();
+
+	void JoinMatch();
+	bool Update();
+
+	MessageStream& GetStream() { return m_stream; }
+	bool IsFinished() const { return m_isFinished; }
+	bool IsMismatched() const { return m_isMismatched; }
+	int GetPlayerIndex() const { return m_playerIndex; }
+	const std::vector<uint64_t>& GetRoundTripSamples() const { return m_roundTripSamples; }
+	const std::vector<uint64_t>& GetCommandIntervalSamples() const { return m_commandIntervalSamples; }
+
+private:
+	LoopbackClient(const LoopbackClient&) = delete;
+	LoopbackClient& operator=(const LoopbackClient&) = delete;
+
+	bool HandleMatchStarted(ByteReader& payload);
+	bool HandleSpectateSnapshot(ByteReader& payload);
+	bool HandleCommand(ByteReader& payload);
+	bool HandleMatchEnded(ByteReader& payload);
+	void RecordCommandTiming();
+	void AdvanceToNextDecision();
+
+	MessageStream m_stream;
+	uint32_t m_matchID;
+	bool m_isSpectator;
+	int m_playerIndex;
+	int m_maxTurns;
+	BattleSimulation* m_simulation;
+	ByteBuffer m_scratchPayload;
+	std::vector<NetCommand> m_commands;
+	int m_readySlot;
+	bool m_hasSentDecision;
+	bool m_isMirrorFinished;
+	uint16_t m_nextSequence;
+	uint16_t m_nextRemoteSequence;
+	bool m_isFinished;
+	bool m_isMismatched;
+	const LinkClock* m_clock;
+	uint64_t m_decisionSentTime;
+	uint64_t m_lastCommandTime;
+	bool m_hasReceivedCommand;
+	std::vector<uint64_t> m_roundTripSamples;
+	std::vector<uint64_t> m_commandIntervalSamples;
+};
@@ -0,0 +1,156 @@
+#include "DedicatedServer/LoopbackTransport.hpp"
+#include <string.h>
+#include <algorithm>
+
+
+class LoopbackEnd : public ByteTransport
+{
+public:
+	LoopbackEnd(LoopbackLink& link, int side)
+		: m_link(link)
+		, m_side(side)
+	{
+
+	}
+
+	virtual ~LoopbackEnd() { m_link.CloseEnd(m_side); }
+
+	virtual int Receive(uint8_t* out_bytes, size_t maxBytes) override { return m_link.Receive(m_side, out_bytes, maxBytes); }
+	virtual int Send(const uint8_t* bytes, size_t numBytes) override { return m_link.Send(m_side, bytes, numBytes); }
+
+private:
+	LoopbackEnd(const LoopbackEnd&) = delete;
+	LoopbackEnd& operator=(const LoopbackEnd&) = delete;
+
+	LoopbackLink& m_link;
+	int m_side;
+};
+
+
+LoopbackLink::LoopbackLink(const LinkClock& clock, const LinkSettings& settings, uint32_t seed)
+	: m_clock(clock)
+	, m_settings(settings)
+	, m_randomState((seed != 0) ? seed : 1)
+	, m_directions()
+	, m_numSegmentsSent(0)
+	, m_numSegmentsLost(0)
+{
+	//Every segment lost would never arrive
+	m_settings.m_lossPercent = std::min(std::max(m_settings.m_lossPercent, 0.0), 99.0);
+}
+
+ByteTransport* LoopbackLink::CreateEnd(int side)
+{
+	return new LoopbackEnd(*this, side);
+}
+
+uint64_t LoopbackLink::GetNextDeliveryTime() const
+{
+	uint64_t nextDeliveryTime = LOOPBACK_NEVER;
+	for (int side = 0; side < 2; side++)
+	{
+		const LinkDirection& direction = m_directions[side];
+		if (!direction.m_segments.empty())
+			nextDeliveryTime = std::min(nextDeliveryTime, direction.m_segments.front().m_deliveryTime);
+	}
+
+	return nextDeliveryTime;
+}
+
+int LoopbackLink::Send(int side, const uint8_t* bytes, size_t numBytes)
+{
+	LinkDirection& direction = m_directions[side];
+	if (direction.m_isReceiverClosed)
+		return -1;
+
+	size_t numSent = 0;
+	while (numSent < numBytes && direction.m_numBytesInFlight < LOOPBACK_SEND_WINDOW_BYTES)
+	{
+		size_t segmentSize = std::min(numBytes - numSent, LOOPBACK_SEGMENT_BYTES);
+		segmentSize = std::min(segmentSize, LOOPBACK_SEND_WINDOW_BYTES - direction.m_numBytesInFlight);
+
+		LinkSegment segment;
+		segment.m_deliveryTime = CalculateDeliveryTime(direction, segmentSize);
+		segment.m_bytes.assign(bytes + numSent, bytes + numSent + segmentSize);
+		segment.m_readOffset = 0;
+		direction.m_segments.push_back(segment);
+
+		direction.m_numBytesInFlight += segmentSize;
+		numSent += segmentSize;
+		m_numSegmentsSent++;
+	}
+
+	return (int)numSent;
+}
+
+int LoopbackLink::Receive(int side, uint8_t* out_bytes, size_t maxBytes)
+{
+	LinkDirection& direction = m_directions[1 - side];
+
+	size_t numReceived = 0;
+	while (numReceived < maxBytes && !direction.m_segments.empty() && direction.m_segments.front().m_deliveryTime <= m_clock.m_nowMicroseconds)
+	{
+		LinkSegment& segment = direction.m_segments.front();
+		size_t numToCopy = std::min(maxBytes - numReceived, segment.m_bytes.size() - segment.m_readOffset);
+		memcpy(out_bytes + numReceived, &segment.m_bytes[segment.m_readOffset], numToCopy);
+		segment.m_readOffset += numToCopy;
+		numReceived += numToCopy;
+
+		if (segment.m_readOffset == segment.m_bytes.size())
+		{
+			direction.m_numBytesInFlight -= segment.m_bytes.size();
+			direction.m_segments.pop_front();
+		}
+	}
+
+	if (numReceived == 0 && direction.m_isSenderClosed && direction.m_segments.empty())
+		return -1;
+
+	return (int)numReceived;
+}
+
+void LoopbackLink::CloseEnd(int side)
+{
+	//What was already sent still arrives; what was headed for this end has nowhere to go
+	m_directions[side].m_isSenderClosed = true;
+
+	LinkDirection& incoming = m_directions[1 - side];
+	incoming.m_isReceiverClosed = true;
+	incoming.m_segments.clear();
+	incoming.m_numBytesInFlight = 0;
+}
+
+uint64_t LoopbackLink::CalculateDeliveryTime(LinkDirection& direction, size_t numBytes)
+{
+	//Segments leave one after another at the link's bandwidth
+	uint64_t departureTime = std::max(m_clock.m_nowMicroseconds, direction.m_nextFreeTime);
+	if (m_settings.m_bandwidthBytesPerSecond > 0.0)
+		departureTime += (uint64_t)(numBytes * 1000000.0 / m_settings.m_bandwidthBytesPerSecond);
+	direction.m_nextFreeTime = departureTime;
+
+	uint64_t latency = (uint64_t)(m_settings.m_latencyMS * 1000.0);
+	uint64_t jitter = (uint64_t)(m_settings.m_jitterMS * 1000.0);
+	uint64_t deliveryTime = departureTime + latency;
+	if (jitter > 0)
+		deliveryTime += RollRandom() % (jitter + 1);
+
+	uint64_t retransmitTimeout = std::max(LOOPBACK_MIN_RETRANSMIT_MICROSECONDS, 2 * (latency + jitter));
+	while (m_settings.m_lossPercent > 0.0 && (RollRandom() % 10000) < (uint32_t)(m_settings.m_lossPercent * 100.0))
+	{
+		deliveryTime += retransmitTimeout;
+		m_numSegmentsLost++;
+	}
+
+	//A segment held up by jitter or loss holds up everything behind it, as it would in TCP
+	deliveryTime = std::max(deliveryTime, direction.m_lastDeliveryTime);
+	direction.m_lastDeliveryTime = deliveryTime;
+	return deliveryTime;
+}
+
+uint32_t LoopbackLink::RollRandom()
+{
+	m_randomState ^= m_randomState << 13;
+	m_randomState ^= m_randomState >> 17;
+	m_randomState ^= m_randomState << 5;
+	return m_randomState;
+}
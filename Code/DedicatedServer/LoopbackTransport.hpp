@@ -0,0 +1,81 @@
+#pragma once
+#include "DedicatedServer/ByteTransport.hpp"
+#include <deque>
+#include <vector>
+
+
+const size_t LOOPBACK_SEGMENT_BYTES = 1400;
+const size_t LOOPBACK_SEND_WINDOW_BYTES = 64 * 1024;
+const uint64_t LOOPBACK_MIN_RETRANSMIT_MICROSECONDS = 200000;
+const uint64_t LOOPBACK_NEVER = ~(uint64_t)0;
+
+
+//Virtual time for loopback links. Nothing advances it but whoever is driving the links, so a run with the same
+//settings and seeds always delivers the same bytes at the same moments regardless of how fast the machine is.
+struct LinkClock
+{
+	uint64_t m_nowMicroseconds = 0;
+};
+
+//Each direction of a link gets these separately. Jitter adds 0 to jitterMS on top of the latency; bandwidth 0 is
+//unlimited. The stream stays reliable, so a lost segment costs a retransmission timeout instead of its bytes.
+struct LinkSettings
+{
+	double m_latencyMS = 0.0;
+	double m_jitterMS = 0.0;
+	double m_bandwidthBytesPerSecond = 0.0;
+	double m_lossPercent = 0.0;
+};
+
+
+//An in-process stand-in for a TCP connection between two MessageStreams. Sent bytes are cut into segments that
+//queue behind the link's bandwidth, then arrive after latency, jitter and any retransmissions, never out of order.
+//A sender only gets LOOPBACK_SEND_WINDOW_BYTES ahead of its reader, so a slow link pushes back like a full socket.
+//Both ends come from CreateEnd and must be destroyed before the link; destroying one closes it like a hang-up.
+class LoopbackLink
+{
+public:
+	LoopbackLink(const LinkClock& clock, const LinkSettings& settings, uint32_t seed);
+
+	ByteTransport* CreateEnd(int side);
+	uint64_t GetNextDeliveryTime() const;
+	size_t GetNumSegmentsSent() const { return m_numSegmentsSent; }
+	size_t GetNumSegmentsLost() const { return m_numSegmentsLost; }
+
+private:
+	friend class LoopbackEnd;
+
+	struct LinkSegment
+	{
+		uint64_t m_deliveryTime;
+		std::vector<uint8_t> m_bytes;
+		size_t m_readOffset;
+	};
+
+	//Indexed by the side that sends into it
+	struct LinkDirection
+	{
+		std::deque<LinkSegment> m_segments;
+		size_t m_numBytesInFlight = 0;
+		uint64_t m_nextFreeTime = 0;
+		uint64_t m_lastDeliveryTime = 0;
+		bool m_isSenderClosed = false;
+		bool m_isReceiverClosed = false;
+	};
+
+	LoopbackLink(const LoopbackLink&) = delete;
+	LoopbackLink& operator=(const LoopbackLink&) = delete;
+
+	int Send(int side, const uint8_t* bytes, size_t numBytes);
+	int Receive(int side, uint8_t* out_bytes, size_t maxBytes);
+	void CloseEnd(int side);
+	uint64_t CalculateDeliveryTime(LinkDirection& direction, size_t numBytes);
+	uint32_t RollRandom();
+
+	const LinkClock& m_clock;
+	LinkSettings m_settings;
+	uint32_t m_randomState;
+	LinkDirection m_directions[2];
+	size_t m_numSegmentsSent;
+	size_t m_numSegmentsLost;
+};
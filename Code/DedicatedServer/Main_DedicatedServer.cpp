@@ -0,0 +1,348 @@
+#include "DedicatedServer/DedicatedServer.hpp"
+#include "DedicatedServer/LoopbackClient.hpp"
+#include "DedicatedServer/SpectatorHub.hpp"
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+
+const int LOAD_TEST_STALL_SECONDS = 30;
+
+
+struct ServerOptions
+{
+	std::string m_dataFolder = "Run_Win32/Data/Gameplay";
+	uint16_t m_port = 54322;
+	uint16_t m_spectatorPort = 54323;
+	int m_numLoadTestMatches = 0;
+	int m_numSpectatorsPerMatch = 0;
+	uint32_t m_baseSeed = 1;
+	int m_maxTurns = 1000;
+	MatchSetup m_setup;
+};
+
+struct LoadTestResult
+{
+	int m_numClients = 0;
+	int m_numSpectators = 0;
+	int m_numFinished = 0;
+	int m_numMismatched = 0;
+	int m_numFailed = 0;
+};
+
+
+std::vector<std::string> SplitCommaSeparated(const std::string& text)
+{
+	std::vector<std::string> pieces;
+	size_t start = 0;
+	while (start <= text.size())
+	{
+		size_t comma = text.find(',', start);
+		if (comma == std::string::npos)
+			comma = text.size();
+
+		if (comma > start)
+			pieces.push_back(text.substr(start, comma - start));
+
+		start = comma + 1;
+	}
+
+	return pieces;
+}
+
+void PrintUsage()
+{
+	printf("Usage: TacticsServer [options]\n");
+	printf("  --data <folder>      Folder holding Characters.xml and Abilities.xml (default Run_Win32/Data/Gameplay)\n");
+	printf("  --port <port>        TCP port to listen on (default 54322)\n");
+	printf("  --spectator-port <port>  TCP port spectators connect to (default 54323)\n");
+	printf("  --matches <count>    Load test: play this many matches with two loopback clients each, then exit\n");
+	printf("  --spectators <count> Load test: also have this many loopback spectators join each match once it's under way\n");
+	printf("  --seed <seed>        Match N is seeded with seed + N (default 1)\n");
+	printf("  --max-turns <count>  Turns before a match is called a draw (default 1000)\n");
+	printf("  --map <W>x<H>        Map size (default 20x20)\n");
+	printf("  --team1 <a,b,...>    Character names for player 0 (default: the whole roster)\n");
+	printf("  --team2 <a,b,...>    Character names for player 1 (default: the whole roster)\n");
+}
+
+bool ParseOptions(int argc, char** argv, ServerOptions& out_options)
+{
+	for (int argIndex = 1; argIndex < argc; argIndex++)
+	{
+		std::string option = argv[argIndex];
+		if (option == "--help" || option == "-h")
+			return false;
+
+		if (argIndex + 1 >= argc)
+		{
+			printf("Missing value for %s\n", option.c_str());
+			return false;
+		}
+
+		std::string value = argv[++argIndex];
+		if (option == "--data")
+			out_options.m_dataFolder = value;
+		else if (option == "--port")
+			out_options.m_port = (uint16_t)atoi(value.c_str());
+		else if (option == "--spectator-port")
+			out_options.m_spectatorPort = (uint16_t)atoi(value.c_str());
+		else if (option == "--matches")
+			out_options.m_numLoadTestMatches = atoi(value.c_str());
+		else if (option == "--spectators")
+			out_options.m_numSpectatorsPerMatch = atoi(value.c_str());
+		else if (option == "--seed")
+			out_options.m_baseSeed = (uint32_t)strtoul(value.c_str(), nullptr, 10);
+		else if (option == "--max-turns")
+			out_options.m_maxTurns = atoi(value.c_str());
+		else if (option == "--map")
+		{
+			if (sscanf(value.c_str(), "%dx%d", &out_options.m_setup.m_mapWidth, &out_options.m_setup.m_mapHeight) != 2)
+			{
+				printf("Map size must look like 20x20\n");
+				return false;
+			}
+		}
+		else if (option == "--team1")
+			out_options.m_setup.m_teams[0] = SplitCommaSeparated(value);
+		else if (option == "--team2")
+			out_options.m_setup.m_teams[1] = SplitCommaSeparated(value);
+		else
+		{
+			printf("Unknown option %s\n", option.c_str());
+			return false;
+		}
+	}
+
+	return out_options.m_numLoadTestMatches >= 0 && out_options.m_numSpectatorsPerMatch >= 0 && out_options.m_maxTurns > 0;
+}
+
+void RaiseOpenFileLimit(size_t numSocketsNeeded)
+{
+	rlimit limit;
+	if (getrlimit(RLIMIT_NOFILE, &limit) != 0)
+		return;
+
+	limit.rlim_cur = limit.rlim_max;
+	setrlimit(RLIMIT_NOFILE, &limit);
+	getrlimit(RLIMIT_NOFILE, &limit);
+
+	if (numSocketsNeeded > (size_t)limit.rlim_cur)
+		printf("Warning: %zu sockets needed but only %zu files may be open; raise ulimit -n\n", numSocketsNeeded, (size_t)limit.rlim_cur);
+}
+
+void Flush(EventLoop& eventLoop, LoopbackClient* client, bool& out_failed)
+{
+	if (!client->GetStream().Send())
+	{
+		out_failed = true;
+		return;
+	}
+
+	uint32_t events = client->GetStream().HasUnsent() ? (SOCKET_EVENT_READ | SOCKET_EVENT_WRITE) : SOCKET_EVENT_READ;
+	eventLoop.Modify(client->GetStream().GetSocket(), events);
+}
+
+//Adds one loopback client to the load test, counting it as failed when it can't connect
+void ConnectLoopbackClient(EventLoop& eventLoop, uint16_t port, uint32_t matchID, bool isSpectator, std::map<int, LoopbackClient*>& clients, LoadTestResult& out_result)
+{
+	out_result.m_numClients++;
+
+	int socket = ConnectToLoopback(port);
+	if (socket < 0 || !eventLoop.Add(socket, SOCKET_EVENT_READ))
+	{
+		CloseSocket(socket);
+		out_result.m_numFailed++;
+		return;
+	}
+
+	LoopbackClient* client = new LoopbackClient(socket, matchID, isSpectator);
+	client->JoinMatch();
+	clients[socket] = client;
+
+	bool failed = false;
+	Flush(eventLoop, client, failed);
+}
+
+//Two clients per match, all sharing one EventLoop on their own thread, the way a load generator machine would.
+//Spectators connect only once every player has, so most of them join matches already under way.
+void RunLoopbackClients(const ServerOptions& options, LoadTestResult& out_result)
+{
+	EventLoop eventLoop;
+	std::map<int, LoopbackClient*> clients;
+	for (int matchIndex = 0; matchIndex < options.m_numLoadTestMatches; matchIndex++)
+	{
+		for (int playerIndex = 0; playerIndex < MATCH_NUM_PLAYERS; playerIndex++)
+		{
+			ConnectLoopbackClient(eventLoop, options.m_port, (uint32_t)matchIndex, false, clients, out_result);
+		}
+	}
+
+	for (int matchIndex = 0; matchIndex < options.m_numLoadTestMatches; matchIndex++)
+	{
+		for (int spectatorIndex = 0; spectatorIndex < options.m_numSpectatorsPerMatch; spectatorIndex++)
+		{
+			ConnectLoopbackClient(eventLoop, options.m_spectatorPort, (uint32_t)matchIndex, true, clients, out_result);
+			out_result.m_numSpectators++;
+		}
+	}
+
+	std::vector<SocketEvent> events;
+	std::chrono::steady_clock::time_point lastProgressTime = std::chrono::steady_clock::now();
+	while (!clients.empty())
+	{
+		eventLoop.Wait(100, events);
+		if (!events.empty())
+			lastProgressTime = std::chrono::steady_clock::now();
+		else if (std::chrono::steady_clock::now() - lastProgressTime > std::chrono::seconds(LOAD_TEST_STALL_SECONDS))
+			break;
+
+		for (const SocketEvent& event : events)
+		{
+			std::map<int, LoopbackClient*>::iterator clientIter = clients.find(event.m_socket);
+			if (clientIter == clients.end())
+				continue;
+
+			LoopbackClient* client = clientIter->second;
+			bool failed = !client->Update();
+			if (!failed && !client->IsFinished())
+				Flush(eventLoop, client, failed);
+
+			if (!failed && !client->IsFinished())
+				continue;
+
+			if (failed)
+				out_result.m_numFailed++;
+			else if (client->IsMismatched())
+				out_result.m_numMismatched++;
+			else
+				out_result.m_numFinished++;
+
+			eventLoop.Remove(event.m_socket);
+			clients.erase(clientIter);
+			delete client;
+		}
+	}
+
+	//Anything left stalled
+	for (std::map<int, LoopbackClient*>::iterator clientIter = clients.begin(); clientIter != clients.end(); ++clientIter)
+	{
+		out_result.m_numFailed++;
+		delete clientIter->second;
+	}
+}
+
+void PrintServerStats(const DedicatedServer& server, const SpectatorHub& spectators, double elapsedSeconds)
+{
+	const ServerStats& stats = server.GetStats();
+	if (elapsedSeconds <= 0.0)
+		elapsedSeconds = 1e-9;
+
+	printf("%.1f s: %zu connections, %zu matches running, %zu finished\n", elapsedSeconds, server.GetNumConnections(), server.GetNumMatches(), stats.m_numMatchesFinished);
+	if (stats.m_numConnectionsOverflowed > 0)
+		printf("  %zu connections dropped for sending or leaving unread too much\n", stats.m_numConnectionsOverflowed);
+	printf("  %.1f matches/s, %.1f turns/s, %.1f commands/s relayed (%zu accepted from players, %zu rejected)\n",
+		stats.m_numMatchesFinished / elapsedSeconds, stats.m_numTurns / elapsedSeconds, stats.m_numCommandsRelayed / elapsedSeconds,
+		stats.m_numCommandsAccepted, stats.m_numCommandsRejected);
+
+	const SpectatorStats& spectatorStats = spectators.GetStats();
+	printf("  %zu spectators served of %zu accepted, %zu bytes published, %zu bytes fanned out\n",
+		(size_t)spectatorStats.m_numSpectatorsServed, (size_t)spectatorStats.m_numSpectatorsAccepted, (size_t)spectatorStats.m_numBytesPublished, (size_t)spectatorStats.m_numBytesSent);
+}
+
+
+int main(int argc, char** argv)
+{
+	ServerOptions options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	BattleRoster roster;
+	std::string error;
+	if (!roster.LoadFromDataFolder(options.m_dataFolder, error))
+	{
+		printf("Failed to load roster: %s\n", error.c_str());
+		return 1;
+	}
+
+	for (int teamIndex = 0; teamIndex < 2; teamIndex++)
+	{
+		if (!options.m_setup.m_teams[teamIndex].empty())
+			continue;
+
+		for (const RosterCharacter& character : roster.m_characters)
+		{
+			options.m_setup.m_teams[teamIndex].push_back(character.m_name);
+		}
+	}
+
+	BattleState validationState;
+	if (!roster.BuildBattleState(options.m_setup, options.m_baseSeed, validationState, error))
+	{
+		printf("Invalid match setup: %s\n", error.c_str());
+		return 1;
+	}
+
+	//A load test holds both ends of every connection in this process
+	RaiseOpenFileLimit((size_t)options.m_numLoadTestMatches * (MATCH_NUM_PLAYERS + options.m_numSpectatorsPerMatch) * 2 + 16);
+
+	SpectatorHub spectators;
+	if (!spectators.Start(options.m_spectatorPort))
+	{
+		printf("Failed to listen for spectators on port %u\n", (unsigned int)options.m_spectatorPort);
+		return 1;
+	}
+
+	DedicatedServer server(roster, options.m_setup, options.m_baseSeed, options.m_maxTurns, &spectators);
+	if (!server.Start(options.m_port))
+	{
+		printf("Failed to listen on port %u\n", (unsigned int)options.m_port);
+		return 1;
+	}
+
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+	if (options.m_numLoadTestMatches == 0)
+	{
+		printf("Listening on port %u, spectators on port %u\n", (unsigned int)options.m_port, (unsigned int)options.m_spectatorPort);
+
+		std::chrono::steady_clock::time_point lastReportTime = startTime;
+		for (;;)
+		{
+			server.RunOnce(100);
+
+			std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+			if (now - lastReportTime >= std::chrono::seconds(10))
+			{
+				PrintServerStats(server, spectators, std::chrono::duration<double>(now - startTime).count());
+				lastReportTime = now;
+			}
+		}
+	}
+
+	LoadTestResult result;
+	std::atomic<bool> areClientsDone(false);
+	std::thread clientThread([&]()
+	{
+		RunLoopbackClients(options, result);
+		areClientsDone = true;
+	});
+
+	while (!areClientsDone)
+	{
+		server.RunOnce(10);
+	}
+	clientThread.join();
+
+	//Let the server notice the last disconnects so its counters are complete
+	server.RunOnce(10);
+
+	PrintServerStats(server, spectators, std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count());
+	printf("Loopback clients: %d of %d (%d of them spectators) agreed with the server, %d mismatched, %d failed\n",
+		result.m_numFinished, result.m_numClients, result.m_numSpectators, result.m_numMismatched, result.m_numFailed);
+	return (result.m_numFinished == result.m_numClients) ? 0 : 1;
+}
@@ -0,0 +1,177 @@
+#include "DedicatedServer/ServerMatch.hpp"
+#include "DedicatedServer/SpectatorHub.hpp"
+#include "Game/ReplayFile.hpp"
+
+
+ServerMatch::ServerMatch(uint32_t matchID, const BattleState& initialState, uint32_t seed, int maxTurns, SpectatorHub* spectators /*= nullptr*/)
+	: m_matchID(matchID)
+	, m_seed(seed)
+	, m_maxTurns(maxTurns)
+	, m_status(MATCH_WAITING_FOR_PLAYERS)
+	, m_simulation(initialState, seed)
+	, m_setupPayload()
+	, m_scratchPayload()
+	, m_spectators(spectators)
+	, m_nextSequence(0)
+	, m_readySlot(-1)
+	, m_numCommands(0)
+{
+	WriteSetupState(m_setupPayload, initialState);
+
+	for (int playerIndex = 0; playerIndex < MATCH_NUM_PLAYERS; playerIndex++)
+	{
+		m_players[playerIndex] = nullptr;
+		m_nextRemoteSequences[playerIndex] = 0;
+	}
+}
+
+int ServerMatch::AddPlayer(MessageStream* stream)
+{
+	if (m_status != MATCH_WAITING_FOR_PLAYERS)
+		return -1;
+
+	for (int playerIndex = 0; playerIndex < MATCH_NUM_PLAYERS; playerIndex++)
+	{
+		if (nullptr != m_players[playerIndex])
+			continue;
+
+		m_players[playerIndex] = stream;
+		if (GetNumPlayers() == MATCH_NUM_PLAYERS)
+			Start();
+
+		return playerIndex;
+	}
+
+	return -1;
+}
+
+void ServerMatch::RemovePlayer(int playerIndex)
+{
+	m_players[playerIndex] = nullptr;
+
+	//Whoever is left shouldn't be kept waiting on a player who isn't coming back
+	if (m_status == MATCH_RUNNING)
+		AdvanceToNextDecision();
+}
+
+bool ServerMatch::HandleCommand(int playerIndex, uint16_t sequence, const NetCommand& command)
+{
+	if (sequence != m_nextRemoteSequences[playerIndex])
+		return false;
+	m_nextRemoteSequences[playerIndex]++;
+
+	//Only the decision the match is waiting for counts; anything else is a client out of step
+	if (m_status != MATCH_RUNNING || m_readySlot < 0)
+		return false;
+
+	const BattleState& state = m_simulation.m_state;
+	if (state.m_owningPlayers[m_readySlot] != playerIndex || state.m_characterIndices[m_readySlot] != command.m_actingCharacterIndex)
+		return false;
+
+	ApplyAndRelay(m_readySlot, MakeBattleDecision(state, m_readySlot, command));
+	AdvanceToNextDecision();
+	return true;
+}
+
+int ServerMatch::GetNumPlayers() const
+{
+	int numPlayers = 0;
+	for (int playerIndex = 0; playerIndex < MATCH_NUM_PLAYERS; playerIndex++)
+	{
+		if (nullptr != m_players[playerIndex])
+			numPlayers++;
+	}
+
+	return numPlayers;
+}
+
+void ServerMatch::Start()
+{
+	m_status = MATCH_RUNNING;
+
+	for (int playerIndex = 0; playerIndex < MATCH_NUM_PLAYERS; playerIndex++)
+	{
+		m_scratchPayload.Clear();
+		m_scratchPayload.WriteByte((uint8_t)playerIndex);
+		m_scratchPayload.WriteVarint(m_seed);
+		m_scratchPayload.WriteVarint((uint64_t)m_maxTurns);
+		m_scratchPayload.WriteBytes(m_setupPayload.GetData(), m_setupPayload.GetSize());
+		m_players[playerIndex]->QueueMessage(SERVER_MESSAGE_MATCH_STARTED, m_scratchPayload);
+	}
+
+	PublishSnapshot();
+	AdvanceToNextDecision();
+}
+
+void ServerMatch::AdvanceToNextDecision()
+{
+	while (m_status == MATCH_RUNNING)
+	{
+		if (m_readySlot < 0)
+		{
+			if (m_simulation.m_numTurns >= m_maxTurns || !m_simulation.StartNextTurn(m_readySlot))
+				Finish();
+
+			continue;
+		}
+
+		int owningPlayer = m_simulation.m_state.m_owningPlayers[m_readySlot];
+		if (owningPlayer < MATCH_NUM_PLAYERS && nullptr != m_players[owningPlayer])
+			return;
+
+		ApplyAndRelay(m_readySlot, m_simulation.m_ai.ChooseAction(m_simulation.m_state, m_readySlot));
+	}
+}
+
+void ServerMatch::ApplyAndRelay(int slot, const BattleDecision& decision)
+{
+	//Clients rebuild the decision from the command, so the server has to apply that same rebuilt decision
+	NetCommand command = MakeNetCommand(m_simulation.m_state, slot, decision);
+	WriteCommandMessage(m_scratchPayload, m_nextSequence, command);
+	Broadcast(SERVER_MESSAGE_COMMAND, m_scratchPayload);
+	m_nextSequence++;
+	m_numCommands++;
+
+	m_simulation.FinishTurn(slot, MakeBattleDecision(m_simulation.m_state, slot, command));
+	m_readySlot = -1;
+
+	if (m_numCommands % SPECTATOR_SNAPSHOT_INTERVAL == 0)
+		PublishSnapshot();
+}
+
+void ServerMatch::Finish()
+{
+	m_status = MATCH_FINISHED;
+
+	m_scratchPayload.Clear();
+	m_scratchPayload.WriteByte((uint8_t)(m_simulation.GetWinningPlayer() + 1));
+	m_scratchPayload.WriteVarint((uint64_t)m_simulation.m_numTurns);
+	Broadcast(SERVER_MESSAGE_MATCH_ENDED, m_scratchPayload);
+}
+
+void ServerMatch::PublishSnapshot()
+{
+	if (nullptr == m_spectators)
+		return;
+
+	//Taken between turns, so a spectator resumes exactly where the next relayed command applies
+	m_scratchPayload.Clear();
+	m_scratchPayload.WriteVarint(m_seed);
+	m_scratchPayload.WriteVarint((uint64_t)m_maxTurns);
+	m_scratchPayload.WriteVarint((uint64_t)m_simulation.m_numTurns);
+	m_scratchPayload.WriteUint16(m_nextSequence);
+	WriteSetupState(m_scratchPayload, m_simulation.m_state);
+	m_spectators->PublishSnapshot(m_matchID, m_scratchPayload);
+}
+
+void ServerMatch::Broadcast(ServerMessageType type, const ByteBuffer& payload)
+{
+	if (nullptr != m_spectators)
+		m_spectators->PublishMessage(m_matchID, type, payload);
+
+	for (int playerIndex = 0; playerIndex < MATCH_NUM_PLAYERS; playerIndex++)
+	{
+		if (nullptr != m_players[playerIndex])
+			m_players[playerIndex]->QueueMessage((uint8_t)type, payload);
+	}
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include "DedicatedServer/ServerProtocol.hpp"
+#include "Game/BattleSimulation.hpp"
+
+class SpectatorHub;
+
+
+const size_t SPECTATOR_SNAPSHOT_INTERVAL = 64;
+
+enum MatchStatus
+{
+	MATCH_WAITING_FOR_PLAYERS,
+	MATCH_RUNNING,
+	MATCH_FINISHED,
+	NUM_MATCH_STATUSES
+};
+
+
+//One battle on the dedicated server. The server's BattleSimulation is the authority: each player decides for the
+//characters it owns, and a decision only counts once this match has applied it and relayed it to everyone.
+//Characters whose player has left are played by the server's BattleAI. With a SpectatorHub, everything the players
+//are sent is published to it too, along with a snapshot every SPECTATOR_SNAPSHOT_INTERVAL commands for late joiners.
+class ServerMatch
+{
+public:
+	ServerMatch(uint32_t matchID, const BattleState& initialState, uint32_t seed, int maxTurns, SpectatorHub* spectators = nullptr);
+
+	int AddPlayer(MessageStream* stream);
+	void RemovePlayer(int playerIndex);
+	bool HandleCommand(int playerIndex, uint16_t sequence, const NetCommand& command);
+
+	uint32_t GetMatchID() const { return m_matchID; }
+	MatchStatus GetStatus() const { return m_status; }
+	MessageStream* GetPlayerStream(int playerIndex) const { return m_players[playerIndex]; }
+	int GetNumPlayers() const;
+	int GetNumTurns() const { return m_simulation.m_numTurns; }
+	int GetWinningPlayer() const { return m_simulation.GetWinningPlayer(); }
+	size_t GetNumCommands() const { return m_numCommands; }
+
+private:
+	void Start();
+	void AdvanceToNextDecision();
+	void ApplyAndRelay(int slot, const BattleDecision& decision);
+	void Finish();
+	void PublishSnapshot();
+	void Broadcast(ServerMessageType type, const ByteBuffer& payload);
+
+	uint32_t m_matchID;
+	uint32_t m_seed;
+	int m_maxTurns;
+	MatchStatus m_status;
+	BattleSimulation m_simulation;
+	ByteBuffer m_setupPayload;
+	ByteBuffer m_scratchPayload;
+	SpectatorHub* m_spectators;
+	MessageStream* m_players[MATCH_NUM_PLAYERS];
+	uint16_t m_nextRemoteSequences[MATCH_NUM_PLAYERS];
+	uint16_t m_nextSequence;
+	int m_readySlot;
+	size_t m_numCommands;
+};
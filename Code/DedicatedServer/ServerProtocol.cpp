@@ -0,0 +1,189 @@
+#include "DedicatedServer/ServerProtocol.hpp"
+#include "DedicatedServer/ByteTransport.hpp"
+#include "Game/BattleReplay.hpp"
+#include <string.h>
+
+
+const size_t RECEIVE_CHUNK_BYTES = 4096;
+
+
+MessageStream::MessageStream(int socket)
+	: MessageStream(new SocketTransport(socket))
+{
+
+}
+
+MessageStream::MessageStream(ByteTransport* transport)
+	: m_transport(transport)
+	, m_received()
+	, m_readOffset(0)
+	, m_unsent()
+	, m_sendOffset(0)
+	, m_numBytesReceived(0)
+	, m_numBytesSent(0)
+	, m_hasOverflowed(false)
+{
+
+}
+
+MessageStream::~MessageStream()
+{
+	delete m_transport;
+}
+
+int MessageStream::GetSocket() const
+{
+	return m_transport->GetSocket();
+}
+
+bool MessageStream::Receive()
+{
+	//Messages handed out by PopMessage point into m_received, so consumed bytes are only dropped here
+	if (m_readOffset > 0)
+	{
+		m_received.erase(m_received.begin(), m_received.begin() + m_readOffset);
+		m_readOffset = 0;
+	}
+
+	//Whatever is left after the slice is still readable, so the EventLoop comes straight back for it
+	size_t numBytesThisCall = 0;
+	while (numBytesThisCall < MAX_RECEIVE_BYTES_PER_CALL)
+	{
+		if (m_received.size() > MAX_BUFFERED_RECEIVE_BYTES)
+			m_hasOverflowed = true;
+		if (m_hasOverflowed)
+			return false;
+
+		size_t oldSize = m_received.size();
+		m_received.resize(oldSize + RECEIVE_CHUNK_BYTES);
+		int numBytes = m_transport->Receive(&m_received[oldSize], RECEIVE_CHUNK_BYTES);
+		m_received.resize(oldSize + ((numBytes > 0) ? (size_t)numBytes : 0));
+
+		if (numBytes <= 0)
+			return numBytes == 0;
+
+		m_numBytesReceived += (size_t)numBytes;
+		numBytesThisCall += (size_t)numBytes;
+	}
+
+	return true;
+}
+
+bool MessageStream::PopMessage(uint8_t& out_type, ByteReader& out_payload)
+{
+	size_t numBuffered = m_received.size() - m_readOffset;
+	if (numBuffered < 3)
+		return false;
+
+	const uint8_t* frame = &m_received[m_readOffset];
+	size_t frameSize = (size_t)frame[0] | ((size_t)frame[1] << 8);
+	if (frameSize == 0 || numBuffered < 2 + frameSize)
+		return false;
+
+	out_type = frame[2];
+	out_payload = ByteReader(frame + 3, frameSize - 1);
+	m_readOffset += 2 + frameSize;
+	return true;
+}
+
+void MessageStream::QueueMessage(uint8_t type, const ByteBuffer& payload)
+{
+	if (m_hasOverflowed)
+		return;
+
+	if (m_sendOffset == m_unsent.size())
+	{
+		m_unsent.clear();
+		m_sendOffset = 0;
+	}
+
+	//A peer that stopped reading would otherwise have everything its match sends kept for it
+	if (m_unsent.size() - m_sendOffset + 3 + payload.GetSize() > MAX_UNSENT_BYTES)
+	{
+		m_hasOverflowed = true;
+		return;
+	}
+
+	AppendMessageFrame(m_unsent, type, payload);
+}
+
+bool MessageStream::Send()
+{
+	if (m_hasOverflowed)
+		return false;
+
+	while (m_sendOffset < m_unsent.size())
+	{
+		int numBytes = m_transport->Send(&m_unsent[m_sendOffset], m_unsent.size() - m_sendOffset);
+		if (numBytes <= 0)
+			return numBytes == 0;
+
+		m_sendOffset += (size_t)numBytes;
+		m_numBytesSent += (size_t)numBytes;
+	}
+
+	m_unsent.clear();
+	m_sendOffset = 0;
+	return true;
+}
+
+
+bool AppendMessageFrame(std::vector<uint8_t>& out_bytes, uint8_t type, const ByteBuffer& payload)
+{
+	size_t frameSize = payload.GetSize() + 1;
+	if (frameSize > MAX_SERVER_MESSAGE_BYTES)
+		return false;
+
+	out_bytes.push_back((uint8_t)(frameSize & 0xFF));
+	out_bytes.push_back((uint8_t)(frameSize >> 8));
+	out_bytes.push_back(type);
+	out_bytes.insert(out_bytes.end(), payload.m_bytes.begin(), payload.m_bytes.end());
+	return true;
+}
+
+void WriteCommandMessage(ByteBuffer& out_payload, uint16_t sequence, const NetCommand& command)
+{
+	ByteBuffer encodedCommand;
+	EncodeCommandBatch(&command, 1, encodedCommand);
+
+	out_payload.Clear();
+	out_payload.WriteUint16(sequence);
+	out_payload.WriteByte(1);
+	out_payload.WriteBytes(encodedCommand.GetData(), encodedCommand.GetSize());
+}
+
+bool ReadCommandMessage(ByteReader& payload, uint16_t& out_sequence, std::vector<NetCommand>& out_commands)
+{
+	out_sequence = payload.ReadUint16();
+	uint8_t numCommands = payload.ReadByte();
+	if (payload.HasOverrun())
+		return false;
+
+	return DecodeCommandBatch(payload, numCommands, out_commands);
+}
+
+NetCommand MakeNetCommand(const BattleState& state, int slot, const BattleDecision& decision)
+{
+	ReplayCommandRecord record = MakeReplayCommand(state, slot, decision);
+
+	NetCommand command;
+	command.m_type = record.m_type;
+	command.m_actingCharacterIndex = record.m_actingCharacterIndex;
+	command.m_tileIndex = (uint16_t)state.CalculateTileIndex(record.m_tileX, record.m_tileY);
+	command.m_targettedCharacterIndex = record.m_targettedCharacterIndex;
+	command.m_abilityIndex = record.m_abilityIndex;
+	return command;
+}
+
+BattleDecision MakeBattleDecision(const BattleState& state, int slot, const NetCommand& command)
+{
+	//Off-map tiles turn into coordinates MakeBattleDecision rejects
+	ReplayCommandRecord record;
+	record.m_type = command.m_type;
+	record.m_actingCharacterIndex = command.m_actingCharacterIndex;
+	record.m_tileX = (command.m_tileIndex < state.m_numTiles) ? state.GetTileX(command.m_tileIndex) : -1;
+	record.m_tileY = (command.m_tileIndex < state.m_numTiles) ? state.GetTileY(command.m_tileIndex) : -1;
+	record.m_targettedCharacterIndex = command.m_targettedCharacterIndex;
+	record.m_abilityIndex = command.m_abilityIndex;
+	return MakeBattleDecision(state, slot, record);
+}
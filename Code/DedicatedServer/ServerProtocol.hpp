@@ -0,0 +1,86 @@
+#pragma once
+#include "Game/ByteBuffer.hpp"
+#include "Game/CommandBatch.hpp"
+#include "Game/BattleAI.hpp"
+#include <vector>
+
+class ByteTransport;
+struct BattleState;
+
+
+//Dedicated server protocol. Every message is framed as [size uint16, counting the type byte][type uint8][payload].
+//  JOIN_MATCH     client -> server: match ID varint. The match starts once it has MATCH_NUM_PLAYERS.
+//  MATCH_STARTED  server -> client: player index, seed varint, max turns varint, then the setup BattleState as in replay.sav.
+//  COMMAND        both ways: sequence of the first command uint16, command count, then commands encoded as in SEND_GAME_COMMAND.
+//                 Clients send their own characters' decisions; the server relays every accepted one to the whole
+//                 match, the sender included, and clients only apply what comes back.
+//  MATCH_ENDED    server -> client: winning player + 1 (0 for a draw), turns varint.
+//Spectators connect to the spectator port instead and only ever send one message:
+//  SPECTATE_MATCH     spectator -> server: match ID varint. A match that hasn't started yet is waited for.
+//  SPECTATE_SNAPSHOT  server -> spectator: seed varint, max turns varint, turns so far varint, sequence of the next
+//                     command uint16, then the current BattleState as in replay.sav's SETUP. It is followed by the
+//                     same COMMAND and MATCH_ENDED messages the players get, and the server hangs up after MATCH_ENDED.
+enum ServerMessageType
+{
+	SERVER_MESSAGE_JOIN_MATCH,
+	SERVER_MESSAGE_MATCH_STARTED,
+	SERVER_MESSAGE_COMMAND,
+	SERVER_MESSAGE_MATCH_ENDED,
+	SERVER_MESSAGE_SPECTATE_MATCH,
+	SERVER_MESSAGE_SPECTATE_SNAPSHOT,
+	NUM_SERVER_MESSAGE_TYPES
+};
+
+const size_t MAX_SERVER_MESSAGE_BYTES = 0xFFFF;
+const int MATCH_NUM_PLAYERS = 2;
+
+//Limits on what one peer can make the loop do or hold. Receive stops after a slice so a flooding peer can't keep the
+//loop to itself, and a stream that has buffered more than a few whole messages either way is given up on.
+const size_t MAX_RECEIVE_BYTES_PER_CALL = 0x10000;
+const size_t MAX_BUFFERED_RECEIVE_BYTES = 4 * MAX_SERVER_MESSAGE_BYTES;
+const size_t MAX_UNSENT_BYTES = 16 * MAX_SERVER_MESSAGE_BYTES;
+
+
+//Buffers one non-blocking socket into whole messages and back out. Never blocks; callers go back to the
+//EventLoop when Receive or Send runs out of data or room. The transport constructor takes ownership, for streams
+//over something other than a socket. Once either buffer passes its limit the stream has overflowed, and Receive and
+//Send both report it closed.
+class MessageStream
+{
+public:
+	explicit MessageStream(int socket);
+	explicit MessageStream(ByteTransport* transport);
+	~MessageStream();
+
+	bool Receive();
+	bool PopMessage(uint8_t& out_type, ByteReader& out_payload);
+
+	void QueueMessage(uint8_t type, const ByteBuffer& payload);
+	bool Send();
+	bool HasUnsent() const { return m_sendOffset < m_unsent.size(); }
+	bool HasOverflowed() const { return m_hasOverflowed; }
+
+	int GetSocket() const;
+	size_t GetNumBytesReceived() const { return m_numBytesReceived; }
+	size_t GetNumBytesSent() const { return m_numBytesSent; }
+
+private:
+	MessageStream(const MessageStream&) = delete;
+	MessageStream& operator=(const MessageStream&) = delete;
+
+	ByteTransport* m_transport;
+	std::vector<uint8_t> m_received;
+	size_t m_readOffset;
+	std::vector<uint8_t> m_unsent;
+	size_t m_sendOffset;
+	size_t m_numBytesReceived;
+	size_t m_numBytesSent;
+	bool m_hasOverflowed;
+};
+
+
+bool AppendMessageFrame(std::vector<uint8_t>& out_bytes, uint8_t type, const ByteBuffer& payload);
+void WriteCommandMessage(ByteBuffer& out_payload, uint16_t sequence, const NetCommand& command);
+bool ReadCommandMessage(ByteReader& payload, uint16_t& out_sequence, std::vector<NetCommand>& out_commands);
+NetCommand MakeNetCommand(const BattleState& state, int slot, const BattleDecision& decision);
+BattleDecision MakeBattleDecision(const BattleState& state, int slot, const NetCommand& command);
@@ -0,0 +1,400 @@
+#include "DedicatedServer/SpectatorHub.hpp"
+#include <errno.h>
+#include <sys/socket.h>
+
+
+const int SPECTATOR_POLL_MS = 5;
+
+enum SendResult
+{
+	SEND_DONE,
+	SEND_BLOCKED,
+	SEND_FAILED,
+	NUM_SEND_RESULTS
+};
+
+static SendResult SendRemaining(int socket, const std::vector<uint8_t>& bytes, size_t& inout_offset, std::atomic<size_t>& inout_numBytesSent)
+{
+	while (inout_offset < bytes.size())
+	{
+		ssize_t numBytes = send(socket, &bytes[inout_offset], bytes.size() - inout_offset, MSG_NOSIGNAL);
+		if (numBytes < 0)
+			return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? SEND_BLOCKED : SEND_FAILED;
+
+		inout_offset += (size_t)numBytes;
+		inout_numBytesSent += (size_t)numBytes;
+	}
+
+	return SEND_DONE;
+}
+
+
+Spectator::Spectator(int socket)
+	: m_stream(socket)
+	, m_matchID(0)
+	, m_feed(nullptr)
+	, m_snapshotIndex(0)
+	, m_snapshotOffset(0)
+	, m_logOffset(0)
+	, m_hasRequestedMatch(false)
+	, m_isWatchingWrites(false)
+	, m_isClosing(false)
+{
+
+}
+
+
+SpectatorHub::SpectatorHub()
+	: m_eventLoop()
+	, m_listenSocket(-1)
+	, m_thread()
+	, m_isStopping(false)
+	, m_publishedLock()
+	, m_published()
+	, m_applying()
+	, m_spectators()
+	, m_feeds()
+	, m_waitingSpectators()
+	, m_endedFeeds()
+	, m_events()
+	, m_socketsToClose()
+	, m_stats()
+{
+	m_stats.m_numSpectatorsAccepted = 0;
+	m_stats.m_numSpectatorsServed = 0;
+	m_stats.m_numBytesPublished = 0;
+	m_stats.m_numBytesSent = 0;
+}
+
+SpectatorHub::~SpectatorHub()
+{
+	Stop();
+
+	for (std::map<int, Spectator*>::iterator spectatorIter = m_spectators.begin(); spectatorIter != m_spectators.end(); ++spectatorIter)
+	{
+		delete spectatorIter->second;
+	}
+	m_spectators.clear();
+	m_waitingSpectators.clear();
+
+	for (std::map<uint32_t, SpectatorFeed*>::iterator feedIter = m_feeds.begin(); feedIter != m_feeds.end(); ++feedIter)
+	{
+		if (!feedIter->second->m_hasEnded)
+			delete feedIter->second;
+	}
+	m_feeds.clear();
+	for (SpectatorFeed* feed : m_endedFeeds)
+	{
+		delete feed;
+	}
+	m_endedFeeds.clear();
+
+	CloseSocket(m_listenSocket);
+}
+
+bool SpectatorHub::Start(uint16_t port)
+{
+	if (!m_eventLoop.IsValid())
+		return false;
+
+	m_listenSocket = ListenOnPort(port);
+	if (m_listenSocket < 0 || !m_eventLoop.Add(m_listenSocket, SOCKET_EVENT_READ))
+		return false;
+
+	m_thread = std::thread(&SpectatorHub::Run, this);
+	return true;
+}
+
+void SpectatorHub::Stop()
+{
+	m_isStopping = true;
+	if (m_thread.joinable())
+		m_thread.join();
+}
+
+void SpectatorHub::PublishSnapshot(uint32_t matchID, const ByteBuffer& payload)
+{
+	PublishMessage(matchID, SERVER_MESSAGE_SPECTATE_SNAPSHOT, payload);
+}
+
+void SpectatorHub::PublishMessage(uint32_t matchID, ServerMessageType type, const ByteBuffer& payload)
+{
+	if (payload.GetSize() + 1 > MAX_SERVER_MESSAGE_BYTES)
+		return;
+
+	//The match thread only frames the message; finding and writing to spectators all happens on the hub's thread
+	std::lock_guard<std::mutex> lock(m_publishedLock);
+	for (int byteIndex = 0; byteIndex < 4; byteIndex++)
+	{
+		m_published.push_back((uint8_t)(matchID >> (8 * byteIndex)));
+	}
+	AppendMessageFrame(m_published, (uint8_t)type, payload);
+	m_stats.m_numBytesPublished += payload.GetSize() + 3;
+}
+
+void SpectatorHub::Run()
+{
+	while (!m_isStopping)
+	{
+		m_eventLoop.Wait(SPECTATOR_POLL_MS, m_events);
+
+		for (const SocketEvent& event : m_events)
+		{
+			if (event.m_socket == m_listenSocket)
+			{
+				AcceptSpectators();
+				continue;
+			}
+
+			std::map<int, Spectator*>::iterator spectatorIter = m_spectators.find(event.m_socket);
+			if (spectatorIter == m_spectators.end())
+				continue;
+
+			Spectator* spectator = spectatorIter->second;
+			if ((event.m_events & (SOCKET_EVENT_READ | SOCKET_EVENT_CLOSED)) != 0 && !HandleMessages(spectator))
+			{
+				QueueClose(spectator);
+				continue;
+			}
+
+			if ((event.m_events & SOCKET_EVENT_WRITE) != 0)
+				Flush(spectator);
+		}
+
+		ApplyPublished();
+
+		for (int socket : m_socketsToClose)
+		{
+			CloseSpectator(socket);
+		}
+		m_socketsToClose.clear();
+
+		RetireFinishedFeeds();
+	}
+}
+
+void SpectatorHub::AcceptSpectators()
+{
+	for (;;)
+	{
+		int socket = AcceptConnection(m_listenSocket);
+		if (socket < 0)
+			return;
+
+		if (!m_eventLoop.Add(socket, SOCKET_EVENT_READ))
+		{
+			CloseSocket(socket);
+			continue;
+		}
+
+		m_spectators[socket] = new Spectator(socket);
+		m_stats.m_numSpectatorsAccepted++;
+	}
+}
+
+bool SpectatorHub::HandleMessages(Spectator* spectator)
+{
+	bool isOpen = spectator->m_stream.Receive();
+
+	uint8_t type;
+	ByteReader payload;
+	while (spectator->m_stream.PopMessage(type, payload))
+	{
+		if (type != SERVER_MESSAGE_SPECTATE_MATCH || spectator->m_hasRequestedMatch)
+			return false;
+
+		spectator->m_matchID = (uint32_t)payload.ReadVarint();
+		spectator->m_hasRequestedMatch = true;
+		if (payload.HasOverrun())
+			return false;
+
+		std::map<uint32_t, SpectatorFeed*>::iterator feedIter = m_feeds.find(spectator->m_matchID);
+		if (feedIter == m_feeds.end() || feedIter->second->m_snapshots.empty())
+		{
+			m_waitingSpectators.insert(std::make_pair(spectator->m_matchID, spectator));
+			continue;
+		}
+
+		AttachToFeed(spectator, feedIter->second);
+		Flush(spectator);
+	}
+
+	return isOpen;
+}
+
+void SpectatorHub::AttachToFeed(Spectator* spectator, SpectatorFeed* feed)
+{
+	spectator->m_feed = feed;
+	spectator->m_snapshotIndex = feed->m_snapshots.size() - 1;
+	spectator->m_snapshotOffset = 0;
+	spectator->m_logOffset = feed->m_snapshots.back().m_logOffset;
+	feed->m_spectators.push_back(spectator);
+}
+
+void SpectatorHub::ApplyPublished()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_publishedLock);
+		m_applying.swap(m_published);
+	}
+
+	//Records are [match ID uint32][message frame]
+	std::vector<SpectatorFeed*> updatedFeeds;
+	size_t offset = 0;
+	while (offset + 7 <= m_applying.size())
+	{
+		const uint8_t* record = &m_applying[offset];
+		uint32_t matchID = (uint32_t)record[0] | ((uint32_t)record[1] << 8) | ((uint32_t)record[2] << 16) | ((uint32_t)record[3] << 24);
+		size_t frameSize = 2 + ((size_t)record[4] | ((size_t)record[5] << 8));
+		uint8_t type = record[6];
+		offset += 4 + frameSize;
+
+		//Match IDs are picked by clients and come back once a match is gone, so anything after the end starts a new feed
+		SpectatorFeed*& feed = m_feeds[matchID];
+		if (nullptr == feed || feed->m_hasEnded)
+		{
+			feed = new SpectatorFeed();
+			feed->m_matchID = matchID;
+		}
+
+		if (type == SERVER_MESSAGE_SPECTATE_SNAPSHOT)
+		{
+			SpectatorSnapshot snapshot;
+			snapshot.m_frame.assign(record + 4, record + 4 + frameSize);
+			snapshot.m_logOffset = feed->m_log.size();
+			feed->m_snapshots.push_back(snapshot);
+
+			std::pair<std::multimap<uint32_t, Spectator*>::iterator, std::multimap<uint32_t, Spectator*>::iterator> waiting = m_waitingSpectators.equal_range(matchID);
+			for (std::multimap<uint32_t, Spectator*>::iterator waitingIter = waiting.first; waitingIter != waiting.second; ++waitingIter)
+			{
+				AttachToFeed(waitingIter->second, feed);
+			}
+			m_waitingSpectators.erase(waiting.first, waiting.second);
+		}
+		else
+		{
+			feed->m_log.insert(feed->m_log.end(), record + 4, record + 4 + frameSize);
+			if (type == SERVER_MESSAGE_MATCH_ENDED)
+			{
+				feed->m_hasEnded = true;
+				m_endedFeeds.push_back(feed);
+			}
+		}
+
+		if (updatedFeeds.empty() || updatedFeeds.back() != feed)
+			updatedFeeds.push_back(feed);
+	}
+	m_applying.clear();
+
+	//A feed can show up more than once here when matches interleave; flushing twice just finds nothing left to send
+	for (SpectatorFeed* feed : updatedFeeds)
+	{
+		for (Spectator* spectator : feed->m_spectators)
+		{
+			Flush(spectator);
+		}
+	}
+}
+
+void SpectatorHub::Flush(Spectator* spectator)
+{
+	SpectatorFeed* feed = spectator->m_feed;
+	if (nullptr == feed || spectator->m_isClosing)
+		return;
+
+	int socket = spectator->m_stream.GetSocket();
+	SendResult result = SendRemaining(socket, feed->m_snapshots[spectator->m_snapshotIndex].m_frame, spectator->m_snapshotOffset, m_stats.m_numBytesSent);
+	if (result == SEND_DONE)
+		result = SendRemaining(socket, feed->m_log, spectator->m_logOffset, m_stats.m_numBytesSent);
+
+	if (result == SEND_FAILED)
+	{
+		QueueClose(spectator);
+		return;
+	}
+
+	if (result == SEND_DONE && feed->m_hasEnded)
+	{
+		m_stats.m_numSpectatorsServed++;
+		QueueClose(spectator);
+		return;
+	}
+
+	bool needsWrites = (result == SEND_BLOCKED);
+	if (needsWrites != spectator->m_isWatchingWrites)
+	{
+		m_eventLoop.Modify(socket, needsWrites ? (SOCKET_EVENT_READ | SOCKET_EVENT_WRITE) : SOCKET_EVENT_READ);
+		spectator->m_isWatchingWrites = needsWrites;
+	}
+}
+
+void SpectatorHub::QueueClose(Spectator* spectator)
+{
+	if (spectator->m_isClosing)
+		return;
+
+	spectator->m_isClosing = true;
+	m_socketsToClose.push_back(spectator->m_stream.GetSocket());
+}
+
+void SpectatorHub::CloseSpectator(int socket)
+{
+	std::map<int, Spectator*>::iterator spectatorIter = m_spectators.find(socket);
+	if (spectatorIter == m_spectators.end())
+		return;
+
+	Spectator* spectator = spectatorIter->second;
+	m_spectators.erase(spectatorIter);
+	m_eventLoop.Remove(socket);
+
+	SpectatorFeed* feed = spectator->m_feed;
+	if (nullptr != feed)
+	{
+		for (size_t spectatorIndex = 0; spectatorIndex < feed->m_spectators.size(); spectatorIndex++)
+		{
+			if (feed->m_spectators[spectatorIndex] != spectator)
+				continue;
+
+			feed->m_spectators[spectatorIndex] = feed->m_spectators.back();
+			feed->m_spectators.pop_back();
+			break;
+		}
+	}
+	else if (spectator->m_hasRequestedMatch)
+	{
+		std::pair<std::multimap<uint32_t, Spectator*>::iterator, std::multimap<uint32_t, Spectator*>::iterator> waiting = m_waitingSpectators.equal_range(spectator->m_matchID);
+		for (std::multimap<uint32_t, Spectator*>::iterator waitingIter = waiting.first; waitingIter != waiting.second; ++waitingIter)
+		{
+			if (waitingIter->second != spectator)
+				continue;
+
+			m_waitingSpectators.erase(waitingIter);
+			break;
+		}
+	}
+
+	delete spectator;
+}
+
+void SpectatorHub::RetireFinishedFeeds()
+{
+	size_t endedIndex = 0;
+	while (endedIndex < m_endedFeeds.size())
+	{
+		SpectatorFeed* feed = m_endedFeeds[endedIndex];
+		if (!feed->m_spectators.empty())
+		{
+			endedIndex++;
+			continue;
+		}
+
+		//The ID may already belong to a newer match's feed, which stays
+		std::map<uint32_t, SpectatorFeed*>::iterator feedIter = m_feeds.find(feed->m_matchID);
+		if (feedIter != m_feeds.end() && feedIter->second == feed)
+			m_feeds.erase(feedIter);
+
+		delete feed;
+		m_endedFeeds[endedIndex] = m_endedFeeds.back();
+		m_endedFeeds.pop_back();
+	}
+}
@@ -0,0 +1,100 @@
+#pragma once
+#include "DedicatedServer/EventLoop.hpp"
+#include "DedicatedServer/ServerProtocol.hpp"
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+struct SpectatorSnapshot
+{
+	std::vector<uint8_t> m_frame;
+	size_t m_logOffset;
+};
+
+struct Spectator;
+
+//Everything a match has broadcast, framed once and shared by all of its spectators
+struct SpectatorFeed
+{
+	uint32_t m_matchID = 0;
+	std::vector<uint8_t> m_log;
+	std::vector<SpectatorSnapshot> m_snapshots;
+	std::vector<Spectator*> m_spectators;
+	bool m_hasEnded = false;
+};
+
+struct Spectator
+{
+	explicit Spectator(int socket);
+
+	MessageStream m_stream;
+	uint32_t m_matchID;
+	SpectatorFeed* m_feed;
+	size_t m_snapshotIndex;
+	size_t m_snapshotOffset;
+	size_t m_logOffset;
+	bool m_hasRequestedMatch;
+	bool m_isWatchingWrites;
+	bool m_isClosing;
+};
+
+struct SpectatorStats
+{
+	std::atomic<size_t> m_numSpectatorsAccepted;
+	std::atomic<size_t> m_numSpectatorsServed;
+	std::atomic<size_t> m_numBytesPublished;
+	std::atomic<size_t> m_numBytesSent;
+};
+
+
+//Streams live matches to any number of spectators from its own thread, so watchers cost the match thread nothing
+//beyond handing over each message once. Each match's messages are appended to one shared log, and every spectator
+//just keeps an offset into it, so a message is never copied per spectator. Late joiners get the match's most recent
+//snapshot and the part of the log after it.
+class SpectatorHub
+{
+public:
+	SpectatorHub();
+	~SpectatorHub();
+
+	bool Start(uint16_t port);
+	void Stop();
+
+	void PublishSnapshot(uint32_t matchID, const ByteBuffer& payload);
+	void PublishMessage(uint32_t matchID, ServerMessageType type, const ByteBuffer& payload);
+
+	const SpectatorStats& GetStats() const { return m_stats; }
+
+private:
+	SpectatorHub(const SpectatorHub&) = delete;
+	SpectatorHub& operator=(const SpectatorHub&) = delete;
+
+	void Run();
+	void AcceptSpectators();
+	bool HandleMessages(Spectator* spectator);
+	void AttachToFeed(Spectator* spectator, SpectatorFeed* feed);
+	void ApplyPublished();
+	void Flush(Spectator* spectator);
+	void QueueClose(Spectator* spectator);
+	void CloseSpectator(int socket);
+	void RetireFinishedFeeds();
+
+	EventLoop m_eventLoop;
+	int m_listenSocket;
+	std::thread m_thread;
+	std::atomic<bool> m_isStopping;
+	std::mutex m_publishedLock;
+	std::vector<uint8_t> m_published;
+	std::vector<uint8_t> m_applying;
+	std::map<int, Spectator*> m_spectators;
+	std::map<uint32_t, SpectatorFeed*> m_feeds;
+	std::multimap<uint32_t, Spectator*> m_waitingSpectators;
+	//Ended feeds stay until their last spectator leaves, even after a new match reuses the ID and takes over m_feeds
+	std::vector<SpectatorFeed*> m_endedFeeds;
+	std::vector<SocketEvent> m_events;
+	std::vector<int> m_socketsToClose;
+	SpectatorStats m_stats;
+};
@@ -0,0 +1,288 @@
+#include "Game/AIPlanner.hpp"
+#include "Game/Character.hpp"
+#include "Game/CloseToAttackBehavior.hpp"
+#include "Game/Map.hpp"
+#include "Game/AITrace.hpp"
+#include "Game/GameCommon.hpp"
+#include "Game/App.hpp"
+#include "Engine/Core/Time.hpp"
+#include "Engine/Core/ConsoleSystem.hpp"
+#include "Engine/Core/StringUtils.hpp"
+
+
+double AIPlanner::s_frameBudgetMilliseconds = 2.0;
+int AIPlanner::s_maxPlanningFrames = 0;
+float AIPlanner::s_commitUtilityThreshold = 0.f;
+
+bool ConsoleAIBudget(std::string args)
+{
+	std::vector<std::string> splitArgs = Split(args, ' ');
+	if (splitArgs.empty() || splitArgs[0].empty())
+	{
+		g_theConsole->ConsolePrintf("AI budget: %.2fms per frame, %d max frames, %.2f commit threshold", AIPlanner::s_frameBudgetMilliseconds, AIPlanner::s_maxPlanningFrames, AIPlanner::s_commitUtilityThreshold);
+		return true;
+	}
+
+	AIPlanner::s_frameBudgetMilliseconds = atof(splitArgs[0].c_str());
+	if (splitArgs.size() > 1)
+		AIPlanner::s_maxPlanningFrames = atoi(splitArgs[1].c_str());
+	if (splitArgs.size() > 2)
+		AIPlanner::s_commitUtilityThreshold = (float)atof(splitArgs[2].c_str());
+
+	return true;
+}
+
+bool ConsoleAITiming(std::string args)
+{
+	UNUSED(args);
+
+	size_t numDecisions = AITrace::GetNumRecentDecisions();
+	if (numDecisions == 0)
+	{
+		g_theConsole->ConsolePrintf("No AI decisions recorded.");
+		return true;
+	}
+
+	double totalMilliseconds = 0.0;
+	double worstMilliseconds = 0.0;
+	for (size_t decisionIndex = 0; decisionIndex < numDecisions; decisionIndex++)
+	{
+		const AIDecisionTrace& decision = *AITrace::GetRecentDecision(numDecisions - 1 - decisionIndex);
+		double decisionMilliseconds = decision.m_planningSeconds * 1000.0;
+
+		g_theConsole->ConsolePrintf("%s -> %s (%.2f): %d frames, %.3fms%s", decision.m_characterName.c_str(), decision.m_chosenBehaviorName.c_str(), decision.m_chosenUtility, decision.m_framesSpent, decisionMilliseconds, decision.m_wasCutShort ? " [cut short]" : "");
+		totalMilliseconds += decisionMilliseconds;
+		if (decisionMilliseconds > worstMilliseconds)
+			worstMilliseconds = decisionMilliseconds;
+	}
+
+	g_theConsole->ConsolePrintf("%d decisions, average %.3fms, worst %.3fms", (int)numDecisions, totalMilliseconds / (double)numDecisions, worstMilliseconds);
+	return true;
+}
+
+AIPlanner::AIPlanner()
+	: m_behaviorUtilities()
+	, m_isBehaviorEvaluated()
+	, m_candidateTiles()
+{
+
+}
+
+AIPlanner::~AIPlanner()
+{
+
+}
+
+void AIPlanner::RegisterConsoleCommands()
+{
+	g_theConsole->RegisterCommand("ai_budget", ConsoleAIBudget);
+	g_theConsole->RegisterCommand("ai_timing", ConsoleAITiming);
+	AITrace::RegisterConsoleCommands();
+}
+
+void AIPlanner::StartPlanning(Character* actingCharacter)
+{
+	g_theApp->m_game->WaitUntilRelease();
+
+	m_actingCharacter = actingCharacter;
+	m_behaviorCursor = 0;
+	m_behaviorUtilities.assign(actingCharacter->m_behaviors.size(), -1.f);
+	m_isBehaviorEvaluated.assign(actingCharacter->m_behaviors.size(), false);
+
+	m_closeToAttackBehavior = nullptr;
+	m_candidateTiles.clear();
+	m_tileCursor = 0;
+	m_hasGatheredCandidateTiles = false;
+	m_bestDestinationSoFar = nullptr;
+	m_bestDestinationUtility = -99999.f;
+
+	m_framesSpent = 0;
+	m_secondsSpent = 0.0;
+	m_wasCutShort = false;
+
+	AITrace::BeginDecision(actingCharacter);
+
+	//Nothing moves while a decision is planned, so damage fields and utilities can be shared until the next one
+	actingCharacter->m_currentMap->InvalidateAbilityDamageFields();
+	actingCharacter->m_utilityMemo.Open(actingCharacter->m_behaviors.size(), actingCharacter->m_currentMap->m_tiles.size());
+}
+
+bool AIPlanner::ContinuePlanning(double budgetSeconds)
+{
+	double startTime = GetCurrentTimeSeconds();
+	m_framesSpent++;
+	AITrace::SetRecording(true);
+
+	bool isFinished = false;
+	while (!isFinished)
+	{
+		isFinished = StepPlanning() || IsThresholdReached();
+
+		if (budgetSeconds >= 0.0 && GetCurrentTimeSeconds() - startTime >= budgetSeconds)
+			break;
+	}
+
+	m_secondsSpent += GetCurrentTimeSeconds() - startTime;
+	AITrace::SetRecording(false);
+
+	if (!isFinished && s_maxPlanningFrames > 0 && m_framesSpent >= s_maxPlanningFrames)
+	{
+		//Out of frames, so settle for whatever has been scored
+		m_wasCutShort = true;
+		if (m_behaviorCursor < m_actingCharacter->m_behaviors.size() && m_hasGatheredCandidateTiles)
+			FinishCloseToAttack();
+
+		isFinished = true;
+	}
+
+	return isFinished;
+}
+
+bool AIPlanner::StepPlanning()
+{
+	BehaviorSet& behaviors = m_actingCharacter->m_behaviors;
+	if (m_behaviorCursor >= behaviors.size())
+		return true;
+
+	Behavior& behavior = behaviors[m_behaviorCursor];
+	if (behavior.m_kind == BEHAVIOR_CLOSE_TO_ATTACK)
+	{
+		CloseToAttackBehavior& closeToAttack = behavior.m_closeToAttack;
+		if (!m_hasGatheredCandidateTiles)
+		{
+			m_candidateTiles = m_actingCharacter->m_currentMap->GetTraversableTilesInRangeOfCharacter(m_actingCharacter);
+			m_tileCursor = 0;
+			m_bestDestinationSoFar = nullptr;
+			m_bestDestinationUtility = -99999.f;
+			m_hasGatheredCandidateTiles = true;
+			AITrace::IncrementCounter(AI_COUNTER_CANDIDATE_TILES, (int)m_candidateTiles.size());
+			return false;
+		}
+
+		if (m_tileCursor < m_candidateTiles.size())
+		{
+			Tile* candidateTile = m_candidateTiles[m_tileCursor];
+			float destinationUtility = closeToAttack.CalcUtilityOfDestination(m_actingCharacter, candidateTile);
+			if (destinationUtility > m_bestDestinationUtility)
+			{
+				m_bestDestinationUtility = destinationUtility;
+				m_bestDestinationSoFar = candidateTile;
+			}
+
+			m_tileCursor++;
+			return false;
+		}
+
+		FinishCloseToAttack();
+	}
+	else
+	{
+		m_behaviorUtilities[m_behaviorCursor] = m_actingCharacter->CalcBehaviorUtility(m_behaviorCursor, m_actingCharacter->m_currentTile);
+		m_isBehaviorEvaluated[m_behaviorCursor] = true;
+		m_behaviorCursor++;
+	}
+
+	return m_behaviorCursor >= behaviors.size();
+}
+
+void AIPlanner::FinishCloseToAttack()
+{
+	Behavior& closeToAttack = m_actingCharacter->m_behaviors[m_behaviorCursor];
+
+	m_closeToAttackBehavior = &closeToAttack;
+	m_behaviorUtilities[m_behaviorCursor] = closeToAttack.m_closeToAttack.CalcUtilityFromBestDestination(m_bestDestinationUtility);
+	m_isBehaviorEvaluated[m_behaviorCursor] = true;
+	m_hasGatheredCandidateTiles = false;
+	m_behaviorCursor++;
+}
+
+bool AIPlanner::IsThresholdReached() const
+{
+	if (s_commitUtilityThreshold <= 0.f)
+		return false;
+
+	float bestUtility = -1.f;
+	GetBestBehaviorSoFar(bestUtility);
+	return bestUtility >= s_commitUtilityThreshold;
+}
+
+Behavior* AIPlanner::GetBestBehaviorSoFar(float& outUtility) const
+{
+	//Same selection rule as before planning was split up: first behavior with the strictly highest utility
+	float maxUtility = -1.f;
+	Behavior* bestBehavior = nullptr;
+	for (size_t behaviorIndex = 0; behaviorIndex < m_behaviorUtilities.size(); behaviorIndex++)
+	{
+		if (m_isBehaviorEvaluated[behaviorIndex] && m_behaviorUtilities[behaviorIndex] > maxUtility)
+		{
+			maxUtility = m_behaviorUtilities[behaviorIndex];
+			bestBehavior = &m_actingCharacter->m_behaviors[behaviorIndex];
+		}
+	}
+
+	outUtility = maxUtility;
+	return bestBehavior;
+}
+
+void AIPlanner::CommitDecision()
+{
+	Character* actingCharacter = m_actingCharacter;
+
+	float utility = -1.f;
+	Behavior* chosenBehavior = GetBestBehaviorSoFar(utility);
+	if (nullptr != chosenBehavior)
+		actingCharacter->m_currentBehavior = chosenBehavior;
+
+	if (nullptr != m_closeToAttackBehavior && actingCharacter->m_currentBehavior == m_closeToAttackBehavior)
+		m_closeToAttackBehavior->m_closeToAttack.m_plannedDestination = m_bestDestinationSoFar;
+
+	RecordDecision(actingCharacter->m_currentBehavior, utility);
+	m_actingCharacter = nullptr;
+
+	AITrace::SetRecording(true);
+	actingCharacter->m_currentBehavior->Act(actingCharacter);
+	actingCharacter->m_utilityMemo.Close();
+	AITrace::EndDecision();
+
+	g_theApp->m_game->ReleaseWait();
+}
+
+void AIPlanner::CancelPlanning()
+{
+	if (!IsPlanning())
+		return;
+
+	m_actingCharacter->m_utilityMemo.Close();
+	m_actingCharacter = nullptr;
+	AITrace::EndDecision();
+	g_theApp->m_game->ReleaseWait();
+}
+
+void AIPlanner::Update()
+{
+	if (!IsPlanning())
+		return;
+
+	if (ContinuePlanning(s_frameBudgetMilliseconds * 0.001))
+		CommitDecision();
+}
+
+void AIPlanner::RecordDecision(Behavior* chosenBehavior, float utility)
+{
+	AIDecisionTrace& decision = AITrace::GetCurrentDecision();
+	decision.m_chosenBehaviorName = (nullptr != chosenBehavior) ? chosenBehavior->GetName() : "None";
+	decision.m_chosenUtility = utility;
+	decision.m_framesSpent = m_framesSpent;
+	decision.m_planningSeconds = m_secondsSpent;
+	decision.m_wasCutShort = m_wasCutShort;
+
+	decision.m_behaviors.clear();
+	for (size_t behaviorIndex = 0; behaviorIndex < m_behaviorUtilities.size(); behaviorIndex++)
+	{
+		AIBehaviorTrace behaviorTrace;
+		behaviorTrace.m_name = m_actingCharacter->m_behaviors[behaviorIndex].GetName();
+		behaviorTrace.m_utility = m_behaviorUtilities[behaviorIndex];
+		behaviorTrace.m_wasEvaluated = m_isBehaviorEvaluated[behaviorIndex];
+		decision.m_behaviors.push_back(behaviorTrace);
+	}
+}
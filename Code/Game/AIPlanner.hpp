@@ -0,0 +1,56 @@
+#pragma once
+#include <string>
+#include <vector>
+
+class Character;
+class Tile;
+class Behavior;
+
+
+//Evaluates a character's behaviors a piece at a time so one decision can be spread over several frames.
+//CloseToAttack is scored one destination tile per step; every other behavior is one step.
+class AIPlanner
+{
+public:
+	AIPlanner();
+	~AIPlanner();
+
+	void StartPlanning(Character* actingCharacter);
+	bool ContinuePlanning(double budgetSeconds);
+	void CommitDecision();
+	void CancelPlanning();
+	void Update();
+
+	static void RegisterConsoleCommands();
+
+	bool IsPlanning() const { return nullptr != m_actingCharacter; }
+	Behavior* GetBestBehaviorSoFar(float& outUtility) const;
+
+public:
+	Character* m_actingCharacter = nullptr;
+
+	size_t m_behaviorCursor = 0;
+	std::vector<float> m_behaviorUtilities;
+	std::vector<bool> m_isBehaviorEvaluated;
+
+	Behavior* m_closeToAttackBehavior = nullptr;
+	std::vector<Tile*> m_candidateTiles;
+	size_t m_tileCursor = 0;
+	bool m_hasGatheredCandidateTiles = false;
+	Tile* m_bestDestinationSoFar = nullptr;
+	float m_bestDestinationUtility = -99999.f;
+
+	int m_framesSpent = 0;
+	double m_secondsSpent = 0.0;
+	bool m_wasCutShort = false;
+
+	static double s_frameBudgetMilliseconds;
+	static int s_maxPlanningFrames;
+	static float s_commitUtilityThreshold;
+
+private:
+	bool StepPlanning();
+	bool IsThresholdReached() const;
+	void FinishCloseToAttack();
+	void RecordDecision(Behavior* chosenBehavior, float utility);
+};
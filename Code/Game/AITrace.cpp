@@ -0,0 +1,267 @@
+#include "Game/AITrace.hpp"
+#include "Game/Character.hpp"
+#include "Game/GameCommon.hpp"
+#include "Engine/Core/Time.hpp"
+#include "Engine/Core/ConsoleSystem.hpp"
+#include "Engine/Core/EngineConfig.hpp"
+#include <fstream>
+
+
+AIDecisionTrace AITrace::s_currentDecision;
+bool AITrace::s_isDecisionOpen = false;
+bool AITrace::s_isRecording = false;
+int AITrace::s_numDecisions = 0;
+std::vector<AIDecisionTrace> AITrace::s_recentDecisions;
+size_t AITrace::s_oldestDecisionIndex = 0;
+
+bool ConsoleAITrace(std::string args)
+{
+	size_t numToPrint = 1;
+	if (!args.empty())
+		numToPrint = (size_t)atoi(args.c_str());
+
+	if (AITrace::GetNumRecentDecisions() == 0)
+	{
+		g_theConsole->ConsolePrintf("No AI decisions traced.");
+		return true;
+	}
+
+	for (size_t decisionIndex = 0; decisionIndex < numToPrint && decisionIndex < AITrace::GetNumRecentDecisions(); decisionIndex++)
+	{
+		AITrace::PrintDecision(*AITrace::GetRecentDecision(decisionIndex));
+	}
+
+	return true;
+}
+
+bool ConsoleAITraceExport(std::string args)
+{
+	std::string filePath = args.empty() ? "ai_trace.json" : args;
+	if (!AITrace::ExportToJSON(filePath))
+	{
+		g_theConsole->ConsolePrintf("Could not write %s", filePath.c_str());
+		return false;
+	}
+
+	g_theConsole->ConsolePrintf("Wrote %d AI decisions to %s", (int)AITrace::GetNumRecentDecisions(), filePath.c_str());
+	return true;
+}
+
+void AITrace::BeginDecision(Character* actingCharacter)
+{
+	s_currentDecision = AIDecisionTrace();
+	s_currentDecision.m_decisionNumber = s_numDecisions++;
+	s_currentDecision.m_characterName = actingCharacter->m_name;
+	s_currentDecision.m_characterIndex = actingCharacter->m_characterIndex;
+	s_currentDecision.m_chosenUtility = -1.f;
+	s_currentDecision.m_framesSpent = 0;
+	s_currentDecision.m_planningSeconds = 0.0;
+	s_currentDecision.m_wasCutShort = false;
+	for (int timerIndex = 0; timerIndex < NUM_AI_TIMERS; timerIndex++)
+	{
+		s_currentDecision.m_timerSeconds[timerIndex] = 0.0;
+	}
+	for (int counterIndex = 0; counterIndex < NUM_AI_COUNTERS; counterIndex++)
+	{
+		s_currentDecision.m_counters[counterIndex] = 0;
+	}
+
+	s_isDecisionOpen = true;
+}
+
+void AITrace::SetRecording(bool isRecording)
+{
+	s_isRecording = isRecording && s_isDecisionOpen;
+}
+
+void AITrace::EndDecision()
+{
+	if (!s_isDecisionOpen)
+		return;
+
+	if (s_recentDecisions.size() < MAX_RECENT_DECISIONS)
+	{
+		s_recentDecisions.push_back(s_currentDecision);
+	}
+	else
+	{
+		s_recentDecisions[s_oldestDecisionIndex] = s_currentDecision;
+		s_oldestDecisionIndex = (s_oldestDecisionIndex + 1) % MAX_RECENT_DECISIONS;
+	}
+
+	s_isDecisionOpen = false;
+	s_isRecording = false;
+}
+
+void AITrace::AddTime(AITraceTimer timer, double seconds)
+{
+	if (s_isRecording)
+		s_currentDecision.m_timerSeconds[timer] += seconds;
+}
+
+void AITrace::IncrementCounter(AITraceCounter counter, int amount /*= 1*/)
+{
+	if (s_isRecording)
+		s_currentDecision.m_counters[counter] += amount;
+}
+
+const AIDecisionTrace* AITrace::GetRecentDecision(size_t indexFromNewest)
+{
+	size_t numDecisions = s_recentDecisions.size();
+	if (indexFromNewest >= numDecisions)
+		return nullptr;
+
+	size_t newestIndex = (s_oldestDecisionIndex + numDecisions - 1) % numDecisions;
+	return &s_recentDecisions[(newestIndex + numDecisions - indexFromNewest) % numDecisions];
+}
+
+void AITrace::PrintDecision(const AIDecisionTrace& decision)
+{
+	g_theConsole->ConsolePrintf("#%d %s -> %s (%.2f), %d frames, %.3fms%s", decision.m_decisionNumber, decision.m_characterName.c_str(), decision.m_chosenBehaviorName.c_str(), decision.m_chosenUtility, decision.m_framesSpent, decision.m_planningSeconds * 1000.0, decision.m_wasCutShort ? " [cut short]" : "");
+
+	for (const AIBehaviorTrace& behavior : decision.m_behaviors)
+	{
+		if (behavior.m_wasEvaluated)
+			g_theConsole->ConsolePrintf("  %s: %.2f", behavior.m_name.c_str(), behavior.m_utility);
+		else
+			g_theConsole->ConsolePrintf("  %s: not evaluated", behavior.m_name.c_str());
+	}
+
+	for (int timerIndex = 0; timerIndex < NUM_AI_TIMERS; timerIndex++)
+	{
+		g_theConsole->ConsolePrintf("  %s: %.3fms", GetTimerName((AITraceTimer)timerIndex), decision.m_timerSeconds[timerIndex] * 1000.0);
+	}
+
+	for (int counterIndex = 0; counterIndex < NUM_AI_COUNTERS; counterIndex++)
+	{
+		g_theConsole->ConsolePrintf("  %s: %d", GetCounterName((AITraceCounter)counterIndex), decision.m_counters[counterIndex]);
+	}
+
+	int cacheLookups = decision.m_counters[AI_COUNTER_CACHE_HITS] + decision.m_counters[AI_COUNTER_CACHE_MISSES];
+	if (cacheLookups > 0)
+		g_theConsole->ConsolePrintf("  cache hit rate: %.1f%%", 100.f * (float)decision.m_counters[AI_COUNTER_CACHE_HITS] / (float)cacheLookups);
+}
+
+std::string EscapeJSONString(const std::string& stringToEscape)
+{
+	std::string escapedString;
+	for (char character : stringToEscape)
+	{
+		if (character == '"' || character == '\\')
+			escapedString += '\\';
+		escapedString += character;
+	}
+
+	return escapedString;
+}
+
+bool AITrace::ExportToJSON(const std::string& filePath)
+{
+	std::ofstream file(filePath);
+	if (!file.is_open())
+		return false;
+
+	file << "[\n";
+	size_t numDecisions = s_recentDecisions.size();
+	for (size_t decisionIndex = 0; decisionIndex < numDecisions; decisionIndex++)
+	{
+		//Oldest first so the file reads in the order decisions were made
+		const AIDecisionTrace& decision = *GetRecentDecision(numDecisions - 1 - decisionIndex);
+
+		file << "  {\"decision\": " << decision.m_decisionNumber;
+		file << ", \"character\": \"" << EscapeJSONString(decision.m_characterName) << "\"";
+		file << ", \"characterIndex\": " << (int)decision.m_characterIndex;
+		file << ", \"chosen\": \"" << EscapeJSONString(decision.m_chosenBehaviorName) << "\"";
+		file << ", \"chosenUtility\": " << decision.m_chosenUtility;
+		file << ", \"frames\": " << decision.m_framesSpent;
+		file << ", \"planningMs\": " << decision.m_planningSeconds * 1000.0;
+		file << ", \"cutShort\": " << (decision.m_wasCutShort ? "true" : "false");
+
+		file << ", \"behaviors\": [";
+		for (size_t behaviorIndex = 0; behaviorIndex < decision.m_behaviors.size(); behaviorIndex++)
+		{
+			const AIBehaviorTrace& behavior = decision.m_behaviors[behaviorIndex];
+			file << (behaviorIndex > 0 ? ", " : "") << "{\"name\": \"" << EscapeJSONString(behavior.m_name) << "\", ";
+			if (behavior.m_wasEvaluated)
+				file << "\"utility\": " << behavior.m_utility << "}";
+			else
+				file << "\"utility\": null}";
+		}
+		file << "]";
+
+		file << ", \"timersMs\": {";
+		for (int timerIndex = 0; timerIndex < NUM_AI_TIMERS; timerIndex++)
+		{
+			file << (timerIndex > 0 ? ", " : "") << "\"" << GetTimerName((AITraceTimer)timerIndex) << "\": " << decision.m_timerSeconds[timerIndex] * 1000.0;
+		}
+		file << "}";
+
+		file << ", \"counters\": {";
+		for (int counterIndex = 0; counterIndex < NUM_AI_COUNTERS; counterIndex++)
+		{
+			file << (counterIndex > 0 ? ", " : "") << "\"" << GetCounterName((AITraceCounter)counterIndex) << "\": " << decision.m_counters[counterIndex];
+		}
+		file << "}}";
+
+		file << (decisionIndex + 1 < numDecisions ? ",\n" : "\n");
+	}
+	file << "]\n";
+
+	return true;
+}
+
+void AITrace::RegisterConsoleCommands()
+{
+	g_theConsole->RegisterCommand("ai_trace", ConsoleAITrace);
+	g_theConsole->RegisterCommand("ai_trace_export", ConsoleAITraceExport);
+}
+
+const char* AITrace::GetTimerName(AITraceTimer timer)
+{
+	switch (timer)
+	{
+	case AI_TIMER_PATHING:
+		return "pathing";
+	case AI_TIMER_REACHABILITY:
+		return "reachability";
+	case AI_TIMER_DAMAGE_ESTIMATION:
+		return "damageEstimation";
+	default:
+		return "unknown";
+	}
+}
+
+const char* AITrace::GetCounterName(AITraceCounter counter)
+{
+	switch (counter)
+	{
+	case AI_COUNTER_CANDIDATE_TILES:
+		return "candidateTiles";
+	case AI_COUNTER_TARGETTABLE_TILES:
+		return "targettableTiles";
+	case AI_COUNTER_UTILITY_CALLS:
+		return "utilityCalls";
+	case AI_COUNTER_CACHE_HITS:
+		return "cacheHits";
+	case AI_COUNTER_CACHE_MISSES:
+		return "cacheMisses";
+	default:
+		return "unknown";
+	}
+}
+
+
+AITraceScope::AITraceScope(AITraceTimer timer)
+	: m_timer(timer)
+	, m_isTiming(AITrace::IsRecording())
+	, m_startTime(0.0)
+{
+	if (m_isTiming)
+		m_startTime = GetCurrentTimeSeconds();
+}
+
+AITraceScope::~AITraceScope()
+{
+	if (m_isTiming)
+		AITrace::AddTime(m_timer, GetCurrentTimeSeconds() - m_startTime);
+}
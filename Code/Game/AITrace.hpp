@@ -0,0 +1,98 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+class Character;
+
+
+enum AITraceTimer
+{
+	AI_TIMER_PATHING,
+	AI_TIMER_REACHABILITY,
+	AI_TIMER_DAMAGE_ESTIMATION,
+	NUM_AI_TIMERS
+};
+
+enum AITraceCounter
+{
+	AI_COUNTER_CANDIDATE_TILES,
+	AI_COUNTER_TARGETTABLE_TILES,
+	AI_COUNTER_UTILITY_CALLS,
+	AI_COUNTER_CACHE_HITS,
+	AI_COUNTER_CACHE_MISSES,
+	NUM_AI_COUNTERS
+};
+
+struct AIBehaviorTrace
+{
+	std::string m_name;
+	float m_utility;
+	bool m_wasEvaluated;
+};
+
+struct AIDecisionTrace
+{
+	int m_decisionNumber;
+	std::string m_characterName;
+	uint16_t m_characterIndex;
+
+	std::vector<AIBehaviorTrace> m_behaviors;
+	std::string m_chosenBehaviorName;
+	float m_chosenUtility;
+
+	int m_framesSpent;
+	double m_planningSeconds;
+	bool m_wasCutShort;
+
+	double m_timerSeconds[NUM_AI_TIMERS];
+	int m_counters[NUM_AI_COUNTERS];
+};
+
+
+//Ring buffer of the most recent AI decisions. Timers and counters only accumulate while a decision is being recorded.
+class AITrace
+{
+public:
+	static void BeginDecision(Character* actingCharacter);
+	static void SetRecording(bool isRecording);
+	static void EndDecision();
+	static bool IsRecording() { return s_isRecording; }
+	static AIDecisionTrace& GetCurrentDecision() { return s_currentDecision; }
+
+	static void AddTime(AITraceTimer timer, double seconds);
+	static void IncrementCounter(AITraceCounter counter, int amount = 1);
+
+	static const AIDecisionTrace* GetRecentDecision(size_t indexFromNewest);
+	static size_t GetNumRecentDecisions() { return s_recentDecisions.size(); }
+
+	static void PrintDecision(const AIDecisionTrace& decision);
+	static bool ExportToJSON(const std::string& filePath);
+	static void RegisterConsoleCommands();
+
+	static const char* GetTimerName(AITraceTimer timer);
+	static const char* GetCounterName(AITraceCounter counter);
+
+	static const size_t MAX_RECENT_DECISIONS = 64;
+
+private:
+	static AIDecisionTrace s_currentDecision;
+	static bool s_isDecisionOpen;
+	static bool s_isRecording;
+	static int s_numDecisions;
+	static std::vector<AIDecisionTrace> s_recentDecisions;
+	static size_t s_oldestDecisionIndex;
+};
+
+
+class AITraceScope
+{
+public:
+	AITraceScope(AITraceTimer timer);
+	~AITraceScope();
+
+private:
+	AITraceTimer m_timer;
+	bool m_isTiming;
+	double m_startTime;
+};
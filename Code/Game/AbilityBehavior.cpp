@@ -4,22 +4,14 @@
 #include "Engine/Math/MathUtils.hpp"
 #include "Engine/Core/XMLUtils.hpp"
 #include "Engine/Core/EngineConfig.hpp"
+#include "Game/Character.hpp"
+#include "Game/Map.hpp"
 
 AbilityBehavior::AbilityBehavior(XMLNode element)
 {
 	UNUSED(element);
 }
 
-AbilityBehavior::AbilityBehavior(AbilityBehavior* behaviorToCopy)
-{
-	UNUSED(behaviorToCopy);
-}
-
-AbilityBehavior::~AbilityBehavior()
-{
-
-}
-
 void AbilityBehavior::Act(Character* actingCharacter)
 {
 	actingCharacter->TargetAndSetBestAbility();
@@ -45,20 +37,9 @@ float AbilityBehavior::CalcUtility(Character* actingCharacter, Tile* tileToActFr
 	return (float)maxNetDamage;
 }
 
-std::string AbilityBehavior::GetName() const
-{
-	return "Ability";
-}
-
 void AbilityBehavior::DebugRender(const Character* actingCharacter) const
 {
 	if(actingCharacter->m_targettedCharacter)
 		g_theRenderer->DrawLine2D((Vector2)actingCharacter->m_currentTile->m_tileCoords + Vector2(0.5f, 0.5f), (Vector2)actingCharacter->m_targettedCharacter->m_currentTile->m_tileCoords + Vector2(0.5f, 0.5f), 0.125f, Rgba::WHITE, Rgba::RED);
 }
 
-Behavior* AbilityBehavior::Clone()
-{
-	AbilityBehavior* outBehavior = new AbilityBehavior(this);
-	return outBehavior;
-}
-
@@ -1,20 +1,16 @@
 #pragma once
-#include "Game/Behavior.hpp"
-#include "Game/Map.hpp"
+#include "ThirdParty\XMLParser\XMLParser.hpp"
 
+class Character;
+class Tile;
 
 
-class AbilityBehavior : public Behavior
+class AbilityBehavior
 {
 public:
 	AbilityBehavior(XMLNode element);
-	virtual ~AbilityBehavior();
-	AbilityBehavior(AbilityBehavior* behaviorToCopy);
 
-	virtual void Act(Character* actingCharacter) override;
-	virtual float CalcUtility(Character* actingCharacter, Tile* tileToActFrom = nullptr) const override;
-	virtual std::string GetName() const override;
-	virtual void DebugRender(const Character* actingCharacter) const override;
-
-	virtual Behavior* Clone() override;
+	void Act(Character* actingCharacter);
+	float CalcUtility(Character* actingCharacter, Tile* tileToActFrom = nullptr) const;
+	void DebugRender(const Character* actingCharacter) const;
 };
\ No newline at end of file
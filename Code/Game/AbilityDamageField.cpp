@@ -0,0 +1,102 @@
+#define NOMINMAX
+#include "Game/AbilityDamageField.hpp"
+#include "Game/Map.hpp"
+#include "Game/Character.hpp"
+#include "Game/AbilityDefinition.hpp"
+#include "Game/MapDefinition.hpp"
+#include <algorithm>
+
+
+AbilityDamageField::AbilityDamageField()
+	: m_map(nullptr)
+	, m_caster(nullptr)
+	, m_ability(nullptr)
+	, m_stamp(-1)
+	, m_netDamage()
+{
+
+}
+
+void AbilityDamageField::Build(Map* map, Character* caster, AbilityDefinition* ability, int stamp)
+{
+	m_map = map;
+	m_caster = caster;
+	m_ability = ability;
+	m_stamp = stamp;
+	m_netDamage.assign(map->m_tiles.size(), 0);
+
+	IntVector2 dimensions = map->m_definition->m_dimensions;
+	int radius = ability->m_radius;
+
+	for (Character* character : map->m_characters)
+	{
+		if (character->m_isDead)
+			continue;
+
+		int contribution = caster->CalculateNetAbilityDamageToCharacter(ability, character);
+		if (contribution == 0)
+			continue;
+
+		//Every tile whose area would cover this character gets its contribution
+		const Tile* characterTile = character->m_currentTile;
+		IntVector2 center = characterTile->m_tileCoords;
+		int minY = std::max(center.y - radius, 0);
+		int maxY = std::min(center.y + radius, dimensions.y - 1);
+		for (int y = minY; y <= maxY; y++)
+		{
+			int remainingRadius = radius - abs(y - center.y);
+			int minX = std::max(center.x - remainingRadius, 0);
+			int maxX = std::min(center.x + remainingRadius, dimensions.x - 1);
+			for (int x = minX; x <= maxX; x++)
+			{
+				int tileIndex = map->CalculateTileIndexFromTileCoords(IntVector2(x, y));
+				if (abs(map->m_tiles[tileIndex].m_height - characterTile->m_height) <= ability->m_areaMaxHeightDifference)
+					m_netDamage[tileIndex] += contribution;
+			}
+		}
+	}
+}
+
+bool AbilityDamageField::IsValidFor(const Character* caster, const AbilityDefinition* ability, int stamp) const
+{
+	return m_caster == caster && m_ability == ability && m_stamp == stamp;
+}
+
+int AbilityDamageField::GetNetDamageAtTile(const Tile* tile) const
+{
+	return m_netDamage[m_map->CalculateTileIndexFromTileCoords(tile->m_tileCoords)];
+}
+
+int AbilityDamageField::FindMaxNetDamageInRange(const Tile* tileToActFrom, int range, int maxHeightDifference, Tile*& outBestTile) const
+{
+	//Scans in tile index order so ties resolve the same way as walking Map::GetTargettableTiles
+	IntVector2 dimensions = m_map->m_definition->m_dimensions;
+	IntVector2 center = tileToActFrom->m_tileCoords;
+
+	int maxNetDamage = 0;
+	outBestTile = nullptr;
+
+	int minY = std::max(center.y - range, 0);
+	int maxY = std::min(center.y + range, dimensions.y - 1);
+	for (int y = minY; y <= maxY; y++)
+	{
+		int remainingRange = range - abs(y - center.y);
+		int minX = std::max(center.x - remainingRange, 0);
+		int maxX = std::min(center.x + remainingRange, dimensions.x - 1);
+		for (int x = minX; x <= maxX; x++)
+		{
+			int tileIndex = m_map->CalculateTileIndexFromTileCoords(IntVector2(x, y));
+			Tile* tile = &m_map->m_tiles[tileIndex];
+			if (abs(tileToActFrom->m_height - tile->m_height) > maxHeightDifference)
+				continue;
+
+			if (m_netDamage[tileIndex] > maxNetDamage)
+			{
+				maxNetDamage = m_netDamage[tileIndex];
+				outBestTile = tile;
+			}
+		}
+	}
+
+	return maxNetDamage;
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <vector>
+
+class Map;
+class Tile;
+class Character;
+class AbilityDefinition;
+
+
+//Net damage an ability would deal if centered on each tile, from one caster's point of view.
+//Built by scattering each character's signed damage over the ability's diamond instead of gathering per tile.
+class AbilityDamageField
+{
+public:
+	AbilityDamageField();
+
+	void Build(Map* map, Character* caster, AbilityDefinition* ability, int stamp);
+	bool IsValidFor(const Character* caster, const AbilityDefinition* ability, int stamp) const;
+
+	int GetNetDamageAtTile(const Tile* tile) const;
+	int FindMaxNetDamageInRange(const Tile* tileToActFrom, int range, int maxHeightDifference, Tile*& outBestTile) const;
+
+public:
+	Map* m_map;
+	Character* m_caster;
+	AbilityDefinition* m_ability;
+	int m_stamp;
+	std::vector<int> m_netDamage;
+};
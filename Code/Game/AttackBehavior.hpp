@@ -1,22 +1,18 @@
 #pragma once
-#include "Game/Behavior.hpp"
-#include "Game/Map.hpp"
+#include "ThirdParty\XMLParser\XMLParser.hpp"
 
+class Character;
+class Tile;
 
 
-class AttackBehavior : public Behavior
+class AttackBehavior
 {
 public:
 	AttackBehavior(XMLNode element);
-	virtual ~AttackBehavior();
-	AttackBehavior(AttackBehavior* behaviorToCopy);
 
-	virtual void Act(Character* actingCharacter) override;
-	virtual float CalcUtility(Character* actingCharacter, Tile* tileToActFrom = nullptr) const override;
-	virtual std::string GetName() const override;
-	virtual void DebugRender(const Character* actingCharacter) const override;
-
-	virtual Behavior* Clone() override;
+	void Act(Character* actingCharacter);
+	float CalcUtility(Character* actingCharacter, Tile* tileToActFrom = nullptr) const;
+	void DebugRender(const Character* actingCharacter) const;
 
 	float m_utility = 0.7f;
 };
\ No newline at end of file
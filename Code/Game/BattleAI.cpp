@@ -0,0 +1,291 @@
+#include "Game/BattleAI.hpp"
+#include "Game/BattleState.hpp"
+#include <stdlib.h>
+
+
+const BehaviorKind DEFAULT_BEHAVIOR_KINDS[] = { BEHAVIOR_WAIT, BEHAVIOR_ATTACK, BEHAVIOR_CLOSE_TO_ATTACK, BEHAVIOR_ABILITY };
+const int NUM_DEFAULT_BEHAVIOR_KINDS = sizeof(DEFAULT_BEHAVIOR_KINDS) / sizeof(DEFAULT_BEHAVIOR_KINDS[0]);
+
+const float WAIT_UTILITY = 0.05f;
+const float CLOSE_TO_ATTACK_UTILITY = 0.5f;
+const float CLOSE_TO_ATTACK_SCALE = 0.6f;
+const float UNREACHABLE_UTILITY = -99999.f;
+
+
+uint32_t MixSeed(uint32_t seed)
+{
+	uint64_t mixed = (uint64_t)seed + 0x9E3779B97F4A7C15ull;
+	mixed = (mixed ^ (mixed >> 30)) * 0xBF58476D1CE4E5B9ull;
+	mixed = (mixed ^ (mixed >> 27)) * 0x94D049BB133111EBull;
+	mixed ^= mixed >> 31;
+
+	uint32_t folded = (uint32_t)(mixed ^ (mixed >> 32));
+	return (folded != 0) ? folded : 1;
+}
+
+
+BattleAI::BattleAI(uint32_t seed /*= 1*/)
+	: m_randomState(MixSeed(seed))
+{
+
+}
+
+BattleDecision BattleAI::ChooseAction(const BattleState& state, int slot)
+{
+	//First behavior with the strictly highest utility, same as AIPlanner::GetBestBehaviorSoFar
+	BattleDecision bestDecision;
+	bestDecision.m_kind = BEHAVIOR_WAIT;
+	bestDecision.m_utility = -1.f;
+	bestDecision.m_targetSlot = -1;
+	bestDecision.m_targetTileIndex = -1;
+	bestDecision.m_abilityID = -1;
+
+	int numBehaviors = GetNumBehaviors(state, slot);
+	for (int behaviorIndex = 0; behaviorIndex < numBehaviors; behaviorIndex++)
+	{
+		BattleDecision decision;
+		float utility = CalcUtility(state, slot, GetBehaviorKind(state, slot, behaviorIndex), state.m_tileIndices[slot], &decision);
+		if (utility > bestDecision.m_utility)
+			bestDecision = decision;
+	}
+
+	return bestDecision;
+}
+
+float BattleAI::CalcUtility(const BattleState& state, int slot, BehaviorKind kind, int tileIndex, BattleDecision* out_decision /*= nullptr*/)
+{
+	int targetSlot = -1;
+	int targetTileIndex = -1;
+	int abilityID = -1;
+	float utility = -1.f;
+
+	switch (kind)
+	{
+	case BEHAVIOR_ATTACK:
+		utility = (float)CalculateMaxNetAttackDamage(state, slot, tileIndex, targetSlot);
+		break;
+	case BEHAVIOR_ABILITY:
+		utility = (float)CalculateMaxNetAbilityDamage(state, slot, tileIndex, abilityID, targetTileIndex);
+		break;
+	case BEHAVIOR_CLOSE_TO_ATTACK:
+		utility = CalcCloseToAttackUtility(state, slot, tileIndex, targetTileIndex);
+		break;
+	case BEHAVIOR_WAIT:
+		utility = WAIT_UTILITY;
+		break;
+	case BEHAVIOR_FLEE:
+	default:
+		//Flee needs a remembered attacker, which the battle state doesn't keep
+		utility = -1.f;
+		break;
+	}
+
+	if (nullptr != out_decision)
+	{
+		out_decision->m_kind = kind;
+		out_decision->m_utility = utility;
+		out_decision->m_targetSlot = targetSlot;
+		out_decision->m_targetTileIndex = targetTileIndex;
+		out_decision->m_abilityID = abilityID;
+	}
+
+	return utility;
+}
+
+int BattleAI::CalculateMaxNetAttackDamage(const BattleState& state, int slot, int tileIndex, int& out_targetSlot)
+{
+	int maxNetDamage = 0;
+	out_targetSlot = -1;
+
+	int range = state.m_attackRanges[slot];
+	int centerX = state.GetTileX(tileIndex);
+	int centerY = state.GetTileY(tileIndex);
+	int centerHeight = state.m_tileHeights[tileIndex];
+
+	//Row-major like Map::GetTargettableTiles so ties pick the same target
+	for (int y = centerY - range; y <= centerY + range; y++)
+	{
+		for (int x = centerX - range; x <= centerX + range; x++)
+		{
+			if (!state.IsInMap(x, y) || abs(x - centerX) + abs(y - centerY) > range)
+				continue;
+
+			int targettedTileIndex = state.CalculateTileIndex(x, y);
+			if (abs(centerHeight - state.m_tileHeights[targettedTileIndex]) > state.m_maxAttackHeightDifferences[slot])
+				continue;
+
+			int defenderSlot = state.m_tileOccupants[targettedTileIndex];
+			if (defenderSlot == INVALID_BATTLE_INDEX || defenderSlot == slot || state.m_isDead[defenderSlot])
+				continue;
+
+			int potentialDamage = state.CalculateAttackDamage(slot, defenderSlot);
+			if (state.m_factions[defenderSlot] == state.m_factions[slot])
+				potentialDamage *= -1;
+
+			if (state.HasStatusEffect(slot, STATUS_CHARM))
+				potentialDamage *= -1;
+
+			if (state.HasStatusEffect(slot, STATUS_CONFUSE) && RollConfusion())
+				potentialDamage *= -1;
+
+			if (potentialDamage > maxNetDamage)
+			{
+				maxNetDamage = potentialDamage;
+				out_targetSlot = defenderSlot;
+			}
+		}
+	}
+
+	return maxNetDamage;
+}
+
+int BattleAI::CalculateMaxNetAbilityDamage(const BattleState& state, int slot, int tileIndex, int& out_abilityID, int& out_targetTileIndex)
+{
+	int maxNetDamage = 0;
+	out_abilityID = -1;
+	out_targetTileIndex = -1;
+
+	//Abilities are aimed with the character's attack range, as in Character::TargetAndSetBestAbility
+	int range = state.m_attackRanges[slot];
+	int centerX = state.GetTileX(tileIndex);
+	int centerY = state.GetTileY(tileIndex);
+	int centerHeight = state.m_tileHeights[tileIndex];
+	uint16_t areaTiles[MAX_BATTLE_TILES];
+
+	for (int abilityIndex = 0; abilityIndex < state.m_numAbilities[slot]; abilityIndex++)
+	{
+		int abilityID = state.m_abilities[slot][abilityIndex];
+		const BattleAbility& ability = state.m_abilityDefinitions[abilityID];
+
+		for (int y = centerY - range; y <= centerY + range; y++)
+		{
+			for (int x = centerX - range; x <= centerX + range; x++)
+			{
+				if (!state.IsInMap(x, y) || abs(x - centerX) + abs(y - centerY) > range)
+					continue;
+
+				int targettedTileIndex = state.CalculateTileIndex(x, y);
+				if (abs(centerHeight - state.m_tileHeights[targettedTileIndex]) > state.m_maxAttackHeightDifferences[slot])
+					continue;
+
+				int netDamage = 0;
+				int numAreaTiles = state.GetTilesInArea(targettedTileIndex, ability.m_radius, ability.m_areaMaxHeightDifference, areaTiles);
+				for (int areaIndex = 0; areaIndex < numAreaTiles; areaIndex++)
+				{
+					int affectedSlot = state.m_tileOccupants[areaTiles[areaIndex]];
+					if (affectedSlot == INVALID_BATTLE_INDEX || state.m_isDead[affectedSlot])
+						continue;
+
+					int abilityDamage = CalculateNetAbilityDamage(state, slot, abilityID, affectedSlot);
+					if (state.HasStatusEffect(slot, STATUS_CONFUSE) && RollConfusion())
+						abilityDamage *= -1;
+
+					netDamage += abilityDamage;
+				}
+
+				if (netDamage > maxNetDamage)
+				{
+					maxNetDamage = netDamage;
+					out_abilityID = abilityID;
+					out_targetTileIndex = targettedTileIndex;
+				}
+			}
+		}
+	}
+
+	return maxNetDamage;
+}
+
+int BattleAI::CalculateNetAbilityDamage(const BattleState& state, int casterSlot, int abilityID, int targetSlot)
+{
+	int abilityDamage = state.CalculateAbilityDamage(casterSlot, abilityID, targetSlot);
+	if (state.m_currentHP[targetSlot] - abilityDamage > state.m_stats[STAT_MAX_HP][targetSlot])
+		abilityDamage = state.m_currentHP[targetSlot] - state.m_stats[STAT_MAX_HP][targetSlot];
+
+	if (state.m_factions[targetSlot] == state.m_factions[casterSlot])
+		abilityDamage *= -1;
+
+	if (state.HasStatusEffect(casterSlot, STATUS_CHARM))
+		abilityDamage *= -1;
+
+	return abilityDamage;
+}
+
+int BattleAI::FindDistanceToNearestEnemy(const BattleState& state, int slot, int tileIndex) const
+{
+	//Corpses still count until they're removed, same as Map::FindNearestCharacterNotOfFaction
+	int nearestDistance = -1;
+	for (int otherSlot = 0; otherSlot < state.m_numCharacters; otherSlot++)
+	{
+		if (!state.IsActive(otherSlot) || state.m_factions[otherSlot] == state.m_factions[slot])
+			continue;
+
+		int distance = state.CalculateManhattanDistance(tileIndex, state.m_tileIndices[otherSlot]);
+		if (nearestDistance < 0 || distance < nearestDistance)
+			nearestDistance = distance;
+	}
+
+	return nearestDistance < 0 ? 0 : nearestDistance;
+}
+
+float BattleAI::CalcCloseToAttackUtility(const BattleState& state, int slot, int tileIndex, int& out_destinationTileIndex)
+{
+	out_destinationTileIndex = -1;
+	float maxUtility = UNREACHABLE_UTILITY;
+
+	uint16_t traversableTiles[MAX_BATTLE_TILES];
+	int numTraversableTiles = state.GetTraversableTiles(slot, tileIndex, traversableTiles);
+	int numBehaviors = GetNumBehaviors(state, slot);
+
+	for (int traversableIndex = 0; traversableIndex < numTraversableTiles; traversableIndex++)
+	{
+		int destinationTileIndex = traversableTiles[traversableIndex];
+		int distanceFromNearestTarget = FindDistanceToNearestEnemy(state, slot, destinationTileIndex);
+
+		float destinationUtility = UNREACHABLE_UTILITY;
+		for (int behaviorIndex = 0; behaviorIndex < numBehaviors; behaviorIndex++)
+		{
+			BehaviorKind kind = GetBehaviorKind(state, slot, behaviorIndex);
+			if (kind == BEHAVIOR_CLOSE_TO_ATTACK)
+				continue;
+
+			float behaviorUtility = CalcUtility(state, slot, kind, destinationTileIndex) - distanceFromNearestTarget;
+			if (behaviorUtility > destinationUtility)
+				destinationUtility = behaviorUtility;
+		}
+
+		if (destinationUtility > maxUtility)
+		{
+			maxUtility = destinationUtility;
+			out_destinationTileIndex = destinationTileIndex;
+		}
+	}
+
+	float scaledUtility = maxUtility * CLOSE_TO_ATTACK_SCALE;
+	return scaledUtility > CLOSE_TO_ATTACK_UTILITY ? scaledUtility : CLOSE_TO_ATTACK_UTILITY;
+}
+
+int BattleAI::GetNumBehaviors(const BattleState& state, int slot) const
+{
+	if (state.m_numBehaviors[slot] == 0)
+		return NUM_DEFAULT_BEHAVIOR_KINDS;
+
+	return state.m_numBehaviors[slot];
+}
+
+BehaviorKind BattleAI::GetBehaviorKind(const BattleState& state, int slot, int behaviorIndex) const
+{
+	if (state.m_numBehaviors[slot] == 0)
+		return DEFAULT_BEHAVIOR_KINDS[behaviorIndex];
+
+	return (BehaviorKind)state.m_behaviorKinds[slot][behaviorIndex];
+}
+
+bool BattleAI::RollConfusion()
+{
+	//xorshift32
+	m_randomState ^= m_randomState << 13;
+	m_randomState ^= m_randomState >> 17;
+	m_randomState ^= m_randomState << 5;
+	return (m_randomState & 1) != 0;
+}
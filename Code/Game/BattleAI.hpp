@@ -0,0 +1,44 @@
+#pragma once
+#include "Game/BehaviorKind.hpp"
+#include <stdint.h>
+
+struct BattleState;
+
+
+struct BattleDecision
+{
+	BehaviorKind m_kind;
+	float m_utility;
+	int m_targetSlot;
+	int m_targetTileIndex;
+	int m_abilityID;
+};
+
+//SplitMix64's finalizer folded down to 32 bits. Consecutive match seeds fed straight into xorshift32 give strongly
+//correlated early outputs, so every generator seeded from a match seed goes through this first. Never returns 0.
+uint32_t MixSeed(uint32_t seed);
+
+
+//Utility AI over a BattleState, scoring the same behaviors the same way Character does.
+//Confusion rolls come from its own seeded generator so headless runs are reproducible.
+class BattleAI
+{
+public:
+	BattleAI(uint32_t seed = 1);
+
+	BattleDecision ChooseAction(const BattleState& state, int slot);
+	float CalcUtility(const BattleState& state, int slot, BehaviorKind kind, int tileIndex, BattleDecision* out_decision = nullptr);
+
+	int CalculateMaxNetAttackDamage(const BattleState& state, int slot, int tileIndex, int& out_targetSlot);
+	int CalculateMaxNetAbilityDamage(const BattleState& state, int slot, int tileIndex, int& out_abilityID, int& out_targetTileIndex);
+	int CalculateNetAbilityDamage(const BattleState& state, int casterSlot, int abilityID, int targetSlot);
+	int FindDistanceToNearestEnemy(const BattleState& state, int slot, int tileIndex) const;
+
+private:
+	float CalcCloseToAttackUtility(const BattleState& state, int slot, int tileIndex, int& out_destinationTileIndex);
+	int GetNumBehaviors(const BattleState& state, int slot) const;
+	BehaviorKind GetBehaviorKind(const BattleState& state, int slot, int behaviorIndex) const;
+	bool RollConfusion();
+
+	uint32_t m_randomState;
+};
@@ -0,0 +1,25 @@
+#pragma once
+#include "Game/StatusEffectType.hpp"
+
+struct BattleState;
+
+
+//Everything the simulation tells the outside world about. The rules never wait on these,
+//so a renderer can animate them, a log can record them, and a headless run can ignore them.
+class BattlePresentation
+{
+public:
+	virtual ~BattlePresentation() {}
+
+	virtual void OnTurnStarted(const BattleState& state, int slot) { (void)state; (void)slot; }
+	virtual void OnCharacterMoved(const BattleState& state, int slot, int fromTileIndex, int toTileIndex) { (void)state; (void)slot; (void)fromTileIndex; (void)toTileIndex; }
+	virtual void OnCharacterAttacked(const BattleState& state, int attackerSlot, int defenderSlot) { (void)state; (void)attackerSlot; (void)defenderSlot; }
+	virtual void OnAbilityQueued(const BattleState& state, int casterSlot, int abilityID, int targetTileIndex) { (void)state; (void)casterSlot; (void)abilityID; (void)targetTileIndex; }
+	virtual void OnAbilityResolved(const BattleState& state, int casterSlot, int abilityID) { (void)state; (void)casterSlot; (void)abilityID; }
+	virtual void OnCharacterWaited(const BattleState& state, int slot) { (void)state; (void)slot; }
+	virtual void OnHealthChanged(const BattleState& state, int slot, int amount) { (void)state; (void)slot; (void)amount; }
+	virtual void OnStatusEffectAdded(const BattleState& state, int slot, StatusEffectType type) { (void)state; (void)slot; (void)type; }
+	virtual void OnCharacterDied(const BattleState& state, int slot) { (void)state; (void)slot; }
+	virtual void OnCharacterRemoved(const BattleState& state, int slot) { (void)state; (void)slot; }
+	virtual void OnBattleEnded(const BattleState& state, int winningPlayer) { (void)state; (void)winningPlayer; }
+};
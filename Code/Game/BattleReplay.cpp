@@ -0,0 +1,101 @@
+#include "Game/BattleReplay.hpp"
+
+
+//Matches the CommandType order in Game.hpp
+enum ReplayCommandType
+{
+	REPLAY_COMMAND_ATTACK,
+	REPLAY_COMMAND_MOVE,
+	REPLAY_COMMAND_ABILITY,
+	REPLAY_COMMAND_WAIT
+};
+
+
+ReplayCommandRecord MakeReplayCommand(const BattleState& state, int slot, const BattleDecision& decision)
+{
+	ReplayCommandRecord command;
+	command.m_type = REPLAY_COMMAND_WAIT;
+	command.m_actingCharacterIndex = state.m_characterIndices[slot];
+	command.m_tileX = 0;
+	command.m_tileY = 0;
+	command.m_targettedCharacterIndex = 0;
+	command.m_abilityIndex = 0;
+
+	int targetTileIndex = -1;
+	switch (decision.m_kind)
+	{
+	case BEHAVIOR_ATTACK:
+		if (decision.m_targetSlot >= 0)
+		{
+			command.m_type = REPLAY_COMMAND_ATTACK;
+			command.m_targettedCharacterIndex = state.m_characterIndices[decision.m_targetSlot];
+			targetTileIndex = state.m_tileIndices[decision.m_targetSlot];
+		}
+		break;
+	case BEHAVIOR_ABILITY:
+		if (decision.m_abilityID >= 0)
+		{
+			command.m_type = REPLAY_COMMAND_ABILITY;
+			for (; command.m_abilityIndex < state.m_numAbilities[slot]; command.m_abilityIndex++)
+			{
+				if (state.m_abilities[slot][command.m_abilityIndex] == decision.m_abilityID)
+					break;
+			}
+
+			targetTileIndex = decision.m_targetTileIndex;
+			int targetSlot = state.m_tileOccupants[targetTileIndex];
+			if (targetSlot != INVALID_BATTLE_INDEX)
+				command.m_targettedCharacterIndex = state.m_characterIndices[targetSlot];
+		}
+		else
+		{
+			command.m_type = REPLAY_COMMAND_MOVE;
+			targetTileIndex = state.m_tileIndices[slot];
+		}
+		break;
+	case BEHAVIOR_CLOSE_TO_ATTACK:
+		command.m_type = REPLAY_COMMAND_MOVE;
+		targetTileIndex = (decision.m_targetTileIndex >= 0) ? decision.m_targetTileIndex : state.m_tileIndices[slot];
+		break;
+	default:
+		break;
+	}
+
+	if (targetTileIndex >= 0)
+	{
+		command.m_tileX = state.GetTileX(targetTileIndex);
+		command.m_tileY = state.GetTileY(targetTileIndex);
+	}
+
+	return command;
+}
+
+BattleDecision MakeBattleDecision(const BattleState& state, int slot, const ReplayCommandRecord& command)
+{
+	BattleDecision decision;
+	decision.m_kind = BEHAVIOR_WAIT;
+	decision.m_utility = 0.f;
+	decision.m_targetSlot = -1;
+	decision.m_targetTileIndex = state.IsInMap(command.m_tileX, command.m_tileY) ? state.CalculateTileIndex(command.m_tileX, command.m_tileY) : -1;
+	decision.m_abilityID = -1;
+
+	switch (command.m_type)
+	{
+	case REPLAY_COMMAND_ATTACK:
+		decision.m_kind = BEHAVIOR_ATTACK;
+		decision.m_targetSlot = state.FindCharacterSlot(command.m_targettedCharacterIndex);
+		break;
+	case REPLAY_COMMAND_MOVE:
+		decision.m_kind = BEHAVIOR_CLOSE_TO_ATTACK;
+		break;
+	case REPLAY_COMMAND_ABILITY:
+		decision.m_kind = BEHAVIOR_ABILITY;
+		if (command.m_abilityIndex < state.m_numAbilities[slot] && decision.m_targetTileIndex >= 0)
+			decision.m_abilityID = state.m_abilities[slot][command.m_abilityIndex];
+		break;
+	default:
+		break;
+	}
+
+	return decision;
+}
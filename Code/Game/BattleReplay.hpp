@@ -0,0 +1,11 @@
+#pragma once
+#include "Game/BattleState.hpp"
+#include "Game/BattleAI.hpp"
+#include "Game/ReplayFile.hpp"
+
+
+//Converts between headless decisions and replay commands, so a BattleSimulation can be recorded and played back.
+//Turns that end without an action (no reachable tile, nothing to cast) are stored as a move onto the character's own tile,
+//which BattleState::ApplyMove rejects and ends the turn the same way.
+ReplayCommandRecord MakeReplayCommand(const BattleState& state, int slot, const BattleDecision& decision);
+BattleDecision MakeBattleDecision(const BattleState& state, int slot, const ReplayCommandRecord& command);
@@ -0,0 +1,131 @@
+#include "Game/BattleSave.hpp"
+#include "Game/Map.hpp"
+#include "Game/MapDefinition.hpp"
+#include "Game/ByteBuffer.hpp"
+#include "Engine/Core/ErrorWarningAssert.hpp"
+#include <stdio.h>
+#include <string.h>
+
+
+static void CopySaveName(char* out_name, const std::string& name)
+{
+	ASSERT_OR_DIE(name.size() < BATTLE_SAVE_NAME_LENGTH, "Name is too long to save: " + name);
+	memset(out_name, 0, BATTLE_SAVE_NAME_LENGTH);
+	memcpy(out_name, name.c_str(), name.size());
+}
+
+static uint32_t CalculateBattleSaveCRC(const BattleSave& save)
+{
+	const uint8_t* bytes = (const uint8_t*)&save;
+	size_t bodyOffset = offsetof(BattleSave, m_mapDefinitionName);
+	return CalculateCRC32(bytes + bodyOffset, sizeof(BattleSave) - bodyOffset);
+}
+
+
+void CaptureBattleSave(const Map& map, uint32_t seed, uint32_t numCommandsRun, uint32_t numTurnsStarted, BattleSave& out_save)
+{
+	//Zeroing first keeps padding and unused slots out of the CRC
+	memset(&out_save, 0, sizeof(BattleSave));
+
+	CopySaveName(out_save.m_mapDefinitionName, map.m_definition->m_name);
+	out_save.m_seed = seed;
+	out_save.m_numCommandsRun = numCommandsRun;
+	out_save.m_numTurnsStarted = numTurnsStarted;
+	out_save.m_nextCharacterIndex = map.m_characterTable.GetNextID();
+	map.CaptureBattleState(out_save.m_state);
+
+	std::map<ItemDefinition*, uint8_t> itemDefinitionIDs;
+	for (std::map<std::string, ItemDefinition*>::const_iterator itemIter = ItemDefinition::s_registry.begin(); itemIter != ItemDefinition::s_registry.end(); ++itemIter)
+	{
+		uint8_t nextID = (uint8_t)itemDefinitionIDs.size();
+		itemDefinitionIDs[itemIter->second] = nextID;
+	}
+
+	for (int slot = 0; slot < out_save.m_state.m_numCharacters; slot++)
+	{
+		const Character* character = map.m_characters[slot];
+		BattleSaveCharacter& savedCharacter = out_save.m_characters[slot];
+		CopySaveName(savedCharacter.m_builderName, character->m_name);
+		CopySaveName(savedCharacter.m_faction, character->m_faction);
+		savedCharacter.m_controller = (uint8_t)character->m_controller;
+
+		for (int equipSlot = 0; equipSlot < NUM_EQUIP_SLOTS; equipSlot++)
+		{
+			BattleSaveItem& savedItem = savedCharacter.m_equippedItems[equipSlot];
+			const Item* item = character->m_equipment.m_equippedItems[equipSlot];
+			if (nullptr == item)
+			{
+				savedItem.m_definitionID = INVALID_BATTLE_INDEX;
+				continue;
+			}
+
+			savedItem.m_definitionID = itemDefinitionIDs[item->m_definition];
+			for (int statIndex = 0; statIndex < NUM_STATS; statIndex++)
+			{
+				savedItem.m_stats[statIndex] = item->m_stats[(StatID)statIndex];
+			}
+		}
+	}
+}
+
+void SealBattleSave(BattleSave& save)
+{
+	save.m_magic = BATTLE_SAVE_MAGIC;
+	save.m_version = BATTLE_SAVE_VERSION;
+	save.m_size = (uint32_t)sizeof(BattleSave);
+	save.m_crc = CalculateBattleSaveCRC(save);
+}
+
+bool ValidateBattleSave(const BattleSave& save, const std::string& sourceName, std::string& out_error)
+{
+	if (save.m_magic != BATTLE_SAVE_MAGIC)
+		out_error = sourceName + " is not a battle save.";
+	else if (save.m_version != BATTLE_SAVE_VERSION || save.m_size != sizeof(BattleSave))
+		out_error = sourceName + " was saved by a different build.";
+	else if (save.m_crc != CalculateBattleSaveCRC(save))
+		out_error = sourceName + " is corrupt.";
+	else if (save.m_mapDefinitionName[BATTLE_SAVE_NAME_LENGTH - 1] != '\0' || save.m_state.m_numCharacters < 0 || save.m_state.m_numCharacters > MAX_BATTLE_CHARACTERS
+		|| save.m_state.m_numTiles != save.m_state.m_mapWidth * save.m_state.m_mapHeight || save.m_state.m_numTiles > MAX_BATTLE_TILES)
+		out_error = sourceName + " has an invalid battle.";
+	else
+		return true;
+
+	return false;
+}
+
+bool WriteBattleSave(const std::string& filePath, BattleSave& save)
+{
+	SealBattleSave(save);
+
+	FILE* file = fopen(filePath.c_str(), "wb");
+	if (nullptr == file)
+		return false;
+
+	bool didWrite = fwrite(&save, sizeof(BattleSave), 1, file) == 1;
+	return (fclose(file) == 0) && didWrite;
+}
+
+bool ReadBattleSave(const std::string& filePath, BattleSave& out_save, std::string& out_error)
+{
+	FILE* file = fopen(filePath.c_str(), "rb");
+	if (nullptr == file)
+	{
+		out_error = "Could not open " + filePath + ".";
+		return false;
+	}
+
+	size_t numBytesRead = fread(&out_save, 1, sizeof(BattleSave), file);
+	bool hasExtraBytes = fgetc(file) != EOF;
+	fclose(file);
+
+	if (numBytesRead < offsetof(BattleSave, m_mapDefinitionName) || out_save.m_magic != BATTLE_SAVE_MAGIC)
+		out_error = filePath + " is not a battle save.";
+	else if (out_save.m_version != BATTLE_SAVE_VERSION || out_save.m_size != sizeof(BattleSave))
+		out_error = filePath + " was saved by a different build.";
+	else if (numBytesRead != sizeof(BattleSave) || hasExtraBytes)
+		out_error = filePath + " is the wrong size.";
+	else
+		return ValidateBattleSave(out_save, filePath, out_error);
+
+	return false;
+}
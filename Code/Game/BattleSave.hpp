@@ -0,0 +1,56 @@
+#pragma once
+#include "Game/BattleState.hpp"
+#include "Game/ItemDefinition.hpp"
+#include <string>
+#include <type_traits>
+
+class Map;
+
+
+//battle.sav:
+//  One BattleSave, written and read with a single call each. It is the host's in-memory layout, not a portable
+//  format like replay.sav, so a save only loads on a build whose layout matches; m_size and m_version catch the rest.
+//  Registry-backed IDs (tiles, abilities, items) follow the sorted registries, the same as in a BattleState.
+const uint32_t BATTLE_SAVE_MAGIC = 0x56415354;
+const uint32_t BATTLE_SAVE_VERSION = 3;
+const int BATTLE_SAVE_NAME_LENGTH = 32;
+
+struct BattleSaveItem
+{
+	uint8_t m_definitionID;
+	int m_stats[NUM_STATS];
+};
+
+//What a BattleState leaves out because the rules don't need it, but rebuilding the Character does
+struct BattleSaveCharacter
+{
+	char m_builderName[BATTLE_SAVE_NAME_LENGTH];
+	char m_faction[BATTLE_SAVE_NAME_LENGTH];
+	uint8_t m_controller;
+	BattleSaveItem m_equippedItems[NUM_EQUIP_SLOTS];
+};
+
+struct BattleSave
+{
+	uint32_t m_magic;
+	uint32_t m_version;
+	uint32_t m_size;
+	uint32_t m_crc;
+
+	char m_mapDefinitionName[BATTLE_SAVE_NAME_LENGTH];
+	uint32_t m_seed;
+	uint32_t m_numCommandsRun;
+	uint32_t m_numTurnsStarted;
+	CharacterID m_nextCharacterIndex;
+	BattleSaveCharacter m_characters[MAX_BATTLE_CHARACTERS];
+	BattleState m_state;
+};
+
+static_assert(std::is_trivially_copyable<BattleSave>::value, "BattleSave must stay trivially copyable");
+
+
+void CaptureBattleSave(const Map& map, uint32_t seed, uint32_t numCommandsRun, uint32_t numTurnsStarted, BattleSave& out_save);
+void SealBattleSave(BattleSave& save);
+bool ValidateBattleSave(const BattleSave& save, const std::string& sourceName, std::string& out_error);
+bool WriteBattleSave(const std::string& filePath, BattleSave& save);
+bool ReadBattleSave(const std::string& filePath, BattleSave& out_save, std::string& out_error);
@@ -0,0 +1,197 @@
+#include "Game/BattleSimulation.hpp"
+#include <string.h>
+
+
+BattlePresentation BattleSimulation::s_silentPresentation;
+
+BattleSimulation::BattleSimulation(const BattleState& initialState, uint32_t seed /*= 1*/)
+	: m_state(initialState)
+	, m_ai(seed)
+	, m_numTurns(0)
+	, m_presentation(&s_silentPresentation)
+{
+	memset(m_damageDealt, 0, sizeof(m_damageDealt));
+	memset(m_healingDone, 0, sizeof(m_healingDone));
+	TakeSnapshot();
+}
+
+void BattleSimulation::SetPresentation(BattlePresentation* presentation)
+{
+	m_presentation = (nullptr != presentation) ? presentation : &s_silentPresentation;
+}
+
+bool BattleSimulation::StepTurn()
+{
+	int readySlot;
+	if (!StartNextTurn(readySlot))
+		return false;
+
+	if (readySlot >= 0)
+		FinishTurn(readySlot, m_ai.ChooseAction(m_state, readySlot));
+
+	return true;
+}
+
+//Runs everything up to the point a decision is needed; out_readySlot is -1 when the turn needed none
+bool BattleSimulation::StartNextTurn(int& out_readySlot)
+{
+	out_readySlot = -1;
+	if (IsFinished())
+		return false;
+
+	int slot = m_state.AdvanceToNextTurn();
+	if (slot < 0)
+		return false;
+
+	m_numTurns++;
+	m_presentation->OnTurnStarted(m_state, slot);
+
+	int pendingAbilityID = m_state.m_pendingAbilities[slot];
+	BattleTurnResult result = m_state.StartTurn(slot);
+
+	if (result == TURN_RESULT_RESOLVED_ABILITY)
+		m_presentation->OnAbilityResolved(m_state, slot, pendingAbilityID);
+
+	//Poison and corpse decay aren't damage anyone dealt
+	ReportChanges((result == TURN_RESULT_RESOLVED_ABILITY) ? slot : -1);
+
+	if (result == TURN_RESULT_READY)
+		out_readySlot = slot;
+	else if (IsFinished())
+		m_presentation->OnBattleEnded(m_state, GetWinningPlayer());
+
+	return true;
+}
+
+void BattleSimulation::FinishTurn(int slot, const BattleDecision& decision)
+{
+	ApplyDecision(slot, decision);
+	ReportChanges(slot);
+
+	if (IsFinished())
+		m_presentation->OnBattleEnded(m_state, GetWinningPlayer());
+}
+
+int BattleSimulation::RunToCompletion(int maxTurns)
+{
+	while (m_numTurns < maxTurns && StepTurn())
+	{
+	}
+
+	return GetWinningPlayer();
+}
+
+bool BattleSimulation::IsFinished() const
+{
+	//Same rule as Game::CheckForVictoryOrDefeat: one owning player left standing
+	int survivingPlayer = -1;
+	for (int slot = 0; slot < m_state.m_numCharacters; slot++)
+	{
+		if (!m_state.IsActive(slot) || m_state.m_isDead[slot])
+			continue;
+
+		if (survivingPlayer < 0)
+			survivingPlayer = m_state.m_owningPlayers[slot];
+		else if (survivingPlayer != m_state.m_owningPlayers[slot])
+			return false;
+	}
+
+	return true;
+}
+
+int BattleSimulation::GetWinningPlayer() const
+{
+	if (!IsFinished())
+		return -1;
+
+	for (int slot = 0; slot < m_state.m_numCharacters; slot++)
+	{
+		if (m_state.IsActive(slot) && !m_state.m_isDead[slot])
+			return m_state.m_owningPlayers[slot];
+	}
+
+	return -1;
+}
+
+void BattleSimulation::ApplyDecision(int slot, const BattleDecision& decision)
+{
+	switch (decision.m_kind)
+	{
+	case BEHAVIOR_ATTACK:
+		if (decision.m_targetSlot >= 0)
+		{
+			m_presentation->OnCharacterAttacked(m_state, slot, decision.m_targetSlot);
+			m_state.ApplyAttack(slot, decision.m_targetSlot);
+			return;
+		}
+		break;
+	case BEHAVIOR_ABILITY:
+		if (decision.m_abilityID >= 0)
+		{
+			int targetSlot = m_state.m_tileOccupants[decision.m_targetTileIndex];
+			m_presentation->OnAbilityQueued(m_state, slot, decision.m_abilityID, decision.m_targetTileIndex);
+			m_state.QueueAbility(slot, decision.m_abilityID, (targetSlot == INVALID_BATTLE_INDEX) ? decision.m_targetTileIndex : -1, (targetSlot == INVALID_BATTLE_INDEX) ? -1 : targetSlot);
+			return;
+		}
+
+		//Nothing worth casting on still ends the turn, like AbilityBehavior::Act
+		m_state.EndTurn(slot, 0);
+		return;
+	case BEHAVIOR_CLOSE_TO_ATTACK:
+		if (decision.m_targetTileIndex >= 0)
+		{
+			int fromTileIndex = m_state.m_tileIndices[slot];
+			if (m_state.ApplyMove(slot, decision.m_targetTileIndex))
+			{
+				m_presentation->OnCharacterMoved(m_state, slot, fromTileIndex, decision.m_targetTileIndex);
+				return;
+			}
+		}
+		m_state.EndTurn(slot, 0);
+		return;
+	default:
+		break;
+	}
+
+	m_presentation->OnCharacterWaited(m_state, slot);
+	m_state.Wait(slot);
+}
+
+void BattleSimulation::ReportChanges(int sourceSlot)
+{
+	for (int slot = 0; slot < m_state.m_numCharacters; slot++)
+	{
+		int healthChange = m_state.m_currentHP[slot] - m_previousHP[slot];
+		if (healthChange != 0)
+		{
+			m_presentation->OnHealthChanged(m_state, slot, healthChange);
+			if (sourceSlot >= 0 && healthChange < 0)
+				m_damageDealt[sourceSlot] -= healthChange;
+			else if (sourceSlot >= 0)
+				m_healingDone[sourceSlot] += healthChange;
+		}
+
+		uint8_t addedEffects = m_state.m_statusEffectBits[slot] & ~m_previousStatusEffectBits[slot];
+		for (int effectIndex = 0; effectIndex < NUM_STATUS_EFFECTS; effectIndex++)
+		{
+			if (addedEffects & (1 << effectIndex))
+				m_presentation->OnStatusEffectAdded(m_state, slot, (StatusEffectType)effectIndex);
+		}
+
+		if (m_state.m_isDead[slot] && !m_previousIsDead[slot])
+			m_presentation->OnCharacterDied(m_state, slot);
+
+		if (m_state.m_isRemoved[slot] && !m_previousIsRemoved[slot])
+			m_presentation->OnCharacterRemoved(m_state, slot);
+	}
+
+	TakeSnapshot();
+}
+
+void BattleSimulation::TakeSnapshot()
+{
+	memcpy(m_previousHP, m_state.m_currentHP, sizeof(m_previousHP));
+	memcpy(m_previousIsDead, m_state.m_isDead, sizeof(m_previousIsDead));
+	memcpy(m_previousIsRemoved, m_state.m_isRemoved, sizeof(m_previousIsRemoved));
+	memcpy(m_previousStatusEffectBits, m_state.m_statusEffectBits, sizeof(m_previousStatusEffectBits));
+}
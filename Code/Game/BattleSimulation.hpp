@@ -0,0 +1,43 @@
+#pragma once
+#include "Game/BattleState.hpp"
+#include "Game/BattleAI.hpp"
+#include "Game/BattlePresentation.hpp"
+
+
+//Runs a battle to completion on a BattleState with no window, renderer or audio.
+//Every character is driven by BattleAI; anything visual goes out through the presentation.
+class BattleSimulation
+{
+public:
+	BattleSimulation(const BattleState& initialState, uint32_t seed = 1);
+
+	void SetPresentation(BattlePresentation* presentation);
+
+	bool StepTurn();
+	bool StartNextTurn(int& out_readySlot);
+	void FinishTurn(int slot, const BattleDecision& decision);
+	int RunToCompletion(int maxTurns);
+	bool IsFinished() const;
+	int GetWinningPlayer() const;
+
+	void ApplyDecision(int slot, const BattleDecision& decision);
+
+public:
+	BattleState m_state;
+	BattleAI m_ai;
+	int m_numTurns;
+	int m_damageDealt[MAX_BATTLE_CHARACTERS];
+	int m_healingDone[MAX_BATTLE_CHARACTERS];
+
+private:
+	void ReportChanges(int sourceSlot);
+	void TakeSnapshot();
+
+	BattlePresentation* m_presentation;
+	int m_previousHP[MAX_BATTLE_CHARACTERS];
+	uint8_t m_previousIsDead[MAX_BATTLE_CHARACTERS];
+	uint8_t m_previousIsRemoved[MAX_BATTLE_CHARACTERS];
+	uint8_t m_previousStatusEffectBits[MAX_BATTLE_CHARACTERS];
+
+	static BattlePresentation s_silentPresentation;
+};
@@ -0,0 +1,400 @@
+#include "Game/BattleState.hpp"
+#include "Game/CTScheduler.hpp"
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+
+
+void BattleState::Clear()
+{
+	memset(this, 0, sizeof(BattleState));
+	memset(m_tileOccupants, INVALID_BATTLE_INDEX, sizeof(m_tileOccupants));
+	memset(m_pendingAbilities, INVALID_BATTLE_INDEX, sizeof(m_pendingAbilities));
+	memset(m_pendingTargetCharacters, INVALID_BATTLE_INDEX, sizeof(m_pendingTargetCharacters));
+	memset(m_pendingTargetTiles, 0xFF, sizeof(m_pendingTargetTiles));
+}
+
+int BattleState::CalculateManhattanDistance(int tileIndexA, int tileIndexB) const
+{
+	return abs(GetTileX(tileIndexA) - GetTileX(tileIndexB)) + abs(GetTileY(tileIndexA) - GetTileY(tileIndexB));
+}
+
+int BattleState::FindCharacterSlot(CharacterID characterIndex) const
+{
+	for (int slot = 0; slot < m_numCharacters; slot++)
+	{
+		if (IsActive(slot) && m_characterIndices[slot] == characterIndex)
+			return slot;
+	}
+
+	return -1;
+}
+
+int BattleState::GetCharacterWithGreatestCT() const
+{
+	//Matches Map::GetCharacterWithGreatestCT, ties go to the later character
+	int maxCT = 0;
+	int slotWithMaxCT = -1;
+
+	for (int slot = 0; slot < m_numCharacters; slot++)
+	{
+		if (IsActive(slot) && m_currentCT[slot] >= maxCT)
+		{
+			maxCT = m_currentCT[slot];
+			slotWithMaxCT = slot;
+		}
+	}
+
+	return slotWithMaxCT;
+}
+
+int BattleState::GetTickRate(int slot) const
+{
+	if (m_pendingAbilities[slot] != INVALID_BATTLE_INDEX)
+		return m_abilityDefinitions[m_pendingAbilities[slot]].m_speed;
+
+	return m_stats[STAT_SPEED][slot];
+}
+
+bool BattleState::IsTileTraversableFromHeight(int slot, int tileIndex, int fromHeight) const
+{
+	return fromHeight + m_stats[STAT_JUMP][slot] >= m_tileHeights[tileIndex];
+}
+
+int BattleState::GetTraversableTiles(int slot, int startTileIndex, uint16_t* out_tiles) const
+{
+	const int UNREACHED = 999999;
+	int distanceField[MAX_BATTLE_TILES];
+	for (int tileIndex = 0; tileIndex < m_numTiles; tileIndex++)
+	{
+		distanceField[tileIndex] = UNREACHED;
+	}
+
+	const int neighborOffsetsX[4] = { 0, 0, 1, -1 };
+	const int neighborOffsetsY[4] = { 1, -1, 0, 0 };
+	int moveRange = m_stats[STAT_MOVE][slot];
+
+	distanceField[startTileIndex] = 0;
+	for (int distanceFieldIteration = 0; distanceFieldIteration <= moveRange; distanceFieldIteration++)
+	{
+		for (int tileIndex = 0; tileIndex < m_numTiles; tileIndex++)
+		{
+			if (distanceField[tileIndex] != distanceFieldIteration)
+				continue;
+
+			int tileX = GetTileX(tileIndex);
+			int tileY = GetTileY(tileIndex);
+			for (int neighborIndex = 0; neighborIndex < 4; neighborIndex++)
+			{
+				int neighborX = tileX + neighborOffsetsX[neighborIndex];
+				int neighborY = tileY + neighborOffsetsY[neighborIndex];
+				if (!IsInMap(neighborX, neighborY))
+					continue;
+
+				int neighborTileIndex = CalculateTileIndex(neighborX, neighborY);
+				if (m_tileOccupants[neighborTileIndex] == INVALID_BATTLE_INDEX && IsTileTraversableFromHeight(slot, neighborTileIndex, m_tileHeights[tileIndex]))
+				{
+					if (distanceField[neighborTileIndex] > distanceFieldIteration + 1)
+						distanceField[neighborTileIndex] = distanceFieldIteration + 1;
+				}
+			}
+		}
+	}
+
+	int numTraversableTiles = 0;
+	for (int tileIndex = 0; tileIndex < m_numTiles; tileIndex++)
+	{
+		if (distanceField[tileIndex] > 0 && distanceField[tileIndex] <= moveRange && m_tileOccupants[tileIndex] == INVALID_BATTLE_INDEX)
+			out_tiles[numTraversableTiles++] = (uint16_t)tileIndex;
+	}
+
+	return numTraversableTiles;
+}
+
+int BattleState::GetTilesInArea(int centerTileIndex, int radius, int maxHeightDifference, uint16_t* out_tiles) const
+{
+	int centerX = GetTileX(centerTileIndex);
+	int centerY = GetTileY(centerTileIndex);
+	int centerHeight = m_tileHeights[centerTileIndex];
+
+	int numTiles = 0;
+	for (int y = centerY - radius; y <= centerY + radius; y++)
+	{
+		for (int x = centerX - radius; x <= centerX + radius; x++)
+		{
+			if (!IsInMap(x, y) || abs(x - centerX) + abs(y - centerY) > radius)
+				continue;
+
+			int tileIndex = CalculateTileIndex(x, y);
+			if (abs(centerHeight - m_tileHeights[tileIndex]) <= maxHeightDifference)
+				out_tiles[numTiles++] = (uint16_t)tileIndex;
+		}
+	}
+
+	return numTiles;
+}
+
+int BattleState::CalculateAttackDamage(int attackerSlot, int defenderSlot) const
+{
+	int damageToDeal = m_attackPower[attackerSlot];
+	if (HasStatusEffect(defenderSlot, STATUS_WALL))
+	{
+		damageToDeal = (int)((float)damageToDeal * 0.5f);
+	}
+
+	return (int)floor((float)damageToDeal * m_attackDamageModifiers[attackerSlot][defenderSlot]);
+}
+
+int BattleState::CalculateAbilityDamage(int casterSlot, int abilityID, int targetSlot) const
+{
+	//Same mapping as Character::CalculateAbilityDamageToCharacter: faith 0-100 maps to 0.25x-2x power
+	float truePowerMultiplier = 0.25f + ((float)m_stats[STAT_FAITH][casterSlot] / 100.f) * 1.75f;
+	float truePower = truePowerMultiplier * m_abilityDefinitions[abilityID].m_power;
+
+	if (HasStatusEffect(targetSlot, STATUS_WALL))
+	{
+		truePower *= 0.5f;
+	}
+
+	return (int)truePower;
+}
+
+void BattleState::TickCT()
+{
+	for (int slot = 0; slot < m_numCharacters; slot++)
+	{
+		if (IsActive(slot))
+			m_currentCT[slot] += GetTickRate(slot);
+	}
+}
+
+int BattleState::AdvanceToNextTurn()
+{
+	int nextSlot = GetCharacterWithGreatestCT();
+	if (nextSlot < 0 || m_currentCT[nextSlot] >= BATTLE_TURN_CT)
+		return nextSlot;
+
+	bool hasNegativeTickRate = false;
+	int ticksToNextTurn = CTScheduler::NEVER_READY;
+	for (int slot = 0; slot < m_numCharacters; slot++)
+	{
+		if (!IsActive(slot))
+			continue;
+
+		int tickRate = GetTickRate(slot);
+		if (tickRate < 0)
+			hasNegativeTickRate = true;
+
+		int ticksToReady = CTScheduler::CalculateTicksToReady(m_currentCT[slot], tickRate);
+		if (ticksToReady != CTScheduler::NEVER_READY && (ticksToNextTurn == CTScheduler::NEVER_READY || ticksToReady < ticksToNextTurn))
+			ticksToNextTurn = ticksToReady;
+	}
+
+	if (ticksToNextTurn == CTScheduler::NEVER_READY)
+		return -1;
+
+	if (hasNegativeTickRate)
+	{
+		while (nextSlot >= 0 && m_currentCT[nextSlot] < BATTLE_TURN_CT)
+		{
+			TickCT();
+			nextSlot = GetCharacterWithGreatestCT();
+		}
+		return nextSlot;
+	}
+
+	for (int slot = 0; slot < m_numCharacters; slot++)
+	{
+		if (IsActive(slot))
+			m_currentCT[slot] += ticksToNextTurn * GetTickRate(slot);
+	}
+
+	return GetCharacterWithGreatestCT();
+}
+
+BattleTurnResult BattleState::StartTurn(int slot)
+{
+	if (m_isDead[slot])
+	{
+		m_currentHP[slot]--;
+		m_currentCT[slot] = 0;
+		if (m_currentHP[slot] <= BATTLE_CORPSE_HP)
+		{
+			RemoveCharacter(slot);
+			return TURN_RESULT_CORPSE_REMOVED;
+		}
+
+		return TURN_RESULT_CORPSE_DECAYED;
+	}
+
+	bool diedFromPoison = false;
+	if (HasStatusEffect(slot, STATUS_POISON))
+	{
+		ApplyDamage(slot, (int)((float)m_stats[STAT_MAX_HP][slot] * 0.1f));
+		if (m_isDead[slot])
+		{
+			EndTurn(slot, 0);
+			diedFromPoison = true;
+		}
+	}
+
+	if (m_pendingAbilities[slot] != INVALID_BATTLE_INDEX)
+	{
+		ResolvePendingAbility(slot);
+		return TURN_RESULT_RESOLVED_ABILITY;
+	}
+
+	if (diedFromPoison)
+		return TURN_RESULT_DIED_FROM_POISON;
+
+	return TURN_RESULT_READY;
+}
+
+void BattleState::EndTurn(int slot, int remainingCT)
+{
+	m_currentCT[slot] = remainingCT;
+	DecrementEffectDurations(slot);
+}
+
+void BattleState::Wait(int slot)
+{
+	EndTurn(slot, BATTLE_WAIT_CT);
+}
+
+bool BattleState::ApplyMove(int slot, int destinationTileIndex)
+{
+	if (destinationTileIndex < 0 || destinationTileIndex >= m_numTiles || m_tileOccupants[destinationTileIndex] != INVALID_BATTLE_INDEX)
+		return false;
+
+	m_tileOccupants[m_tileIndices[slot]] = INVALID_BATTLE_INDEX;
+	m_tileOccupants[destinationTileIndex] = (uint8_t)slot;
+	m_tileIndices[slot] = (uint16_t)destinationTileIndex;
+
+	EndTurn(slot, 0);
+	return true;
+}
+
+void BattleState::ApplyAttack(int attackerSlot, int defenderSlot)
+{
+	ApplyDamage(defenderSlot, CalculateAttackDamage(attackerSlot, defenderSlot));
+	EndTurn(attackerSlot, 0);
+}
+
+//Game::UseAbilityWithCharacter: a fast enough ability goes off now, anything slower waits for the caster's next turn
+void BattleState::ApplyAbility(int casterSlot, int abilityID, int targetTileIndex, int targetSlot)
+{
+	if (m_abilityDefinitions[abilityID].m_speed < BATTLE_TURN_CT)
+	{
+		QueueAbility(casterSlot, abilityID, targetTileIndex, targetSlot);
+		return;
+	}
+
+	SetPendingAbility(casterSlot, abilityID, targetTileIndex, targetSlot);
+	ResolvePendingAbility(casterSlot);
+}
+
+//AbilityBehavior::Act: the AI always ends its turn on the ability and lets the next turn resolve it, whatever its speed
+void BattleState::QueueAbility(int casterSlot, int abilityID, int targetTileIndex, int targetSlot)
+{
+	SetPendingAbility(casterSlot, abilityID, targetTileIndex, targetSlot);
+	EndTurn(casterSlot, 0);
+}
+
+void BattleState::SetPendingAbility(int casterSlot, int abilityID, int targetTileIndex, int targetSlot)
+{
+	m_pendingAbilities[casterSlot] = (uint8_t)abilityID;
+	m_pendingTargetTiles[casterSlot] = (targetTileIndex >= 0) ? (uint16_t)targetTileIndex : INVALID_BATTLE_TILE;
+	m_pendingTargetCharacters[casterSlot] = (targetSlot >= 0) ? (uint8_t)targetSlot : INVALID_BATTLE_INDEX;
+}
+
+void BattleState::ResolvePendingAbility(int casterSlot)
+{
+	int abilityID = m_pendingAbilities[casterSlot];
+	const BattleAbility& ability = m_abilityDefinitions[abilityID];
+	m_currentCT[casterSlot] = 0;
+
+	//A character target is followed to wherever it stands now, same as Character::ApplyAbilityEffectToArea
+	int centerTileIndex = m_pendingTargetTiles[casterSlot];
+	int targetSlot = m_pendingTargetCharacters[casterSlot];
+	if (targetSlot != INVALID_BATTLE_INDEX && IsActive(targetSlot))
+		centerTileIndex = m_tileIndices[targetSlot];
+
+	if (centerTileIndex != INVALID_BATTLE_TILE)
+	{
+		uint16_t areaTiles[MAX_BATTLE_TILES];
+		int numAreaTiles = GetTilesInArea(centerTileIndex, ability.m_radius, ability.m_areaMaxHeightDifference, areaTiles);
+		for (int areaIndex = 0; areaIndex < numAreaTiles; areaIndex++)
+		{
+			int affectedSlot = m_tileOccupants[areaTiles[areaIndex]];
+			if (affectedSlot == INVALID_BATTLE_INDEX)
+				continue;
+
+			ApplyDamage(affectedSlot, CalculateAbilityDamage(casterSlot, abilityID, affectedSlot));
+			for (int effectIndex = 0; effectIndex < NUM_STATUS_EFFECTS; effectIndex++)
+			{
+				if (ability.m_statusEffectDurations[effectIndex] > 0)
+					AddStatusEffect(affectedSlot, (StatusEffectType)effectIndex, ability.m_statusEffectDurations[effectIndex]);
+			}
+		}
+	}
+
+	m_pendingAbilities[casterSlot] = INVALID_BATTLE_INDEX;
+	m_pendingTargetCharacters[casterSlot] = INVALID_BATTLE_INDEX;
+	m_pendingTargetTiles[casterSlot] = INVALID_BATTLE_TILE;
+	EndTurn(casterSlot, 0);
+}
+
+void BattleState::ApplyDamage(int slot, int damageToDeal)
+{
+	m_currentHP[slot] -= damageToDeal;
+	if (m_currentHP[slot] > m_stats[STAT_MAX_HP][slot])
+		m_currentHP[slot] = m_stats[STAT_MAX_HP][slot];
+
+	if (m_currentHP[slot] <= 0)
+	{
+		m_currentHP[slot] = 0;
+		m_isDead[slot] = 1;
+	}
+}
+
+void BattleState::AddStatusEffect(int slot, StatusEffectType type, int duration)
+{
+	if (duration > 255)
+		duration = 255;
+
+	if (!HasStatusEffect(slot, type) || m_statusEffectDurations[type][slot] < duration)
+		m_statusEffectDurations[type][slot] = (uint8_t)duration;
+
+	m_statusEffectBits[slot] |= (uint8_t)(1 << type);
+}
+
+void BattleState::DecrementEffectDurations(int slot)
+{
+	for (int effectIndex = 0; effectIndex < NUM_STATUS_EFFECTS; effectIndex++)
+	{
+		if (!HasStatusEffect(slot, (StatusEffectType)effectIndex))
+			continue;
+
+		if (m_statusEffectDurations[effectIndex][slot] <= 1)
+		{
+			m_statusEffectDurations[effectIndex][slot] = 0;
+			m_statusEffectBits[slot] &= (uint8_t)~(1 << effectIndex);
+		}
+		else
+		{
+			m_statusEffectDurations[effectIndex][slot]--;
+		}
+	}
+}
+
+void BattleState::RemoveCharacter(int slot)
+{
+	for (int otherSlot = 0; otherSlot < m_numCharacters; otherSlot++)
+	{
+		if (m_pendingTargetCharacters[otherSlot] == slot)
+			m_pendingTargetCharacters[otherSlot] = INVALID_BATTLE_INDEX;
+	}
+
+	m_tileOccupants[m_tileIndices[slot]] = INVALID_BATTLE_INDEX;
+	m_isRemoved[slot] = 1;
+}
@@ -0,0 +1,139 @@
+#pragma once
+#include "Game/Stats.hpp"
+#include "Game/StatusEffectType.hpp"
+#include "Game/BehaviorKind.hpp"
+#include <stdint.h>
+#include <type_traits>
+
+
+const int MAX_BATTLE_TILES = 1024;
+const int MAX_BATTLE_CHARACTERS = 16;
+const int MAX_BATTLE_ABILITIES = 32;
+const int MAX_CHARACTER_ABILITIES = 8;
+const int MAX_CHARACTER_BEHAVIORS = 8;
+const uint8_t INVALID_BATTLE_INDEX = 0xFF;
+const uint16_t INVALID_BATTLE_TILE = 0xFFFF;
+
+//A character's ID for the whole battle: on the wire, in replays and in saves. Slots are only positions in a BattleState.
+typedef uint16_t CharacterID;
+
+const int BATTLE_TURN_CT = 100;
+const int BATTLE_WAIT_CT = 20;
+const int BATTLE_CORPSE_HP = -4;
+
+enum BattleTileFlag
+{
+	TILE_FLAG_TRAVERSABLE = 1 << 0,
+	TILE_FLAG_OPAQUE = 1 << 1
+};
+
+enum BattleTurnResult
+{
+	TURN_RESULT_NONE,
+	TURN_RESULT_CORPSE_DECAYED,
+	TURN_RESULT_CORPSE_REMOVED,
+	TURN_RESULT_DIED_FROM_POISON,
+	TURN_RESULT_RESOLVED_ABILITY,
+	TURN_RESULT_READY
+};
+
+
+struct BattleAbility
+{
+	int16_t m_range;
+	int16_t m_radius;
+	int16_t m_maxHeightDifference;
+	int16_t m_areaMaxHeightDifference;
+	int m_power;
+	int m_speed;
+	uint8_t m_statusEffectDurations[NUM_STATUS_EFFECTS];
+};
+
+
+//Plain-old-data copy of everything the rules need. Arrays are laid out per field so a whole
+//battle can be cloned with a single assignment and scanned without touching unrelated data.
+struct BattleState
+{
+	//Map
+	int m_mapWidth;
+	int m_mapHeight;
+	int m_numTiles;
+	int16_t m_tileHeights[MAX_BATTLE_TILES];
+	uint8_t m_tileDefinitionIDs[MAX_BATTLE_TILES];
+	uint8_t m_tileFlags[MAX_BATTLE_TILES];
+	uint8_t m_tileOccupants[MAX_BATTLE_TILES];
+
+	//Characters, in Map::m_characters order
+	int m_numCharacters;
+	CharacterID m_characterIndices[MAX_BATTLE_CHARACTERS];
+	uint8_t m_owningPlayers[MAX_BATTLE_CHARACTERS];
+	uint8_t m_factions[MAX_BATTLE_CHARACTERS];
+	uint8_t m_isAIControlled[MAX_BATTLE_CHARACTERS];
+	uint8_t m_isDead[MAX_BATTLE_CHARACTERS];
+	uint8_t m_isRemoved[MAX_BATTLE_CHARACTERS];
+	uint16_t m_tileIndices[MAX_BATTLE_CHARACTERS];
+	int m_currentHP[MAX_BATTLE_CHARACTERS];
+	int m_currentCT[MAX_BATTLE_CHARACTERS];
+	int m_stats[NUM_STATS][MAX_BATTLE_CHARACTERS];
+	int m_attackPower[MAX_BATTLE_CHARACTERS];
+	int m_attackRanges[MAX_BATTLE_CHARACTERS];
+	int m_maxAttackHeightDifferences[MAX_BATTLE_CHARACTERS];
+	float m_attackDamageModifiers[MAX_BATTLE_CHARACTERS][MAX_BATTLE_CHARACTERS];
+
+	uint8_t m_statusEffectBits[MAX_BATTLE_CHARACTERS];
+	uint8_t m_statusEffectDurations[NUM_STATUS_EFFECTS][MAX_BATTLE_CHARACTERS];
+
+	uint8_t m_numAbilities[MAX_BATTLE_CHARACTERS];
+	uint8_t m_abilities[MAX_BATTLE_CHARACTERS][MAX_CHARACTER_ABILITIES];
+	uint8_t m_pendingAbilities[MAX_BATTLE_CHARACTERS];
+	uint8_t m_pendingTargetCharacters[MAX_BATTLE_CHARACTERS];
+	uint16_t m_pendingTargetTiles[MAX_BATTLE_CHARACTERS];
+
+	//Behavior kinds in evaluation order, for headless AI
+	uint8_t m_numBehaviors[MAX_BATTLE_CHARACTERS];
+	uint8_t m_behaviorKinds[MAX_BATTLE_CHARACTERS][MAX_CHARACTER_BEHAVIORS];
+
+	//Ability table shared by every character
+	int m_numAbilityDefinitions;
+	BattleAbility m_abilityDefinitions[MAX_BATTLE_ABILITIES];
+
+	void Clear();
+
+	//Queries
+	int CalculateTileIndex(int x, int y) const { return y * m_mapWidth + x; }
+	int GetTileX(int tileIndex) const { return tileIndex % m_mapWidth; }
+	int GetTileY(int tileIndex) const { return tileIndex / m_mapWidth; }
+	bool IsInMap(int x, int y) const { return x >= 0 && y >= 0 && x < m_mapWidth && y < m_mapHeight; }
+	int CalculateManhattanDistance(int tileIndexA, int tileIndexB) const;
+	int FindCharacterSlot(CharacterID characterIndex) const;
+	int GetCharacterWithGreatestCT() const;
+	int GetTickRate(int slot) const;
+	bool HasStatusEffect(int slot, StatusEffectType type) const { return (m_statusEffectBits[slot] & (1 << type)) != 0; }
+	bool IsActive(int slot) const { return !m_isRemoved[slot]; }
+	bool IsTileTraversableFromHeight(int slot, int tileIndex, int fromHeight) const;
+	int GetTraversableTiles(int slot, int startTileIndex, uint16_t* out_tiles) const;
+	int GetTilesInArea(int centerTileIndex, int radius, int maxHeightDifference, uint16_t* out_tiles) const;
+
+	//Damage
+	int CalculateAttackDamage(int attackerSlot, int defenderSlot) const;
+	int CalculateAbilityDamage(int casterSlot, int abilityID, int targetSlot) const;
+
+	//Rules
+	void TickCT();
+	int AdvanceToNextTurn();
+	BattleTurnResult StartTurn(int slot);
+	void EndTurn(int slot, int remainingCT);
+	void Wait(int slot);
+	bool ApplyMove(int slot, int destinationTileIndex);
+	void ApplyAttack(int attackerSlot, int defenderSlot);
+	void ApplyAbility(int casterSlot, int abilityID, int targetTileIndex, int targetSlot);
+	void QueueAbility(int casterSlot, int abilityID, int targetTileIndex, int targetSlot);
+	void SetPendingAbility(int casterSlot, int abilityID, int targetTileIndex, int targetSlot);
+	void ResolvePendingAbility(int casterSlot);
+	void ApplyDamage(int slot, int damageToDeal);
+	void AddStatusEffect(int slot, StatusEffectType type, int duration);
+	void DecrementEffectDurations(int slot);
+	void RemoveCharacter(int slot);
+};
+
+static_assert(std::is_trivially_copyable<BattleState>::value, "BattleState must stay trivially copyable");
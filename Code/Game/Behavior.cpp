@@ -1,46 +1,133 @@
 #include "Game/Behavior.hpp"
 #include <string>
-#include "Game/CloseToAttackBehavior.hpp"
-#include "Game/FleeBehavior.hpp"
 #include "Engine/Core/ErrorWarningAssert.hpp"
 #include "Engine/Core/EngineConfig.hpp"
-#include "Game/AttackBehavior.hpp"
 #include "Game/Character.hpp"
-#include "Game/WaitBehavior.hpp"
-#include "Game/AbilityBehavior.hpp"
 
 Behavior::Behavior()
+	: m_kind(BEHAVIOR_WAIT)
+	, m_wait()
 {
 
 }
 
-Behavior::~Behavior()
+Behavior::Behavior(const CloseToAttackBehavior& closeToAttack)
+	: m_kind(BEHAVIOR_CLOSE_TO_ATTACK)
+	, m_closeToAttack(closeToAttack)
 {
 
 }
 
+Behavior::Behavior(const AttackBehavior& attack)
+	: m_kind(BEHAVIOR_ATTACK)
+	, m_attack(attack)
+{
+
+}
+
+Behavior::Behavior(const WaitBehavior& wait)
+	: m_kind(BEHAVIOR_WAIT)
+	, m_wait(wait)
+{
+
+}
+
+Behavior::Behavior(const AbilityBehavior& ability)
+	: m_kind(BEHAVIOR_ABILITY)
+	, m_ability(ability)
+{
+
+}
+
+Behavior::Behavior(const FleeBehavior& flee)
+	: m_kind(BEHAVIOR_FLEE)
+	, m_flee(flee)
+{
+
+}
+
+void Behavior::Act(Character* actingCharacter)
+{
+	auto actVisitor = [actingCharacter](auto& behavior) { behavior.Act(actingCharacter); };
+	Visit(actVisitor);
+}
+
 float Behavior::CalcUtility(Character* actingCharacter, Tile* tileToActFrom /*= nullptr*/) const
 {
-	UNUSED(actingCharacter);
-	UNUSED(tileToActFrom);
-	return 0.f;
+	auto utilityVisitor = [actingCharacter, tileToActFrom](const auto& behavior) { return behavior.CalcUtility(actingCharacter, tileToActFrom); };
+	return Visit(utilityVisitor);
+}
+
+void Behavior::DebugRender(const Character* actingCharacter) const
+{
+	auto debugRenderVisitor = [actingCharacter](const auto& behavior) { behavior.DebugRender(actingCharacter); };
+	Visit(debugRenderVisitor);
+}
+
+const char* Behavior::GetName() const
+{
+	return GetKindName(m_kind);
 }
 
-Behavior* Behavior::Create(XMLNode element)
+const char* Behavior::GetKindName(BehaviorKind kind)
+{
+	switch (kind)
+	{
+	case BEHAVIOR_CLOSE_TO_ATTACK:
+		return "CloseToAttack";
+	case BEHAVIOR_ATTACK:
+		return "Attack";
+	case BEHAVIOR_WAIT:
+		return "Wait";
+	case BEHAVIOR_ABILITY:
+		return "Ability";
+	case BEHAVIOR_FLEE:
+		return "Flee";
+	default:
+		return "Unknown";
+	}
+}
+
+Behavior Behavior::Create(XMLNode element)
 {
 	std::string elementName = element.getName();
 
 	if (elementName == "CloseToAttack")
-		return new CloseToAttackBehavior(element);
+		return Behavior(CloseToAttackBehavior(element));
 
 	if (elementName == "Attack")
-		return new AttackBehavior(element);
+		return Behavior(AttackBehavior(element));
 
 	if (elementName == "Wait")
-		return new WaitBehavior(element);
+		return Behavior(WaitBehavior(element));
 
 	if (elementName == "Ability")
-		return new AbilityBehavior(element);
+		return Behavior(AbilityBehavior(element));
 
 	ERROR_AND_DIE("Invalid behavior name.");
 }
+
+
+BehaviorSet::BehaviorSet()
+	: m_numBehaviors(0)
+{
+
+}
+
+void BehaviorSet::push_back(const Behavior& behavior)
+{
+	ASSERT_OR_DIE(m_numBehaviors < MAX_BEHAVIORS, "Too many behaviors on one character.");
+	m_behaviors[m_numBehaviors] = behavior;
+	m_numBehaviors++;
+}
+
+int BehaviorSet::FindFirstOfKind(BehaviorKind kind) const
+{
+	for (size_t behaviorIndex = 0; behaviorIndex < m_numBehaviors; behaviorIndex++)
+	{
+		if (m_behaviors[behaviorIndex].m_kind == kind)
+			return (int)behaviorIndex;
+	}
+
+	return -1;
+}
@@ -1,21 +1,121 @@
 #pragma once
 #include "ThirdParty\XMLParser\XMLParser.hpp"
-#include <string>
+#include "Game/CloseToAttackBehavior.hpp"
+#include "Game/AttackBehavior.hpp"
+#include "Game/WaitBehavior.hpp"
+#include "Game/AbilityBehavior.hpp"
+#include "Game/FleeBehavior.hpp"
+#include "Game/BehaviorKind.hpp"
+#include <type_traits>
+#include <stddef.h>
 
 class Character;
 class Tile;
 
+
+//Closed set of behaviors stored inline. Dispatch is a switch on m_kind instead of a virtual call,
+//so copying a character's behaviors is a plain memberwise copy with no heap clones.
 class Behavior
 {
 public:
 	Behavior();
-	virtual ~Behavior();
+	Behavior(const CloseToAttackBehavior& closeToAttack);
+	Behavior(const AttackBehavior& attack);
+	Behavior(const WaitBehavior& wait);
+	Behavior(const AbilityBehavior& ability);
+	Behavior(const FleeBehavior& flee);
+
+	void Act(Character* actingCharacter);
+	float CalcUtility(Character* actingCharacter, Tile* tileToActFrom = nullptr) const;
+	void DebugRender(const Character* actingCharacter) const;
+	const char* GetName() const;
+
+	static const char* GetKindName(BehaviorKind kind);
+	static Behavior Create(XMLNode element);
+
+	template<typename Visitor>
+	auto Visit(Visitor& visitor) -> decltype(visitor(std::declval<WaitBehavior&>()));
+	template<typename Visitor>
+	auto Visit(Visitor& visitor) const -> decltype(visitor(std::declval<const WaitBehavior&>()));
+
+public:
+	BehaviorKind m_kind;
+	union
+	{
+		CloseToAttackBehavior m_closeToAttack;
+		AttackBehavior m_attack;
+		WaitBehavior m_wait;
+		AbilityBehavior m_ability;
+		FleeBehavior m_flee;
+	};
+};
+
+static_assert(std::is_trivially_copyable<Behavior>::value, "Behavior must stay trivially copyable so characters can copy their behaviors by value");
+
+
+template<typename Visitor>
+auto Behavior::Visit(Visitor& visitor) -> decltype(visitor(std::declval<WaitBehavior&>()))
+{
+	switch (m_kind)
+	{
+	case BEHAVIOR_CLOSE_TO_ATTACK:
+		return visitor(m_closeToAttack);
+	case BEHAVIOR_ATTACK:
+		return visitor(m_attack);
+	case BEHAVIOR_ABILITY:
+		return visitor(m_ability);
+	case BEHAVIOR_FLEE:
+		return visitor(m_flee);
+	case BEHAVIOR_WAIT:
+	default:
+		return visitor(m_wait);
+	}
+}
+
+template<typename Visitor>
+auto Behavior::Visit(Visitor& visitor) const -> decltype(visitor(std::declval<const WaitBehavior&>()))
+{
+	switch (m_kind)
+	{
+	case BEHAVIOR_CLOSE_TO_ATTACK:
+		return visitor(m_closeToAttack);
+	case BEHAVIOR_ATTACK:
+		return visitor(m_attack);
+	case BEHAVIOR_ABILITY:
+		return visitor(m_ability);
+	case BEHAVIOR_FLEE:
+		return visitor(m_flee);
+	case BEHAVIOR_WAIT:
+	default:
+		return visitor(m_wait);
+	}
+}
+
+
+//Fixed-capacity list of behaviors kept inside the owning character or builder.
+class BehaviorSet
+{
+public:
+	static const size_t MAX_BEHAVIORS = 8;
+
+	BehaviorSet();
+
+	void push_back(const Behavior& behavior);
+	void clear() { m_numBehaviors = 0; }
+	size_t size() const { return m_numBehaviors; }
+	bool empty() const { return m_numBehaviors == 0; }
+
+	Behavior& operator[](size_t behaviorIndex) { return m_behaviors[behaviorIndex]; }
+	const Behavior& operator[](size_t behaviorIndex) const { return m_behaviors[behaviorIndex]; }
+
+	Behavior* begin() { return m_behaviors; }
+	Behavior* end() { return m_behaviors + m_numBehaviors; }
+	const Behavior* begin() const { return m_behaviors; }
+	const Behavior* end() const { return m_behaviors + m_numBehaviors; }
 
-	virtual void Act(Character* actingCharacter) = 0;
-	virtual float CalcUtility(Character* actingCharacter, Tile* tileToActFrom = nullptr) const;
+	int FindFirstOfKind(BehaviorKind kind) const;
 
-	virtual void DebugRender(const Character* actingCharacter) const = 0;
-	virtual std::string GetName() const = 0;
-	virtual Behavior* Clone() = 0;
-	static Behavior* Create(XMLNode element);
-};
\ No newline at end of file
+private:
+	Behavior m_behaviors[MAX_BEHAVIORS];
+	size_t m_numBehaviors;
+};
@@ -0,0 +1,12 @@
+#pragma once
+
+
+enum BehaviorKind
+{
+	BEHAVIOR_CLOSE_TO_ATTACK,
+	BEHAVIOR_ATTACK,
+	BEHAVIOR_WAIT,
+	BEHAVIOR_ABILITY,
+	BEHAVIOR_FLEE,
+	NUM_BEHAVIOR_KINDS
+};
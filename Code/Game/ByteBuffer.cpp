@@ -0,0 +1,267 @@
+#include "Game/ByteBuffer.hpp"
+#include <string.h>
+
+
+ByteBuffer::ByteBuffer()
+	: m_bytes()
+	, m_pendingWriteBits(0)
+	, m_numPendingWriteBits(0)
+{
+
+}
+
+void ByteBuffer::Clear()
+{
+	m_bytes.clear();
+	m_pendingWriteBits = 0;
+	m_numPendingWriteBits = 0;
+}
+
+void ByteBuffer::WriteByte(uint8_t value)
+{
+	FlushBits();
+	m_bytes.push_back(value);
+}
+
+void ByteBuffer::WriteBytes(const void* data, size_t numBytes)
+{
+	FlushBits();
+	const uint8_t* bytes = (const uint8_t*)data;
+	m_bytes.insert(m_bytes.end(), bytes, bytes + numBytes);
+}
+
+void ByteBuffer::WriteUint16(uint16_t value)
+{
+	WriteByte((uint8_t)(value & 0xFF));
+	WriteByte((uint8_t)(value >> 8));
+}
+
+void ByteBuffer::WriteUint32(uint32_t value)
+{
+	WriteByte((uint8_t)(value & 0xFF));
+	WriteByte((uint8_t)((value >> 8) & 0xFF));
+	WriteByte((uint8_t)((value >> 16) & 0xFF));
+	WriteByte((uint8_t)(value >> 24));
+}
+
+void ByteBuffer::WriteVarint(uint64_t value)
+{
+	FlushBits();
+	while (value >= 0x80)
+	{
+		m_bytes.push_back((uint8_t)(value | 0x80));
+		value >>= 7;
+	}
+	m_bytes.push_back((uint8_t)value);
+}
+
+void ByteBuffer::WriteSignedVarint(int64_t value)
+{
+	WriteVarint(ZigZagEncode(value));
+}
+
+void ByteBuffer::WriteBits(uint32_t value, int numBits)
+{
+	for (int bitIndex = 0; bitIndex < numBits; bitIndex++)
+	{
+		m_pendingWriteBits |= ((value >> bitIndex) & 1) << m_numPendingWriteBits;
+		m_numPendingWriteBits++;
+		if (m_numPendingWriteBits == 8)
+		{
+			m_bytes.push_back((uint8_t)m_pendingWriteBits);
+			m_pendingWriteBits = 0;
+			m_numPendingWriteBits = 0;
+		}
+	}
+}
+
+void ByteBuffer::FlushBits()
+{
+	if (m_numPendingWriteBits == 0)
+		return;
+
+	m_bytes.push_back((uint8_t)m_pendingWriteBits);
+	m_pendingWriteBits = 0;
+	m_numPendingWriteBits = 0;
+}
+
+int ByteBuffer::CalculateBitsNeeded(uint32_t maxValue)
+{
+	int numBits = 0;
+	while (maxValue > 0)
+	{
+		numBits++;
+		maxValue >>= 1;
+	}
+
+	return numBits;
+}
+
+
+ByteReader::ByteReader()
+	: m_data(nullptr)
+	, m_size(0)
+	, m_readOffset(0)
+	, m_numReadBits(0)
+	, m_hasOverrun(false)
+{
+
+}
+
+ByteReader::ByteReader(const void* data, size_t numBytes)
+	: m_data((const uint8_t*)data)
+	, m_size(numBytes)
+	, m_readOffset(0)
+	, m_numReadBits(0)
+	, m_hasOverrun(false)
+{
+
+}
+
+ByteReader::ByteReader(const ByteBuffer& buffer)
+	: ByteReader(buffer.GetData(), buffer.GetSize())
+{
+
+}
+
+uint8_t ByteReader::ReadByte()
+{
+	AlignToByte();
+	if (m_readOffset >= m_size)
+	{
+		m_hasOverrun = true;
+		return 0;
+	}
+
+	return m_data[m_readOffset++];
+}
+
+bool ByteReader::ReadBytes(void* out_data, size_t numBytes)
+{
+	const uint8_t* bytes = SkipBytes(numBytes);
+	if (nullptr == bytes)
+	{
+		memset(out_data, 0, numBytes);
+		return false;
+	}
+
+	memcpy(out_data, bytes, numBytes);
+	return true;
+}
+
+const uint8_t* ByteReader::SkipBytes(size_t numBytes)
+{
+	AlignToByte();
+	if (GetRemainingBytes() < numBytes)
+	{
+		m_hasOverrun = true;
+		return nullptr;
+	}
+
+	const uint8_t* bytes = m_data + m_readOffset;
+	m_readOffset += numBytes;
+	return bytes;
+}
+
+uint16_t ByteReader::ReadUint16()
+{
+	uint16_t value = ReadByte();
+	value |= (uint16_t)ReadByte() << 8;
+	return value;
+}
+
+uint32_t ByteReader::ReadUint32()
+{
+	uint32_t value = ReadByte();
+	value |= (uint32_t)ReadByte() << 8;
+	value |= (uint32_t)ReadByte() << 16;
+	value |= (uint32_t)ReadByte() << 24;
+	return value;
+}
+
+uint64_t ByteReader::ReadVarint()
+{
+	uint64_t value = 0;
+	for (int shift = 0; shift < 64; shift += 7)
+	{
+		uint8_t byte = ReadByte();
+		value |= (uint64_t)(byte & 0x7F) << shift;
+		if ((byte & 0x80) == 0 || m_hasOverrun)
+			return value;
+	}
+
+	//More than ten bytes can't be a valid 64-bit varint
+	m_hasOverrun = true;
+	return value;
+}
+
+int64_t ByteReader::ReadSignedVarint()
+{
+	return ByteBuffer::ZigZagDecode(ReadVarint());
+}
+
+uint32_t ByteReader::ReadBits(int numBits)
+{
+	uint32_t value = 0;
+	for (int bitIndex = 0; bitIndex < numBits; bitIndex++)
+	{
+		if (m_readOffset >= m_size)
+		{
+			m_hasOverrun = true;
+			return value;
+		}
+
+		value |= (uint32_t)((m_data[m_readOffset] >> m_numReadBits) & 1) << bitIndex;
+		m_numReadBits++;
+		if (m_numReadBits == 8)
+		{
+			m_readOffset++;
+			m_numReadBits = 0;
+		}
+	}
+
+	return value;
+}
+
+void ByteReader::AlignToByte()
+{
+	if (m_numReadBits == 0)
+		return;
+
+	m_readOffset++;
+	m_numReadBits = 0;
+}
+
+
+struct CRC32Table
+{
+	CRC32Table()
+	{
+		for (uint32_t tableIndex = 0; tableIndex < 256; tableIndex++)
+		{
+			uint32_t entry = tableIndex;
+			for (int bitIndex = 0; bitIndex < 8; bitIndex++)
+			{
+				entry = (entry & 1) ? (0xEDB88320u ^ (entry >> 1)) : (entry >> 1);
+			}
+			m_entries[tableIndex] = entry;
+		}
+	}
+
+	uint32_t m_entries[256];
+};
+
+uint32_t CalculateCRC32(const void* data, size_t numBytes, uint32_t previousCRC /*= 0*/)
+{
+	//Standard reflected CRC-32 (zlib, PNG); the table is a function static so threads can share it
+	static const CRC32Table s_table;
+
+	const uint8_t* bytes = (const uint8_t*)data;
+	uint32_t crc = ~previousCRC;
+	for (size_t byteIndex = 0; byteIndex < numBytes; byteIndex++)
+	{
+		crc = s_table.m_entries[(crc ^ bytes[byteIndex]) & 0xFF] ^ (crc >> 8);
+	}
+
+	return ~crc;
+}
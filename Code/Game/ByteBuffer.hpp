@@ -0,0 +1,77 @@
+#pragma once
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+
+//Growable byte array with endian-neutral encoders: little-endian fixed-width integers,
+//LEB128 varints, zigzag signed varints and LSB-first bit packing.
+class ByteBuffer
+{
+public:
+	ByteBuffer();
+
+	void Clear();
+	void Reserve(size_t numBytes) { m_bytes.reserve(numBytes); }
+
+	void WriteByte(uint8_t value);
+	void WriteBytes(const void* data, size_t numBytes);
+	void WriteUint16(uint16_t value);
+	void WriteUint32(uint32_t value);
+	void WriteVarint(uint64_t value);
+	void WriteSignedVarint(int64_t value);
+	void WriteBits(uint32_t value, int numBits);
+	void FlushBits();
+
+	size_t GetSize() const { return m_bytes.size(); }
+	const uint8_t* GetData() const { return m_bytes.empty() ? nullptr : &m_bytes[0]; }
+
+	static uint64_t ZigZagEncode(int64_t value) { return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63); }
+	static int64_t ZigZagDecode(uint64_t value) { return (int64_t)(value >> 1) ^ -(int64_t)(value & 1); }
+	static int CalculateBitsNeeded(uint32_t maxValue);
+
+public:
+	std::vector<uint8_t> m_bytes;
+
+private:
+	uint32_t m_pendingWriteBits;
+	int m_numPendingWriteBits;
+};
+
+
+//Decodes what ByteBuffer writes, straight out of memory it doesn't own (a ByteBuffer, a mapped file, a packet).
+//Reads past the end return zero and set m_hasOverrun instead of asserting, so callers can reject bad data.
+class ByteReader
+{
+public:
+	ByteReader();
+	ByteReader(const void* data, size_t numBytes);
+	explicit ByteReader(const ByteBuffer& buffer);
+
+	uint8_t ReadByte();
+	bool ReadBytes(void* out_data, size_t numBytes);
+	const uint8_t* SkipBytes(size_t numBytes);
+	uint16_t ReadUint16();
+	uint32_t ReadUint32();
+	uint64_t ReadVarint();
+	int64_t ReadSignedVarint();
+	uint32_t ReadBits(int numBits);
+	void AlignToByte();
+
+	void SetReadOffset(size_t offset) { m_readOffset = offset; m_numReadBits = 0; m_hasOverrun = false; }
+	size_t GetReadOffset() const { return m_readOffset; }
+	size_t GetRemainingBytes() const { return (m_readOffset < m_size) ? m_size - m_readOffset : 0; }
+	size_t GetSize() const { return m_size; }
+	const uint8_t* GetData() const { return m_data; }
+	bool HasOverrun() const { return m_hasOverrun; }
+
+private:
+	const uint8_t* m_data;
+	size_t m_size;
+	size_t m_readOffset;
+	int m_numReadBits;
+	bool m_hasOverrun;
+};
+
+
+uint32_t CalculateCRC32(const void* data, size_t numBytes, uint32_t previousCRC = 0);
@@ -0,0 +1,92 @@
+#include "Game/ByteCompression.hpp"
+#include <string.h>
+
+
+const int COMPRESSION_HASH_BITS = 12;
+const uint32_t COMPRESSION_NO_POSITION = 0xFFFFFFFF;
+
+
+static uint32_t HashFourBytes(const uint8_t* bytes)
+{
+	uint32_t value;
+	memcpy(&value, bytes, sizeof(value));
+	return (value * 2654435761u) >> (32 - COMPRESSION_HASH_BITS);
+}
+
+static void WriteLiterals(ByteBuffer& out_buffer, const uint8_t* literals, size_t numLiterals)
+{
+	out_buffer.WriteVarint(numLiterals);
+	out_buffer.WriteBytes(literals, numLiterals);
+}
+
+
+void CompressBytes(const void* data, size_t numBytes, ByteBuffer& out_buffer)
+{
+	const uint8_t* bytes = (const uint8_t*)data;
+	uint32_t lastPositions[1 << COMPRESSION_HASH_BITS];
+	memset(lastPositions, 0xFF, sizeof(lastPositions));
+
+	out_buffer.Clear();
+	out_buffer.WriteVarint(numBytes);
+
+	//Greedy: take the most recent position with the same four bytes and extend it as far as it goes
+	size_t literalStart = 0;
+	size_t position = 0;
+	while (position + COMPRESSION_MIN_MATCH <= numBytes)
+	{
+		uint32_t hash = HashFourBytes(bytes + position);
+		uint32_t candidate = lastPositions[hash];
+		lastPositions[hash] = (uint32_t)position;
+		if (candidate == COMPRESSION_NO_POSITION || memcmp(bytes + candidate, bytes + position, COMPRESSION_MIN_MATCH) != 0)
+		{
+			position++;
+			continue;
+		}
+
+		size_t matchLength = COMPRESSION_MIN_MATCH;
+		while (position + matchLength < numBytes && bytes[candidate + matchLength] == bytes[position + matchLength])
+		{
+			matchLength++;
+		}
+
+		WriteLiterals(out_buffer, bytes + literalStart, position - literalStart);
+		out_buffer.WriteVarint(matchLength - COMPRESSION_MIN_MATCH);
+		out_buffer.WriteVarint(position - candidate);
+		position += matchLength;
+		literalStart = position;
+	}
+
+	WriteLiterals(out_buffer, bytes + literalStart, numBytes - literalStart);
+}
+
+bool DecompressBytes(ByteReader& reader, void* out_data, size_t numBytes)
+{
+	uint8_t* outBytes = (uint8_t*)out_data;
+	if (reader.ReadVarint() != numBytes)
+		return false;
+
+	size_t position = 0;
+	for (;;)
+	{
+		uint64_t numLiterals = reader.ReadVarint();
+		if (reader.HasOverrun() || numLiterals > numBytes - position || !reader.ReadBytes(outBytes + position, (size_t)numLiterals))
+			return false;
+
+		position += (size_t)numLiterals;
+		if (position == numBytes)
+			return true;
+
+		uint64_t matchLength = reader.ReadVarint() + COMPRESSION_MIN_MATCH;
+		uint64_t offset = reader.ReadVarint();
+		if (reader.HasOverrun() || offset == 0 || offset > position || matchLength > numBytes - position)
+			return false;
+
+		//Byte by byte, since a match can start inside the bytes it's copying
+		const uint8_t* source = outBytes + position - offset;
+		for (size_t byteIndex = 0; byteIndex < matchLength; byteIndex++)
+		{
+			outBytes[position + byteIndex] = source[byteIndex];
+		}
+		position += (size_t)matchLength;
+	}
+}
@@ -0,0 +1,11 @@
+#pragma once
+#include "Game/ByteBuffer.hpp"
+
+
+//Small LZ77 codec for state transfers, where fixed-size structs are mostly zeros and repeated rows.
+//Stream: [uncompressed size varint], then runs of [literal count varint][literals][match length - 4 varint][match offset varint].
+//The last run is literals only and ends exactly at the uncompressed size. Matches may overlap what they copy.
+const size_t COMPRESSION_MIN_MATCH = 4;
+
+void CompressBytes(const void* data, size_t numBytes, ByteBuffer& out_buffer);
+bool DecompressBytes(ByteReader& reader, void* out_data, size_t numBytes);
@@ -0,0 +1,76 @@
+#include "Game/CTScheduler.hpp"
+#include <algorithm>
+
+
+bool IsScheduledLater(const CTScheduleEntry& entryA, const CTScheduleEntry& entryB)
+{
+	if (entryA.m_readyTick != entryB.m_readyTick)
+		return entryA.m_readyTick > entryB.m_readyTick;
+
+	if (entryA.m_ctAtReady != entryB.m_ctAtReady)
+		return entryA.m_ctAtReady < entryB.m_ctAtReady;
+
+	return entryA.m_actorIndex < entryB.m_actorIndex;
+}
+
+
+CTScheduler::CTScheduler()
+	: m_heap()
+	, m_hasNegativeTickRate(false)
+{
+
+}
+
+void CTScheduler::Clear()
+{
+	m_heap.clear();
+	m_hasNegativeTickRate = false;
+}
+
+void CTScheduler::AddActor(size_t actorIndex, int currentCT, int tickRate, int currentTick /*= 0*/)
+{
+	if (tickRate < 0)
+		m_hasNegativeTickRate = true;
+
+	if (CalculateTicksToReady(currentCT, tickRate) == NEVER_READY)
+		return;
+
+	Push(MakeEntry(actorIndex, currentCT, tickRate, currentTick));
+}
+
+void CTScheduler::Push(const CTScheduleEntry& entry)
+{
+	m_heap.push_back(entry);
+	std::push_heap(m_heap.begin(), m_heap.end(), IsScheduledLater);
+}
+
+CTScheduleEntry CTScheduler::PopNext()
+{
+	std::pop_heap(m_heap.begin(), m_heap.end(), IsScheduledLater);
+	CTScheduleEntry nextEntry = m_heap.back();
+	m_heap.pop_back();
+	return nextEntry;
+}
+
+int CTScheduler::CalculateTicksToReady(int currentCT, int tickRate)
+{
+	if (currentCT >= TURN_CT)
+		return 0;
+
+	if (tickRate <= 0)
+		return NEVER_READY;
+
+	return (TURN_CT - currentCT + tickRate - 1) / tickRate;
+}
+
+CTScheduleEntry CTScheduler::MakeEntry(size_t actorIndex, int currentCT, int tickRate, int currentTick)
+{
+	int ticksToReady = CalculateTicksToReady(currentCT, tickRate);
+
+	CTScheduleEntry entry;
+	entry.m_readyTick = currentTick + ticksToReady;
+	entry.m_ctAtReady = currentCT + ticksToReady * tickRate;
+	entry.m_tickRate = tickRate;
+	entry.m_actorIndex = actorIndex;
+	return entry;
+}
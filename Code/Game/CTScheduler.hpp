@@ -0,0 +1,42 @@
+#pragma once
+#include <vector>
+#include <stddef.h>
+
+
+struct CTScheduleEntry
+{
+	int m_readyTick;
+	int m_ctAtReady;
+	int m_tickRate;
+	size_t m_actorIndex;
+};
+
+
+//Priority queue of the tick at which each actor next reaches 100 CT.
+//Ties break the same way as Map::GetCharacterWithGreatestCT: highest CT first, then the later actor.
+class CTScheduler
+{
+public:
+	CTScheduler();
+
+	void Clear();
+	void AddActor(size_t actorIndex, int currentCT, int tickRate, int currentTick = 0);
+	void Push(const CTScheduleEntry& entry);
+	CTScheduleEntry PopNext();
+
+	const CTScheduleEntry& PeekNext() const { return m_heap.front(); }
+	bool IsEmpty() const { return m_heap.empty(); }
+	size_t GetNumActors() const { return m_heap.size(); }
+	bool HasNegativeTickRate() const { return m_hasNegativeTickRate; }
+
+	static int CalculateTicksToReady(int currentCT, int tickRate);
+	static CTScheduleEntry MakeEntry(size_t actorIndex, int currentCT, int tickRate, int currentTick);
+
+	static const int TURN_CT = 100;
+	static const int WAIT_CT = 20;
+	static const int NEVER_READY = -1;
+
+private:
+	std::vector<CTScheduleEntry> m_heap;
+	bool m_hasNegativeTickRate;
+};
@@ -11,10 +11,11 @@
 #include <algorithm>
 #include "Engine/Math/Vector3.hpp"
 #include "Game/AbilityDefinition.hpp"
+#include "Game/AIPlanner.hpp"
+#include "Game/AITrace.hpp"
+#include "Game/AbilityDamageField.hpp"
 
 
-uint8_t Character::s_currentCharacterIndex = 1;
-
 Character::Character()
 	: m_stats()
 	, m_currentMap(nullptr)
@@ -30,8 +31,8 @@ Character::Character()
 	, m_currentlyRenderingStatusEffectIndex(0)
 	, m_statusEffectRenderingTimer(0.f)
 {
-	m_characterIndex = s_currentCharacterIndex;
-	s_currentCharacterIndex++;
+	//The map assigns the real ID when the character is placed
+	m_characterIndex = NO_CHARACTER_ID;
 }
 
 Character::~Character()
@@ -249,35 +250,26 @@ void Character::UpdateUsingAbility(float deltaSeconds)
 }
 
 void Character::TickCT()
+{
+	SetCurrentCT(m_currentCT + GetTickRate());
+}
+
+int Character::GetTickRate() const
 {
 	if (nullptr != m_currentAbility)
-	{
-		m_currentCT += m_currentAbility->m_speed;
-	}
-	else
-	{
-		m_currentCT += m_stats[STAT_SPEED];
-	}
+		return m_currentAbility->m_speed;
+
+	return m_stats[STAT_SPEED];
 }
 
 void Character::Act()
 {
-	g_theApp->m_game->WaitUntilRelease();
-
-	float maxUtility = -1.f;
-	for (size_t behaviorIndex = 0; behaviorIndex < m_behaviors.size(); behaviorIndex++)
+	AIPlanner planner;
+	planner.StartPlanning(this);
+	while (!planner.ContinuePlanning(-1.0))
 	{
-		float behaviorUtility = m_behaviors[behaviorIndex]->CalcUtility(this);
-		if (behaviorUtility > maxUtility)
-		{
-			maxUtility = behaviorUtility;
-			m_currentBehavior = m_behaviors[behaviorIndex];
-		}
 	}
-
-	m_currentBehavior->Act(this);
-
-	g_theApp->m_game->ReleaseWait();
+	planner.CommitDecision();
 }
 
 void Character::Rest()
@@ -308,12 +300,7 @@ void Character::MoveWest()
 void Character::Attack(Character* attackedCharacter)
 {
 	int damageToDeal = CalculateAttackDamage(attackedCharacter);
-
-	Tags damageTypes;
-	if (m_equipment.m_equippedItems[EQUIP_SLOT_PRIMARY_WEAPON])
-		damageTypes = m_equipment.m_equippedItems[EQUIP_SLOT_PRIMARY_WEAPON]->m_damageTypes;
-
-	attackedCharacter->ApplyDamage(damageToDeal, damageTypes);
+	attackedCharacter->ApplyDamage(damageToDeal, GetAttackDamageTypes());
 }
 
 void Character::StartAbility()
@@ -323,9 +310,27 @@ void Character::StartAbility()
 	else
 		UpdateHeading(m_targettedTile->m_tileCoords - m_currentTile->m_tileCoords);
 
+	if (g_theApp->m_game->m_resolveInstantly)
+	{
+		ResolveAbilityInstantly();
+		return;
+	}
+
 	g_theApp->m_game->WaitUntilRelease();
 	m_currentState = STATE_USING_ABILITY;
-	m_currentCT = 0;
+	SetCurrentCT(0);
+}
+
+void Character::ResolveAbilityInstantly()
+{
+	SetCurrentCT(0);
+	ApplyAbilityEffectToArea();
+	if (g_theApp->m_game->ShouldPlayActionVisuals())
+		AddSpriteEffectsToArea();
+
+	m_currentMap->m_isWaitingForInput = false;
+	m_currentAbility = nullptr;
+	g_theApp->m_game->EndTurn(this, 0);
 }
 
 void Character::ApplyAbilityEffectToArea()
@@ -343,7 +348,8 @@ void Character::ApplyAbilityEffectToArea()
 	std::vector<Tile*> tilesToAffect;
 	tilesToAffect = m_currentMap->GetAoETiles(centerTileToAffect->m_tileCoords, m_currentAbility->m_radius, m_currentAbility->m_areaMaxHeightDifference);
 
-	g_theAudio->PlaySoundAtVolume(m_currentAbility->m_soundEffect);
+	if (g_theApp->m_game->ShouldPlayActionVisuals())
+		g_theAudio->PlaySoundAtVolume(m_currentAbility->m_soundEffect);
 
 	for (Tile* tile : tilesToAffect)
 	{
@@ -358,11 +364,30 @@ void Character::StartMoving(Path newPath)
 {
 	m_currentPath = newPath;
 	m_moveTimer = 0.f;
+	if (g_theApp->m_game->m_resolveInstantly)
+	{
+		ResolveMoveInstantly();
+		return;
+	}
+
 	g_theApp->m_game->WaitUntilRelease();
 	m_currentState = STATE_MOVING;
 	UpdateHeading(m_currentPath.back()->m_tileCoords - m_currentTile->m_tileCoords);
 }
 
+void Character::ResolveMoveInstantly()
+{
+	//Same tile-by-tile steps as UpdateMoving, minus the walk between them
+	while (!m_currentPath.empty())
+	{
+		UpdateHeading(m_currentPath.back()->m_tileCoords - m_currentTile->m_tileCoords);
+		m_currentMap->TryToMoveCharacterToTile(this, m_currentPath.back());
+		m_currentPath.pop_back();
+	}
+
+	g_theApp->m_game->EndTurn(this, 0);
+}
+
 int Character::CalculateAttackDamage(Character* target)
 {
 	Stats modifiedAttackerStats = m_stats + m_equipment.CalculateCombinedStatModifiers();
@@ -377,49 +402,44 @@ int Character::CalculateAttackDamage(Character* target)
 	return damageToDeal;
 }
 
-int Character::CalculateMaxNetAttackDamage(Tile* tileToAttackFrom)
+float Character::CalcBehaviorUtility(size_t behaviorIndex, Tile* tileToActFrom)
 {
-	int maxNetDamage = 0;
-
-	std::vector<Tile*> targettableTiles = m_currentMap->GetTargettableTiles(tileToAttackFrom->m_tileCoords, m_attackRange, m_maxAttackHeightDifference);
-
-	for (Tile* tile : targettableTiles)
+	int tileIndex = m_currentMap->CalculateTileIndexFromTileCoords(tileToActFrom->m_tileCoords);
+	const UtilityMemoEntry* memoizedEntry = m_utilityMemo.Find(behaviorIndex, tileIndex);
+	if (nullptr != memoizedEntry)
 	{
-		if (nullptr != tile->m_occupyingCharacter && !tile->m_occupyingCharacter->m_isDead && tile->m_occupyingCharacter != this)
-		{
-			int potentialDamage = CalculateAttackDamage(tile->m_occupyingCharacter);
+		AITrace::IncrementCounter(AI_COUNTER_CACHE_HITS);
+		return memoizedEntry->m_utility;
+	}
 
-			//Attacking allies is bad
-			if (tile->m_occupyingCharacter->m_faction == m_faction)
-				potentialDamage *= -1;
+	AITrace::IncrementCounter(AI_COUNTER_CACHE_MISSES);
+	AITrace::IncrementCounter(AI_COUNTER_UTILITY_CALLS);
 
-			if (HasStatusEffect(STATUS_CHARM))
-			{
-				potentialDamage *= -1;
-			}
+	m_estimatedTarget = nullptr;
+	float utility = m_behaviors[behaviorIndex].CalcUtility(this, tileToActFrom);
+	m_utilityMemo.Store(behaviorIndex, tileIndex, utility, m_estimatedTarget);
 
-			if (HasStatusEffect(STATUS_CONFUSE))
-			{
-				if (g_random.GetRandomFloatZeroToOne() > 0.5f)
-				{
-					potentialDamage *= -1;
-				}
-			}
+	return utility;
+}
 
-			if (potentialDamage > maxNetDamage)
-				maxNetDamage = potentialDamage;
-		}
-	}
+const UtilityMemoEntry* Character::FindMemoizedUtility(BehaviorKind kind, Tile* tileToActFrom) const
+{
+	int behaviorIndex = m_behaviors.FindFirstOfKind(kind);
+	if (behaviorIndex < 0)
+		return nullptr;
 
-	return maxNetDamage;
+	return m_utilityMemo.Find((size_t)behaviorIndex, m_currentMap->CalculateTileIndexFromTileCoords(tileToActFrom->m_tileCoords));
 }
 
-Character* Character::CalculateBestAttackTarget()
+int Character::CalculateMaxNetAttackDamage(Tile* tileToAttackFrom, Character** out_bestTarget /*= nullptr*/)
 {
+	AITraceScope traceScope(AI_TIMER_DAMAGE_ESTIMATION);
+
 	int maxNetDamage = 0;
 	Character* bestTarget = nullptr;
 
-	std::vector<Tile*> targettableTiles = m_currentMap->GetTargettableTiles(m_currentTile->m_tileCoords, m_attackRange, m_maxAttackHeightDifference);
+	std::vector<Tile*> targettableTiles = m_currentMap->GetTargettableTiles(tileToAttackFrom->m_tileCoords, m_attackRange, m_maxAttackHeightDifference);
+	AITrace::IncrementCounter(AI_COUNTER_TARGETTABLE_TILES, (int)targettableTiles.size());
 
 	for (Tile* tile : targettableTiles)
 	{
@@ -452,14 +472,36 @@ Character* Character::CalculateBestAttackTarget()
 		}
 	}
 
+	if (nullptr != out_bestTarget)
+		*out_bestTarget = bestTarget;
+
+	return maxNetDamage;
+}
+
+Character* Character::CalculateBestAttackTarget()
+{
+	Character* bestTarget = nullptr;
+	CalculateMaxNetAttackDamage(m_currentTile, &bestTarget);
+
 	return bestTarget;
 }
 
 int Character::CalculateMaxNetAbilityDamage(AbilityDefinition* ability, Tile* tileToActFrom)
 {
+	AITraceScope traceScope(AI_TIMER_DAMAGE_ESTIMATION);
+
+	//Confused characters re-roll every estimate, so they can't share a precomputed field
+	if (!HasStatusEffect(STATUS_CONFUSE))
+	{
+		Tile* bestTile = nullptr;
+		const AbilityDamageField& damageField = m_currentMap->GetAbilityDamageField(this, ability);
+		return damageField.FindMaxNetDamageInRange(tileToActFrom, m_attackRange, m_maxAttackHeightDifference, bestTile);
+	}
+
 	int maxNetDamage = 0;
 
 	std::vector<Tile*> targettableTiles = m_currentMap->GetTargettableTiles(tileToActFrom->m_tileCoords, m_attackRange, m_maxAttackHeightDifference);
+	AITrace::IncrementCounter(AI_COUNTER_TARGETTABLE_TILES, (int)targettableTiles.size());
 
 	for (Tile* tile : targettableTiles)
 	{
@@ -474,6 +516,8 @@ int Character::CalculateMaxNetAbilityDamage(AbilityDefinition* ability, Tile* ti
 
 void Character::TargetAndSetBestAbility()
 {
+	AITraceScope traceScope(AI_TIMER_DAMAGE_ESTIMATION);
+
 	int maxNetDamage = 0;
 	Tile* tileTargetToSet = nullptr;
 	Character* characterTargetToSet = nullptr;
@@ -481,7 +525,31 @@ void Character::TargetAndSetBestAbility()
 
 	for (AbilityDefinition* ability : m_abilities)
 	{
+		if (!HasStatusEffect(STATUS_CONFUSE))
+		{
+			Tile* bestTile = nullptr;
+			const AbilityDamageField& damageField = m_currentMap->GetAbilityDamageField(this, ability);
+			int abilityNetDamage = damageField.FindMaxNetDamageInRange(m_currentTile, m_attackRange, m_maxAttackHeightDifference, bestTile);
+			if (abilityNetDamage > maxNetDamage)
+			{
+				maxNetDamage = abilityNetDamage;
+				abilityToSet = ability;
+				if (nullptr != bestTile->m_occupyingCharacter)
+				{
+					characterTargetToSet = bestTile->m_occupyingCharacter;
+					tileTargetToSet = nullptr;
+				}
+				else
+				{
+					characterTargetToSet = nullptr;
+					tileTargetToSet = bestTile;
+				}
+			}
+			continue;
+		}
+
 		std::vector<Tile*> targettableTiles = m_currentMap->GetTargettableTiles(m_currentTile->m_tileCoords, m_attackRange, m_maxAttackHeightDifference);
+		AITrace::IncrementCounter(AI_COUNTER_TARGETTABLE_TILES, (int)targettableTiles.size());
 
 		for (Tile* tile : targettableTiles)
 		{
@@ -541,12 +609,15 @@ void Character::AddStatusEffect(StatusEffectType type, int duration)
 	StatusEffect* foundEffect = GetStatusEffect(type);
 	if (nullptr != foundEffect)
 	{
-		foundEffect->m_remainingDuration = std::max(foundEffect->m_remainingDuration, duration);
+		int newDuration = std::max(foundEffect->m_remainingDuration, duration);
+		UpdateStateHash((StateHashFeature)(HASH_FEATURE_FIRST_STATUS_EFFECT + type), foundEffect->m_remainingDuration, newDuration);
+		foundEffect->m_remainingDuration = newDuration;
 	}
 	else
 	{
 		StatusEffect* newEffect = new StatusEffect(type, duration);
 		m_statusEffects.push_back(newEffect);
+		ToggleStateHash((StateHashFeature)(HASH_FEATURE_FIRST_STATUS_EFFECT + type), duration);
 	}
 
 	m_currentlyRenderingStatusEffectIndex = 0;
@@ -560,6 +631,7 @@ void Character::RemoveStatusEffect(StatusEffectType type)
 	{
 		if (m_statusEffects[effectIndex]->m_type == type)
 		{
+			ToggleStateHash((StateHashFeature)(HASH_FEATURE_FIRST_STATUS_EFFECT + type), m_statusEffects[effectIndex]->m_remainingDuration);
 			m_statusEffects.erase(m_statusEffects.begin() + effectIndex);
 			return;
 		}
@@ -571,9 +643,12 @@ void Character::DecrementEffectDurations()
 	size_t numEffects = m_statusEffects.size();
 	for (size_t effectIndex = 0; effectIndex < numEffects; effectIndex++)
 	{
-		m_statusEffects[effectIndex]->m_remainingDuration--;
-		if (m_statusEffects[effectIndex]->m_remainingDuration <= 0)
+		StatusEffect* effect = m_statusEffects[effectIndex];
+		UpdateStateHash((StateHashFeature)(HASH_FEATURE_FIRST_STATUS_EFFECT + effect->m_type), effect->m_remainingDuration, effect->m_remainingDuration - 1);
+		effect->m_remainingDuration--;
+		if (effect->m_remainingDuration <= 0)
 		{
+			ToggleStateHash((StateHashFeature)(HASH_FEATURE_FIRST_STATUS_EFFECT + effect->m_type), effect->m_remainingDuration);
 			std::iter_swap(m_statusEffects.begin() + effectIndex, m_statusEffects.end() - 1);
 			m_statusEffects.pop_back();
 			effectIndex--;
@@ -584,6 +659,45 @@ void Character::DecrementEffectDurations()
 	}
 }
 
+void Character::SetCurrentHP(int newHP)
+{
+	UpdateStateHash(HASH_FEATURE_HP, m_currentHP, newHP);
+	m_currentHP = newHP;
+}
+
+void Character::SetCurrentCT(int newCT)
+{
+	UpdateStateHash(HASH_FEATURE_CT, m_currentCT, newCT);
+	m_currentCT = newCT;
+}
+
+void Character::SetCurrentTile(Tile* newTile)
+{
+	if (nullptr != m_currentMap && nullptr != m_currentTile && nullptr != newTile)
+		UpdateStateHash(HASH_FEATURE_TILE, m_currentMap->CalculateTileIndexFromTileCoords(m_currentTile->m_tileCoords), m_currentMap->CalculateTileIndexFromTileCoords(newTile->m_tileCoords));
+
+	m_currentTile = newTile;
+}
+
+void Character::SetIsDead(bool isDead)
+{
+	UpdateStateHash(HASH_FEATURE_DEAD, m_isDead ? 1 : 0, isDead ? 1 : 0);
+	m_isDead = isDead;
+}
+
+//Characters only count toward the map's hash once they've been placed in it
+void Character::UpdateStateHash(StateHashFeature feature, int oldValue, int newValue)
+{
+	if (nullptr != m_currentMap)
+		m_currentMap->m_stateHash.Update(m_characterIndex, feature, oldValue, newValue);
+}
+
+void Character::ToggleStateHash(StateHashFeature feature, int value)
+{
+	if (nullptr != m_currentMap)
+		m_currentMap->m_stateHash.Toggle(m_characterIndex, feature, value);
+}
+
 void Character::UpdateIdleAnim(float deltaSeconds)
 {
 	m_frontWalkAnim->Update(deltaSeconds);
@@ -770,19 +884,7 @@ int Character::CalculatePotentialAbilityDamage(AbilityDefinition* ability, Tile*
 	int netDamage = 0;
 	for (Character* character : charactersInRadius)
 	{
-		int abilityDamage = CalculateAbilityDamageToCharacter(ability, character);
-		if (character->m_currentHP - abilityDamage > character->m_stats[STAT_MAX_HP])
-			abilityDamage = character->m_currentHP - character->m_stats[STAT_MAX_HP];
-
-		if (character->m_faction == m_faction)
-		{
-			abilityDamage *= -1;
-		}
-
-		if (HasStatusEffect(STATUS_CHARM))
-		{
-			abilityDamage *= -1;
-		}
+		int abilityDamage = CalculateNetAbilityDamageToCharacter(ability, character);
 
 		if (HasStatusEffect(STATUS_CONFUSE))
 		{
@@ -798,6 +900,25 @@ int Character::CalculatePotentialAbilityDamage(AbilityDefinition* ability, Tile*
 	return netDamage;
 }
 
+int Character::CalculateNetAbilityDamageToCharacter(AbilityDefinition* ability, Character* targettedCharacter)
+{
+	int abilityDamage = CalculateAbilityDamageToCharacter(ability, targettedCharacter);
+	if (targettedCharacter->m_currentHP - abilityDamage > targettedCharacter->m_stats[STAT_MAX_HP])
+		abilityDamage = targettedCharacter->m_currentHP - targettedCharacter->m_stats[STAT_MAX_HP];
+
+	if (targettedCharacter->m_faction == m_faction)
+	{
+		abilityDamage *= -1;
+	}
+
+	if (HasStatusEffect(STATUS_CHARM))
+	{
+		abilityDamage *= -1;
+	}
+
+	return abilityDamage;
+}
+
 int Character::CalculateAbilityDamageToCharacter(AbilityDefinition* ability, Character* targettedCharacter)
 {
 	float truePowerMultiplier = RangeMapFloat((float)m_stats[STAT_FAITH], 0.f, 100.f, 0.25f, 2.f);
@@ -874,7 +995,7 @@ float Character::GetGCostBias(std::string tileType) const
 	return found->second;
 }
 
-void Character::ApplyDamage(int damageToDeal, const Tags& damageTypes)
+float Character::CalculateDamageModifier(const Tags& damageTypes) const
 {
 	float damageModifier = 1.f;
 	for (std::string weaknessTag : m_damageTypeWeaknesses)
@@ -898,19 +1019,33 @@ void Character::ApplyDamage(int damageToDeal, const Tags& damageTypes)
 		}
 	}
 
+	return damageModifier;
+}
+
+Tags Character::GetAttackDamageTypes() const
+{
+	Tags damageTypes;
+	if (m_equipment.m_equippedItems[EQUIP_SLOT_PRIMARY_WEAPON])
+		damageTypes = m_equipment.m_equippedItems[EQUIP_SLOT_PRIMARY_WEAPON]->m_damageTypes;
+
+	return damageTypes;
+}
+
+void Character::ApplyDamage(int damageToDeal, const Tags& damageTypes)
+{
+	float damageModifier = CalculateDamageModifier(damageTypes);
+
 	damageToDeal = (int)floor((float)damageToDeal * damageModifier);
 
-	if (damageToDeal > 0 && m_currentState == STATE_IDLE)
+	if (damageToDeal > 0 && m_currentState == STATE_IDLE && !g_theApp->m_game->m_resolveInstantly)
 	{
 		g_theApp->m_game->WaitUntilRelease();
 		m_currentState = STATE_ATTACKED;
 	}
 
-	m_currentHP -= damageToDeal;
-	if (m_currentHP > m_stats[STAT_MAX_HP])
-		m_currentHP = m_stats[STAT_MAX_HP];
+	SetCurrentHP(std::min(m_currentHP - damageToDeal, m_stats[STAT_MAX_HP]));
 
-	if (damageToDeal != 0)
+	if (damageToDeal != 0 && g_theApp->m_game->ShouldPlayActionVisuals())
 	{
 		Rgba numberColor;
 		if (damageToDeal > 0)
@@ -928,8 +1063,8 @@ void Character::ApplyDamage(int damageToDeal, const Tags& damageTypes)
 
 	if (m_currentHP <= 0)
 	{
-		m_currentHP = 0;
-		m_isDead = true;
+		SetCurrentHP(0);
+		SetIsDead(true);
 	}
 }
 
@@ -937,17 +1072,15 @@ void Character::ApplyDamage(int damageToDeal, bool shouldPlayHitAnim /*= true*/)
 {
 	damageToDeal = (int)floor((float)damageToDeal);
 
-	if (shouldPlayHitAnim && damageToDeal > 0 && m_currentState == STATE_IDLE)
+	if (shouldPlayHitAnim && damageToDeal > 0 && m_currentState == STATE_IDLE && !g_theApp->m_game->m_resolveInstantly)
 	{
 		m_currentState = STATE_ATTACKED;
 		g_theApp->m_game->WaitUntilRelease();
 	}
 
-	m_currentHP -= damageToDeal;
-	if (m_currentHP > m_stats[STAT_MAX_HP])
-		m_currentHP = m_stats[STAT_MAX_HP];
+	SetCurrentHP(std::min(m_currentHP - damageToDeal, m_stats[STAT_MAX_HP]));
 
-	if (damageToDeal != 0)
+	if (damageToDeal != 0 && g_theApp->m_game->ShouldPlayActionVisuals())
 	{
 		Rgba numberColor;
 		if (damageToDeal > 0)
@@ -964,14 +1097,25 @@ void Character::ApplyDamage(int damageToDeal, bool shouldPlayHitAnim /*= true*/)
 	}
 	if (m_currentHP <= 0)
 	{
-		m_currentHP = 0;
-		m_isDead = true;
+		SetCurrentHP(0);
+		SetIsDead(true);
 	}
 }
 
 void Character::StartAttack(Character* characterToAttack)
 {
 	UpdateHeading(characterToAttack->m_currentTile->m_tileCoords - m_currentTile->m_tileCoords);
+	if (g_theApp->m_game->m_resolveInstantly)
+	{
+		if (g_theApp->m_game->ShouldPlayActionVisuals())
+			g_theAudio->PlaySoundAtVolume(g_theAudio->CreateOrGetSound("Data/Audio/Melee.mp3"));
+
+		Attack(characterToAttack);
+		m_targettedCharacter = nullptr;
+		g_theApp->m_game->EndTurn(this, 0);
+		return;
+	}
+
 	g_theApp->m_game->WaitUntilRelease();
 	m_currentState = STATE_ATTACKING;
 	m_targettedCharacter = characterToAttack;
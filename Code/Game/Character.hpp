@@ -6,6 +6,8 @@
 #include "Game/Inventory.hpp"
 #include "Engine/Renderer/RHI/SpriteAnimation2D.hpp"
 #include "StatusEffect.hpp"
+#include "Game/UtilityMemo.hpp"
+#include "Game/StateHash.hpp"
 
 class Map;
 class Tile;
@@ -90,6 +92,7 @@ public:
 	void UpdateUsingAbility(float deltaSeconds);
 
 	void TickCT();
+	int GetTickRate() const;
 	void Act();
 
 	float GetGCostBias(std::string tileType) const;
@@ -101,21 +104,29 @@ public:
 	void MoveEast();
 	void MoveWest();
 
+	float CalculateDamageModifier(const Tags& damageTypes) const;
+	Tags GetAttackDamageTypes() const;
 	void ApplyDamage(int damageToDeal, const Tags& damageTypesString);
 	void ApplyDamage(int damageToDeal, bool shouldPlayHitAnim = true);
 	void StartAttack(Character* characterToAttack);
 	void Attack(Character* attackedCharacter);
 
 	void StartAbility();
+	void ResolveAbilityInstantly();
 	void ApplyAbilityEffectToArea();
 
 	void StartMoving(Path newPath);
+	void ResolveMoveInstantly();
 
 	int CalculateAttackDamage(Character* target);
-	int CalculateMaxNetAttackDamage(Tile* tileToAttackFrom);
+	float CalcBehaviorUtility(size_t behaviorIndex, Tile* tileToActFrom);
+	const UtilityMemoEntry* FindMemoizedUtility(BehaviorKind kind, Tile* tileToActFrom) const;
+
+	int CalculateMaxNetAttackDamage(Tile* tileToAttackFrom, Character** out_bestTarget = nullptr);
 	Character* CalculateBestAttackTarget();
 
 	int CalculateMaxNetAbilityDamage(AbilityDefinition* ability, Tile* tileToActFrom);
+	int CalculateNetAbilityDamageToCharacter(AbilityDefinition* ability, Character* targettedCharacter);
 	void TargetAndSetBestAbility();
 
 	bool HasStatusEffect(StatusEffectType type) const;
@@ -125,12 +136,16 @@ public:
 
 
 	void DecrementEffectDurations();
-public:
-	static uint8_t s_currentCharacterIndex;
 
+	//Setters for the hashed state, which keep the map's StateHash current
+	void SetCurrentHP(int newHP);
+	void SetCurrentCT(int newCT);
+	void SetCurrentTile(Tile* newTile);
+	void SetIsDead(bool isDead);
+public:
 	CharacterController m_controller;
 	uint8_t m_owningPlayer;
-	uint8_t m_characterIndex;
+	CharacterID m_characterIndex;
 
 	std::string m_name;
 	Map* m_currentMap;
@@ -164,8 +179,11 @@ public:
 	bool m_isDead = false;
 
 	std::string m_faction;
-	std::vector<Behavior*> m_behaviors;
+	BehaviorSet m_behaviors;
 	Behavior* m_currentBehavior;
+	UtilityMemo m_utilityMemo;
+	Character* m_estimatedTarget = nullptr;
+	Path m_fleePath;
 
 	std::vector<AbilityDefinition*> m_abilities;
 	AbilityDefinition* m_currentAbility = nullptr;
@@ -205,6 +223,9 @@ public:
 
 	Texture2D* m_portrait;
 private:
+	void UpdateStateHash(StateHashFeature feature, int oldValue, int newValue);
+	void ToggleStateHash(StateHashFeature feature, int value);
+
 	void UpdateIdleAnim(float deltaSeconds);
 	void UpdateMovingAnim(float deltaSeconds);
 	void UpdateHeading(IntVector2 newHeading);
@@ -140,7 +140,7 @@ Character* CharacterBuilder::BuildNewCharacter(std::string characterTypeName)
 
 	newCharacter->m_faction = foundBuilder->m_faction;
 	newCharacter->m_stats = Stats::CalculateRandomStatsInRange(foundBuilder->m_minStats, foundBuilder->m_maxStats);
-	newCharacter->m_behaviors = CloneBehaviors(foundBuilder->m_behaviors);
+	newCharacter->m_behaviors = foundBuilder->m_behaviors;
 	newCharacter->m_currentHP = newCharacter->m_stats[STAT_MAX_HP];
 	newCharacter->m_gCostBiases = foundBuilder->m_gCostBiases;
 	newCharacter->m_tags.SetTags(foundBuilder->m_tagsToSet);
@@ -182,14 +182,3 @@ Character* CharacterBuilder::BuildNewCharacter(std::string characterTypeName)
 
 	return newCharacter;
 }
-
-std::vector<Behavior*> CharacterBuilder::CloneBehaviors(std::vector<Behavior*> behaviorsToClone)
-{
-	std::vector<Behavior*> outputBehaviors;
-	for (size_t behaviorIndex = 0; behaviorIndex < behaviorsToClone.size(); behaviorIndex++)
-	{
-		outputBehaviors.push_back(behaviorsToClone[behaviorIndex]->Clone());
-	}
-
-	return outputBehaviors;
-}
\ No newline at end of file
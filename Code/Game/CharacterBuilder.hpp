@@ -54,7 +54,7 @@ public:
 
 	std::vector<AbilityDefinition*> m_abilities;
 
-	std::vector<Behavior*> m_behaviors;
+	BehaviorSet m_behaviors;
 	std::vector<std::string> m_loot;
 	std::map<std::string, float> m_gCostBiases;
 	std::string m_tagsToSet;
@@ -63,6 +63,4 @@ public:
 	std::vector<std::string> m_damageTypeImmunities;
 
 	static std::map<std::string, CharacterBuilder*> s_registry;
-private:
-	static std::vector<Behavior*> CloneBehaviors(std::vector<Behavior*> behaviorsToClone);
 };
\ No newline at end of file
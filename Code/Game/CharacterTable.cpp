@@ -0,0 +1,59 @@
+#include "Game/CharacterTable.hpp"
+#include "Game/Character.hpp"
+#include "Engine/Core/ErrorWarningAssert.hpp"
+
+
+CharacterTable::CharacterTable()
+	: m_characters()
+	, m_nextID(NO_CHARACTER_ID + 1)
+{
+
+}
+
+void CharacterTable::Clear()
+{
+	m_characters.clear();
+	m_nextID = NO_CHARACTER_ID + 1;
+}
+
+void CharacterTable::Add(Character* character)
+{
+	//Characters restored from a save or keyframe keep the ID they already had
+	if (character->m_characterIndex == NO_CHARACTER_ID)
+	{
+		ASSERT_OR_DIE(m_nextID != MAX_CHARACTER_ID, "Ran out of character IDs.");
+		character->m_characterIndex = m_nextID;
+	}
+
+	CharacterID id = character->m_characterIndex;
+	if (id >= m_nextID)
+		m_nextID = id + 1;
+
+	if (id >= m_characters.size())
+		m_characters.resize(id + 1, nullptr);
+
+	ASSERT_OR_DIE(nullptr == m_characters[id], "Two characters share an ID.");
+	m_characters[id] = character;
+}
+
+void CharacterTable::Remove(CharacterID id)
+{
+	if (id >= m_characters.size() || nullptr == m_characters[id])
+		return;
+
+	m_characters[id] = nullptr;
+}
+
+Character* CharacterTable::Find(CharacterID id) const
+{
+	if (id >= m_characters.size())
+		return nullptr;
+
+	return m_characters[id];
+}
+
+void CharacterTable::SetNextID(CharacterID nextID)
+{
+	if (nextID > m_nextID)
+		m_nextID = nextID;
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include "Game/BattleState.hpp"
+#include <vector>
+
+class Character;
+
+
+//The map hands out IDs from 1 up, so 0 always means "no character", as it does for command targets
+const CharacterID NO_CHARACTER_ID = 0;
+const CharacterID MAX_CHARACTER_ID = 0xFFFF;
+
+//Every character on the map, indexed by CharacterID, so resolving an ID from a command, turn alert or replay is one
+//array lookup. IDs are only ever handed out in increasing order, which every peer does identically in lockstep, and
+//never reused, so an ID kept past its character's death finds nothing rather than someone else.
+class CharacterTable
+{
+public:
+	CharacterTable();
+
+	void Clear();
+	void Add(Character* character);
+	void Remove(CharacterID id);
+
+	Character* Find(CharacterID id) const;
+
+	CharacterID GetNextID() const { return m_nextID; }
+	void SetNextID(CharacterID nextID);
+
+private:
+	std::vector<Character*> m_characters;
+	CharacterID m_nextID;
+};
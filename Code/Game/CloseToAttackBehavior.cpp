@@ -6,32 +6,26 @@
 #include "Engine/Core/XMLUtils.hpp"
 #include "Engine/Core/EngineConfig.hpp"
 #include "Game/Character.hpp"
+#include "Game/Map.hpp"
 #include <algorithm>
 
 CloseToAttackBehavior::CloseToAttackBehavior(XMLNode element)
-	: m_path()
 {
-
-}
-
-CloseToAttackBehavior::CloseToAttackBehavior(CloseToAttackBehavior* behaviorToCopy)
-	: m_path()
-{
-	m_utility = behaviorToCopy->m_utility;
-}
-
-CloseToAttackBehavior::~CloseToAttackBehavior()
-{
-
+	UNUSED(element);
 }
 
 void CloseToAttackBehavior::Act(Character* actingCharacter)
 {
-	float utility = 0.f;
-	Tile* destinationTile = CalculateBestTileToMoveTo(utility, actingCharacter, actingCharacter->m_currentTile);
+	Tile* destinationTile = m_plannedDestination;
+	m_plannedDestination = nullptr;
+	if (nullptr == destinationTile)
+	{
+		float utility = 0.f;
+		destinationTile = CalculateBestTileToMoveTo(utility, actingCharacter, actingCharacter->m_currentTile);
+	}
 
-	m_path = actingCharacter->m_currentMap->GeneratePath(actingCharacter->m_currentTile->m_tileCoords, destinationTile->m_tileCoords, actingCharacter);
-	actingCharacter->StartMoving(m_path);
+	Path path = actingCharacter->m_currentMap->GeneratePath(actingCharacter->m_currentTile->m_tileCoords, destinationTile->m_tileCoords, actingCharacter);
+	actingCharacter->StartMoving(path);
 }
 
 
@@ -43,12 +37,12 @@ float CloseToAttackBehavior::CalcUtility(Character* actingCharacter, Tile* tileT
 	float utility = -1.f;
 	CalculateBestTileToMoveTo(utility, actingCharacter, tileToActFrom);
 
-	return std::max(utility * 0.6f, m_utility);
+	return CalcUtilityFromBestDestination(utility);
 }
 
-std::string CloseToAttackBehavior::GetName() const
+float CloseToAttackBehavior::CalcUtilityFromBestDestination(float bestDestinationUtility) const
 {
-	return "CloseToAttack";
+	return std::max(bestDestinationUtility * 0.6f, m_utility);
 }
 
 void CloseToAttackBehavior::DebugRender(const Character* actingCharacter) const
@@ -65,24 +59,11 @@ Tile* CloseToAttackBehavior::CalculateBestTileToMoveTo(float& outUtility, Charac
 
 	for (Tile* tile : traversableTiles)
 	{
-		for (size_t behaviorIndex = 0; behaviorIndex < actingCharacter->m_behaviors.size(); behaviorIndex++)
+		float destinationUtility = CalcUtilityOfDestination(actingCharacter, tile);
+		if (destinationUtility > maxUtility)
 		{
-			if (actingCharacter->m_behaviors[behaviorIndex]->GetName() == "CloseToAttack")
-				continue;
-
-			Character* nearestTarget = actingCharacter->m_currentMap->FindNearestCharacterNotOfFaction(tile->m_tileCoords, actingCharacter->m_faction);
-			int distanceFromNearestTarget = 0;
-			if(nullptr != nearestTarget)
-			{
-				distanceFromNearestTarget = actingCharacter->m_currentMap->CalculateManhattanDistance(*nearestTarget->m_currentTile, *tile);
-			}
-
-			float behaviorUtility = actingCharacter->m_behaviors[behaviorIndex]->CalcUtility(actingCharacter, tile) - distanceFromNearestTarget;
-			if (behaviorUtility > maxUtility)
-			{
-				maxUtility = behaviorUtility;
-				bestTile = tile;
-			}
+			maxUtility = destinationUtility;
+			bestTile = tile;
 		}
 	}
 
@@ -90,9 +71,28 @@ Tile* CloseToAttackBehavior::CalculateBestTileToMoveTo(float& outUtility, Charac
 	return bestTile;
 }
 
-Behavior* CloseToAttackBehavior::Clone()
+float CloseToAttackBehavior::CalcUtilityOfDestination(Character* actingCharacter, Tile* destinationTile) const
 {
-	CloseToAttackBehavior* outBehavior = new CloseToAttackBehavior(this);
-	return outBehavior;
+	float maxUtility = -99999.f;
+
+	//The nearest target only depends on the tile, not the behavior being scored
+	Character* nearestTarget = actingCharacter->m_currentMap->FindNearestCharacterNotOfFaction(destinationTile->m_tileCoords, actingCharacter->m_faction);
+	int distanceFromNearestTarget = 0;
+	if(nullptr != nearestTarget)
+	{
+		distanceFromNearestTarget = actingCharacter->m_currentMap->CalculateManhattanDistance(*nearestTarget->m_currentTile, *destinationTile);
+	}
+
+	for (size_t behaviorIndex = 0; behaviorIndex < actingCharacter->m_behaviors.size(); behaviorIndex++)
+	{
+		if (actingCharacter->m_behaviors[behaviorIndex].m_kind == BEHAVIOR_CLOSE_TO_ATTACK)
+			continue;
+
+		float behaviorUtility = actingCharacter->CalcBehaviorUtility(behaviorIndex, destinationTile) - distanceFromNearestTarget;
+		if (behaviorUtility > maxUtility)
+			maxUtility = behaviorUtility;
+	}
+
+	return maxUtility;
 }
 
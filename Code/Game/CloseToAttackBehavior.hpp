@@ -1,25 +1,23 @@
 #pragma once
-#include "Game/Behavior.hpp"
-#include "Game/Map.hpp"
+#include "ThirdParty\XMLParser\XMLParser.hpp"
 
+class Character;
+class Tile;
 
 
-class CloseToAttackBehavior : public Behavior
+class CloseToAttackBehavior
 {
 public:
 	CloseToAttackBehavior(XMLNode element);
-	virtual ~CloseToAttackBehavior();
-	CloseToAttackBehavior(CloseToAttackBehavior* behaviorToCopy);
 
-	virtual void Act(Character* actingCharacter) override;
-	virtual float CalcUtility(Character* actingCharacter, Tile* tileToActFrom = nullptr) const override;
-	virtual std::string GetName() const override;
-	virtual void DebugRender(const Character* actingCharacter) const override;
+	void Act(Character* actingCharacter);
+	float CalcUtility(Character* actingCharacter, Tile* tileToActFrom = nullptr) const;
+	void DebugRender(const Character* actingCharacter) const;
 
 	Tile* CalculateBestTileToMoveTo(float& outUtility, Character* actingCharacter, Tile* tileToStartFrom) const;
-
-	virtual Behavior* Clone() override;
+	float CalcUtilityOfDestination(Character* actingCharacter, Tile* destinationTile) const;
+	float CalcUtilityFromBestDestination(float bestDestinationUtility) const;
 
 	float m_utility = 0.5f;
-	Path m_path;
+	Tile* m_plannedDestination = nullptr;
 };
\ No newline at end of file
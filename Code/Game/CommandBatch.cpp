@@ -0,0 +1,88 @@
+#include "Game/CommandBatch.hpp"
+
+
+enum NetCommandFlag
+{
+	NET_COMMAND_TYPE_MASK = 0x03,
+	NET_COMMAND_SAME_CHARACTER = 1 << 2,
+	NET_COMMAND_HAS_TARGET = 1 << 3,
+	NET_COMMAND_HAS_ABILITY = 1 << 4,
+	NET_COMMAND_RESERVED_MASK = 0xE0
+};
+
+
+static bool ReadCharacterID(ByteReader& reader, CharacterID& out_id)
+{
+	uint64_t id = reader.ReadVarint();
+	out_id = (CharacterID)id;
+	return id <= 0xFFFF;
+}
+
+
+void EncodeCommandBatch(const NetCommand* commands, size_t numCommands, ByteBuffer& out_buffer)
+{
+	out_buffer.Clear();
+
+	//The first command is a delta from an all-zero one, so a batch decodes on its own
+	NetCommand previous = {};
+	for (size_t commandIndex = 0; commandIndex < numCommands; commandIndex++)
+	{
+		const NetCommand& command = commands[commandIndex];
+
+		uint8_t flags = command.m_type & NET_COMMAND_TYPE_MASK;
+		if (command.m_actingCharacterIndex == previous.m_actingCharacterIndex)
+			flags |= NET_COMMAND_SAME_CHARACTER;
+		if (command.m_targettedCharacterIndex != 0)
+			flags |= NET_COMMAND_HAS_TARGET;
+		if (command.m_abilityIndex != 0)
+			flags |= NET_COMMAND_HAS_ABILITY;
+
+		out_buffer.WriteByte(flags);
+		if ((flags & NET_COMMAND_SAME_CHARACTER) == 0)
+			out_buffer.WriteVarint(command.m_actingCharacterIndex);
+		out_buffer.WriteSignedVarint((int64_t)command.m_tileIndex - (int64_t)previous.m_tileIndex);
+		if ((flags & NET_COMMAND_HAS_TARGET) != 0)
+			out_buffer.WriteVarint(command.m_targettedCharacterIndex);
+		if ((flags & NET_COMMAND_HAS_ABILITY) != 0)
+			out_buffer.WriteByte(command.m_abilityIndex);
+
+		previous = command;
+	}
+}
+
+bool DecodeCommandBatch(ByteReader& reader, size_t numCommands, std::vector<NetCommand>& out_commands)
+{
+	out_commands.clear();
+
+	NetCommand previous = {};
+	for (size_t commandIndex = 0; commandIndex < numCommands; commandIndex++)
+	{
+		uint8_t flags = reader.ReadByte();
+		if ((flags & NET_COMMAND_RESERVED_MASK) != 0)
+			return false;
+
+		NetCommand command = {};
+		command.m_type = flags & NET_COMMAND_TYPE_MASK;
+		command.m_actingCharacterIndex = previous.m_actingCharacterIndex;
+		if ((flags & NET_COMMAND_SAME_CHARACTER) == 0 && !ReadCharacterID(reader, command.m_actingCharacterIndex))
+			return false;
+
+		int64_t tileIndex = (int64_t)previous.m_tileIndex + reader.ReadSignedVarint();
+		if (tileIndex < 0 || tileIndex > 0xFFFF)
+			return false;
+		command.m_tileIndex = (uint16_t)tileIndex;
+
+		if ((flags & NET_COMMAND_HAS_TARGET) != 0 && !ReadCharacterID(reader, command.m_targettedCharacterIndex))
+			return false;
+		if ((flags & NET_COMMAND_HAS_ABILITY) != 0)
+			command.m_abilityIndex = reader.ReadByte();
+
+		if (reader.HasOverrun())
+			return false;
+
+		out_commands.push_back(command);
+		previous = command;
+	}
+
+	return reader.GetRemainingBytes() == 0;
+}
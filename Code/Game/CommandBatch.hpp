@@ -0,0 +1,26 @@
+#pragma once
+#include "Game/ByteBuffer.hpp"
+#include "Game/BattleState.hpp"
+#include <vector>
+
+
+//SEND_GAME_COMMAND payload: [sequence uint16][command count uint8][encoded size uint16][encoded commands].
+//Each command starts with a flags byte and only carries what differs from the command before it in the batch:
+//  bits 0-1 command type, bit 2 same acting character, bit 3 has a targetted character, bit 4 has an ability.
+//  Then the acting character ID as a varint if it changed, the tile as a zigzag varint delta, the target ID as a varint
+//  and the ability byte if flagged.
+const size_t MAX_COMMANDS_PER_BATCH = 255;
+const size_t MAX_COMMAND_BATCH_BYTES = 0xFFFF;
+
+struct NetCommand
+{
+	uint8_t m_type;
+	CharacterID m_actingCharacterIndex;
+	uint16_t m_tileIndex;
+	CharacterID m_targettedCharacterIndex;
+	uint8_t m_abilityIndex;
+};
+
+
+void EncodeCommandBatch(const NetCommand* commands, size_t numCommands, ByteBuffer& out_buffer);
+bool DecodeCommandBatch(ByteReader& reader, size_t numCommands, std::vector<NetCommand>& out_commands);
@@ -0,0 +1,148 @@
+#include "Game/DesyncDetector.hpp"
+#include "Game/Map.hpp"
+#include "Game/GameCommon.hpp"
+#include "Game/App.hpp"
+#include "Game/Game.hpp"
+#include "Game/GameSession.hpp"
+#include "Engine/Core/ConsoleSystem.hpp"
+#include "Engine/Core/EngineConfig.hpp"
+#include <fstream>
+
+
+bool ConsoleStateHash(std::string args)
+{
+	UNUSED(args);
+
+	Game* game = g_theApp->m_game;
+	if (nullptr == game->m_theMap)
+	{
+		g_theConsole->ConsolePrintf("No battle is running.");
+		return false;
+	}
+
+	//Recomputing from scratch is only for checking the incremental hash hasn't missed a change
+	StateHashSnapshot snapshot;
+	game->m_theMap->CaptureStateHashSnapshot(snapshot);
+	uint64_t recomputedHash = CalculateSnapshotHash(snapshot);
+	g_theConsole->ConsolePrintf("State hash %016llx (recomputed %016llx%s), %u turns hashed", (unsigned long long)snapshot.m_hash, (unsigned long long)recomputedHash,
+		(recomputedHash == snapshot.m_hash) ? "" : ", MISMATCH", game->m_desyncDetector.GetNumTurnsHashed());
+
+	if (game->m_desyncDetector.HasDesynced())
+		g_theConsole->ConsolePrintf("Desynced at turn %u", game->m_desyncDetector.GetDesyncTurn());
+
+	return true;
+}
+
+
+DesyncDetector::DesyncDetector()
+	: m_history(STATE_HASH_HISTORY_SIZE)
+	, m_pendingRemoteHashes()
+	, m_firstTurnHashed(0)
+	, m_numTurnsHashed(0)
+	, m_hasDesynced(false)
+	, m_desyncTurn(0)
+{
+
+}
+
+void DesyncDetector::Reset(uint32_t firstTurn /*= 0*/)
+{
+	//A battle resumed from the host picks up the host's turn numbering
+	m_pendingRemoteHashes.clear();
+	m_firstTurnHashed = firstTurn;
+	m_numTurnsHashed = firstTurn;
+	m_hasDesynced = false;
+	m_desyncTurn = 0;
+}
+
+void DesyncDetector::RecordTurn(const Map& map)
+{
+	StateHashSnapshot& snapshot = m_history[m_numTurnsHashed % STATE_HASH_HISTORY_SIZE];
+	map.CaptureStateHashSnapshot(snapshot);
+	snapshot.m_turn = m_numTurnsHashed;
+	m_numTurnsHashed++;
+
+	Game* game = g_theApp->m_game;
+	if (!game->m_isPlayingReplay && game->m_session->IsRunning())
+		game->m_session->SendStateHash(snapshot.m_turn, snapshot.m_hash);
+
+	CompareHashes();
+}
+
+void DesyncDetector::OnRemoteHash(uint8_t connectionIndex, uint32_t turn, uint64_t hash)
+{
+	RemoteStateHash remoteHash;
+	remoteHash.m_connectionIndex = connectionIndex;
+	remoteHash.m_turn = turn;
+	remoteHash.m_hash = hash;
+	m_pendingRemoteHashes.push_back(remoteHash);
+
+	CompareHashes();
+}
+
+void DesyncDetector::OnRemoteSnapshot(uint8_t connectionIndex, const StateHashSnapshot& remoteSnapshot)
+{
+	const StateHashSnapshot* localSnapshot = FindLocalSnapshot(remoteSnapshot.m_turn);
+	if (nullptr == localSnapshot)
+	{
+		g_theConsole->ConsolePrintf("Desync dump from connection %d is for turn %u, which is no longer in the history.", connectionIndex, remoteSnapshot.m_turn);
+		return;
+	}
+
+	std::string diff = DiffStateHashSnapshots(*localSnapshot, remoteSnapshot);
+	if (CalculateSnapshotHash(*localSnapshot) != localSnapshot->m_hash)
+		diff += "  local hash doesn't match its own values; a change skipped the incremental update\n";
+
+	std::string filePath = "desync_turn_" + std::to_string(remoteSnapshot.m_turn) + ".txt";
+	std::ofstream file(filePath);
+	file << diff;
+
+	size_t lineStart = 0;
+	while (lineStart < diff.size())
+	{
+		size_t lineEnd = diff.find('\n', lineStart);
+		if (lineEnd == std::string::npos)
+			lineEnd = diff.size();
+
+		g_theConsole->ConsolePrintf("%s", diff.substr(lineStart, lineEnd - lineStart).c_str());
+		lineStart = lineEnd + 1;
+	}
+	g_theConsole->ConsolePrintf("Wrote %s", filePath.c_str());
+}
+
+void DesyncDetector::RegisterConsoleCommands()
+{
+	g_theConsole->RegisterCommand("state_hash", ConsoleStateHash);
+}
+
+const StateHashSnapshot* DesyncDetector::FindLocalSnapshot(uint32_t turn) const
+{
+	if (turn < m_firstTurnHashed || turn >= m_numTurnsHashed || turn + STATE_HASH_HISTORY_SIZE < m_numTurnsHashed)
+		return nullptr;
+
+	return &m_history[turn % STATE_HASH_HISTORY_SIZE];
+}
+
+void DesyncDetector::CompareHashes()
+{
+	//Hashes for turns this peer hasn't reached yet wait until it gets there
+	for (size_t remoteIndex = 0; remoteIndex < m_pendingRemoteHashes.size(); remoteIndex++)
+	{
+		const RemoteStateHash& remoteHash = m_pendingRemoteHashes[remoteIndex];
+		if (remoteHash.m_turn >= m_numTurnsHashed)
+			continue;
+
+		const StateHashSnapshot* localSnapshot = FindLocalSnapshot(remoteHash.m_turn);
+		if (nullptr != localSnapshot && localSnapshot->m_hash != remoteHash.m_hash && !m_hasDesynced)
+		{
+			m_hasDesynced = true;
+			m_desyncTurn = remoteHash.m_turn;
+			g_theConsole->ConsolePrintf("DESYNC at turn %u with connection %d: local %016llx, remote %016llx", remoteHash.m_turn, remoteHash.m_connectionIndex,
+				(unsigned long long)localSnapshot->m_hash, (unsigned long long)remoteHash.m_hash);
+			g_theApp->m_game->m_session->SendStateSnapshot(*localSnapshot);
+		}
+
+		m_pendingRemoteHashes.erase(m_pendingRemoteHashes.begin() + remoteIndex);
+		remoteIndex--;
+	}
+}
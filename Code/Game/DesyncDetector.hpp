@@ -0,0 +1,45 @@
+#pragma once
+#include "Game/StateHash.hpp"
+#include <vector>
+
+class Map;
+
+const size_t STATE_HASH_HISTORY_SIZE = 64;
+
+struct RemoteStateHash
+{
+	uint8_t m_connectionIndex;
+	uint32_t m_turn;
+	uint64_t m_hash;
+};
+
+
+//Trades the map's StateHash with every peer at the start of each turn. The first turn whose hashes disagree
+//is flagged once; both sides then swap what they hashed for that turn and write out the differences.
+class DesyncDetector
+{
+public:
+	DesyncDetector();
+
+	void Reset(uint32_t firstTurn = 0);
+	void RecordTurn(const Map& map);
+	void OnRemoteHash(uint8_t connectionIndex, uint32_t turn, uint64_t hash);
+	void OnRemoteSnapshot(uint8_t connectionIndex, const StateHashSnapshot& remoteSnapshot);
+
+	bool HasDesynced() const { return m_hasDesynced; }
+	uint32_t GetDesyncTurn() const { return m_desyncTurn; }
+	uint32_t GetNumTurnsHashed() const { return m_numTurnsHashed; }
+
+	static void RegisterConsoleCommands();
+
+private:
+	const StateHashSnapshot* FindLocalSnapshot(uint32_t turn) const;
+	void CompareHashes();
+
+	std::vector<StateHashSnapshot> m_history;
+	std::vector<RemoteStateHash> m_pendingRemoteHashes;
+	uint32_t m_firstTurnHashed;
+	uint32_t m_numTurnsHashed;
+	bool m_hasDesynced;
+	uint32_t m_desyncTurn;
+};
@@ -2,6 +2,7 @@
 #include "Engine/Core/ErrorWarningAssert.hpp"
 #include "Engine/Math/Vector2.hpp"
 #include "Game/Character.hpp"
+#include "Game/Map.hpp"
 #include <vector>
 #include "Engine/Math/MathUtils.hpp"
 #include "Game/App.hpp"
@@ -15,16 +16,6 @@ FleeBehavior::FleeBehavior(XMLNode element)
 	m_cowardice = ParseXMLAttributeFloat(element, "cowardice", m_cowardice);
 }
 
-FleeBehavior::FleeBehavior(FleeBehavior* behaviorToCopy)
-{
-	m_cowardice = behaviorToCopy->m_cowardice;
-}
-
-FleeBehavior::~FleeBehavior()
-{
-
-}
-
 void FleeBehavior::Act(Character* actingCharacter)
 {
 	if(actingCharacter->m_targettedCharacter)
@@ -50,7 +41,7 @@ void FleeBehavior::Act(Character* actingCharacter)
 // 		int nextTileIndex = GetRandomIntLessThan(potentialTiles.size());
 // 		Tile* nextTile = actingCharacter->m_currentMap->GetTileAtTileCoords(potentialTiles[nextTileIndex]);
 
-		if (m_fleePath.empty())
+		if (actingCharacter->m_fleePath.empty())
 		{
 			Tile* nextTile = nullptr;
 			int nextTileDist = 0;
@@ -66,14 +57,14 @@ void FleeBehavior::Act(Character* actingCharacter)
 				}
 			}
 
-			m_fleePath = actingCharacter->m_currentMap->GeneratePath(actingCharacter->m_currentTile->m_tileCoords, nextTile->m_tileCoords, actingCharacter);
+			actingCharacter->m_fleePath = actingCharacter->m_currentMap->GeneratePath(actingCharacter->m_currentTile->m_tileCoords, nextTile->m_tileCoords, actingCharacter);
 		}
 		
 	}
-	Tile* nextTile = *(m_fleePath.end() - 1);
+	Tile* nextTile = *(actingCharacter->m_fleePath.end() - 1);
 	bool successfullyMoved = actingCharacter->m_currentMap->TryToMoveCharacterToTile(actingCharacter, nextTile);
 	if (successfullyMoved)
-		m_fleePath.pop_back();
+		actingCharacter->m_fleePath.pop_back();
 }
 
 float FleeBehavior::CalcUtility(Character* actingCharacter, Tile* tileToActFrom /*= nullptr*/) const
@@ -89,25 +80,15 @@ float FleeBehavior::CalcUtility(Character* actingCharacter, Tile* tileToActFrom
 	return -1.f;
 }
 
-std::string FleeBehavior::GetName() const
-{
-	return "Flee";
-}
-
 void FleeBehavior::DebugRender(const Character* actingCharacter) const 
 {
 	if(actingCharacter->m_targettedCharacter)
 		g_theRenderer->DrawLine2D((Vector2)actingCharacter->m_currentTile->m_tileCoords + Vector2(0.5f, 0.5f), (Vector2)actingCharacter->m_targettedCharacter->m_currentTile->m_tileCoords + Vector2(0.5f, 0.5f), 0.125f, Rgba::WHITE, Rgba::RED);
 
-	for (Tile* tile : m_fleePath)
+	for (Tile* tile : actingCharacter->m_fleePath)
 	{
 		g_theRenderer->DrawCenteredText2D((Vector2)tile->m_tileCoords + Vector2(0.5f, 0.5f), g_theRenderer->m_defaultFont, "p", Rgba::BLUE, 0.5f);
 	}
 }
 
-Behavior* FleeBehavior::Clone()
-{
-	FleeBehavior* outBehavior = new FleeBehavior(this);
-	return outBehavior;
-}
 
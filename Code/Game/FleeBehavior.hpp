@@ -1,23 +1,18 @@
 #pragma once
-#include "Game/Behavior.hpp"
-#include "Game/Map.hpp"
+#include "ThirdParty\XMLParser\XMLParser.hpp"
 
+class Character;
+class Tile;
 
 
-class FleeBehavior : public Behavior
+class FleeBehavior
 {
 public:
 	FleeBehavior(XMLNode element);
-	virtual ~FleeBehavior();
-	FleeBehavior(FleeBehavior* behaviorToCopy);
 
-	virtual void Act(Character* actingCharacter) override;
-	virtual float CalcUtility(Character* actingCharacter, Tile* tileToActFrom = nullptr) const override;
-	virtual std::string GetName() const override;
-	virtual void DebugRender(const Character* actingCharacter) const override;
+	void Act(Character* actingCharacter);
+	float CalcUtility(Character* actingCharacter, Tile* tileToActFrom = nullptr) const;
+	void DebugRender(const Character* actingCharacter) const;
 
-	virtual Behavior* Clone() override;
-
-	Path m_fleePath;
 	float m_cowardice = 0.7f;
 };
\ No newline at end of file
@@ -21,6 +21,7 @@
 #include "Engine/Network/NetMessage.hpp"
 #include "Engine/Core/ConsoleSystem.hpp"
 #include "Engine/Core/EngineConfig.hpp"
+#include "Engine/Core/Time.hpp"
 
 bool ConsolePrintCT(std::string args)
 {
@@ -31,6 +32,87 @@ bool ConsolePrintCT(std::string args)
 	return true;
 }
 
+bool ConsoleTurnOrder(std::string args)
+{
+	size_t numTurns = 10;
+	if (!args.empty())
+		numTurns = (size_t)atoi(args.c_str());
+
+	std::vector<TurnForecast> forecast = g_theApp->m_game->m_theMap->ForecastTurnOrder(numTurns);
+	for (const TurnForecast& turn : forecast)
+	{
+		g_theConsole->ConsolePrintf("+%d %s%s", turn.m_ticksFromNow, turn.m_character->m_name.c_str(), turn.m_isResolvingAbility ? " (ability)" : "");
+	}
+	return true;
+}
+
+bool ConsoleInstantResolve(std::string args)
+{
+	std::vector<std::string> splitArgs = Split(args, ' ');
+	if (splitArgs.empty() || splitArgs[0].empty())
+	{
+		g_theConsole->ConsolePrintf("Instant resolve: %s, visuals %s, %d turns per frame", g_theApp->m_game->m_resolveInstantly ? "on" : "off", g_theApp->m_game->m_showInstantVisuals ? "on" : "off", Game::s_maxInstantTurnsPerFrame);
+		return true;
+	}
+
+	g_theApp->m_game->m_resolveInstantly = atoi(splitArgs[0].c_str()) != 0;
+	if (splitArgs.size() > 1)
+		g_theApp->m_game->m_showInstantVisuals = atoi(splitArgs[1].c_str()) != 0;
+	if (splitArgs.size() > 2)
+		Game::s_maxInstantTurnsPerFrame = atoi(splitArgs[2].c_str());
+
+	return true;
+}
+
+bool ConsoleReplaySeek(std::string args)
+{
+	Game* game = g_theApp->m_game;
+	if (args.empty())
+	{
+		g_theConsole->ConsolePrintf("Replay at command %d of %d", (int)game->GetNumCommandsRun(), (int)game->GetNumReplayCommands());
+		return true;
+	}
+
+	double startTime = GetCurrentTimeSeconds();
+	if (!game->SeekReplay((size_t)atoi(args.c_str())))
+	{
+		g_theConsole->ConsolePrintf("No replay is playing.");
+		return false;
+	}
+
+	g_theConsole->ConsolePrintf("Seeked to command %d of %d in %.2fms", (int)game->GetNumCommandsRun(), (int)game->GetNumReplayCommands(), (GetCurrentTimeSeconds() - startTime) * 1000.0);
+	return true;
+}
+
+bool ConsoleSaveBattle(std::string args)
+{
+	Game* game = g_theApp->m_game;
+	if (nullptr == game->m_theMap)
+	{
+		g_theConsole->ConsolePrintf("No battle is running.");
+		return false;
+	}
+
+	game->RequestBattleSave(args.empty() ? "battle.sav" : args);
+	g_theConsole->ConsolePrintf("Saving when the next turn starts.");
+	return true;
+}
+
+bool ConsoleLoadBattle(std::string args)
+{
+	std::string filePath = args.empty() ? "battle.sav" : args;
+	std::string error;
+	double startTime = GetCurrentTimeSeconds();
+	if (!g_theApp->m_game->LoadBattle(filePath, error))
+	{
+		g_theConsole->ConsolePrintf("%s", error.c_str());
+		return false;
+	}
+
+	g_theConsole->ConsolePrintf("Loaded %s in %.2fms", filePath.c_str(), (GetCurrentTimeSeconds() - startTime) * 1000.0);
+	return true;
+}
+
 bool ConsoleSetJoinAddress(std::string args)
 {
 	if (g_theApp->m_game->m_currentGameState == STATE_JOINING)
@@ -42,6 +124,8 @@ bool ConsoleSetJoinAddress(std::string args)
 	return false;
 }
 
+int Game::s_maxInstantTurnsPerFrame = 50;
+
 Game::Game()
 	: m_isGamePaused(false)
 	, m_theMap(nullptr)
@@ -67,6 +151,13 @@ Game::Game()
 
 	g_theConsole->RegisterCommand("ct", ConsolePrintCT);
 	g_theConsole->RegisterCommand("set_join_address", ConsoleSetJoinAddress);
+	g_theConsole->RegisterCommand("turn_order", ConsoleTurnOrder);
+	g_theConsole->RegisterCommand("instant_resolve", ConsoleInstantResolve);
+	g_theConsole->RegisterCommand("replay_seek", ConsoleReplaySeek);
+	g_theConsole->RegisterCommand("save_battle", ConsoleSaveBattle);
+	g_theConsole->RegisterCommand("load_battle", ConsoleLoadBattle);
+	AIPlanner::RegisterConsoleCommands();
+	DesyncDetector::RegisterConsoleCommands();
 }
 
 
@@ -111,11 +202,21 @@ void Game::Update(float deltaSeconds)
 
 	if(!m_isPlayingReplay)
 	{
-		TCPConnection* hostConnection = (TCPConnection*)m_session->m_session.m_hostConnection;
-		if ((m_currentGameState == STATE_PLAYING || m_currentGameState == STATE_WAITING) && (!m_session->m_session.IsRunning() || hostConnection == nullptr || hostConnection->IsDisconnected()))
+		if ((m_currentGameState == STATE_PLAYING || m_currentGameState == STATE_WAITING) && m_session->HasLostHost())
 		{
-			m_session->m_session.Leave();
-			m_currentGameState = STATE_MAINMENU;
+			//A client that loses the host goes back to the join screen; the host sends the battle again when it rejoins
+			bool wasHosting = m_session->IsHosting();
+			m_session->Leave();
+			if (wasHosting)
+			{
+				m_currentGameState = STATE_MAINMENU;
+			}
+			else
+			{
+				g_theConsole->ConsolePrintf("Lost the connection to the host. Rejoin to pick the battle back up.");
+				m_currentGameState = STATE_JOINING;
+				m_joinState = JOIN_STATE_SETUP;
+			}
 		}
 	}
 
@@ -139,6 +240,8 @@ void Game::Update(float deltaSeconds)
 	case STATE_END_SCREEN:
 		UpdateEndScreen(deltaSeconds);
 	}
+
+	m_session->EndFrame();
 }
 
 void Game::Render() const
@@ -164,6 +267,9 @@ void Game::Render() const
 		RenderEndScreen();
 		break;
 	}
+
+	if (m_session->m_showNetStatsOverlay)
+		DrawNetStatsOverlay();
 }
 
 void Game::WaitUntilRelease()
@@ -182,14 +288,18 @@ void Game::ReleaseWait()
 	}
 }
 
+bool Game::ShouldPlayActionVisuals() const
+{
+	return !m_resolveInstantly || m_showInstantVisuals;
+}
+
 void Game::UpdateMainMenu(float deltaSeconds)
 {
 	if (g_theInput->WasKeyJustPressed('1'))
 	{
 		g_theAudio->PlaySoundAtVolume(m_menuConfirmSound);
 
-		m_session->m_session.Host(GAME_PORT);
-		m_session->m_session.StartListening();
+		m_session->Host(GAME_PORT);
 		m_session->m_players[0] = new Player();
 		m_session->m_players[0]->m_connectionIndex = 0;
 		m_session->m_currentNumPlayers++;
@@ -222,14 +332,19 @@ void Game::UpdateHosting(float deltaSeconds)
 {
 	if (g_theInput->WasKeyJustPressed(KEYCODE_ESCAPE))
 	{
-		m_session->m_session.Leave();
+		m_session->Leave();
 		m_currentGameState = STATE_MAINMENU;
 	}
 
 	if(m_session->m_currentNumPlayers > 1)
 	{
 		g_random.Seed(m_session->m_seed);
+		m_session->ClearResumePoint();
 		m_theMap = new Map("test");
+		m_replayKeyframes.clear();
+		m_numTurnsStarted = 0;
+		CaptureReplaySetupState();
+		m_desyncDetector.Reset();
 		m_currentGameState = STATE_PLAYING;
 		UpdateWaiting(deltaSeconds);
 	}
@@ -246,23 +361,28 @@ void Game::UpdateJoining(float deltaSeconds)
 		break;
 	case JOIN_STATE_GET_INFO:
 	{
-		uint8_t connectionIndex = m_session->m_session.m_myConnection->m_connectionIndex;
-		if (m_session->m_players.size() > connectionIndex && m_session->m_players[connectionIndex] != nullptr)
+		//Joining a battle already under way waits on the host's SEND_GAME_RESUME_BATTLE instead of generating the map
+		int connectionIndex = m_session->GetMyConnectionIndex();
+		if (connectionIndex >= 0 && (int)m_session->m_players.size() > connectionIndex && m_session->m_players[connectionIndex] != nullptr && !m_session->m_isJoiningBattleInProgress)
 		{
 			g_random.Seed(m_session->m_seed);
 			m_joinState = JOIN_STATE_NOT_JOINING;
 			m_theMap = new Map("test");
+			m_replayKeyframes.clear();
+			m_numTurnsStarted = 0;
+			CaptureReplaySetupState();
+			m_desyncDetector.Reset();
 			m_currentGameState = STATE_PLAYING;
 			UpdateWaiting(deltaSeconds);
 		}
-		else if (!m_session->m_session.IsReady())
+		else if (!m_session->IsReady())
 		{
 			m_joinState = JOIN_STATE_SETUP;
 		}
 	}
 	break;
 	case JOIN_STATE_CONNECTING:
-		if (m_session->m_session.IsReady())
+		if (m_session->IsReady())
 		{
 			m_joinState = JOIN_STATE_GET_INFO;
 			m_session->SendJoinRequest();
@@ -294,7 +414,7 @@ void Game::UpdatePlaying(float deltaSeconds)
 	{
 		g_theAudio->PlaySoundAtVolume(m_menuCancelSound);
 		m_currentGameState = STATE_MAINMENU;
-		m_session->m_session.Leave();
+		m_session->Leave();
 	}
 
 	if (CheckForVictoryOrDefeat())
@@ -302,24 +422,13 @@ void Game::UpdatePlaying(float deltaSeconds)
 		return;
 	}
 
-	if (!m_commandQueue.empty())
+	TryRunNextCommand();
+
+	if (m_resolveInstantly)
 	{
-		if (m_isPlayingReplay)
-		{
-			if (m_commandQueue.front().m_actingCharacter->m_currentCT >= 100)
-			{
-				m_commandQueue.front().RunCommand(this);
-				m_commandHistory.push(m_commandQueue.front());
-				m_commandQueue.pop();
-			}
-		}
-		else
-		{
-			m_commandQueue.front().RunCommand(this);
-			m_commandHistory.push(m_commandQueue.front());
-			m_commandQueue.pop();
-		}
-// 		m_theMap->m_isWaitingForInput = false;
+		ResolveTurnsInstantly();
+		if (m_currentGameState != STATE_PLAYING)
+			return;
 	}
 
 	if (nullptr != m_theMap->m_selectedCharacter)
@@ -354,6 +463,39 @@ void Game::UpdatePlaying(float deltaSeconds)
 	m_theMap->Update(deltaSeconds);
 }
 
+void Game::ResolveTurnsInstantly()
+{
+	//Actions finish the moment they start, so keep taking turns until someone needs input or the network
+	for (int turnIndex = 0; turnIndex < s_maxInstantTurnsPerFrame; turnIndex++)
+	{
+		if (CheckForVictoryOrDefeat())
+			return;
+
+		if (TryRunNextCommand())
+			continue;
+
+		if (!m_theMap->CanStartNextTurn())
+			return;
+
+		m_theMap->StartNextTurn();
+	}
+}
+
+bool Game::TryRunNextCommand()
+{
+	if (m_commandQueue.empty())
+		return false;
+
+	if (m_isPlayingReplay && m_commandQueue.front().m_actingCharacter->m_currentCT < 100)
+		return false;
+
+	m_commandQueue.front().RunCommand(this);
+	m_commandHistory.push(m_commandQueue.front());
+	m_commandQueue.pop();
+// 	m_theMap->m_isWaitingForInput = false;
+	return true;
+}
+
 void Game::UpdateWaiting(float deltaSeconds)
 {
 	if (g_theInput->WasKeyJustPressed(KEYCODE_ESCAPE))
@@ -442,7 +584,7 @@ void Game::RenderHosting() const
 	g_theRenderer->SetViewMatrix(Matrix4::CreateTranslation(Vector3::ZERO));
 
 	g_theRenderer->DrawCenteredText2D(Vector2(ORTHO_X_DIMENSION * 0.5f, ORTHO_Y_DIMENSION * 0.5f), g_theRenderer->m_defaultFont, "Waiting for client.", Rgba::WHITE, 1.f);
-	g_theRenderer->DrawCenteredText2D(Vector2(ORTHO_X_DIMENSION * 0.5f, 3.f), g_theRenderer->m_defaultFont, "Hosting on: " + NetAddressToString(m_session->m_session.m_hostConnection->m_address), Rgba::WHITE, 1.f);
+	g_theRenderer->DrawCenteredText2D(Vector2(ORTHO_X_DIMENSION * 0.5f, 3.f), g_theRenderer->m_defaultFont, "Hosting on: " + m_session->GetHostAddressText(), Rgba::WHITE, 1.f);
 }
 
 void Game::RenderJoining() const
@@ -458,7 +600,7 @@ void Game::RenderJoining() const
 	case JOIN_STATE_NOT_JOINING:
 		break;
 	case JOIN_STATE_GET_INFO:
-		g_theRenderer->DrawCenteredText2D(Vector2::ZERO, g_theRenderer->m_defaultFont, "Waiting for host response.");
+		g_theRenderer->DrawCenteredText2D(Vector2::ZERO, g_theRenderer->m_defaultFont, m_session->m_isJoiningBattleInProgress ? "Receiving the battle from the host." : "Waiting for host response.");
 		break;
 	case JOIN_STATE_CONNECTING:
 		g_theRenderer->DrawCenteredText2D(Vector2::ZERO, g_theRenderer->m_defaultFont, "Joining host.");
@@ -772,7 +914,7 @@ void Game::UseAbilityWithCharacter(Character* actingCharacter, AbilityDefinition
 	}
 }
 
-void Game::ProcessCommand(uint8_t type, uint8_t characterIndex, unsigned int tileIndex, uint8_t targettedCharacterIndex, uint8_t abilityIndex)
+void Game::ProcessCommand(uint8_t type, CharacterID characterIndex, unsigned int tileIndex, CharacterID targettedCharacterIndex, uint8_t abilityIndex)
 {
 	CommandType commandType;
 	switch (type)
@@ -793,29 +935,11 @@ void Game::ProcessCommand(uint8_t type, uint8_t characterIndex, unsigned int til
 		ERROR_AND_DIE("Invalid command type.");
 	}
 
-	Character* actingCharacter = nullptr;
-	for (Character* character : m_theMap->m_characters)
-	{
-		if (character->m_characterIndex == characterIndex)
-		{
-			actingCharacter = character;
-			break;
-		}
-	}
-
+	Character* actingCharacter = m_theMap->FindCharacterByIndex(characterIndex);
 	ASSERT_OR_DIE(actingCharacter != nullptr, "Invalid character index sent.");
 
 	Tile* targettedTile = m_theMap->GetTileAtTileIndex(tileIndex);
-
-	Character* targettedCharacter = nullptr;
-	for (Character* character : m_theMap->m_characters)
-	{
-		if (character->m_characterIndex == targettedCharacterIndex)
-		{
-			targettedCharacter = character;
-			break;
-		}
-	}
+	Character* targettedCharacter = m_theMap->FindCharacterByIndex(targettedCharacterIndex);
 
 	AbilityDefinition* abilityToUse = nullptr;
 	if (abilityIndex < actingCharacter->m_abilities.size())
@@ -1242,7 +1366,7 @@ bool Game::CheckForVictoryOrDefeat()
 		}
 		else
 		{
-			if (*survivingPlayers.begin() == m_session->m_session.m_myConnection->m_connectionIndex)
+			if (*survivingPlayers.begin() == m_session->GetMyConnectionIndex())
 			{
 				m_endScreenText = "Victory!";
 			}
@@ -1254,45 +1378,316 @@ bool Game::CheckForVictoryOrDefeat()
 		}
 		m_currentGameState = STATE_END_SCREEN;
 
-		m_session->m_session.Leave();
+		m_session->Leave();
 		return true;
 	}
 	return false;
 }
 
+void Game::CaptureReplaySetupState()
+{
+	//A battle too large for a BattleState is recorded without its setup, which only the headless tools need
+	if (m_theMap->CanCaptureBattleState())
+		m_theMap->CaptureBattleState(m_replaySetupState);
+	else
+		m_replaySetupState.Clear();
+}
+
 void Game::WriteHistoryToFile()
 {
-	FileBinaryStream file;
-	file.OpenForWrite("replay.sav");
-	file.Write(m_session->m_seed);
-	file.Write(m_commandHistory.size());
-	while (!m_commandHistory.empty())
+	ReplayFileWriter file;
+	if (!file.Open("replay.sav", (uint32_t)m_session->m_seed))
+		return;
+	if (m_replaySetupState.m_numCharacters > 0)
+		file.WriteSetup(m_replaySetupState);
+
+	//Keyframes go in right before the command they were taken ahead of, so a reader meets them in order
+	size_t keyframeIndex = 0;
+	for (size_t commandIndex = 0; !m_commandHistory.empty(); commandIndex++)
 	{
-		m_commandHistory.front().WriteToFile(&file);
+		for (; keyframeIndex < m_replayKeyframes.size() && m_replayKeyframes[keyframeIndex].m_commandIndex <= commandIndex; keyframeIndex++)
+		{
+			file.WriteKeyframe(m_replayKeyframes[keyframeIndex].m_commandIndex, m_replayKeyframes[keyframeIndex].m_numTurnsStarted, m_replayKeyframes[keyframeIndex].m_state);
+		}
+
+		file.WriteCommand(m_commandHistory.front().ToReplayRecord());
 		m_commandHistory.pop();
 	}
+
+	for (; keyframeIndex < m_replayKeyframes.size(); keyframeIndex++)
+	{
+		file.WriteKeyframe(m_replayKeyframes[keyframeIndex].m_commandIndex, m_replayKeyframes[keyframeIndex].m_numTurnsStarted, m_replayKeyframes[keyframeIndex].m_state);
+	}
 	file.Close();
 }
 
-void Game::ReadReplayFromFile()
+void Game::ReadReplayFromFile(size_t numCommandsToSkip /*= 0*/)
 {
-	FileBinaryStream file;
-	file.OpenForRead("replay.sav");
-	uint_fast32_t seed;
-	file.Read(seed);
+	ReplayFileReader file;
+	if (!file.Open("replay.sav"))
+		ERROR_AND_DIE("Could not read replay.sav.");
+
+	uint_fast32_t seed = file.m_seed;
 	g_random.Seed(seed);
+	m_session->m_seed = seed;
+	m_isReplayReseedingEveryTurn = file.m_version >= REPLAY_VERSION_RESEEDS_EVERY_TURN;
 
+	delete m_theMap;
 	m_theMap = new Map("test");
+	m_commandQueue = std::queue<Command>();
+	m_commandHistory = std::queue<Command>();
+	m_replayKeyframes.clear();
+	m_numTurnsStarted = 0;
+	m_desyncDetector.Reset();
+	m_numWaits = 0;
+
+	//Skipped commands count as already run, so seeking can pick up from a keyframe
+	size_t numCommands = 0;
+	while (file.ReadNextChunk())
+	{
+		if (file.m_chunkType == REPLAY_CHUNK_KEYFRAME)
+		{
+			//Without its turn count, or in a replay that rolled one stream all game, a keyframe can't put the random stream back,
+			//so it's no use for seeking
+			if (m_isReplayReseedingEveryTurn && file.m_keyframeTurnsStarted > 0)
+			{
+				m_replayKeyframes.push_back(ReplayKeyframe());
+				m_replayKeyframes.back().m_commandIndex = file.m_keyframeCommandIndex;
+				m_replayKeyframes.back().m_numTurnsStarted = file.m_keyframeTurnsStarted;
+				m_replayKeyframes.back().m_state = file.m_keyframeState;
+			}
+			continue;
+		}
+
+		for (const ReplayCommandRecord& record : file.m_chunkCommands)
+		{
+			Command newCommand;
+			newCommand.FromReplayRecord(record);
+			if (numCommands < numCommandsToSkip)
+				m_commandHistory.push(newCommand);
+			else
+				m_commandQueue.push(newCommand);
+			numCommands++;
+		}
+	}
+	ASSERT_OR_DIE(!file.HasError(), "replay.sav is corrupt.");
+
+	m_numReplayCommands = numCommands;
+	m_nextReplayKeyframe = 0;
+}
 
-	size_t numCommands;
-	file.Read(numCommands);
-	for(size_t commandIndex = 0; commandIndex < numCommands; commandIndex++)
+void Game::SyncReplayKeyframe()
+{
+	size_t numCommandsRun = m_commandHistory.size();
+	m_numTurnsStarted++;
+	if (m_isPlayingReplay)
 	{
-		Command newCommand;
-		newCommand.ReadFromFile(&file);
-		m_commandQueue.push(newCommand);
+		if (m_nextReplayKeyframe < m_replayKeyframes.size() && m_replayKeyframes[m_nextReplayKeyframe].m_commandIndex == numCommandsRun)
+			m_nextReplayKeyframe++;
 	}
-	file.Close();
+	else
+	{
+		size_t lastKeyframeCommandIndex = m_replayKeyframes.empty() ? 0 : m_replayKeyframes.back().m_commandIndex;
+		if (numCommandsRun >= lastKeyframeCommandIndex + REPLAY_KEYFRAME_INTERVAL && m_theMap->CanCaptureBattleState())
+		{
+			m_replayKeyframes.push_back(ReplayKeyframe());
+			m_replayKeyframes.back().m_commandIndex = numCommandsRun;
+			m_replayKeyframes.back().m_numTurnsStarted = m_numTurnsStarted;
+			m_theMap->CaptureBattleState(m_replayKeyframes.back().m_state);
+		}
+	}
+
+	//Restarting the random stream every turn lets a seek or a loaded save pick up at any turn and still roll what the original game rolled.
+	//The turn count keeps turns that start without a new command, like an ability going off, from rolling the same numbers again.
+	//Replays from before this rolled one stream from the seed, AI turns included, and have to keep doing so.
+	if (!m_isPlayingReplay || m_isReplayReseedingEveryTurn)
+		g_random.Seed(CalculateKeyframeSeed(numCommandsRun, m_numTurnsStarted));
+}
+
+bool Game::SeekReplay(size_t commandIndex)
+{
+	if (!m_isPlayingReplay || (m_currentGameState != STATE_PLAYING && m_currentGameState != STATE_WAITING))
+		return false;
+
+	if (commandIndex > m_numReplayCommands)
+		commandIndex = m_numReplayCommands;
+
+	int keyframeToRestore = -1;
+	for (size_t keyframeIndex = 0; keyframeIndex < m_replayKeyframes.size() && m_replayKeyframes[keyframeIndex].m_commandIndex <= commandIndex; keyframeIndex++)
+	{
+		keyframeToRestore = (int)keyframeIndex;
+	}
+
+	//Playing on from here is only cheaper if no keyframe sits between here and the target and nothing is mid-animation
+	size_t numCommandsRun = m_commandHistory.size();
+	bool isMidAction = m_currentGameState == STATE_WAITING;
+	bool canSkipAhead = keyframeToRestore >= 0 && m_replayKeyframes[keyframeToRestore].m_commandIndex > numCommandsRun;
+	if (commandIndex < numCommandsRun || isMidAction || canSkipAhead)
+	{
+		if (keyframeToRestore >= 0)
+		{
+			size_t keyframeCommandIndex = m_replayKeyframes[keyframeToRestore].m_commandIndex;
+			uint32_t keyframeTurnsStarted = m_replayKeyframes[keyframeToRestore].m_numTurnsStarted;
+			ReadReplayFromFile(keyframeCommandIndex);
+			m_theMap->ApplyBattleState(m_replayKeyframes[keyframeToRestore].m_state);
+
+			//The keyframe's turn starts over once restored, and counts itself again when it does
+			m_numTurnsStarted = keyframeTurnsStarted - 1;
+			g_random.Seed(CalculateKeyframeSeed(keyframeCommandIndex, m_numTurnsStarted));
+			m_nextReplayKeyframe = keyframeToRestore + 1;
+		}
+		else
+		{
+			ReadReplayFromFile();
+		}
+
+		m_currentGameState = STATE_PLAYING;
+	}
+
+	FastForwardReplay(commandIndex);
+	return true;
+}
+
+void Game::FastForwardReplay(size_t commandIndex)
+{
+	const int MAX_FAST_FORWARD_STEPS = 100000;
+
+	bool wasResolvingInstantly = m_resolveInstantly;
+	bool wasShowingInstantVisuals = m_showInstantVisuals;
+	m_resolveInstantly = true;
+	m_showInstantVisuals = false;
+
+	for (int stepIndex = 0; stepIndex < MAX_FAST_FORWARD_STEPS && m_commandHistory.size() < commandIndex; stepIndex++)
+	{
+		if (CheckForVictoryOrDefeat())
+			break;
+
+		if (TryRunNextCommand())
+			continue;
+
+		if (!m_theMap->CanStartNextTurn())
+			break;
+
+		m_theMap->StartNextTurn();
+	}
+
+	m_resolveInstantly = wasResolvingInstantly;
+	m_showInstantVisuals = wasShowingInstantVisuals;
+}
+
+//Linear in both counts, so a loaded save can fold where it was up to into the session seed and count on from 0
+uint_fast32_t Game::CalculateKeyframeSeed(size_t commandIndex, uint32_t numTurnsStarted) const
+{
+	return (uint32_t)(m_session->m_seed + (uint_fast32_t)commandIndex * 2654435761u + (uint_fast32_t)numTurnsStarted * 0x85EBCA77u);
+}
+
+void Game::RequestBattleSave(const std::string& filePath)
+{
+	m_pendingBattleSavePath = filePath;
+}
+
+void Game::WritePendingBattleSave()
+{
+	if (m_pendingBattleSavePath.empty())
+		return;
+
+	if (!m_theMap->CanCaptureBattleState())
+	{
+		g_theConsole->ConsolePrintf("Battle is too large to save; saves hold up to %d characters on %d tiles.", MAX_BATTLE_CHARACTERS, MAX_BATTLE_TILES);
+		m_pendingBattleSavePath.clear();
+		return;
+	}
+
+	//Only called as a turn starts, so the state and the random stream are both at a point a load can rebuild
+	double startTime = GetCurrentTimeSeconds();
+	CaptureBattleSave(*m_theMap, (uint32_t)m_session->m_seed, (uint32_t)m_commandHistory.size(), m_numTurnsStarted, m_battleSave);
+	if (WriteBattleSave(m_pendingBattleSavePath, m_battleSave))
+		g_theConsole->ConsolePrintf("Saved %s in %.2fms", m_pendingBattleSavePath.c_str(), (GetCurrentTimeSeconds() - startTime) * 1000.0);
+	else
+		g_theConsole->ConsolePrintf("Could not write %s.", m_pendingBattleSavePath.c_str());
+
+	m_pendingBattleSavePath.clear();
+}
+
+bool Game::LoadBattle(const std::string& filePath, std::string& out_error)
+{
+	if (nullptr == m_theMap || (m_currentGameState != STATE_PLAYING && m_currentGameState != STATE_WAITING))
+	{
+		out_error = "No battle is running.";
+		return false;
+	}
+
+	if (m_isPlayingReplay)
+	{
+		out_error = "Can't load a battle over a replay.";
+		return false;
+	}
+
+	//Only this machine's battle would change, leaving everyone else in lockstep with the old one. A player who has
+	//dropped is fine: the host hands them the loaded battle when they rejoin.
+	if (m_session->HasConnectedPeers())
+	{
+		out_error = "Can't load a battle while other players are connected.";
+		return false;
+	}
+
+	if (!ReadBattleSave(filePath, m_battleSave, out_error))
+		return false;
+
+	StartBattleFromSave(m_battleSave);
+	m_desyncDetector.Reset();
+	m_session->ClearResumePoint();
+	return true;
+}
+
+void Game::ResumeBattle(const BattleSave& save, uint32_t numTurnsHashed)
+{
+	StartBattleFromSave(save);
+	m_desyncDetector.Reset(numTurnsHashed);
+	m_joinState = JOIN_STATE_NOT_JOINING;
+}
+
+bool Game::IsBattleRunning() const
+{
+	return nullptr != m_theMap && !m_isPlayingReplay && (m_currentGameState == STATE_PLAYING || m_currentGameState == STATE_WAITING);
+}
+
+void Game::CaptureResumePoint()
+{
+	//Only the host hands the battle to players who rejoin
+	if (m_isPlayingReplay || !m_session->IsHosting())
+		return;
+
+	if (!m_theMap->CanCaptureBattleState())
+	{
+		m_session->ClearResumePoint();
+		return;
+	}
+
+	m_session->CaptureResumePoint(*m_theMap, (uint32_t)m_commandHistory.size(), m_numTurnsStarted, m_desyncDetector.GetNumTurnsHashed(), m_commandQueue.size());
+}
+
+void Game::StartBattleFromSave(const BattleSave& save)
+{
+	delete m_theMap;
+	m_theMap = new Map(save);
+
+	//The loaded battle starts over at command 0 and turn 0, so move the seed on to where the saved game's random stream had
+	//got to. The saved turn starts over too and counts itself again. CalculateKeyframeSeed works from the session seed,
+	//which has to be the saved game's first.
+	m_session->m_seed = save.m_seed;
+	m_session->m_seed = CalculateKeyframeSeed(save.m_numCommandsRun, (save.m_numTurnsStarted > 0) ? save.m_numTurnsStarted - 1 : 0);
+	m_numTurnsStarted = 0;
+	g_random.Seed(m_session->m_seed);
+
+	m_commandQueue = std::queue<Command>();
+	m_commandHistory = std::queue<Command>();
+	m_replayKeyframes.clear();
+	m_replaySetupState = save.m_state;
+	m_pendingBattleSavePath.clear();
+	m_numWaits = 0;
+	m_currentGameState = STATE_PLAYING;
+	m_currentUIState = STATE_COMMAND_LIST;
 }
 
 void Game::UpdateEndScreen(float deltaSeconds)
@@ -1326,7 +1721,7 @@ void Game::RenderEndScreen() const
 void Game::EndTurn(Character* characterToEnd, int remainingCT)
 {
 	m_currentMenuSelection = 0;
-	characterToEnd->m_currentCT = remainingCT;
+	characterToEnd->SetCurrentCT(remainingCT);
 	characterToEnd->DecrementEffectDurations();
 	m_theMap->m_selectedCharacter = nullptr;
 	m_theMap->m_isWaitingForInput = false;
@@ -1356,6 +1751,37 @@ void Game::DrawPortraitMenu() const
 	g_theRenderer->DrawText2D(Vector2(200.f, 170.f), g_theRenderer->m_defaultFont, "CT: " + std::to_string(m_theMap->m_selectedTile->m_occupyingCharacter->m_currentCT), Rgba::BLACK, 30.f);
 }
 
+void Game::DrawNetStatsOverlay() const
+{
+	int windowWidth = WINDOW_DEFAULT_RESOLUTION_X;
+	int windowHeight = WINDOW_DEFAULT_RESOLUTION_Y;
+	g_theConfig->GetConfigInt(windowWidth, (std::string)"WINDOW_RES_X");
+	g_theConfig->GetConfigInt(windowHeight, (std::string)"WINDOW_RES_Y");
+
+	//Totals only; net_stats in the console breaks them down by message type
+	std::vector<std::string> lines;
+	m_session->m_netStats.WriteReport(lines, false);
+
+	const float lineHeight = 20.f;
+	float top = (float)windowHeight - 10.f;
+	float bottom = top - lineHeight * (float)lines.size() - 10.f;
+
+	g_theRenderer->SetProjectionMatrix(g_theRenderer->CreateOrthoProjectionMatrix(Vector2::ZERO, Vector2((float)windowWidth, (float)windowHeight)));
+	g_theRenderer->SetViewMatrix(Matrix4::CreateIdentity());
+	g_theRenderer->SetShader(m_orthoShader);
+	g_theRenderer->EnableBlend(BLEND_SRC_ALPHA, BLEND_INV_SRC_ALPHA);
+	g_theRenderer->EnableDepthTest(false);
+	g_theRenderer->EnableDepthWrite(false);
+
+	g_theRenderer->SetTexture(nullptr);
+	g_theRenderer->DrawBorderedQuad2D(AABB2(10.f, bottom, (float)windowWidth - 10.f, top), 2.f, Rgba(0, 0, 0, 160), Rgba::BLACK);
+
+	for (size_t lineIndex = 0; lineIndex < lines.size(); lineIndex++)
+	{
+		g_theRenderer->DrawText2D(Vector2(20.f, top - 5.f - lineHeight * (float)lineIndex), g_theRenderer->m_defaultFont, lines[lineIndex], Rgba::WHITE, lineHeight);
+	}
+}
+
 void Game::HandleMenuControl(int numMenuOptions)
 {
 	if (g_theInput->WasKeyJustPressed(KEYCODE_UP))
@@ -1378,13 +1804,13 @@ void Game::HandleMenuControl(int numMenuOptions)
 void Game::PushCommand(CommandType type, Character* actingCharacter, Tile* targettedTile /*= nullptr*/, Character* targettedCharacter /*= nullptr*/, AbilityDefinition* abilityToUse /*= nullptr*/)
 {
 	uint8_t commandType = type;
-	uint8_t characterIndex = actingCharacter->m_characterIndex;
+	CharacterID characterIndex = actingCharacter->m_characterIndex;
 	unsigned int tileIndex = 0;
 	if (nullptr != targettedTile)
 	{
 		tileIndex = m_theMap->CalculateTileIndexFromTileCoords(targettedTile->m_tileCoords);
 	}
-	uint8_t targettedCharacterIndex = 0;
+	CharacterID targettedCharacterIndex = NO_CHARACTER_ID;
 	if (nullptr != targettedCharacter)
 	{
 		targettedCharacterIndex = targettedCharacter->m_characterIndex;
@@ -1407,7 +1833,7 @@ void Game::PushCommand(CommandType type, Character* actingCharacter, Tile* targe
 
 void Game::WaitCharacter(Character* characterToWait)
 {
-	EndTurn(characterToWait, 20);
+	EndTurn(characterToWait, CTScheduler::WAIT_CT);
 	//ReleaseWait();
 }
 
@@ -1509,118 +1935,49 @@ void Command::RunCommand(Game* game)
 	}
 }
 
-void Command::WriteToFile(FileBinaryStream* file)
+ReplayCommandRecord Command::ToReplayRecord() const
 {
-	switch (m_type)
-	{
-	case COMMAND_ATTACK:
-		file->Write(0);
-		break;
-	case COMMAND_MOVE:
-		file->Write(1);
-		break;
-	case COMMAND_ABILITY:
-		file->Write(2);
-		break;
-	case COMMAND_WAIT:
-		file->Write(3);
-		break;
-	}
-	file->Write(m_actingCharacter->m_characterIndex);
-	if(m_targettedTile)
-	{
-		file->Write(m_targettedTile->m_tileCoords.x);
-		file->Write(m_targettedTile->m_tileCoords.y);
-	}
-	else
-	{
-		file->Write(0);
-		file->Write(0);
-	}
-
-	if(m_targettedCharacter)
-	{
-		file->Write(m_targettedCharacter->m_characterIndex);
-	}
-	else
-	{
-		file->Write((uint8_t)0);
-	}
-
-	uint8_t abilityIndex = 0;
+	ReplayCommandRecord record;
+	record.m_type = (uint8_t)m_type;
+	record.m_actingCharacterIndex = m_actingCharacter->m_characterIndex;
+	record.m_tileX = m_targettedTile ? m_targettedTile->m_tileCoords.x : 0;
+	record.m_tileY = m_targettedTile ? m_targettedTile->m_tileCoords.y : 0;
+	record.m_targettedCharacterIndex = m_targettedCharacter ? m_targettedCharacter->m_characterIndex : 0;
+
+	record.m_abilityIndex = 0;
 	if (m_abilityToUse != nullptr)
 	{
-		for (; abilityIndex < m_actingCharacter->m_abilities.size(); abilityIndex++)
+		for (; record.m_abilityIndex < m_actingCharacter->m_abilities.size(); record.m_abilityIndex++)
 		{
-			if (m_actingCharacter->m_abilities[abilityIndex] == m_abilityToUse)
+			if (m_actingCharacter->m_abilities[record.m_abilityIndex] == m_abilityToUse)
 			{
 				break;
 			}
 		}
 	}
-	file->Write(abilityIndex);
+
+	return record;
 }
 
-void Command::ReadFromFile(FileBinaryStream* file)
+void Command::FromReplayRecord(const ReplayCommandRecord& record)
 {
-	int type;
-	file->Read(type);
-	switch (type)
-	{
-	case 0:
-		m_type = COMMAND_ATTACK;
-		break;
-	case 1:
-		m_type = COMMAND_MOVE;
-		break;
-	case 2:
-		m_type = COMMAND_ABILITY;
-		break;
-	case 3:
-		m_type = COMMAND_WAIT;
-		break;
-	default:
-		ERROR_AND_DIE("Invalid command type.");
-	}
+	ASSERT_OR_DIE(record.m_type < NUM_COMMAND_TYPES, "Invalid command type.");
+	m_type = (CommandType)record.m_type;
 
-	uint8_t actingCharacterIndex;
-	file->Read(actingCharacterIndex);
-	for (Character* character : g_theApp->m_game->m_theMap->m_characters)
-	{
-		if (character->m_characterIndex == actingCharacterIndex)
-		{
-			m_actingCharacter = character;
-			break;
-		}
-	}
+	Map* map = g_theApp->m_game->m_theMap;
+	m_actingCharacter = map->FindCharacterByIndex(record.m_actingCharacterIndex);
 	ASSERT_OR_DIE(m_actingCharacter != nullptr, "Invalid character index.");
 
-	IntVector2 tileCoords;
-	file->Read(tileCoords.x);
-	file->Read(tileCoords.y);
-	m_targettedTile = g_theApp->m_game->m_theMap->GetTileAtTileCoords(tileCoords);
-
-	uint8_t targettedCharacterIndex;
-	file->Read(targettedCharacterIndex);
-	m_targettedCharacter = nullptr;
-	for (Character* character : g_theApp->m_game->m_theMap->m_characters)
-	{
-		if (character->m_characterIndex == targettedCharacterIndex)
-		{
-			m_targettedCharacter = character;
-			break;
-		}
-	}
+	m_targettedTile = map->GetTileAtTileCoords(IntVector2(record.m_tileX, record.m_tileY));
+	m_targettedCharacter = map->FindCharacterByIndex(record.m_targettedCharacterIndex);
 
-	uint8_t abilityIndex;
-	file->Read(abilityIndex);
-	if(abilityIndex < m_actingCharacter->m_abilities.size())
+	if (record.m_abilityIndex < m_actingCharacter->m_abilities.size())
 	{
-		m_abilityToUse = m_actingCharacter->m_abilities[abilityIndex];
+		m_abilityToUse = m_actingCharacter->m_abilities[record.m_abilityIndex];
 	}
 	else
 	{
-		m_abilityToUse = false;
+		m_abilityToUse = nullptr;
 	}
 }
 
@@ -4,6 +4,10 @@
 #include "Engine/Audio/Audio.hpp"
 #include "Game/Map.hpp"
 #include "Game/Camera3D.hpp"
+#include "Game/BattleState.hpp"
+#include "Game/ReplayFile.hpp"
+#include "Game/DesyncDetector.hpp"
+#include "Game/BattleSave.hpp"
 
 enum GameState
 {
@@ -47,14 +51,23 @@ enum CommandType
 class Game;
 class GameSession;
 
+const size_t REPLAY_KEYFRAME_INTERVAL = 8;
+
+struct ReplayKeyframe
+{
+	size_t m_commandIndex;
+	uint32_t m_numTurnsStarted;
+	BattleState m_state;
+};
+
 struct Command
 {
 	Command();
 	Command(CommandType type, Character* actingCharacter, Tile* targettedTile, Character* targettedCharacter, AbilityDefinition* abilityToUse);
 	void RunCommand(Game* game);
 
-	void WriteToFile(FileBinaryStream* file);
-	void ReadFromFile(FileBinaryStream* file);
+	ReplayCommandRecord ToReplayRecord() const;
+	void FromReplayRecord(const ReplayCommandRecord& record);
 
 	CommandType m_type;
 
@@ -79,6 +92,10 @@ public:
 	JoinState m_joinState = JOIN_STATE_NOT_JOINING;
 	UIState m_currentUIState = STATE_COMMAND_LIST;
 	bool m_isPlayingReplay = false;
+	DesyncDetector m_desyncDetector;
+	bool m_resolveInstantly = false;
+	bool m_showInstantVisuals = true;
+	static int s_maxInstantTurnsPerFrame;
 
 	ShaderProgram* m_orthoShader;
 	ShaderProgram* m_litShader;
@@ -99,6 +116,7 @@ public:
 
 	void WaitUntilRelease();
 	void ReleaseWait();
+	bool ShouldPlayActionVisuals() const;
 
 	void WaitCharacter(Character* characterToWait);
 	void EndTurn(Character* characterToEnd, int remainingCT);
@@ -108,7 +126,23 @@ public:
 	void AttackCharacterWithCharacter(Character* attackingCharacter, Character* targettedCharacter);
 	void UseAbilityWithCharacter(Character* actingCharacter, AbilityDefinition* abilityToUse, Tile* targettedTile, Character* targettedCharacter);
 
-	void ProcessCommand(uint8_t commandType, uint8_t characterIndex, unsigned int tileIndex, uint8_t targettedCharacterIndex, uint8_t abilityIndex);
+	void ProcessCommand(uint8_t commandType, CharacterID characterIndex, unsigned int tileIndex, CharacterID targettedCharacterIndex, uint8_t abilityIndex);
+
+	//Replays
+	void SyncReplayKeyframe();
+	bool SeekReplay(size_t commandIndex);
+	size_t GetNumReplayCommands() const { return m_numReplayCommands; }
+	size_t GetNumCommandsRun() const { return m_commandHistory.size(); }
+
+	//Battle saves
+	void RequestBattleSave(const std::string& filePath);
+	void WritePendingBattleSave();
+	bool LoadBattle(const std::string& filePath, std::string& out_error);
+
+	//Rejoining a battle in progress
+	void ResumeBattle(const BattleSave& save, uint32_t numTurnsHashed);
+	bool IsBattleRunning() const;
+	void CaptureResumePoint();
 
 private:
 	bool m_isGamePaused;
@@ -116,6 +150,14 @@ private:
 
 	std::queue<Command> m_commandQueue;
 	std::queue<Command> m_commandHistory;
+	std::vector<ReplayKeyframe> m_replayKeyframes;
+	BattleState m_replaySetupState;
+	size_t m_nextReplayKeyframe = 0;
+	size_t m_numReplayCommands = 0;
+	uint32_t m_numTurnsStarted = 0;
+	bool m_isReplayReseedingEveryTurn = true;
+	BattleSave m_battleSave;
+	std::string m_pendingBattleSavePath;
 
 	int m_currentMenuSelection;
 	SoundID m_menuConfirmSound;
@@ -129,6 +171,7 @@ private:
 	bool HandleMapMovement(float deltaSeconds);
 	void HandleMenuControl(int numMenuOptions);
 
+	void StartBattleFromSave(const BattleSave& save);
 	void PushCommand(CommandType type, Character* actingCharacter, Tile* targettedTile = nullptr, Character* targettedCharacter = nullptr, AbilityDefinition* abilityToUse = nullptr);
 
 	//State Updates
@@ -136,6 +179,8 @@ private:
 	void UpdateHosting(float deltaSeconds);
 	void UpdateJoining(float deltaSeconds);
 	void UpdatePlaying(float deltaSeconds);
+	void ResolveTurnsInstantly();
+	bool TryRunNextCommand();
 	void UpdateWaiting(float deltaSeconds);
 	void UpdateMapSelectionMovement(float deltaSeconds);
 	void UpdateMapSelectionTargetting(float deltaSeconds);
@@ -156,6 +201,7 @@ private:
 	void RenderActionList() const;
 	void RenderAbilitiesList() const;
 	void RenderEndScreen() const;
+	void DrawNetStatsOverlay() const;
 
 	void DrawUI() const;
 	void DrawPortraitMenu() const;
@@ -172,6 +218,9 @@ private:
 	void UnloadParticleEffects();
 
 	bool CheckForVictoryOrDefeat();
+	void CaptureReplaySetupState();
 	void WriteHistoryToFile();
-	void ReadReplayFromFile();
+	void ReadReplayFromFile(size_t numCommandsToSkip = 0);
+	void FastForwardReplay(size_t commandIndex);
+	uint_fast32_t CalculateKeyframeSeed(size_t commandIndex, uint32_t numTurnsStarted) const;
 };
\ No newline at end of file
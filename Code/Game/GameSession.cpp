@@ -1,12 +1,18 @@
 #include "Game/GameSession.hpp"
 #include "Engine/Core/EngineConfig.hpp"
 #include "Engine/Core/ConsoleSystem.hpp"
+#include "Engine/Core/ErrorWarningAssert.hpp"
 #include "Engine/Network/NetMessage.hpp"
 #include "Engine/Network/NetConnection.hpp"
 #include "Engine/Network/NetMessageDefinition.hpp"
 #include "Engine/Network/TCPSocket.hpp"
+#include "Engine/Core/Time.hpp"
+#include "Engine/Core/Logger.hpp"
 #include "Game/GameCommon.hpp"
 #include "Game/App.hpp"
+#include "Game/ByteCompression.hpp"
+#include <algorithm>
+#include <chrono>
 
 
 bool ConsoleSetSeed(std::string args)
@@ -15,96 +21,575 @@ bool ConsoleSetSeed(std::string args)
 	return true;
 }
 
+bool ConsoleNetPool(std::string args)
+{
+	UNUSED(args);
+
+	const GameSession* session = g_theApp->m_game->m_session;
+	const NetMessagePool& pool = session->m_messagePool;
+	g_theConsole->ConsolePrintf("Pooled net messages: %u allocated, %u sent, %u in use, %u free", (unsigned int)pool.GetNumAllocations(), (unsigned int)pool.GetNumAcquires(),
+		(unsigned int)pool.GetNumInUse(), (unsigned int)pool.GetNumFree());
+	g_theConsole->ConsolePrintf("Allocated outside the pool: %u one-off messages, %u per-connection copies made by SendMessageToOthers",
+		(unsigned int)session->GetNumOneOffMessages(), (unsigned int)session->GetNumPeerCopies());
+	return true;
+}
+
+bool ConsoleNetStats(std::string args)
+{
+	UNUSED(args);
+
+	std::vector<std::string> lines;
+	g_theApp->m_game->m_session->m_netStats.WriteReport(lines, true);
+	for (const std::string& line : lines)
+	{
+		g_theConsole->ConsolePrintf("%s", line.c_str());
+	}
+	return true;
+}
+
+bool ConsoleNetOverlay(std::string args)
+{
+	GameSession* session = g_theApp->m_game->m_session;
+	session->m_showNetStatsOverlay = args.empty() ? !session->m_showNetStatsOverlay : (atoi(args.c_str()) != 0);
+	return true;
+}
+
+//Payload bytes as written by SendStateSnapshot
+static size_t CalculateStateSnapshotBytes(int numCharacters)
+{
+	size_t characterBytes = sizeof(StateHashCharacter::m_characterIndex) + sizeof(StateHashCharacter::m_tileIndex) + sizeof(StateHashCharacter::m_currentHP)
+		+ sizeof(StateHashCharacter::m_currentCT) + sizeof(StateHashCharacter::m_isDead) + NUM_STATUS_EFFECTS * sizeof(StateHashCharacter::m_statusEffectDurations[0]);
+	return sizeof(uint32_t) + sizeof(uint64_t) + sizeof(uint16_t) + numCharacters * characterBytes;
+}
+
 GameSession::GameSession()
 	: m_maxNumPlayers(2)
 	, m_currentNumPlayers(0)
+	, m_isJoiningBattleInProgress(false)
+	, m_netStats(NUM_GAME_MESSAGE_TYPES)
+	, m_showNetStatsOverlay(false)
+	, m_isNetworkThreadRunning(false)
+	, m_isRunning(false)
+	, m_isReady(false)
+	, m_hasLostHost(false)
+	, m_myConnectionIndex(-1)
+	, m_hostConnectionIndex(-1)
+	, m_numConnectionSlots(2)
+	, m_disconnectedConnections(0)
+	, m_numOneOffMessages(0)
+	, m_numPeerCopies(0)
+	, m_nextCommandSequence(0)
+	, m_resumeTurnsHashed(0)
+	, m_hasResumePoint(false)
+	, m_joinRequestTime(0.0)
+	, m_frameNetworkSeconds(0.0)
+	, m_lastPingTime(0.0)
+	, m_pingEchoes()
+	, m_lastNetStatsLogTime(0.0)
+	, m_netStatsLogSeconds(NET_STATS_DEFAULT_LOG_SECONDS)
 {
 	m_players.resize(m_maxNumPlayers, nullptr);
+	m_pendingCommands.reserve(MAX_COMMANDS_PER_BATCH);
+	m_messagePool.Reserve(4);
 
 	SetupMessageDefinitions();
 	g_theConsole->RegisterCommand("set_seed", ConsoleSetSeed);
+	g_theConsole->RegisterCommand("net_pool", ConsoleNetPool);
+	g_theConsole->RegisterCommand("net_stats", ConsoleNetStats);
+	g_theConsole->RegisterCommand("net_overlay", ConsoleNetOverlay);
+
+	//0 turns the periodic log off
+	g_theConfig->GetConfigFloat(m_netStatsLogSeconds, "NetStatsLogSeconds");
+	m_lastNetStatsLogTime = GetCurrentTimeSeconds();
+
+	m_isNetworkThreadRunning = true;
+	m_networkThread = std::thread(&GameSession::RunNetworkThread, this);
 }
 
 GameSession::~GameSession()
 {
+	m_isNetworkThreadRunning = false;
+	m_networkThread.join();
+
+	//Nothing is left to send or apply these, but pooled messages still have to go back before the pool goes away
+	DiscardInboundMessages();
+	ClearInboundBacklog();
+
+	OutboundNetMessage outbound;
+	while (m_outbound.TryPop(outbound))
+	{
+		m_outboundBacklog.push_back(outbound);
+	}
+	for (OutboundNetMessage& unsent : m_outboundBacklog)
+	{
+		if (unsent.m_isPooled)
+			m_messagePool.Recycle(unsent.m_message);
+		else
+			delete unsent.m_message;
+	}
+	m_outboundBacklog.clear();
 
+	RecyclePooledMessages();
+	for (NetMessage* message : m_sentPooledBacklog)
+	{
+		m_messagePool.Recycle(message);
+	}
+	m_sentPooledBacklog.clear();
 }
 
 void GameSession::SetupMessageDefinitions()
 {
 	m_session.m_messageDefinitions.resize(NUM_GAME_MESSAGE_TYPES);
 
-	//  Send/Receive commands
-	//  Send message
-	std::function<void(NetMessage*)> onJoinRequestHandler = [=](NetMessage* msg)
+	//Handlers run on the network thread, so all they do is pass the message on to the main thread
+	for (uint8_t type = SEND_GAME_JOIN_RESPONSE; type < NUM_GAME_MESSAGE_TYPES; type++)
 	{
-		this->OnJoinRequest(msg);
-	};
-	NetMessageDefinition* requestDef = new NetMessageDefinition();
-	requestDef->m_handler = onJoinRequestHandler;
-	requestDef->m_messageTypeIndex = SEND_GAME_JOIN_REQUEST;
-	m_session.RegisterMessageDefinition(SEND_GAME_JOIN_REQUEST, requestDef);
+		std::function<void(NetMessage*)> handler = [=](NetMessage* msg)
+		{
+			this->QueueInbound(type, msg);
+		};
+		NetMessageDefinition* definition = new NetMessageDefinition();
+		definition->m_handler = handler;
+		definition->m_messageTypeIndex = type;
+		m_session.RegisterMessageDefinition(type, definition);
+	}
 
-	std::function<void(NetMessage*)> onJoinResponseHandler = [=](NetMessage* msg)
-	{
-		this->OnJoinResponse(msg);
-	};
-	NetMessageDefinition* responseDef = new NetMessageDefinition();
-	responseDef->m_handler = onJoinResponseHandler;
-	responseDef->m_messageTypeIndex = SEND_GAME_JOIN_RESPONSE;
-	m_session.RegisterMessageDefinition(SEND_GAME_JOIN_RESPONSE, responseDef);
+	m_netStats.SetMessageTypeName(SEND_GAME_JOIN_RESPONSE, "JOIN_RESPONSE");
+	m_netStats.SetMessageTypeName(SEND_GAME_JOIN_REQUEST, "JOIN_REQUEST");
+	m_netStats.SetMessageTypeName(SEND_GAME_ALERT_TURN, "ALERT_TURN");
+	m_netStats.SetMessageTypeName(SEND_GAME_COMMAND, "COMMAND");
+	m_netStats.SetMessageTypeName(SEND_GAME_STATE_HASH, "STATE_HASH");
+	m_netStats.SetMessageTypeName(SEND_GAME_STATE_SNAPSHOT, "STATE_SNAPSHOT");
+	m_netStats.SetMessageTypeName(SEND_GAME_RESUME_BATTLE, "RESUME_BATTLE");
+	m_netStats.SetMessageTypeName(SEND_GAME_PING, "PING");
+}
 
-	std::function<void(NetMessage*)> onTurnAlertHandler = [=](NetMessage* msg)
+void GameSession::Update()
+{
+	double startTime = GetCurrentTimeSeconds();
+	RecyclePooledMessages();
+	MoveOutboundBacklogToQueue();
+	if (IsRunning())
 	{
-		this->OnTurnAlert(msg);
-	};
-	NetMessageDefinition* turnDef = new NetMessageDefinition();
-	turnDef->m_handler = onTurnAlertHandler;
-	turnDef->m_messageTypeIndex = SEND_GAME_ALERT_TURN;
-	m_session.RegisterMessageDefinition(SEND_GAME_ALERT_TURN, turnDef);
+		HandleInboundMessages();
+		CheckForDroppedPlayers();
+		SendPings();
+	}
+	m_frameNetworkSeconds = GetCurrentTimeSeconds() - startTime;
+}
 
-	std::function<void(NetMessage*)> onCommandHandler = [=](NetMessage* msg)
-	{
-		this->OnCommand(msg);
-	};
-	NetMessageDefinition* commandDef = new NetMessageDefinition();
-	commandDef->m_handler = onCommandHandler;
-	commandDef->m_messageTypeIndex = SEND_GAME_COMMAND;
-	m_session.RegisterMessageDefinition(SEND_GAME_COMMAND, commandDef);
+void GameSession::EndFrame()
+{
+	size_t numCommandsQueued = m_pendingCommands.size();
+	double startTime = GetCurrentTimeSeconds();
+	FlushCommands();
+	double now = GetCurrentTimeSeconds();
+	m_frameNetworkSeconds += now - startTime;
 
+	//What the network thread hasn't picked up yet, plus whatever didn't fit in its queue
+	size_t numMessagesUnsent = m_outbound.GetSize() + m_outboundBacklog.size();
+	m_netStats.RecordFrame(m_frameNetworkSeconds, numCommandsQueued, numMessagesUnsent);
+	m_frameNetworkSeconds = 0.0;
+
+	if (m_netStatsLogSeconds > 0.f && now - m_lastNetStatsLogTime >= m_netStatsLogSeconds)
+	{
+		LogNetStats();
+		m_lastNetStatsLogTime = now;
+	}
 }
 
-void GameSession::Update()
+void GameSession::LogNetStats()
 {
-	if (m_session.IsRunning())
+	std::vector<std::string> lines;
+	m_netStats.WriteReport(lines, true);
+	for (const std::string& line : lines)
 	{
-		m_session.Update();
+		LogPrintf("NetStats: %s\n", line.c_str());
 	}
+	m_netStats.ResetPeaks();
 }
 
 bool GameSession::Join(NetAddress address)
 {
-	m_session.Leave();
-	bool success = m_session.Join(address);
-	if (success)
+	bool success;
+	{
+		std::lock_guard<std::mutex> lock(m_sessionLock);
+		SendAllOutbound();
+		m_session.Leave();
+		ClearInboundBacklog();
+
+		success = m_session.Join(address);
+		if (success)
+		{
+			((TCPConnection*)m_session.m_hostConnection)->m_socket->SetBlocking(false);
+		}
+		RefreshSessionState();
+	}
+	DiscardInboundMessages();
+	ResetCommandStream();
+	m_pingEchoes.clear();
+
+	//A rejoin starts from nothing; the host's response says who's in and whether the battle is already going
+	for (Player*& player : m_players)
 	{
-		((TCPConnection*)m_session.m_hostConnection)->m_socket->SetBlocking(false);
+		delete player;
+		player = nullptr;
 	}
+	m_currentNumPlayers = 0;
+	m_isJoiningBattleInProgress = false;
+	m_netStats.Reset();
 	return success;
 }
 
-void GameSession::OnJoinRequest(NetMessage* msg)
+void GameSession::Host(uint16_t port)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_sessionLock);
+		SendAllOutbound();
+		ClearInboundBacklog();
+
+		m_session.Host(port);
+		m_session.StartListening();
+		m_hostAddressText = (nullptr != m_session.m_hostConnection) ? NetAddressToString(m_session.m_hostConnection->m_address) : "";
+		RefreshSessionState();
+	}
+	DiscardInboundMessages();
+	m_pingEchoes.clear();
+}
+
+void GameSession::Leave()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_sessionLock);
+		SendAllOutbound();
+		m_session.Leave();
+		ClearInboundBacklog();
+		RefreshSessionState();
+	}
+	DiscardInboundMessages();
+}
+
+void GameSession::HandleInboundMessages()
+{
+	//A handler that leaves the session empties the queue, which ends this loop too
+	InboundNetMessage inbound;
+	while (m_inbound.TryPop(inbound))
+	{
+		switch (inbound.m_type)
+		{
+		case SEND_GAME_JOIN_RESPONSE:	OnJoinResponse(inbound.m_message, inbound.m_connectionIndex);	break;
+		case SEND_GAME_JOIN_REQUEST:	OnJoinRequest(inbound);											break;
+		case SEND_GAME_ALERT_TURN:		OnTurnAlert(inbound);											break;
+		case SEND_GAME_COMMAND:			OnCommand(inbound);												break;
+		case SEND_GAME_STATE_HASH:		OnStateHash(inbound);											break;
+		case SEND_GAME_STATE_SNAPSHOT:	OnStateSnapshot(inbound.m_message, inbound.m_connectionIndex);	break;
+		case SEND_GAME_RESUME_BATTLE:	OnResumeBattle(inbound.m_message, inbound.m_connectionIndex);	break;
+		case SEND_GAME_PING:			OnPing(inbound);												break;
+		default:																						break;
+		}
+		delete inbound.m_message;
+	}
+}
+
+void GameSession::DiscardInboundMessages()
+{
+	InboundNetMessage inbound;
+	while (m_inbound.TryPop(inbound))
+	{
+		delete inbound.m_message;
+	}
+}
+
+void GameSession::QueueOutbound(NetMessage* message, int connectionIndex, bool isPooled)
+{
+	OutboundNetMessage outbound;
+	outbound.m_message = message;
+	outbound.m_connectionIndex = connectionIndex;
+	outbound.m_isPooled = isPooled;
+	if (!isPooled)
+		m_numOneOffMessages++;
+
+	//Anything already waiting goes first, so messages still leave in the order they were sent
+	m_outboundBacklog.push_back(outbound);
+	MoveOutboundBacklogToQueue();
+}
+
+bool GameSession::MoveOutboundBacklogToQueue()
+{
+	size_t numMoved = 0;
+	while (numMoved < m_outboundBacklog.size() && m_outbound.TryPush(m_outboundBacklog[numMoved]))
+	{
+		numMoved++;
+	}
+	m_outboundBacklog.erase(m_outboundBacklog.begin(), m_outboundBacklog.begin() + numMoved);
+	return m_outboundBacklog.empty();
+}
+
+//Only with m_sessionLock held; sends everything the main thread has queued before the session changes
+void GameSession::SendAllOutbound()
+{
+	bool isBacklogEmpty;
+	do
+	{
+		isBacklogEmpty = MoveOutboundBacklogToQueue();
+		SendOutbound();
+		RecyclePooledMessages();
+	} while (!isBacklogEmpty);
+}
+
+void GameSession::RecyclePooledMessages()
+{
+	NetMessage* message;
+	while (m_sentPooledMessages.TryPop(message))
+	{
+		m_messagePool.Recycle(message);
+	}
+}
+
+void GameSession::RunNetworkThread()
+{
+	while (m_isNetworkThreadRunning)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_sessionLock);
+			SendOutbound();
+
+			//While the main thread is behind the session isn't read at all, so TCP pushes back on whoever is sending
+			if (MoveBacklogToQueues() && m_session.IsRunning())
+			{
+				m_session.Update();
+
+				//State goes out before the messages, so whatever the main thread pops is never newer than what it sees
+				RefreshSessionState();
+				MoveBacklogToQueues();
+			}
+			else
+			{
+				RefreshSessionState();
+			}
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(NETWORK_THREAD_SLEEP_MS));
+	}
+}
+
+void GameSession::QueueInbound(uint8_t type, NetMessage* msg)
+{
+	InboundNetMessage inbound;
+	inbound.m_type = type;
+	inbound.m_connectionIndex = msg->m_sender->m_connectionIndex;
+	inbound.m_message = nullptr;
+	inbound.m_batchSequence = 0;
+	inbound.m_batchBytes = 0;
+	inbound.m_numBatchCommands = 0;
+	inbound.m_batchCommandIndex = 0;
+	inbound.m_command = NetCommand();
+	inbound.m_alertCharacterIndex = 0;
+	inbound.m_hashTurn = 0;
+	inbound.m_hash = 0;
+	inbound.m_pingSentTime = 0.0;
+	inbound.m_hasPingEcho = false;
+	inbound.m_echoedPingTime = 0.0;
+	inbound.m_pingEchoHeldSeconds = 0.0;
+
+	//The session owns msg and reuses it once this returns, so anything small is read out of it here
+	switch (type)
+	{
+	case SEND_GAME_COMMAND:
+		break;
+	case SEND_GAME_JOIN_REQUEST:
+		m_inboundBacklog.push_back(inbound);
+		return;
+	case SEND_GAME_ALERT_TURN:
+		msg->Read(inbound.m_alertCharacterIndex);
+		m_inboundBacklog.push_back(inbound);
+		return;
+	case SEND_GAME_STATE_HASH:
+		msg->Read(inbound.m_hashTurn);
+		msg->Read(inbound.m_hash);
+		m_inboundBacklog.push_back(inbound);
+		return;
+	case SEND_GAME_PING:
+	{
+		//Only the echo of our own ping matters here
+		uint8_t numEchoes;
+		msg->Read(inbound.m_pingSentTime);
+		msg->Read(numEchoes);
+		for (uint8_t echoIndex = 0; echoIndex < numEchoes; echoIndex++)
+		{
+			uint8_t echoConnectionIndex;
+			double echoedTime;
+			double heldSeconds;
+			msg->Read(echoConnectionIndex);
+			msg->Read(echoedTime);
+			msg->Read(heldSeconds);
+			if ((int)echoConnectionIndex == m_myConnectionIndex)
+			{
+				inbound.m_hasPingEcho = true;
+				inbound.m_echoedPingTime = echoedTime;
+				inbound.m_pingEchoHeldSeconds = heldSeconds;
+			}
+		}
+		m_inboundBacklog.push_back(inbound);
+		return;
+	}
+	default:
+		//Join responses, snapshots and resumes come once a connection or once a desync, and are too big for an entry
+		inbound.m_message = new NetMessage(*msg);
+		m_inboundBacklog.push_back(inbound);
+		return;
+	}
+
+	//Command batches are decoded here, so the main thread only has to apply them
+	uint8_t numCommands;
+	msg->Read(inbound.m_batchSequence);
+	msg->Read(numCommands);
+	msg->Read(inbound.m_batchBytes);
+
+	m_networkCommandBuffer.Clear();
+	for (uint16_t byteIndex = 0; byteIndex < inbound.m_batchBytes; byteIndex++)
+	{
+		uint8_t byte;
+		msg->Read(byte);
+		m_networkCommandBuffer.WriteByte(byte);
+	}
+
+	//A malformed batch still goes through, with no commands, so the main thread can report it in order
+	ByteReader reader(m_networkCommandBuffer);
+	if (!DecodeCommandBatch(reader, numCommands, m_networkCommands))
+	{
+		m_inboundBacklog.push_back(inbound);
+		return;
+	}
+
+	inbound.m_numBatchCommands = (uint8_t)m_networkCommands.size();
+	for (size_t commandIndex = 0; commandIndex < m_networkCommands.size(); commandIndex++)
+	{
+		inbound.m_batchCommandIndex = (uint8_t)commandIndex;
+		inbound.m_command = m_networkCommands[commandIndex];
+		m_inboundBacklog.push_back(inbound);
+	}
+}
+
+void GameSession::SendOutbound()
+{
+	OutboundNetMessage outbound;
+	while (m_outbound.TryPop(outbound))
+	{
+		if (outbound.m_connectionIndex == SEND_TO_OTHERS)
+		{
+			if (m_session.IsRunning())
+			{
+				m_session.SendMessageToOthers(*outbound.m_message);
+				m_numPeerCopies += CountOtherConnections();
+			}
+
+			if (outbound.m_isPooled)
+				m_sentPooledBacklog.push_back(outbound.m_message);
+			else
+				delete outbound.m_message;
+			continue;
+		}
+
+		NetConnection* connection = nullptr;
+		if (m_session.IsRunning())
+			connection = (outbound.m_connectionIndex == SEND_TO_HOST) ? m_session.m_hostConnection : m_session.GetConnection((uint8_t)outbound.m_connectionIndex);
+
+		if (nullptr != connection)
+			connection->Send(outbound.m_message);
+		else
+			delete outbound.m_message;
+	}
+
+	size_t numReturned = 0;
+	while (numReturned < m_sentPooledBacklog.size() && m_sentPooledMessages.TryPush(m_sentPooledBacklog[numReturned]))
+	{
+		numReturned++;
+	}
+	m_sentPooledBacklog.erase(m_sentPooledBacklog.begin(), m_sentPooledBacklog.begin() + numReturned);
+}
+
+size_t GameSession::CountOtherConnections()
+{
+	size_t numOtherConnections = 0;
+	uint8_t numConnectionSlots = m_numConnectionSlots;
+	for (uint8_t connectionIndex = 0; connectionIndex < numConnectionSlots; connectionIndex++)
+	{
+		NetConnection* connection = m_session.GetConnection(connectionIndex);
+		if (nullptr != connection && connection != m_session.m_myConnection)
+			numOtherConnections++;
+	}
+	return numOtherConnections;
+}
+
+bool GameSession::MoveBacklogToQueues()
+{
+	size_t numMoved = 0;
+	while (numMoved < m_inboundBacklog.size() && m_inbound.TryPush(m_inboundBacklog[numMoved]))
+	{
+		numMoved++;
+	}
+	m_inboundBacklog.erase(m_inboundBacklog.begin(), m_inboundBacklog.begin() + numMoved);
+	return m_inboundBacklog.empty();
+}
+
+void GameSession::ClearInboundBacklog()
 {
-	m_players[msg->m_sender->m_connectionIndex] = new Player();
-	m_players[msg->m_sender->m_connectionIndex]->m_connectionIndex = msg->m_sender->m_connectionIndex;
+	for (InboundNetMessage& inbound : m_inboundBacklog)
+	{
+		delete inbound.m_message;
+	}
+	m_inboundBacklog.clear();
+}
+
+void GameSession::RefreshSessionState()
+{
+	bool isRunning = m_session.IsRunning();
+	NetConnection* myConnection = isRunning ? m_session.m_myConnection : nullptr;
+	TCPConnection* hostConnection = isRunning ? (TCPConnection*)m_session.m_hostConnection : nullptr;
+
+	m_isRunning = isRunning;
+	m_isReady = isRunning && m_session.IsReady();
+	m_myConnectionIndex = (nullptr != myConnection) ? myConnection->m_connectionIndex : -1;
+	m_hostConnectionIndex = (nullptr != hostConnection) ? hostConnection->m_connectionIndex : -1;
+	m_hasLostHost = nullptr == hostConnection || hostConnection->IsDisconnected();
+
+	uint32_t disconnectedConnections = 0;
+	uint8_t numConnectionSlots = std::min((uint8_t)m_numConnectionSlots, (uint8_t)32);
+	for (uint8_t connectionIndex = 0; isRunning && connectionIndex < numConnectionSlots; connectionIndex++)
+	{
+		TCPConnection* connection = (TCPConnection*)m_session.GetConnection(connectionIndex);
+		if (nullptr == connection || connection->IsDisconnected())
+			disconnectedConnections |= 1u << connectionIndex;
+	}
+	m_disconnectedConnections = disconnectedConnections;
+}
 
-	m_currentNumPlayers++;
+void GameSession::OnJoinRequest(const InboundNetMessage& inbound)
+{
+	uint8_t connectionIndex = inbound.m_connectionIndex;
+	m_netStats.ResetConnection(connectionIndex);
+	m_netStats.RecordReceived(connectionIndex, SEND_GAME_JOIN_REQUEST, 0);
+	if (nullptr == m_players[connectionIndex])
+	{
+		m_players[connectionIndex] = new Player();
+		m_players[connectionIndex]->m_connectionIndex = connectionIndex;
+		m_currentNumPlayers++;
+	}
+	else
+	{
+		//Back in the seat a dropped connection left, so the characters it owned are its again
+		m_players[connectionIndex]->m_hasDropped = false;
+	}
+
+	ResetCommandStream();
+	SendJoinResponse(connectionIndex);
 
 	Game* game = g_theApp->m_game;
-	SendJoinResponse(msg->m_sender->m_connectionIndex);
+	if (game->IsBattleRunning())
+		SendResumeBattle(connectionIndex);
 }
 
-void GameSession::OnJoinResponse(NetMessage* msg)
+void GameSession::OnJoinResponse(NetMessage* msg, uint8_t connectionIndex)
 {
 	Game* game = g_theApp->m_game;
 	msg->Read(m_maxNumPlayers);
@@ -118,51 +603,159 @@ void GameSession::OnJoinResponse(NetMessage* msg)
 		msg->Read(newPlayer->m_connectionIndex);
 		m_players[newPlayer->m_connectionIndex] = newPlayer;
 	}
+	msg->Read(m_isJoiningBattleInProgress);
+	m_numConnectionSlots = m_maxNumPlayers;
+	m_netStats.RecordReceived(connectionIndex, SEND_GAME_JOIN_RESPONSE, 2 * sizeof(uint8_t) + sizeof(m_seed) + m_currentNumPlayers * sizeof(uint8_t) + sizeof(bool));
 
 	game->Initialize();
 }
 
-void GameSession::OnTurnAlert(NetMessage* msg)
+void GameSession::OnTurnAlert(const InboundNetMessage& inbound)
 {
-	uint8_t characterIndex;
-	msg->Read(characterIndex);
+	CharacterID characterIndex = inbound.m_alertCharacterIndex;
+	m_netStats.RecordReceived(inbound.m_connectionIndex, SEND_GAME_ALERT_TURN, sizeof(characterIndex));
 
 	g_theApp->m_game->m_currentGameState = STATE_PLAYING;
 	g_theApp->m_game->m_currentUIState = STATE_COMMAND_LIST;
 
-	for(Character* character : g_theApp->m_game->m_theMap->m_characters)
+	Character* character = g_theApp->m_game->m_theMap->FindCharacterByIndex(characterIndex);
+	if (nullptr != character)
+	{
+		g_theApp->m_game->m_theMap->m_selectedCharacter = character;
+		g_theApp->m_game->m_theMap->m_selectedTile = character->m_currentTile;
+	}
+}
+
+void GameSession::OnCommand(const InboundNetMessage& inbound)
+{
+	//The network thread already split the batch up; its first command stands in for the batch as a whole
+	uint8_t connectionIndex = inbound.m_connectionIndex;
+	if (inbound.m_batchCommandIndex == 0)
 	{
-		if(character->m_characterIndex == characterIndex)
+		//Batches arrive in order over TCP, so a gap means a message was dropped or sent twice on the way
+		m_netStats.RecordReceived(connectionIndex, SEND_GAME_COMMAND, sizeof(inbound.m_batchSequence) + sizeof(uint8_t) + sizeof(inbound.m_batchBytes) + inbound.m_batchBytes);
+		if (connectionIndex >= m_nextRemoteCommandSequences.size())
+			m_nextRemoteCommandSequences.resize(connectionIndex + 1, 0);
+		if (inbound.m_batchSequence != m_nextRemoteCommandSequences[connectionIndex])
+			g_theConsole->ConsolePrintf("Command batch %u from connection %d was expected to be %u.", inbound.m_batchSequence, connectionIndex, m_nextRemoteCommandSequences[connectionIndex]);
+		m_nextRemoteCommandSequences[connectionIndex] = inbound.m_batchSequence + 1;
+
+		if (inbound.m_numBatchCommands == 0)
 		{
-			g_theApp->m_game->m_theMap->m_selectedCharacter = character;
-			g_theApp->m_game->m_theMap->m_selectedTile = character->m_currentTile;
-			break;
+			g_theConsole->ConsolePrintf("Dropped malformed command batch %u from connection %d.", inbound.m_batchSequence, connectionIndex);
+			return;
 		}
 	}
+
+	const NetCommand& command = inbound.m_command;
+	g_theApp->m_game->ProcessCommand(command.m_type, command.m_actingCharacterIndex, command.m_tileIndex, command.m_targettedCharacterIndex, command.m_abilityIndex);
+
+	if (IsHosting())
+		m_resumeCommands.push_back(command);
+}
+
+void GameSession::OnStateHash(const InboundNetMessage& inbound)
+{
+	m_netStats.RecordReceived(inbound.m_connectionIndex, SEND_GAME_STATE_HASH, sizeof(inbound.m_hashTurn) + sizeof(inbound.m_hash));
+
+	g_theApp->m_game->m_desyncDetector.OnRemoteHash(inbound.m_connectionIndex, inbound.m_hashTurn, inbound.m_hash);
 }
 
-void GameSession::OnCommand(NetMessage* msg)
+void GameSession::OnStateSnapshot(NetMessage* msg, uint8_t connectionIndex)
 {
-	uint8_t commandType;
-	uint8_t characterIndex;
-	unsigned int tileIndex;
-	uint8_t targettedCharacterIndex;
-	uint8_t abilityIndex;
+	StateHashSnapshot snapshot;
+	uint16_t numCharacters;
+	msg->Read(snapshot.m_turn);
+	msg->Read(snapshot.m_hash);
+	msg->Read(numCharacters);
+	snapshot.m_characters.resize(numCharacters);
 
-	msg->Read(commandType);
-	msg->Read(characterIndex);
-	msg->Read(tileIndex);
-	msg->Read(targettedCharacterIndex);
-	msg->Read(abilityIndex);
+	for (StateHashCharacter& character : snapshot.m_characters)
+	{
+		msg->Read(character.m_characterIndex);
+		msg->Read(character.m_tileIndex);
+		msg->Read(character.m_currentHP);
+		msg->Read(character.m_currentCT);
+		msg->Read(character.m_isDead);
+		for (int effectIndex = 0; effectIndex < NUM_STATUS_EFFECTS; effectIndex++)
+		{
+			msg->Read(character.m_statusEffectDurations[effectIndex]);
+		}
+	}
+	m_netStats.RecordReceived(connectionIndex, SEND_GAME_STATE_SNAPSHOT, CalculateStateSnapshotBytes(numCharacters));
 
-	g_theApp->m_game->ProcessCommand(commandType, characterIndex, tileIndex, targettedCharacterIndex, abilityIndex);
+	g_theApp->m_game->m_desyncDetector.OnRemoteSnapshot(connectionIndex, snapshot);
 }
 
+void GameSession::OnResumeBattle(NetMessage* msg, uint8_t connectionIndex)
+{
+	Game* game = g_theApp->m_game;
+	if (game->m_currentGameState != STATE_JOINING || !m_isJoiningBattleInProgress)
+		return;
+
+	uint32_t numTurnsHashed;
+	uint16_t numCompressedBytes;
+	msg->Read(numTurnsHashed);
+	msg->Read(numCompressedBytes);
+
+	m_resumeBuffer.Clear();
+	for (uint16_t byteIndex = 0; byteIndex < numCompressedBytes; byteIndex++)
+	{
+		uint8_t byte;
+		msg->Read(byte);
+		m_resumeBuffer.WriteByte(byte);
+	}
+
+	uint8_t numCommands;
+	uint16_t numCommandBytes;
+	msg->Read(numCommands);
+	msg->Read(numCommandBytes);
+
+	m_commandBuffer.Clear();
+	for (uint16_t byteIndex = 0; byteIndex < numCommandBytes; byteIndex++)
+	{
+		uint8_t byte;
+		msg->Read(byte);
+		m_commandBuffer.WriteByte(byte);
+	}
+	m_netStats.RecordReceived(connectionIndex, SEND_GAME_RESUME_BATTLE, sizeof(numTurnsHashed) + sizeof(numCompressedBytes) + numCompressedBytes
+		+ sizeof(numCommands) + sizeof(numCommandBytes) + numCommandBytes);
+
+	std::string error;
+	ByteReader saveReader(m_resumeBuffer);
+	ByteReader commandReader(m_commandBuffer);
+	if (!DecompressBytes(saveReader, &m_resumeSave, sizeof(BattleSave)))
+		error = "The host's battle didn't decompress.";
+	else if (ValidateBattleSave(m_resumeSave, "The host's battle", error) && !DecodeCommandBatch(commandReader, numCommands, m_receivedCommands))
+		error = "The host's queued commands are malformed.";
+
+	if (!error.empty())
+	{
+		g_theConsole->ConsolePrintf("Could not resume: %s", error.c_str());
+		Leave();
+		return;
+	}
+
+	game->ResumeBattle(m_resumeSave, numTurnsHashed);
+	for (const NetCommand& command : m_receivedCommands)
+	{
+		game->ProcessCommand(command.m_type, command.m_actingCharacterIndex, command.m_tileIndex, command.m_targettedCharacterIndex, command.m_abilityIndex);
+	}
+
+	g_theConsole->ConsolePrintf("Resumed at command %u with %u queued: %u bytes of battle (%u uncompressed) arrived %.0fms after asking to join",
+		m_resumeSave.m_numCommandsRun, (unsigned int)m_receivedCommands.size(), (unsigned int)numCompressedBytes, (unsigned int)sizeof(BattleSave), (GetCurrentTimeSeconds() - m_joinRequestTime) * 1000.0);
+}
+
+//Connection::Send takes ownership of the message, so these one-off sends can't come from the pool. The network
+//thread does the actual sending, so a send here only queues the message for it.
 void GameSession::SendJoinRequest()
 {
 	NetMessage* msg = new NetMessage(SEND_GAME_JOIN_REQUEST);
+	m_joinRequestTime = GetCurrentTimeSeconds();
 
-	m_session.m_hostConnection->Send(msg);
+	QueueOutbound(msg, SEND_TO_HOST, false);
+	if (m_hostConnectionIndex >= 0)
+		m_netStats.RecordSent((uint8_t)m_hostConnectionIndex, SEND_GAME_JOIN_REQUEST, 0);
 }
 
 void GameSession::SendJoinResponse(uint8_t connectionIndex)
@@ -172,34 +765,267 @@ void GameSession::SendJoinResponse(uint8_t connectionIndex)
 	msg->Write(m_currentNumPlayers);
 	msg->Write(m_seed);
 
+	size_t numPlayersWritten = 0;
 	for (Player* player : m_players)
 	{
 		if (nullptr != player)
 		{
 			msg->Write(player->m_connectionIndex);
+			numPlayersWritten++;
 		}
 	}
+	msg->Write(g_theApp->m_game->IsBattleRunning());
 
-
-	m_session.GetConnection(connectionIndex)->Send(msg);
+	QueueOutbound(msg, connectionIndex, false);
+	m_netStats.RecordSent(connectionIndex, SEND_GAME_JOIN_RESPONSE, 2 * sizeof(uint8_t) + sizeof(m_seed) + numPlayersWritten * sizeof(uint8_t) + sizeof(bool));
 }
 
-void GameSession::SendTurnAlert(uint8_t connectionIndex, uint8_t characterIndex)
+void GameSession::SendTurnAlert(uint8_t connectionIndex, CharacterID characterIndex)
 {
 	NetMessage* msg = new NetMessage(SEND_GAME_ALERT_TURN);
 	msg->Write(characterIndex);
 
-	m_session.GetConnection(connectionIndex)->Send(msg);
+	QueueOutbound(msg, connectionIndex, false);
+	m_netStats.RecordSent(connectionIndex, SEND_GAME_ALERT_TURN, sizeof(characterIndex));
 }
 
-void GameSession::SendCommand(uint8_t commandType, uint8_t characterIndex, unsigned int targettedTileIndex, uint8_t targettedCharacterIndex, uint8_t abilityIndex)
+void GameSession::SendCommand(uint8_t commandType, CharacterID characterIndex, unsigned int targettedTileIndex, CharacterID targettedCharacterIndex, uint8_t abilityIndex)
 {
-	NetMessage* msg = new NetMessage(SEND_GAME_COMMAND);
-	msg->Write(commandType);
-	msg->Write(characterIndex);
-	msg->Write(targettedTileIndex);
-	msg->Write(targettedCharacterIndex);
-	msg->Write(abilityIndex);
+	ASSERT_OR_DIE(targettedTileIndex <= 0xFFFF, "Tile index is too large to send.");
+
+	NetCommand command;
+	command.m_type = commandType;
+	command.m_actingCharacterIndex = characterIndex;
+	command.m_tileIndex = (uint16_t)targettedTileIndex;
+	command.m_targettedCharacterIndex = targettedCharacterIndex;
+	command.m_abilityIndex = abilityIndex;
+	m_pendingCommands.push_back(command);
+	if (IsHosting())
+		m_resumeCommands.push_back(command);
+
+	if (m_pendingCommands.size() >= MAX_COMMANDS_PER_BATCH)
+		FlushCommands();
+}
+
+void GameSession::FlushCommands()
+{
+	if (m_pendingCommands.empty())
+		return;
+
+	EncodeCommandBatch(&m_pendingCommands[0], m_pendingCommands.size(), m_commandBuffer);
+	ASSERT_OR_DIE(m_commandBuffer.GetSize() <= MAX_COMMAND_BATCH_BYTES, "Command batch is too large to send.");
+
+	PooledNetMessage msg = m_messagePool.Acquire(SEND_GAME_COMMAND);
+	msg->Write(m_nextCommandSequence);
+	msg->Write((uint8_t)m_pendingCommands.size());
+	msg->Write((uint16_t)m_commandBuffer.GetSize());
+	for (uint8_t byte : m_commandBuffer.m_bytes)
+	{
+		msg->Write(byte);
+	}
+
+	QueueOutbound(msg.Detach(), SEND_TO_OTHERS, true);
+	RecordSentToOthers(SEND_GAME_COMMAND, sizeof(m_nextCommandSequence) + sizeof(uint8_t) + sizeof(uint16_t) + m_commandBuffer.GetSize());
+	m_nextCommandSequence++;
+	m_pendingCommands.clear();
+}
+
+void GameSession::ResetCommandStream()
+{
+	m_pendingCommands.clear();
+	m_nextCommandSequence = 0;
+	m_nextRemoteCommandSequences.clear();
+}
+
+void GameSession::SendStateHash(uint32_t turn, uint64_t hash)
+{
+	PooledNetMessage msg = m_messagePool.Acquire(SEND_GAME_STATE_HASH);
+	msg->Write(turn);
+	msg->Write(hash);
+
+	QueueOutbound(msg.Detach(), SEND_TO_OTHERS, true);
+	RecordSentToOthers(SEND_GAME_STATE_HASH, sizeof(turn) + sizeof(hash));
+}
+
+void GameSession::SendStateSnapshot(const StateHashSnapshot& snapshot)
+{
+	PooledNetMessage msg = m_messagePool.Acquire(SEND_GAME_STATE_SNAPSHOT);
+	msg->Write(snapshot.m_turn);
+	msg->Write(snapshot.m_hash);
+	uint16_t numCharacters = (uint16_t)snapshot.m_characters.size();
+	msg->Write(numCharacters);
+
+	for (const StateHashCharacter& character : snapshot.m_characters)
+	{
+		msg->Write(character.m_characterIndex);
+		msg->Write(character.m_tileIndex);
+		msg->Write(character.m_currentHP);
+		msg->Write(character.m_currentCT);
+		msg->Write(character.m_isDead);
+		for (int effectIndex = 0; effectIndex < NUM_STATUS_EFFECTS; effectIndex++)
+		{
+			msg->Write(character.m_statusEffectDurations[effectIndex]);
+		}
+	}
+
+	QueueOutbound(msg.Detach(), SEND_TO_OTHERS, true);
+	RecordSentToOthers(SEND_GAME_STATE_SNAPSHOT, CalculateStateSnapshotBytes(numCharacters));
+}
+
+void GameSession::SendResumeBattle(uint8_t connectionIndex)
+{
+	if (!m_hasResumePoint)
+	{
+		g_theConsole->ConsolePrintf("Connection %d can't resume the battle: it hasn't reached a turn yet, or is too large to save.", connectionIndex);
+		return;
+	}
+
+	double startTime = GetCurrentTimeSeconds();
+	CompressBytes(&m_resumeSave, sizeof(BattleSave), m_resumeBuffer);
+	ASSERT_OR_DIE(m_resumeBuffer.GetSize() <= MAX_RESUME_BATTLE_BYTES, "Battle is too large to send to a rejoining player.");
+	ASSERT_OR_DIE(m_resumeCommands.size() <= MAX_COMMANDS_PER_BATCH, "Too many commands queued to send to a rejoining player.");
+
+	m_commandBuffer.Clear();
+	if (!m_resumeCommands.empty())
+		EncodeCommandBatch(&m_resumeCommands[0], m_resumeCommands.size(), m_commandBuffer);
+
+	NetMessage* msg = new NetMessage(SEND_GAME_RESUME_BATTLE);
+	msg->Write(m_resumeTurnsHashed);
+	msg->Write((uint16_t)m_resumeBuffer.GetSize());
+	for (uint8_t byte : m_resumeBuffer.m_bytes)
+	{
+		msg->Write(byte);
+	}
+	msg->Write((uint8_t)m_resumeCommands.size());
+	msg->Write((uint16_t)m_commandBuffer.GetSize());
+	for (uint8_t byte : m_commandBuffer.m_bytes)
+	{
+		msg->Write(byte);
+	}
+
+	QueueOutbound(msg, connectionIndex, false);
+	m_netStats.RecordSent(connectionIndex, SEND_GAME_RESUME_BATTLE, sizeof(m_resumeTurnsHashed) + sizeof(uint16_t) + m_resumeBuffer.GetSize()
+		+ sizeof(uint8_t) + sizeof(uint16_t) + m_commandBuffer.GetSize());
+	g_theConsole->ConsolePrintf("Sent connection %d the battle at command %u: %u bytes compressed to %u, %u commands queued, %.2fms to build", connectionIndex,
+		m_resumeSave.m_numCommandsRun, (unsigned int)sizeof(BattleSave), (unsigned int)m_resumeBuffer.GetSize(), (unsigned int)m_resumeCommands.size(), (GetCurrentTimeSeconds() - startTime) * 1000.0);
+}
+
+void GameSession::SendPings()
+{
+	double now = GetCurrentTimeSeconds();
+	if (now - m_lastPingTime < NET_PING_INTERVAL_SECONDS || m_myConnectionIndex < 0)
+		return;
+	m_lastPingTime = now;
+
+	//Echoes ride along with the ping every peer gets, instead of each going out as a reply NetConnection::Send would
+	//have to be handed a new message for
+	uint8_t numEchoes = (uint8_t)m_pingEchoes.size();
+	PooledNetMessage msg = m_messagePool.Acquire(SEND_GAME_PING);
+	msg->Write(now);
+	msg->Write(numEchoes);
+	for (const PingEcho& echo : m_pingEchoes)
+	{
+		msg->Write(echo.m_connectionIndex);
+		msg->Write(echo.m_sentTime);
+		msg->Write(now - echo.m_receivedTime);
+	}
+	m_pingEchoes.clear();
+
+	QueueOutbound(msg.Detach(), SEND_TO_OTHERS, true);
+	RecordSentToOthers(SEND_GAME_PING, sizeof(now) + sizeof(numEchoes) + numEchoes * (sizeof(uint8_t) + 2 * sizeof(double)));
+}
+
+void GameSession::OnPing(const InboundNetMessage& inbound)
+{
+	uint8_t connectionIndex = inbound.m_connectionIndex;
+	double now = GetCurrentTimeSeconds();
+	m_netStats.RecordReceived(connectionIndex, SEND_GAME_PING, sizeof(double) + sizeof(uint8_t));
 
-	m_session.SendMessageToOthers(*msg);
+	//Both ends handle pings on their main thread, so this includes up to a frame of waiting on either side
+	if (inbound.m_hasPingEcho)
+		m_netStats.RecordRoundTrip(connectionIndex, now - inbound.m_echoedPingTime - inbound.m_pingEchoHeldSeconds);
+
+	//Only the newest ping from each connection is echoed
+	for (PingEcho& echo : m_pingEchoes)
+	{
+		if (echo.m_connectionIndex == connectionIndex)
+		{
+			echo.m_sentTime = inbound.m_pingSentTime;
+			echo.m_receivedTime = now;
+			return;
+		}
+	}
+
+	PingEcho echo;
+	echo.m_connectionIndex = connectionIndex;
+	echo.m_sentTime = inbound.m_pingSentTime;
+	echo.m_receivedTime = now;
+	m_pingEchoes.push_back(echo);
+}
+
+bool GameSession::IsHosting() const
+{
+	int myConnectionIndex = m_myConnectionIndex;
+	return myConnectionIndex >= 0 && myConnectionIndex == m_hostConnectionIndex;
+}
+
+bool GameSession::HasConnectedPeers() const
+{
+	int myConnectionIndex = m_myConnectionIndex;
+	for (Player* player : m_players)
+	{
+		if (nullptr != player && !player->m_hasDropped && player->m_connectionIndex != myConnectionIndex)
+			return true;
+	}
+
+	return false;
+}
+
+void GameSession::ClearResumePoint()
+{
+	m_hasResumePoint = false;
+	m_resumeCommands.clear();
+}
+
+void GameSession::CaptureResumePoint(const Map& map, uint32_t numCommandsRun, uint32_t numTurnsStarted, uint32_t numTurnsHashed, size_t numCommandsQueued)
+{
+	CaptureBattleSave(map, (uint32_t)m_seed, numCommandsRun, numTurnsStarted, m_resumeSave);
+	SealBattleSave(m_resumeSave);
+	m_resumeTurnsHashed = numTurnsHashed;
+	m_hasResumePoint = true;
+
+	//Commands arrive in the order they're queued, so the ones the save doesn't include yet are the newest
+	if (m_resumeCommands.size() > numCommandsQueued)
+		m_resumeCommands.erase(m_resumeCommands.begin(), m_resumeCommands.end() - numCommandsQueued);
+}
+
+void GameSession::CheckForDroppedPlayers()
+{
+	if (!IsHosting())
+		return;
+
+	uint32_t disconnectedConnections = m_disconnectedConnections;
+	for (Player* player : m_players)
+	{
+		if (nullptr == player || player->m_hasDropped || player->m_connectionIndex == m_myConnectionIndex || player->m_connectionIndex >= 32)
+			continue;
+
+		if ((disconnectedConnections & (1u << player->m_connectionIndex)) != 0)
+		{
+			//Keep the seat; the battle waits on that player's turns until they rejoin
+			player->m_hasDropped = true;
+			g_theConsole->ConsolePrintf("Player %d dropped. They can rejoin to pick the battle back up.", player->m_connectionIndex);
+		}
+	}
+}
+
+void GameSession::RecordSentToOthers(uint8_t type, size_t numBytes)
+{
+	//SendMessageToOthers copies the message to every connection but this one
+	int myConnectionIndex = m_myConnectionIndex;
+	for (Player* player : m_players)
+	{
+		if (nullptr != player && !player->m_hasDropped && player->m_connectionIndex != myConnectionIndex)
+			m_netStats.RecordSent(player->m_connectionIndex, type, numBytes);
+	}
 }
@@ -1,6 +1,15 @@
 #pragma once
 #include "Engine/Network/TCPSession.hpp"
 #include "Engine/Math/Vector2.hpp"
+#include "Game/StateHash.hpp"
+#include "Game/CommandBatch.hpp"
+#include "Game/NetMessagePool.hpp"
+#include "Game/BattleSave.hpp"
+#include "Game/NetStats.hpp"
+#include "Game/SPSCQueue.hpp"
+#include <atomic>
+#include <mutex>
+#include <thread>
 
 
 class NetConnection;
@@ -11,18 +20,84 @@ enum eGameMessageTypes
 	SEND_GAME_JOIN_REQUEST = 18,
 	SEND_GAME_ALERT_TURN = 19,
 	SEND_GAME_COMMAND = 20,
+	SEND_GAME_STATE_HASH = 21,
+	SEND_GAME_STATE_SNAPSHOT = 22,
+	SEND_GAME_RESUME_BATTLE = 23,
+	SEND_GAME_PING = 24,
 
 	NUM_GAME_MESSAGE_TYPES
 };
 
 constexpr uint16_t GAME_PORT = 54321;
 
+//SEND_GAME_RESUME_BATTLE payload: [turns hashed uint32][compressed size uint16][BattleSave compressed with CompressBytes]
+//[command count uint8][encoded size uint16][command batch]. The save is the host's state at the start of the current turn
+//and the batch is every command queued since, so a client that drops can rejoin and play on from where the host is.
+const size_t MAX_RESUME_BATTLE_BYTES = 0xFFFF;
+
+//SEND_GAME_PING payload: [sender's clock double][echo count uint8], then per echo [connection index uint8]
+//[that connection's clock from its last ping double][seconds it was held before this ping went out double].
+//A peer finds its own echo and takes the held time off how long ago it sent, so round trips are measured on one
+//clock without a reply message of their own. Every peer pings the others this often.
+const double NET_PING_INTERVAL_SECONDS = 1.0;
+const float NET_STATS_DEFAULT_LOG_SECONDS = 60.f;
+
+const size_t INBOUND_NET_QUEUE_SIZE = 1024;
+const size_t OUTBOUND_NET_QUEUE_SIZE = 256;
+const int NETWORK_THREAD_SLEEP_MS = 1;
+const int SEND_TO_OTHERS = -1;
+const int SEND_TO_HOST = -2;
+
 struct Player
 {
 	uint8_t m_connectionIndex;
+	bool m_hasDropped;
+};
+
+//A ping received from one connection, waiting to be echoed back in our next ping
+struct PingEcho
+{
+	uint8_t m_connectionIndex;
+	double m_sentTime;
+	double m_receivedTime;
+};
+
+//One message handed from the network thread to the main thread, already read out of the NetMessage so steady-state
+//traffic isn't copied. A command batch is split into one entry per command so entries stay small. Only the
+//rare messages too big for an entry (join response, snapshot, resume) are a copy the main thread handles and deletes.
+struct InboundNetMessage
+{
+	uint8_t m_type;
+	uint8_t m_connectionIndex;
+	NetMessage* m_message;
+	uint16_t m_batchSequence;
+	uint16_t m_batchBytes;
+	uint8_t m_numBatchCommands;
+	uint8_t m_batchCommandIndex;
+	NetCommand m_command;
+	CharacterID m_alertCharacterIndex;
+	uint32_t m_hashTurn;
+	uint64_t m_hash;
+	double m_pingSentTime;
+	bool m_hasPingEcho;
+	double m_echoedPingTime;
+	double m_pingEchoHeldSeconds;
+};
+
+//One message handed from the main thread to the network thread. Pooled messages are copied to every other
+//connection and then handed back to be recycled; the rest are given to one connection, which takes ownership.
+struct OutboundNetMessage
+{
+	NetMessage* m_message;
+	int m_connectionIndex;
+	bool m_isPooled;
 };
 
 
+//Socket I/O runs on its own thread. It pumps the TCPSession, decodes what arrives into the inbound queue and sends
+//whatever the main thread put in the outbound queue; the main thread applies inbound messages in Update and never
+//touches the TCPSession except through the few calls below that lock it. Everything else about the connection the
+//main thread sees is a snapshot the network thread refreshes every time it's done with the session.
 class GameSession
 {
 public:
@@ -34,21 +109,123 @@ public:
 	void Update();
 
 	bool Join(NetAddress address);
+	void Host(uint16_t port);
+	void Leave();
 
-	void OnJoinRequest(NetMessage* msg);
-	void OnJoinResponse(NetMessage* msg);
-	void OnTurnAlert(NetMessage* msg);
-	void OnCommand(NetMessage* msg);
+	bool IsRunning() const { return m_isRunning; }
+	bool IsReady() const { return m_isReady; }
+	bool HasLostHost() const { return m_hasLostHost; }
+	int GetMyConnectionIndex() const { return m_myConnectionIndex; }
+	size_t GetNumOneOffMessages() const { return m_numOneOffMessages; }
+	size_t GetNumPeerCopies() const { return m_numPeerCopies; }
+	const std::string& GetHostAddressText() const { return m_hostAddressText; }
+
+	void OnJoinRequest(const InboundNetMessage& inbound);
+	void OnJoinResponse(NetMessage* msg, uint8_t connectionIndex);
+	void OnTurnAlert(const InboundNetMessage& inbound);
+	void OnCommand(const InboundNetMessage& inbound);
+	void OnStateHash(const InboundNetMessage& inbound);
+	void OnStateSnapshot(NetMessage* msg, uint8_t connectionIndex);
+	void OnResumeBattle(NetMessage* msg, uint8_t connectionIndex);
+	void OnPing(const InboundNetMessage& inbound);
 
 	void SendJoinRequest();
 	void SendJoinResponse(uint8_t connectionIndex);
-	void SendTurnAlert(uint8_t connectionIndex, uint8_t characterIndex);
-	void SendCommand(uint8_t commandType, uint8_t characterIndex, unsigned int targettedTileIndex, uint8_t targettedCharacterIndex, uint8_t abilityIndex);
+	void SendTurnAlert(uint8_t connectionIndex, CharacterID characterIndex);
+	void SendCommand(uint8_t commandType, CharacterID characterIndex, unsigned int targettedTileIndex, CharacterID targettedCharacterIndex, uint8_t abilityIndex);
+	void FlushCommands();
+	void SendStateHash(uint32_t turn, uint64_t hash);
+	void SendStateSnapshot(const StateHashSnapshot& snapshot);
+	void SendResumeBattle(uint8_t connectionIndex);
+	void SendPings();
+
+	void EndFrame();
+	void LogNetStats();
+
+	bool IsHosting() const;
+	bool HasConnectedPeers() const;
+	void ClearResumePoint();
+	void CaptureResumePoint(const Map& map, uint32_t numCommandsRun, uint32_t numTurnsStarted, uint32_t numTurnsHashed, size_t numCommandsQueued);
 
-	TCPSession m_session;
 	std::vector<Player*> m_players;
 	uint8_t m_maxNumPlayers;
 	uint8_t m_currentNumPlayers;
 
 	uint_fast32_t m_seed;
+	NetMessagePool m_messagePool;
+	bool m_isJoiningBattleInProgress;
+	NetStats m_netStats;
+	bool m_showNetStatsOverlay;
+
+private:
+	void ResetCommandStream();
+	void CheckForDroppedPlayers();
+	void RecordSentToOthers(uint8_t type, size_t numBytes);
+	void HandleInboundMessages();
+	void DiscardInboundMessages();
+	void QueueOutbound(NetMessage* message, int connectionIndex, bool isPooled);
+	bool MoveOutboundBacklogToQueue();
+	void SendAllOutbound();
+	void RecyclePooledMessages();
+
+	//Network thread only, or whoever holds m_sessionLock
+	void RunNetworkThread();
+	void QueueInbound(uint8_t type, NetMessage* msg);
+	void SendOutbound();
+	size_t CountOtherConnections();
+	bool MoveBacklogToQueues();
+	void ClearInboundBacklog();
+	void RefreshSessionState();
+
+	TCPSession m_session;
+	std::mutex m_sessionLock;
+	std::thread m_networkThread;
+	std::atomic<bool> m_isNetworkThreadRunning;
+	SPSCQueue<InboundNetMessage, INBOUND_NET_QUEUE_SIZE> m_inbound;
+	SPSCQueue<OutboundNetMessage, OUTBOUND_NET_QUEUE_SIZE> m_outbound;
+	SPSCQueue<NetMessage*, OUTBOUND_NET_QUEUE_SIZE> m_sentPooledMessages;
+
+	//Whatever doesn't fit in a full queue waits here, and the session isn't pumped again until it has gone through
+	std::vector<InboundNetMessage> m_inboundBacklog;
+	std::vector<NetMessage*> m_sentPooledBacklog;
+	//Main thread only; sends wait here while the network thread catches up instead of the frame waiting on it
+	std::vector<OutboundNetMessage> m_outboundBacklog;
+	std::vector<NetCommand> m_networkCommands;
+	ByteBuffer m_networkCommandBuffer;
+
+	std::atomic<bool> m_isRunning;
+	std::atomic<bool> m_isReady;
+	std::atomic<bool> m_hasLostHost;
+	std::atomic<int> m_myConnectionIndex;
+	std::atomic<int> m_hostConnectionIndex;
+	std::atomic<uint8_t> m_numConnectionSlots;
+	std::atomic<uint32_t> m_disconnectedConnections;
+	std::string m_hostAddressText;
+
+	//Allocations the pool doesn't cover: messages new'd for one connection, and the copy of a pooled message
+	//SendMessageToOthers makes for each connection it goes to
+	size_t m_numOneOffMessages;
+	std::atomic<size_t> m_numPeerCopies;
+
+	//Commands queued by SendCommand go out together in one message per frame
+	std::vector<NetCommand> m_pendingCommands;
+	std::vector<NetCommand> m_receivedCommands;
+	ByteBuffer m_commandBuffer;
+	uint16_t m_nextCommandSequence;
+	std::vector<uint16_t> m_nextRemoteCommandSequences;
+
+	//Where a rejoining client starts from: the last turn start the host saw, plus the commands queued since
+	BattleSave m_resumeSave;
+	uint32_t m_resumeTurnsHashed;
+	bool m_hasResumePoint;
+	std::vector<NetCommand> m_resumeCommands;
+	ByteBuffer m_resumeBuffer;
+	double m_joinRequestTime;
+
+	//Main thread time spent in Update and the end-of-frame flush, reported once the frame is over
+	double m_frameNetworkSeconds;
+	double m_lastPingTime;
+	std::vector<PingEcho> m_pingEchoes;
+	double m_lastNetStatsLogTime;
+	float m_netStatsLogSeconds;
 };
@@ -14,6 +14,11 @@
 #include "Engine/Network/NetSession.hpp"
 #include "Engine/Network/NetConnection.hpp"
 #include "Game/GameSession.hpp"
+#include "Game/BattleState.hpp"
+#include "Game/AITrace.hpp"
+#include "Game/AbilityDefinition.hpp"
+#include "Game/TileDefinition.hpp"
+#include "Game/BattleSave.hpp"
 
 
 PathGenerator::PathGenerator(const IntVector2& start, const IntVector2& end, Map* map, Character* gCostReferenceCharacter)
@@ -124,13 +129,12 @@ DamageNumber::DamageNumber(std::string number, const Vector3& position, const Rg
 Map::Map(std::string mapDefinitionName)
 	: m_tiles()
 	, m_characters()
+	, m_characterTable()
 	, m_spriteEffects()
 	, m_name()
 	, m_selectedCharacter(nullptr)
 	, m_selectedTile(nullptr)
 {
-	Character::s_currentCharacterIndex = 1;
-
 	m_definition = MapDefinition::GetDefinition(mapDefinitionName);
 
 	m_tiles.resize(m_definition->m_dimensions.x * m_definition->m_dimensions.y);
@@ -190,6 +194,83 @@ Map::Map(std::string mapDefinitionName)
 	m_selectedTile = GetTileAtTileIndex(0);
 }
 
+Map::Map(const BattleSave& save)
+	: m_tiles()
+	, m_characters()
+	, m_characterTable()
+	, m_spriteEffects()
+	, m_name()
+	, m_selectedCharacter(nullptr)
+	, m_selectedTile(nullptr)
+{
+	//Skips generation entirely; everything comes straight out of the save
+	const BattleState& state = save.m_state;
+	m_definition = MapDefinition::GetDefinition(save.m_mapDefinitionName);
+	ASSERT_OR_DIE(m_definition->m_dimensions.x == state.m_mapWidth && m_definition->m_dimensions.y == state.m_mapHeight, "Battle save doesn't match its map definition.");
+
+	std::vector<TileDefinition*> tileDefinitionsByID;
+	for (std::map<std::string, TileDefinition*>::const_iterator tileDefIter = TileDefinition::s_tileDefinitionRegistry.begin(); tileDefIter != TileDefinition::s_tileDefinitionRegistry.end(); ++tileDefIter)
+	{
+		tileDefinitionsByID.push_back(tileDefIter->second);
+	}
+
+	std::vector<std::string> itemDefinitionNamesByID;
+	for (std::map<std::string, ItemDefinition*>::const_iterator itemIter = ItemDefinition::s_registry.begin(); itemIter != ItemDefinition::s_registry.end(); ++itemIter)
+	{
+		itemDefinitionNamesByID.push_back(itemIter->first);
+	}
+
+	m_tiles.resize(state.m_numTiles);
+	for (size_t tileIndex = 0; tileIndex < m_tiles.size(); tileIndex++)
+	{
+		ASSERT_OR_DIE(state.m_tileDefinitionIDs[tileIndex] < tileDefinitionsByID.size(), "Battle save uses an unknown tile definition.");
+		m_tiles[tileIndex].m_tileCoords = CalculateTileCoordsFromTileIndex(tileIndex);
+		m_tiles[tileIndex].m_containingMap = this;
+		m_tiles[tileIndex].m_tileDefinition = tileDefinitionsByID[state.m_tileDefinitionIDs[tileIndex]];
+		m_tiles[tileIndex].m_height = (float)state.m_tileHeights[tileIndex];
+	}
+
+	BuildTileVerts();
+
+	for (int slot = 0; slot < state.m_numCharacters; slot++)
+	{
+		const BattleSaveCharacter& savedCharacter = save.m_characters[slot];
+		ASSERT_OR_DIE(savedCharacter.m_builderName[BATTLE_SAVE_NAME_LENGTH - 1] == '\0' && savedCharacter.m_faction[BATTLE_SAVE_NAME_LENGTH - 1] == '\0', "Battle save has an unterminated name.");
+		ASSERT_OR_DIE(state.m_tileIndices[slot] < m_tiles.size(), "Battle save places a character off the map.");
+
+		Character* character = CharacterBuilder::BuildNewCharacter(savedCharacter.m_builderName);
+		character->m_characterIndex = state.m_characterIndices[slot];
+		character->m_owningPlayer = state.m_owningPlayers[slot];
+		character->m_controller = (CharacterController)savedCharacter.m_controller;
+		character->m_faction = savedCharacter.m_faction;
+		for (int statIndex = 0; statIndex < NUM_STATS; statIndex++)
+		{
+			character->m_stats[(StatID)statIndex] = state.m_stats[statIndex][slot];
+		}
+
+		for (int equipSlot = 0; equipSlot < NUM_EQUIP_SLOTS; equipSlot++)
+		{
+			const BattleSaveItem& savedItem = savedCharacter.m_equippedItems[equipSlot];
+			if (savedItem.m_definitionID == INVALID_BATTLE_INDEX)
+				continue;
+
+			ASSERT_OR_DIE(savedItem.m_definitionID < itemDefinitionNamesByID.size(), "Battle save uses an unknown item definition.");
+			Item* item = new Item(itemDefinitionNamesByID[savedItem.m_definitionID]);
+			for (int statIndex = 0; statIndex < NUM_STATS; statIndex++)
+			{
+				item->m_stats[(StatID)statIndex] = savedItem.m_stats[statIndex];
+			}
+			character->m_equipment.m_equippedItems[equipSlot] = item;
+		}
+
+		PlaceCharacterInMap(character, &m_tiles[state.m_tileIndices[slot]]);
+	}
+	m_characterTable.SetNextID(save.m_nextCharacterIndex);
+
+	ApplyBattleState(state);
+	m_selectedTile = GetTileAtTileIndex(0);
+}
+
 Map::~Map()
 {
 	for (DrawCall call : m_drawCalls)
@@ -232,77 +313,103 @@ void Map::Update(float deltaSeconds)
 		}
 	}
 
-	if(!m_isWaitingForInput /* && g_theApp->m_game->m_session->m_session.IsHost()*/ && !m_selectedCharacter)
+	if (m_aiPlanner.IsPlanning())
+	{
+		m_aiPlanner.Update();
+	}
+	else if (CanStartNextTurn())
 	{
-		Character* nextCharacterToAct = GetCharacterWithGreatestCT();
-		if (nextCharacterToAct && nextCharacterToAct->m_currentCT >= 100)
+		StartNextTurn();
+	}
+
+	if(m_selectedCharacter)
+		m_traversableTiles = GetTraversableTilesInRangeOfCharacter(m_selectedCharacter);
+
+	UpdateDamageNumbers(deltaSeconds);
+}
+
+bool Map::CanStartNextTurn() const
+{
+	return !m_aiPlanner.IsPlanning() && !m_isWaitingForInput /* && g_theApp->m_game->m_session->m_session.IsHost()*/ && !m_selectedCharacter;
+}
+
+void Map::StartNextTurn()
+{
+	Character* nextCharacterToAct = GetCharacterWithGreatestCT();
+	if (nextCharacterToAct && nextCharacterToAct->m_currentCT >= 100)
+	{
+		if (nextCharacterToAct->m_isDead)
 		{
-			if (nextCharacterToAct->m_isDead)
+			nextCharacterToAct->SetCurrentHP(nextCharacterToAct->m_currentHP - 1);
+			nextCharacterToAct->SetCurrentCT(0);
+			if (nextCharacterToAct->m_currentHP <= -4)
 			{
-				nextCharacterToAct->m_currentHP--;
-				nextCharacterToAct->m_currentCT = 0;
-				if (nextCharacterToAct->m_currentHP <= -4)
-				{
-					DestroyCharacter(nextCharacterToAct);
-				}
+				DestroyCharacter(nextCharacterToAct);
+			}
+		}
+		else
+		{
+			g_theApp->m_game->SyncReplayKeyframe();
+			g_theApp->m_game->WritePendingBattleSave();
+			g_theApp->m_game->CaptureResumePoint();
+			g_theApp->m_game->m_desyncDetector.RecordTurn(*this);
+
+			if (nextCharacterToAct->m_owningPlayer == g_theApp->m_game->m_session->GetMyConnectionIndex())
+			{
+				m_selectedCharacter = nextCharacterToAct;
+				m_activeCharacter = nextCharacterToAct;
+// 				g_theApp->m_game->m_currentGameState = STATE_PLAYING;
+//				m_isWaitingForInput = true;
 			}
 			else
 			{
-				if (g_theApp->m_game->m_session->m_session.m_myConnection != nullptr && nextCharacterToAct->m_owningPlayer == g_theApp->m_game->m_session->m_session.m_myConnection->m_connectionIndex)
+// 				g_theApp->m_game->m_session->SendTurnAlert(nextCharacterToAct->m_owningPlayer, nextCharacterToAct->m_characterIndex);
+				m_isWaitingForInput = true;
+				m_activeCharacter = nextCharacterToAct;
+			}
+			m_selectedTile = nextCharacterToAct->m_currentTile;
+
+			if (nextCharacterToAct->HasStatusEffect(STATUS_POISON))
+			{
+				nextCharacterToAct->ApplyDamage((int)((float)nextCharacterToAct->m_stats[STAT_MAX_HP] * 0.1f), false);
+				if (nextCharacterToAct->m_isDead)
 				{
-					m_selectedCharacter = nextCharacterToAct;
-					m_activeCharacter = nextCharacterToAct;
-// 					g_theApp->m_game->m_currentGameState = STATE_PLAYING;
-//					m_isWaitingForInput = true;
-				}
- 				else
- 				{
-// 					g_theApp->m_game->m_session->SendTurnAlert(nextCharacterToAct->m_owningPlayer, nextCharacterToAct->m_characterIndex);
-					m_isWaitingForInput = true;
-					m_activeCharacter = nextCharacterToAct;
+					if (m_isWaitingForInput)
+					{
+						m_isWaitingForInput = false;
+					}
+					g_theApp->m_game->EndTurn(nextCharacterToAct, 0);
 				}
-				m_selectedTile = nextCharacterToAct->m_currentTile;
+			}
 
-				if (nextCharacterToAct->HasStatusEffect(STATUS_POISON))
+			if (nullptr != nextCharacterToAct->m_currentAbility)
+			{
+				nextCharacterToAct->StartAbility();
+			}
+			else
+			{
+				if (nextCharacterToAct->m_controller == CONTROLLER_AI || (nextCharacterToAct->HasStatusEffect(STATUS_CONFUSE)) || nextCharacterToAct->HasStatusEffect(STATUS_CHARM))
 				{
-					nextCharacterToAct->ApplyDamage((int)((float)nextCharacterToAct->m_stats[STAT_MAX_HP] * 0.1f), false);
-					if (nextCharacterToAct->m_isDead)
+					m_aiPlanner.StartPlanning(nextCharacterToAct);
+					if (g_theApp->m_game->m_resolveInstantly)
 					{
-						if (m_isWaitingForInput)
+						while (!m_aiPlanner.ContinuePlanning(-1.0))
 						{
-							m_isWaitingForInput = false;
 						}
-						g_theApp->m_game->EndTurn(nextCharacterToAct, 0);
+						m_aiPlanner.CommitDecision();
 					}
-				}
-
-				if (nullptr != nextCharacterToAct->m_currentAbility)
-				{
-					nextCharacterToAct->StartAbility();
-				}
-				else
-				{
-					if (nextCharacterToAct->m_controller == CONTROLLER_AI || (nextCharacterToAct->HasStatusEffect(STATUS_CONFUSE)) || nextCharacterToAct->HasStatusEffect(STATUS_CHARM))
+					else
 					{
-						nextCharacterToAct->Act();
+						m_aiPlanner.Update();
 					}
 				}
 			}
 		}
-		else
-		{
-			while(nextCharacterToAct && nextCharacterToAct->m_currentCT < 100)
-			{
-				TickCT();
-				nextCharacterToAct = GetCharacterWithGreatestCT();
-			}
-		}
 	}
-
-	if(m_selectedCharacter)
-		m_traversableTiles = GetTraversableTilesInRangeOfCharacter(m_selectedCharacter);
-
-	UpdateDamageNumbers(deltaSeconds);
+	else
+	{
+		AdvanceCTToNextTurn();
+	}
 }
 
 void Map::Render() const
@@ -389,6 +496,88 @@ void Map::TickCT()
 	}
 }
 
+std::vector<TurnForecast> Map::ForecastTurnOrder(size_t numTurns, bool assumeActiveCharacterWaits /*= false*/) const
+{
+	//Assumes stats hold and every turn after a character's current one ends with 0 CT
+	std::vector<TurnForecast> forecast;
+	forecast.reserve(numTurns);
+
+	CTScheduler scheduler;
+	std::vector<bool> hasPendingAbility(m_characters.size(), false);
+	for (size_t characterIndex = 0; characterIndex < m_characters.size(); characterIndex++)
+	{
+		Character* character = m_characters[characterIndex];
+		if (character->m_isDead)
+			continue;
+
+		hasPendingAbility[characterIndex] = (nullptr != character->m_currentAbility);
+		scheduler.AddActor(characterIndex, character->m_currentCT, character->GetTickRate());
+	}
+
+	bool hasActiveCharacterActed = false;
+	while (forecast.size() < numTurns && !scheduler.IsEmpty())
+	{
+		CTScheduleEntry nextEntry = scheduler.PopNext();
+		Character* character = m_characters[nextEntry.m_actorIndex];
+
+		TurnForecast turn;
+		turn.m_character = character;
+		turn.m_ticksFromNow = nextEntry.m_readyTick;
+		turn.m_isResolvingAbility = hasPendingAbility[nextEntry.m_actorIndex];
+		forecast.push_back(turn);
+
+		int remainingCT = 0;
+		if (character == m_activeCharacter && !hasActiveCharacterActed && !turn.m_isResolvingAbility)
+		{
+			hasActiveCharacterActed = true;
+			if (assumeActiveCharacterWaits)
+				remainingCT = CTScheduler::WAIT_CT;
+		}
+
+		//Resolving an ability ends the turn, after which the character ticks at its own speed again
+		hasPendingAbility[nextEntry.m_actorIndex] = false;
+		scheduler.AddActor(nextEntry.m_actorIndex, remainingCT, character->m_stats[STAT_SPEED], nextEntry.m_readyTick);
+	}
+
+	return forecast;
+}
+
+Character* Map::AdvanceCTToNextTurn()
+{
+	Character* nextCharacterToAct = GetCharacterWithGreatestCT();
+	if (nullptr == nextCharacterToAct || nextCharacterToAct->m_currentCT >= 100)
+		return nextCharacterToAct;
+
+	m_ctScheduler.Clear();
+	for (size_t characterIndex = 0; characterIndex < m_characters.size(); characterIndex++)
+	{
+		m_ctScheduler.AddActor(characterIndex, m_characters[characterIndex]->m_currentCT, m_characters[characterIndex]->GetTickRate());
+	}
+
+	//Falling CT can empty GetCharacterWithGreatestCT partway through, so tick one at a time like before
+	if (m_ctScheduler.HasNegativeTickRate())
+	{
+		while (nextCharacterToAct && nextCharacterToAct->m_currentCT < 100)
+		{
+			TickCT();
+			nextCharacterToAct = GetCharacterWithGreatestCT();
+		}
+		return nextCharacterToAct;
+	}
+
+	if (m_ctScheduler.IsEmpty())
+		return nullptr;
+
+	//Every rate is constant until someone acts, so jumping k ticks is the same as ticking k times
+	const CTScheduleEntry& nextEntry = m_ctScheduler.PeekNext();
+	for (Character* character : m_characters)
+	{
+		character->SetCurrentCT(character->m_currentCT + nextEntry.m_readyTick * character->GetTickRate());
+	}
+
+	return m_characters[nextEntry.m_actorIndex];
+}
+
 int Map::CalculateTileIndexFromTileCoords(const IntVector2& tileCoords) const
 {
 	return tileCoords.y * m_definition->m_dimensions.x + tileCoords.x;
@@ -639,10 +828,18 @@ void Map::DestroyCharacter(Character* characterToKill)
 		if (character->m_targettedCharacter == characterToKill)
 			character->m_targettedCharacter = nullptr;
 	}
+	if (m_selectedCharacter == characterToKill)
+		m_selectedCharacter = nullptr;
+	if (m_activeCharacter == characterToKill)
+		m_activeCharacter = nullptr;
 
 	Tile* tileContainingCharacterToKill = characterToKill->m_currentTile;
 	tileContainingCharacterToKill->m_occupyingCharacter = nullptr;
 
+	StateHashCharacter hashedCharacter;
+	CaptureStateHashCharacter(characterToKill, hashedCharacter);
+	ToggleCharacterFeatures(m_stateHash, hashedCharacter);
+
 	size_t characterIndex = 0;
 	for (; characterIndex < m_characters.size(); characterIndex++)
 	{
@@ -650,6 +847,7 @@ void Map::DestroyCharacter(Character* characterToKill)
 			break;
 	}
 	m_characters.erase(m_characters.begin() + characterIndex);
+	m_characterTable.Remove(characterToKill->m_characterIndex);
 
 	delete characterToKill;
 	characterToKill = nullptr;
@@ -680,12 +878,17 @@ void Map::PlaceCharacterInMap(Character* characterToPlace, Tile* destinationTile
 	if (!destinationTile)
 		return;
 
+	m_characterTable.Add(characterToPlace);
 	destinationTile->m_occupyingCharacter = characterToPlace;
 
 	characterToPlace->m_currentMap = this;
 	characterToPlace->m_currentTile = destinationTile;
 	characterToPlace->m_currentPosition = Vector3(destinationTile->m_tileCoords.x + 0.5f, destinationTile->GetDisplayHeight(), destinationTile->m_tileCoords.y + 0.5f);
 	m_characters.push_back(characterToPlace);
+
+	StateHashCharacter hashedCharacter;
+	CaptureStateHashCharacter(characterToPlace, hashedCharacter);
+	ToggleCharacterFeatures(m_stateHash, hashedCharacter);
 }
 
 void Map::MoveCharacterToTile(Character* characterToMove, Tile* destinationTile)
@@ -694,7 +897,7 @@ void Map::MoveCharacterToTile(Character* characterToMove, Tile* destinationTile)
 	startTile->m_occupyingCharacter = nullptr;
 	destinationTile->m_occupyingCharacter = characterToMove;
 
-	characterToMove->m_currentTile = destinationTile;
+	characterToMove->SetCurrentTile(destinationTile);
 	characterToMove->m_currentPosition = Vector3(destinationTile->m_tileCoords.x + 0.5f, destinationTile->GetDisplayHeight(), destinationTile->m_tileCoords.y + 0.5f);
 }
 
@@ -949,6 +1152,8 @@ std::vector<Tile*> Map::GetTilesInRadius(const IntVector2& tileCoords, float rad
 
 std::vector<Tile*> Map::GetTraversableTilesInRangeOfCharacter(const Character* character, const Tile* startingTile /*= nullptr*/)
 {
+	AITraceScope traceScope(AI_TIMER_REACHABILITY);
+
 	if (startingTile == nullptr)
 		startingTile = character->m_currentTile;
 
@@ -1176,8 +1381,310 @@ RaycastResult Map::RaycastForOpaque(const Vector2& startPosition, const Vector2&
 	return result;
 }
 
+//BattleStates, and the saves, keyframes and replay setups built from them, hold a fixed number of everything
+bool Map::CanCaptureBattleState() const
+{
+	return (int)m_tiles.size() <= MAX_BATTLE_TILES && (int)m_characters.size() <= MAX_BATTLE_CHARACTERS && (int)AbilityDefinition::s_registry.size() <= MAX_BATTLE_ABILITIES;
+}
+
+void Map::CaptureBattleState(BattleState& out_state) const
+{
+	out_state.Clear();
+
+	ASSERT_OR_DIE((int)m_tiles.size() <= MAX_BATTLE_TILES, "Map is too large to capture into a BattleState.");
+	ASSERT_OR_DIE((int)m_characters.size() <= MAX_BATTLE_CHARACTERS, "Too many characters to capture into a BattleState.");
+	ASSERT_OR_DIE((int)AbilityDefinition::s_registry.size() <= MAX_BATTLE_ABILITIES, "Too many abilities to capture into a BattleState.");
+
+	//Registries are sorted maps, so IDs come out the same on every machine
+	std::map<TileDefinition*, uint8_t> tileDefinitionIDs;
+	for (std::map<std::string, TileDefinition*>::const_iterator tileDefIter = TileDefinition::s_tileDefinitionRegistry.begin(); tileDefIter != TileDefinition::s_tileDefinitionRegistry.end(); ++tileDefIter)
+	{
+		uint8_t nextID = (uint8_t)tileDefinitionIDs.size();
+		tileDefinitionIDs[tileDefIter->second] = nextID;
+	}
+
+	std::map<AbilityDefinition*, uint8_t> abilityIDs;
+	for (std::map<std::string, AbilityDefinition*>::const_iterator abilityIter = AbilityDefinition::s_registry.begin(); abilityIter != AbilityDefinition::s_registry.end(); ++abilityIter)
+	{
+		AbilityDefinition* ability = abilityIter->second;
+		uint8_t abilityID = (uint8_t)out_state.m_numAbilityDefinitions;
+		abilityIDs[ability] = abilityID;
+
+		BattleAbility& battleAbility = out_state.m_abilityDefinitions[abilityID];
+		battleAbility.m_range = (int16_t)ability->m_range;
+		battleAbility.m_radius = (int16_t)ability->m_radius;
+		battleAbility.m_maxHeightDifference = (int16_t)ability->m_maxHeightDifference;
+		battleAbility.m_areaMaxHeightDifference = (int16_t)ability->m_areaMaxHeightDifference;
+		battleAbility.m_power = ability->m_power;
+		battleAbility.m_speed = ability->m_speed;
+		for (size_t effectIndex = 0; effectIndex < ability->m_statusEffects.size(); effectIndex++)
+		{
+			battleAbility.m_statusEffectDurations[ability->m_statusEffects[effectIndex]] = (uint8_t)ability->m_statusEffectDurations[effectIndex];
+		}
+
+		out_state.m_numAbilityDefinitions++;
+	}
+
+	out_state.m_mapWidth = m_definition->m_dimensions.x;
+	out_state.m_mapHeight = m_definition->m_dimensions.y;
+	out_state.m_numTiles = (int)m_tiles.size();
+	for (size_t tileIndex = 0; tileIndex < m_tiles.size(); tileIndex++)
+	{
+		const Tile& tile = m_tiles[tileIndex];
+		out_state.m_tileHeights[tileIndex] = (int16_t)tile.m_height;
+		out_state.m_tileDefinitionIDs[tileIndex] = tileDefinitionIDs[tile.m_tileDefinition];
+		out_state.m_tileFlags[tileIndex] = (uint8_t)((tile.m_tileDefinition->m_isTraversable ? TILE_FLAG_TRAVERSABLE : 0) | (tile.m_tileDefinition->m_isOpaque ? TILE_FLAG_OPAQUE : 0));
+	}
+
+	std::vector<std::string> factionNames;
+	out_state.m_numCharacters = (int)m_characters.size();
+	for (int slot = 0; slot < out_state.m_numCharacters; slot++)
+	{
+		Character* character = m_characters[slot];
+
+		uint8_t factionID = 0;
+		for (; factionID < factionNames.size(); factionID++)
+		{
+			if (factionNames[factionID] == character->m_faction)
+				break;
+		}
+		if (factionID == factionNames.size())
+			factionNames.push_back(character->m_faction);
+
+		int tileIndex = CalculateTileIndexFromTileCoords(character->m_currentTile->m_tileCoords);
+		out_state.m_tileOccupants[tileIndex] = (uint8_t)slot;
+
+		Stats modifiedStats = character->m_stats;
+		modifiedStats += character->m_equipment.CalculateCombinedStatModifiers();
+
+		out_state.m_characterIndices[slot] = character->m_characterIndex;
+		out_state.m_owningPlayers[slot] = character->m_owningPlayer;
+		out_state.m_factions[slot] = factionID;
+		out_state.m_isAIControlled[slot] = (character->m_controller == CONTROLLER_AI) ? 1 : 0;
+		out_state.m_isDead[slot] = character->m_isDead ? 1 : 0;
+		out_state.m_tileIndices[slot] = (uint16_t)tileIndex;
+		out_state.m_currentHP[slot] = character->m_currentHP;
+		out_state.m_currentCT[slot] = character->m_currentCT;
+		for (int statIndex = 0; statIndex < NUM_STATS; statIndex++)
+		{
+			out_state.m_stats[statIndex][slot] = character->m_stats[(StatID)statIndex];
+		}
+		out_state.m_attackPower[slot] = modifiedStats[STAT_ATTACK];
+		out_state.m_attackRanges[slot] = character->m_attackRange;
+		out_state.m_maxAttackHeightDifferences[slot] = character->m_maxAttackHeightDifference;
+
+		for (StatusEffect* effect : character->m_statusEffects)
+		{
+			out_state.AddStatusEffect(slot, effect->m_type, effect->m_remainingDuration);
+		}
+
+		for (size_t abilityIndex = 0; abilityIndex < character->m_abilities.size() && abilityIndex < MAX_CHARACTER_ABILITIES; abilityIndex++)
+		{
+			out_state.m_abilities[slot][abilityIndex] = abilityIDs[character->m_abilities[abilityIndex]];
+			out_state.m_numAbilities[slot]++;
+		}
+
+		for (size_t behaviorIndex = 0; behaviorIndex < character->m_behaviors.size() && behaviorIndex < MAX_CHARACTER_BEHAVIORS; behaviorIndex++)
+		{
+			out_state.m_behaviorKinds[slot][behaviorIndex] = (uint8_t)character->m_behaviors[behaviorIndex].m_kind;
+			out_state.m_numBehaviors[slot]++;
+		}
+
+		if (nullptr != character->m_currentAbility)
+		{
+			out_state.m_pendingAbilities[slot] = abilityIDs[character->m_currentAbility];
+			if (nullptr != character->m_targettedTile)
+				out_state.m_pendingTargetTiles[slot] = (uint16_t)CalculateTileIndexFromTileCoords(character->m_targettedTile->m_tileCoords);
+		}
+	}
+
+	for (int attackerSlot = 0; attackerSlot < out_state.m_numCharacters; attackerSlot++)
+	{
+		Tags attackDamageTypes = m_characters[attackerSlot]->GetAttackDamageTypes();
+		for (int defenderSlot = 0; defenderSlot < out_state.m_numCharacters; defenderSlot++)
+		{
+			out_state.m_attackDamageModifiers[attackerSlot][defenderSlot] = m_characters[defenderSlot]->CalculateDamageModifier(attackDamageTypes);
+
+			if (nullptr != m_characters[attackerSlot]->m_currentAbility && m_characters[attackerSlot]->m_targettedCharacter == m_characters[defenderSlot])
+				out_state.m_pendingTargetCharacters[attackerSlot] = (uint8_t)defenderSlot;
+		}
+	}
+}
+
+void Map::ApplyBattleState(const BattleState& state)
+{
+	ASSERT_OR_DIE(state.m_numTiles == (int)m_tiles.size(), "BattleState was captured from a different map.");
+
+	if (m_aiPlanner.IsPlanning())
+		m_aiPlanner.CancelPlanning();
+
+	//Anyone missing from the snapshot had already been destroyed when it was taken
+	for (size_t characterIndex = 0; characterIndex < m_characters.size();)
+	{
+		if (state.FindCharacterSlot(m_characters[characterIndex]->m_characterIndex) < 0)
+			DestroyCharacter(m_characters[characterIndex]);
+		else
+			characterIndex++;
+	}
+
+	std::vector<AbilityDefinition*> abilitiesByID;
+	for (std::map<std::string, AbilityDefinition*>::const_iterator abilityIter = AbilityDefinition::s_registry.begin(); abilityIter != AbilityDefinition::s_registry.end(); ++abilityIter)
+	{
+		abilitiesByID.push_back(abilityIter->second);
+	}
+
+	for (Character* character : m_characters)
+	{
+		character->m_currentTile->m_occupyingCharacter = nullptr;
+	}
+
+	for (Character* character : m_characters)
+	{
+		int slot = state.FindCharacterSlot(character->m_characterIndex);
+		Tile* tile = &m_tiles[state.m_tileIndices[slot]];
+		tile->m_occupyingCharacter = character;
+		character->m_currentTile = tile;
+		character->m_currentPosition = Vector3(tile->m_tileCoords.x + 0.5f, tile->GetDisplayHeight(), tile->m_tileCoords.y + 0.5f);
+
+		character->m_currentHP = state.m_currentHP[slot];
+		character->m_currentCT = state.m_currentCT[slot];
+		character->m_isDead = state.m_isDead[slot] != 0;
+		character->m_currentState = STATE_IDLE;
+		character->m_currentPath.clear();
+
+		for (StatusEffect* effect : character->m_statusEffects)
+		{
+			delete effect;
+		}
+		character->m_statusEffects.clear();
+		for (int effectIndex = 0; effectIndex < NUM_STATUS_EFFECTS; effectIndex++)
+		{
+			if (state.HasStatusEffect(slot, (StatusEffectType)effectIndex))
+				character->AddStatusEffect((StatusEffectType)effectIndex, state.m_statusEffectDurations[effectIndex][slot]);
+		}
+
+		character->m_currentAbility = nullptr;
+		character->m_targettedTile = nullptr;
+		character->m_targettedCharacter = nullptr;
+		if (state.m_pendingAbilities[slot] != INVALID_BATTLE_INDEX && state.m_pendingAbilities[slot] < abilitiesByID.size())
+		{
+			character->m_currentAbility = abilitiesByID[state.m_pendingAbilities[slot]];
+			if (state.m_pendingTargetTiles[slot] != INVALID_BATTLE_TILE && state.m_pendingTargetTiles[slot] < m_tiles.size())
+				character->m_targettedTile = &m_tiles[state.m_pendingTargetTiles[slot]];
+		}
+	}
+
+	//Target slots refer to the snapshot, so they can only be resolved once every character is matched up
+	for (int slot = 0; slot < state.m_numCharacters; slot++)
+	{
+		if (!state.IsActive(slot) || state.m_pendingTargetCharacters[slot] == INVALID_BATTLE_INDEX)
+			continue;
+
+		Character* caster = FindCharacterByIndex(state.m_characterIndices[slot]);
+		Character* target = FindCharacterByIndex(state.m_characterIndices[state.m_pendingTargetCharacters[slot]]);
+		if (nullptr != caster && nullptr != target && state.IsActive(state.m_pendingTargetCharacters[slot]))
+			caster->m_targettedCharacter = target;
+	}
+
+	m_selectedCharacter = nullptr;
+	m_activeCharacter = nullptr;
+	m_isWaitingForInput = false;
+	m_damageNumbers.clear();
+	m_spriteEffects.clear();
+	InvalidateAbilityDamageFields();
+
+	//A wholesale restore is the one place the hash starts over instead of following each change
+	RebuildStateHash();
+}
+
+Character* Map::FindCharacterByIndex(CharacterID characterIndex) const
+{
+	return m_characterTable.Find(characterIndex);
+}
+
+void Map::CaptureStateHashCharacter(const Character* character, StateHashCharacter& out_character) const
+{
+	out_character.m_characterIndex = character->m_characterIndex;
+	out_character.m_tileIndex = (uint16_t)CalculateTileIndexFromTileCoords(character->m_currentTile->m_tileCoords);
+	out_character.m_currentHP = character->m_currentHP;
+	out_character.m_currentCT = character->m_currentCT;
+	out_character.m_isDead = character->m_isDead ? 1 : 0;
+	for (int effectIndex = 0; effectIndex < NUM_STATUS_EFFECTS; effectIndex++)
+	{
+		out_character.m_statusEffectDurations[effectIndex] = STATE_HASH_NO_EFFECT;
+	}
+	for (StatusEffect* effect : character->m_statusEffects)
+	{
+		out_character.m_statusEffectDurations[effect->m_type] = effect->m_remainingDuration;
+	}
+}
+
+void Map::CaptureStateHashSnapshot(StateHashSnapshot& out_snapshot) const
+{
+	//Snapshots in the history keep their characters' storage, so this only allocates when the battle grows
+	out_snapshot.m_turn = 0;
+	out_snapshot.m_hash = m_stateHash.GetValue();
+	out_snapshot.m_characters.resize(m_characters.size());
+	for (size_t characterIndex = 0; characterIndex < m_characters.size(); characterIndex++)
+	{
+		CaptureStateHashCharacter(m_characters[characterIndex], out_snapshot.m_characters[characterIndex]);
+	}
+}
+
+void Map::RebuildStateHash()
+{
+	m_stateHash.Clear();
+	for (Character* character : m_characters)
+	{
+		StateHashCharacter hashedCharacter;
+		CaptureStateHashCharacter(character, hashedCharacter);
+		ToggleCharacterFeatures(m_stateHash, hashedCharacter);
+	}
+}
+
+const AbilityDamageField& Map::GetAbilityDamageField(Character* caster, AbilityDefinition* ability)
+{
+	for (const AbilityDamageField& damageField : m_abilityDamageFields)
+	{
+		if (damageField.IsValidFor(caster, ability, m_abilityDamageFieldStamp))
+		{
+			AITrace::IncrementCounter(AI_COUNTER_CACHE_HITS);
+			return damageField;
+		}
+	}
+
+	AITrace::IncrementCounter(AI_COUNTER_CACHE_MISSES);
+
+	//Reuse a stale field's storage before growing the list
+	AbilityDamageField* fieldToBuild = nullptr;
+	for (AbilityDamageField& damageField : m_abilityDamageFields)
+	{
+		if (damageField.m_stamp != m_abilityDamageFieldStamp)
+		{
+			fieldToBuild = &damageField;
+			break;
+		}
+	}
+
+	if (nullptr == fieldToBuild)
+	{
+		m_abilityDamageFields.push_back(AbilityDamageField());
+		fieldToBuild = &m_abilityDamageFields.back();
+	}
+
+	fieldToBuild->Build(this, caster, ability, m_abilityDamageFieldStamp);
+	return *fieldToBuild;
+}
+
+void Map::InvalidateAbilityDamageFields()
+{
+	m_abilityDamageFieldStamp++;
+}
+
 Path Map::GeneratePath(const IntVector2& start, const IntVector2& end, Character* characterForPath /*= nullptr*/)
 {
+	AITraceScope traceScope(AI_TIMER_PATHING);
+
 	StartSteppedPath(start, end, characterForPath);
 	Path outPath;
 
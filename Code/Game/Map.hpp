@@ -3,6 +3,10 @@
 #include "Game/Character.hpp"
 #include "Game/Message.hpp"
 #include "Game/Tile.hpp"
+#include "Game/AIPlanner.hpp"
+#include "Game/AbilityDamageField.hpp"
+#include "Game/CTScheduler.hpp"
+#include "Game/CharacterTable.hpp"
 #include <set>
 #include "Engine/Renderer/RHI/VertexBuffer.hpp"
 #include "Engine/Renderer/RHI/SpriteAnimation2D.hpp"
@@ -13,6 +17,8 @@ typedef std::vector<Tile*> Path;
 
 class MapDefinition;
 class Map;
+struct BattleState;
+struct BattleSave;
 
 struct SpriteEffect
 {
@@ -38,6 +44,13 @@ struct DamageNumber
 	float m_lifetime;
 };
 
+struct TurnForecast
+{
+	Character* m_character;
+	int m_ticksFromNow;
+	bool m_isResolvingAbility;
+};
+
 struct RaycastResult
 {
 	bool m_didImpact;
@@ -91,9 +104,12 @@ class Map
 {
 public:
 	Map(std::string mapDefinitionName);
+	Map(const BattleSave& save);
 	~Map();
 
 	void Update(float deltaSeconds);
+	bool CanStartNextTurn() const;
+	void StartNextTurn();
 	void Render() const;
 
 	void RenderDebugPathing() const;
@@ -105,6 +121,8 @@ public:
 	void DrawSelectedTile() const;
 
 	void TickCT();
+	Character* AdvanceCTToNextTurn();
+	std::vector<TurnForecast> ForecastTurnOrder(size_t numTurns, bool assumeActiveCharacterWaits = false) const;
 
 	int CalculateTileIndexFromTileCoords(const IntVector2& tileCoords) const;
 	IntVector2 CalculateTileCoordsFromTileIndex(int tileIndex) const;
@@ -150,6 +168,18 @@ public:
 	void StartSteppedPath(const IntVector2& start, const IntVector2& end, Character* characterForPath = nullptr);
 	bool ContinueSteppedPath(Path& out_pathWhenComplete);
 
+	bool CanCaptureBattleState() const;
+	void CaptureBattleState(BattleState& out_state) const;
+	void ApplyBattleState(const BattleState& state);
+	Character* FindCharacterByIndex(CharacterID characterIndex) const;
+
+	void CaptureStateHashCharacter(const Character* character, StateHashCharacter& out_character) const;
+	void CaptureStateHashSnapshot(StateHashSnapshot& out_snapshot) const;
+	void RebuildStateHash();
+
+	const AbilityDamageField& GetAbilityDamageField(Character* caster, AbilityDefinition* ability);
+	void InvalidateAbilityDamageFields();
+
 	bool m_isWaitingForInput = false;
 
 	Character* m_selectedCharacter;
@@ -163,6 +193,7 @@ public:
 	MapDefinition* m_definition;
 	std::vector<Tile> m_tiles;
 	std::vector<Character*> m_characters;
+	CharacterTable m_characterTable;
 	std::vector<DamageNumber> m_damageNumbers;
 	std::vector<SpriteEffect> m_spriteEffects;
 	ParticleSystem m_particleSystem;
@@ -170,6 +201,11 @@ public:
 	std::vector<DrawCall> m_drawCalls;
 
 	PathGenerator* m_currentPath = nullptr;
+	AIPlanner m_aiPlanner;
+	CTScheduler m_ctScheduler;
+	StateHash m_stateHash;
+	std::vector<AbilityDamageField> m_abilityDamageFields;
+	int m_abilityDamageFieldStamp = 0;
 
 	static const float DAMAGE_NUMBER_LIFETIME;
 private:
@@ -0,0 +1,126 @@
+#include "Game/NetMessagePool.hpp"
+#include "Engine/Network/NetMessage.hpp"
+#include "Engine/Core/ErrorWarningAssert.hpp"
+
+
+PooledNetMessage::PooledNetMessage()
+	: m_pool(nullptr)
+	, m_message(nullptr)
+{
+
+}
+
+PooledNetMessage::PooledNetMessage(NetMessagePool* pool, NetMessage* message)
+	: m_pool(pool)
+	, m_message(message)
+{
+
+}
+
+PooledNetMessage::PooledNetMessage(PooledNetMessage&& other)
+	: m_pool(other.m_pool)
+	, m_message(other.m_message)
+{
+	other.m_pool = nullptr;
+	other.m_message = nullptr;
+}
+
+PooledNetMessage& PooledNetMessage::operator=(PooledNetMessage&& other)
+{
+	if (this != &other)
+	{
+		Release();
+		m_pool = other.m_pool;
+		m_message = other.m_message;
+		other.m_pool = nullptr;
+		other.m_message = nullptr;
+	}
+
+	return *this;
+}
+
+PooledNetMessage::~PooledNetMessage()
+{
+	Release();
+}
+
+void PooledNetMessage::Release()
+{
+	if (nullptr == m_message)
+		return;
+
+	m_pool->Return(m_message);
+	m_pool = nullptr;
+	m_message = nullptr;
+}
+
+NetMessage* PooledNetMessage::Detach()
+{
+	NetMessage* message = m_message;
+	m_pool = nullptr;
+	m_message = nullptr;
+	return message;
+}
+
+
+NetMessagePool::NetMessagePool()
+	: m_freeMessages()
+	, m_numAllocations(0)
+	, m_numAcquires(0)
+	, m_numInUse(0)
+{
+
+}
+
+NetMessagePool::~NetMessagePool()
+{
+	ASSERT_OR_DIE(m_numInUse == 0, "NetMessagePool destroyed while its messages are still in use.");
+
+	for (NetMessage* message : m_freeMessages)
+	{
+		delete message;
+	}
+	m_freeMessages.clear();
+}
+
+void NetMessagePool::Reserve(size_t numMessages)
+{
+	m_freeMessages.reserve(numMessages);
+	while (m_freeMessages.size() < numMessages)
+	{
+		m_freeMessages.push_back(new NetMessage());
+		m_numAllocations++;
+	}
+}
+
+PooledNetMessage NetMessagePool::Acquire(uint8_t messageTypeIndex)
+{
+	NetMessage* message = nullptr;
+	if (m_freeMessages.empty())
+	{
+		message = new NetMessage(messageTypeIndex);
+		m_numAllocations++;
+	}
+	else
+	{
+		//Assigning a fresh message rewinds it in place; the payload is a fixed buffer, so this doesn't allocate
+		message = m_freeMessages.back();
+		m_freeMessages.pop_back();
+		*message = NetMessage(messageTypeIndex);
+	}
+
+	m_numAcquires++;
+	m_numInUse++;
+	return PooledNetMessage(this, message);
+}
+
+void NetMessagePool::Recycle(NetMessage* message)
+{
+	Return(message);
+}
+
+void NetMessagePool::Return(NetMessage* message)
+{
+	m_freeMessages.push_back(message);
+	m_numInUse--;
+}
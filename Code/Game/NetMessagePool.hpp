@@ -0,0 +1,64 @@
+#pragma once
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+class NetMessage;
+class NetMessagePool;
+
+
+//Move-only handle to a pooled NetMessage. The message goes back to its pool when the handle is released or destroyed,
+//so it can only be given to calls that copy it, like NetSession::SendMessageToOthers.
+class PooledNetMessage
+{
+public:
+	PooledNetMessage();
+	PooledNetMessage(NetMessagePool* pool, NetMessage* message);
+	PooledNetMessage(PooledNetMessage&& other);
+	PooledNetMessage& operator=(PooledNetMessage&& other);
+	PooledNetMessage(const PooledNetMessage&) = delete;
+	PooledNetMessage& operator=(const PooledNetMessage&) = delete;
+	~PooledNetMessage();
+
+	void Release();
+	NetMessage* Detach();
+
+	NetMessage* operator->() const { return m_message; }
+	NetMessage& operator*() const { return *m_message; }
+	bool IsValid() const { return nullptr != m_message; }
+
+private:
+	NetMessagePool* m_pool;
+	NetMessage* m_message;
+};
+
+
+//Recycles the NetMessages the game builds for every peer, so only the first use of each one allocates. The copy
+//SendMessageToOthers makes for each connection is the engine's and isn't covered.
+//A message detached from its handle stays in use until it comes back through Recycle, which lets it be sent from
+//another thread; the pool itself is only ever touched by the thread that owns it.
+class NetMessagePool
+{
+	friend class PooledNetMessage;
+
+public:
+	NetMessagePool();
+	~NetMessagePool();
+
+	void Reserve(size_t numMessages);
+	PooledNetMessage Acquire(uint8_t messageTypeIndex);
+	void Recycle(NetMessage* message);
+
+	size_t GetNumAllocations() const { return m_numAllocations; }
+	size_t GetNumAcquires() const { return m_numAcquires; }
+	size_t GetNumInUse() const { return m_numInUse; }
+	size_t GetNumFree() const { return m_freeMessages.size(); }
+
+private:
+	void Return(NetMessage* message);
+
+	std::vector<NetMessage*> m_freeMessages;
+	size_t m_numAllocations;
+	size_t m_numAcquires;
+	size_t m_numInUse;
+};
@@ -0,0 +1,197 @@
+#include "Game/NetStats.hpp"
+#include <stdio.h>
+#include <math.h>
+#include <algorithm>
+
+
+static std::string FormatByteCount(uint64_t numBytes)
+{
+	char text[32];
+	if (numBytes < 10 * 1024)
+		snprintf(text, sizeof(text), "%uB", (unsigned int)numBytes);
+	else if (numBytes < 10 * 1024 * 1024)
+		snprintf(text, sizeof(text), "%.1fKB", numBytes / 1024.0);
+	else
+		snprintf(text, sizeof(text), "%.1fMB", numBytes / (1024.0 * 1024.0));
+	return text;
+}
+
+
+NetStats::NetStats(size_t numMessageTypes)
+	: m_messageTypeNames(numMessageTypes)
+	, m_connections()
+	, m_numFrames(0)
+	, m_lastFrameSeconds(0.0)
+	, m_totalFrameSeconds(0.0)
+	, m_peakFrameSeconds(0.0)
+	, m_totalCommandsQueued(0)
+	, m_peakCommandsQueued(0)
+	, m_totalMessagesUnsent(0)
+	, m_peakMessagesUnsent(0)
+{
+
+}
+
+void NetStats::SetMessageTypeName(uint8_t type, const std::string& name)
+{
+	if (type < m_messageTypeNames.size())
+		m_messageTypeNames[type] = name;
+}
+
+void NetStats::Reset()
+{
+	m_connections.clear();
+	m_numFrames = 0;
+	m_lastFrameSeconds = 0.0;
+	m_totalFrameSeconds = 0.0;
+	m_totalCommandsQueued = 0;
+	m_totalMessagesUnsent = 0;
+	ResetPeaks();
+}
+
+void NetStats::ResetConnection(uint8_t connectionIndex)
+{
+	if (connectionIndex < m_connections.size())
+		m_connections[connectionIndex] = ConnectionNetStats();
+}
+
+void NetStats::ResetPeaks()
+{
+	m_peakFrameSeconds = 0.0;
+	m_peakCommandsQueued = 0;
+	m_peakMessagesUnsent = 0;
+}
+
+void NetStats::RecordSent(uint8_t connectionIndex, uint8_t type, size_t numBytes)
+{
+	ConnectionNetStats& connection = GetOrAddConnection(connectionIndex);
+	connection.m_sent.m_numMessages++;
+	connection.m_sent.m_numBytes += numBytes;
+	if (type < connection.m_sentByType.size())
+	{
+		connection.m_sentByType[type].m_numMessages++;
+		connection.m_sentByType[type].m_numBytes += numBytes;
+	}
+}
+
+void NetStats::RecordReceived(uint8_t connectionIndex, uint8_t type, size_t numBytes)
+{
+	ConnectionNetStats& connection = GetOrAddConnection(connectionIndex);
+	connection.m_received.m_numMessages++;
+	connection.m_received.m_numBytes += numBytes;
+	if (type < connection.m_receivedByType.size())
+	{
+		connection.m_receivedByType[type].m_numMessages++;
+		connection.m_receivedByType[type].m_numBytes += numBytes;
+	}
+}
+
+void NetStats::RecordRoundTrip(uint8_t connectionIndex, double seconds)
+{
+	ConnectionNetStats& connection = GetOrAddConnection(connectionIndex);
+	connection.m_lastRoundTripSeconds = seconds;
+	if (!connection.m_hasRoundTrip)
+	{
+		connection.m_smoothedRoundTripSeconds = seconds;
+		connection.m_roundTripDeviationSeconds = seconds * 0.5;
+		connection.m_hasRoundTrip = true;
+		return;
+	}
+
+	connection.m_roundTripDeviationSeconds = 0.75 * connection.m_roundTripDeviationSeconds + 0.25 * fabs(connection.m_smoothedRoundTripSeconds - seconds);
+	connection.m_smoothedRoundTripSeconds = 0.875 * connection.m_smoothedRoundTripSeconds + 0.125 * seconds;
+}
+
+void NetStats::RecordFrame(double networkSeconds, size_t numCommandsQueued, size_t numMessagesUnsent)
+{
+	m_numFrames++;
+	m_lastFrameSeconds = networkSeconds;
+	m_totalFrameSeconds += networkSeconds;
+	m_peakFrameSeconds = std::max(m_peakFrameSeconds, networkSeconds);
+	m_totalCommandsQueued += numCommandsQueued;
+	m_peakCommandsQueued = std::max(m_peakCommandsQueued, numCommandsQueued);
+	m_totalMessagesUnsent += numMessagesUnsent;
+	m_peakMessagesUnsent = std::max(m_peakMessagesUnsent, numMessagesUnsent);
+}
+
+const ConnectionNetStats* NetStats::GetConnection(uint8_t connectionIndex) const
+{
+	if (connectionIndex >= m_connections.size() || !m_connections[connectionIndex].m_isActive)
+		return nullptr;
+
+	return &m_connections[connectionIndex];
+}
+
+void NetStats::WriteReport(std::vector<std::string>& out_lines, bool includeMessageTypes) const
+{
+	char line[256];
+	out_lines.clear();
+
+	double averageFrameSeconds = (m_numFrames > 0) ? m_totalFrameSeconds / m_numFrames : 0.0;
+	double averageCommandsQueued = (m_numFrames > 0) ? (double)m_totalCommandsQueued / m_numFrames : 0.0;
+	snprintf(line, sizeof(line), "Net time per frame: %.3fms last, %.3fms avg, %.3fms peak. Commands queued at flush: %.2f avg, %u peak",
+		m_lastFrameSeconds * 1000.0, averageFrameSeconds * 1000.0, m_peakFrameSeconds * 1000.0, averageCommandsQueued, (unsigned int)m_peakCommandsQueued);
+	out_lines.push_back(line);
+
+	double averageMessagesUnsent = (m_numFrames > 0) ? (double)m_totalMessagesUnsent / m_numFrames : 0.0;
+	snprintf(line, sizeof(line), "Messages waiting for the network thread at end of frame: %.2f avg, %u peak", averageMessagesUnsent, (unsigned int)m_peakMessagesUnsent);
+	out_lines.push_back(line);
+
+	for (size_t connectionIndex = 0; connectionIndex < m_connections.size(); connectionIndex++)
+	{
+		const ConnectionNetStats& connection = m_connections[connectionIndex];
+		if (!connection.m_isActive)
+			continue;
+
+		std::string roundTrip = "rtt unknown";
+		if (connection.m_hasRoundTrip)
+		{
+			char roundTripText[64];
+			snprintf(roundTripText, sizeof(roundTripText), "rtt %.1fms +/- %.1fms", connection.m_smoothedRoundTripSeconds * 1000.0, connection.m_roundTripDeviationSeconds * 1000.0);
+			roundTrip = roundTripText;
+		}
+
+		snprintf(line, sizeof(line), "Connection %u: %s, sent %u msgs %s, received %u msgs %s", (unsigned int)connectionIndex, roundTrip.c_str(),
+			connection.m_sent.m_numMessages, FormatByteCount(connection.m_sent.m_numBytes).c_str(), connection.m_received.m_numMessages, FormatByteCount(connection.m_received.m_numBytes).c_str());
+		out_lines.push_back(line);
+
+		if (!includeMessageTypes)
+			continue;
+
+		for (size_t type = 0; type < m_messageTypeNames.size(); type++)
+		{
+			const NetTrafficCounter& sent = connection.m_sentByType[type];
+			const NetTrafficCounter& received = connection.m_receivedByType[type];
+			if (sent.m_numMessages == 0 && received.m_numMessages == 0)
+				continue;
+
+			snprintf(line, sizeof(line), "  %-14s sent %u msgs %s, received %u msgs %s", GetMessageTypeName((uint8_t)type).c_str(),
+				sent.m_numMessages, FormatByteCount(sent.m_numBytes).c_str(), received.m_numMessages, FormatByteCount(received.m_numBytes).c_str());
+			out_lines.push_back(line);
+		}
+	}
+}
+
+ConnectionNetStats& NetStats::GetOrAddConnection(uint8_t connectionIndex)
+{
+	if (connectionIndex >= m_connections.size())
+		m_connections.resize(connectionIndex + 1);
+
+	ConnectionNetStats& connection = m_connections[connectionIndex];
+	if (!connection.m_isActive)
+	{
+		connection.m_isActive = true;
+		connection.m_sentByType.resize(m_messageTypeNames.size());
+		connection.m_receivedByType.resize(m_messageTypeNames.size());
+	}
+
+	return connection;
+}
+
+std::string NetStats::GetMessageTypeName(uint8_t type) const
+{
+	if (type < m_messageTypeNames.size() && !m_messageTypeNames[type].empty())
+		return m_messageTypeNames[type];
+
+	return "type " + std::to_string(type);
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+
+struct NetTrafficCounter
+{
+	uint32_t m_numMessages = 0;
+	uint64_t m_numBytes = 0;
+};
+
+//Round trips are smoothed the way TCP does (RFC 6298): a 1/8 moving average and a 1/4 moving mean deviation
+struct ConnectionNetStats
+{
+	bool m_isActive = false;
+	std::vector<NetTrafficCounter> m_sentByType;
+	std::vector<NetTrafficCounter> m_receivedByType;
+	NetTrafficCounter m_sent;
+	NetTrafficCounter m_received;
+	bool m_hasRoundTrip = false;
+	double m_lastRoundTripSeconds = 0.0;
+	double m_smoothedRoundTripSeconds = 0.0;
+	double m_roundTripDeviationSeconds = 0.0;
+};
+
+
+//Traffic counters for one session, kept per connection and per message type. Bytes are payload bytes as written
+//into each message; the transport's own framing isn't visible from here and isn't counted. Also tracks how long
+//each frame spent on networking, how many commands were waiting to go out when the frame flushed them, and how many
+//messages were still queued for the network thread to send once it had.
+//Peaks cover the time since the last ResetPeaks, so a periodic report shows the worst of its own interval.
+class NetStats
+{
+public:
+	explicit NetStats(size_t numMessageTypes);
+
+	void SetMessageTypeName(uint8_t type, const std::string& name);
+	void Reset();
+	void ResetConnection(uint8_t connectionIndex);
+	void ResetPeaks();
+
+	void RecordSent(uint8_t connectionIndex, uint8_t type, size_t numBytes);
+	void RecordReceived(uint8_t connectionIndex, uint8_t type, size_t numBytes);
+	void RecordRoundTrip(uint8_t connectionIndex, double seconds);
+	void RecordFrame(double networkSeconds, size_t numCommandsQueued, size_t numMessagesUnsent);
+
+	const ConnectionNetStats* GetConnection(uint8_t connectionIndex) const;
+	void WriteReport(std::vector<std::string>& out_lines, bool includeMessageTypes) const;
+
+private:
+	ConnectionNetStats& GetOrAddConnection(uint8_t connectionIndex);
+	std::string GetMessageTypeName(uint8_t type) const;
+
+	std::vector<std::string> m_messageTypeNames;
+	std::vector<ConnectionNetStats> m_connections;
+
+	uint64_t m_numFrames;
+	double m_lastFrameSeconds;
+	double m_totalFrameSeconds;
+	double m_peakFrameSeconds;
+	uint64_t m_totalCommandsQueued;
+	size_t m_peakCommandsQueued;
+	uint64_t m_totalMessagesUnsent;
+	size_t m_peakMessagesUnsent;
+};
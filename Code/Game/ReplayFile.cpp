@@ -0,0 +1,871 @@
+#include "Game/ReplayFile.hpp"
+#include <string.h>
+#include <algorithm>
+
+
+const size_t MAX_REPLAY_CHUNK_BYTES = 16 * 1024 * 1024;
+const size_t REPLAY_V1_COMMAND_BYTES = 15;
+
+
+ReplayFileWriter::ReplayFileWriter()
+	: m_file(nullptr)
+	, m_payload()
+	, m_pendingCommands()
+	, m_numCommandsWritten(0)
+	, m_numKeyframesWritten(0)
+	, m_hasFailed(false)
+{
+
+}
+
+ReplayFileWriter::~ReplayFileWriter()
+{
+	if (nullptr != m_file)
+		Close();
+}
+
+bool ReplayFileWriter::Open(const std::string& filePath, uint32_t seed, uint32_t infoFlags /*= 0*/)
+{
+	m_file = fopen(filePath.c_str(), "wb");
+	if (nullptr == m_file)
+		return false;
+
+	m_pendingCommands.clear();
+	m_numCommandsWritten = 0;
+	m_numKeyframesWritten = 0;
+	m_hasFailed = false;
+
+	m_payload.Clear();
+	m_payload.WriteUint32(REPLAY_MAGIC);
+	m_payload.WriteByte(REPLAY_VERSION);
+	if (fwrite(m_payload.GetData(), 1, m_payload.GetSize(), m_file) != m_payload.GetSize())
+		m_hasFailed = true;
+
+	m_payload.Clear();
+	m_payload.WriteVarint(seed);
+	m_payload.WriteVarint(infoFlags);
+	WriteChunk(REPLAY_CHUNK_INFO);
+	return !m_hasFailed;
+}
+
+void ReplayFileWriter::WriteCommand(const ReplayCommandRecord& command)
+{
+	m_pendingCommands.push_back(command);
+	if (m_pendingCommands.size() >= REPLAY_COMMANDS_PER_CHUNK)
+		FlushCommands();
+}
+
+void ReplayFileWriter::WriteKeyframe(size_t commandIndex, uint32_t numTurnsStarted, const BattleState& state)
+{
+	//Keep chunks in the order things happened
+	FlushCommands();
+
+	m_payload.Clear();
+	m_payload.WriteVarint(commandIndex);
+	WriteKeyframeState(m_payload, state);
+	m_payload.WriteVarint(numTurnsStarted);
+	WriteChunk(REPLAY_CHUNK_KEYFRAME);
+	m_numKeyframesWritten++;
+}
+
+void ReplayFileWriter::WriteSetup(const BattleState& state)
+{
+	FlushCommands();
+
+	m_payload.Clear();
+	WriteSetupState(m_payload, state);
+	WriteChunk(REPLAY_CHUNK_SETUP);
+}
+
+bool ReplayFileWriter::Close(size_t numTurnsPlayed /*= 0*/)
+{
+	if (nullptr == m_file)
+		return false;
+
+	FlushCommands();
+
+	m_payload.Clear();
+	m_payload.WriteVarint(m_numCommandsWritten);
+	m_payload.WriteVarint(m_numKeyframesWritten);
+	m_payload.WriteVarint(numTurnsPlayed);
+	WriteChunk(REPLAY_CHUNK_END);
+
+	if (fclose(m_file) != 0)
+		m_hasFailed = true;
+	m_file = nullptr;
+
+	return !m_hasFailed;
+}
+
+void ReplayFileWriter::FlushCommands()
+{
+	if (m_pendingCommands.empty())
+		return;
+
+	uint32_t maxCharacterIndex = 0;
+	uint32_t maxTileX = 0;
+	uint32_t maxTileY = 0;
+	uint32_t maxAbilityIndex = 0;
+	for (const ReplayCommandRecord& command : m_pendingCommands)
+	{
+		maxCharacterIndex = std::max(maxCharacterIndex, (uint32_t)std::max(command.m_actingCharacterIndex, command.m_targettedCharacterIndex));
+		maxTileX = std::max(maxTileX, (uint32_t)command.m_tileX);
+		maxTileY = std::max(maxTileY, (uint32_t)command.m_tileY);
+		maxAbilityIndex = std::max(maxAbilityIndex, (uint32_t)command.m_abilityIndex);
+	}
+
+	int characterIndexBits = ByteBuffer::CalculateBitsNeeded(maxCharacterIndex);
+	int tileXBits = ByteBuffer::CalculateBitsNeeded(maxTileX);
+	int tileYBits = ByteBuffer::CalculateBitsNeeded(maxTileY);
+	int abilityIndexBits = ByteBuffer::CalculateBitsNeeded(maxAbilityIndex);
+
+	m_payload.Clear();
+	m_payload.WriteVarint(m_pendingCommands.size());
+	m_payload.WriteByte((uint8_t)characterIndexBits);
+	m_payload.WriteByte((uint8_t)tileXBits);
+	m_payload.WriteByte((uint8_t)tileYBits);
+	m_payload.WriteByte((uint8_t)abilityIndexBits);
+	for (const ReplayCommandRecord& command : m_pendingCommands)
+	{
+		m_payload.WriteBits(command.m_type, 2);
+		m_payload.WriteBits(command.m_actingCharacterIndex, characterIndexBits);
+		m_payload.WriteBits((uint32_t)command.m_tileX, tileXBits);
+		m_payload.WriteBits((uint32_t)command.m_tileY, tileYBits);
+		m_payload.WriteBits(command.m_targettedCharacterIndex, characterIndexBits);
+		m_payload.WriteBits(command.m_abilityIndex, abilityIndexBits);
+	}
+	m_payload.FlushBits();
+	WriteChunk(REPLAY_CHUNK_COMMANDS);
+
+	m_numCommandsWritten += m_pendingCommands.size();
+	m_pendingCommands.clear();
+}
+
+void ReplayFileWriter::WriteChunk(ReplayChunkType type)
+{
+	m_payload.FlushBits();
+
+	ByteBuffer framing;
+	framing.WriteByte((uint8_t)type);
+	framing.WriteVarint(m_payload.GetSize());
+	if (fwrite(framing.GetData(), 1, framing.GetSize(), m_file) != framing.GetSize())
+		m_hasFailed = true;
+
+	if (m_payload.GetSize() > 0 && fwrite(m_payload.GetData(), 1, m_payload.GetSize(), m_file) != m_payload.GetSize())
+		m_hasFailed = true;
+
+	framing.Clear();
+	framing.WriteUint32(CalculateCRC32(m_payload.GetData(), m_payload.GetSize()));
+	if (fwrite(framing.GetData(), 1, framing.GetSize(), m_file) != framing.GetSize())
+		m_hasFailed = true;
+}
+
+
+ReplayFileReader::ReplayFileReader()
+	: m_version(0)
+	, m_seed(0)
+	, m_infoFlags(0)
+	, m_chunkType(NUM_REPLAY_CHUNK_TYPES)
+	, m_chunkCommands()
+	, m_keyframeCommandIndex(0)
+	, m_keyframeTurnsStarted(0)
+	, m_error()
+	, m_file(nullptr)
+	, m_payload()
+	, m_numCommandsRead(0)
+	, m_numKeyframesRead(0)
+	, m_numV1CommandsLeft(0)
+	, m_numV1KeyframesLeft(0)
+	, m_v1CountBytes(4)
+	, m_hasReadV1KeyframeCount(false)
+	, m_isFinished(false)
+{
+	m_keyframeState.Clear();
+	m_setupState.Clear();
+}
+
+ReplayFileReader::~ReplayFileReader()
+{
+	Close();
+}
+
+bool ReplayFileReader::Open(const std::string& filePath)
+{
+	Close();
+	m_error.clear();
+	m_isFinished = false;
+	m_numCommandsRead = 0;
+	m_numKeyframesRead = 0;
+	m_infoFlags = 0;
+
+	m_file = fopen(filePath.c_str(), "rb");
+	if (nullptr == m_file)
+		return Fail("Could not open " + filePath + ".");
+
+	uint8_t header[4];
+	if (!ReadRawBytes(header, sizeof(header)))
+		return Fail("Replay is empty.");
+
+	uint32_t firstWord = (uint32_t)header[0] | ((uint32_t)header[1] << 8) | ((uint32_t)header[2] << 16) | ((uint32_t)header[3] << 24);
+	if (firstWord != REPLAY_MAGIC)
+	{
+		//No header, so the first word was the seed
+		m_version = 1;
+		m_seed = firstWord;
+		m_hasReadV1KeyframeCount = false;
+		if (!DetectV1Layout())
+			return Fail("Version 1 replay's counts don't match its size.");
+
+		return true;
+	}
+
+	uint8_t version = 0;
+	if (!ReadRawBytes(&version, 1))
+		return Fail("Replay header is truncated.");
+	if (version < 2 || version > REPLAY_VERSION)
+		return Fail("Unsupported replay version " + std::to_string(version) + ".");
+
+	m_version = version;
+	if (!ReadNextChunkV2() || m_chunkType != REPLAY_CHUNK_INFO)
+		return Fail(m_error.empty() ? "Replay doesn't start with an info chunk." : m_error);
+
+	return true;
+}
+
+void ReplayFileReader::Close()
+{
+	if (nullptr != m_file)
+		fclose(m_file);
+	m_file = nullptr;
+}
+
+bool ReplayFileReader::ReadNextChunk()
+{
+	if (nullptr == m_file || m_isFinished || HasError())
+		return false;
+
+	return (m_version == 1) ? ReadNextChunkV1() : ReadNextChunkV2();
+}
+
+bool ReplayFileReader::ReadNextChunkV1()
+{
+	m_chunkCommands.clear();
+
+	if (m_numV1CommandsLeft > 0)
+	{
+		size_t numCommands = std::min(m_numV1CommandsLeft, REPLAY_COMMANDS_PER_CHUNK);
+		for (size_t commandIndex = 0; commandIndex < numCommands; commandIndex++)
+		{
+			uint8_t bytes[REPLAY_V1_COMMAND_BYTES];
+			if (!ReadRawBytes(bytes, sizeof(bytes)))
+				return Fail("Version 1 replay ends partway through its commands.");
+
+			//int type, uint8 actor, int x, int y, uint8 target, uint8 ability
+			ReplayCommandRecord command;
+			command.m_type = bytes[0];
+			command.m_actingCharacterIndex = bytes[4];
+			command.m_tileX = (int)((uint32_t)bytes[5] | ((uint32_t)bytes[6] << 8) | ((uint32_t)bytes[7] << 16) | ((uint32_t)bytes[8] << 24));
+			command.m_tileY = (int)((uint32_t)bytes[9] | ((uint32_t)bytes[10] << 8) | ((uint32_t)bytes[11] << 16) | ((uint32_t)bytes[12] << 24));
+			command.m_targettedCharacterIndex = bytes[13];
+			command.m_abilityIndex = bytes[14];
+			if (command.m_type > 3)
+				return Fail("Invalid command type in version 1 replay.");
+
+			m_chunkCommands.push_back(command);
+		}
+
+		m_numV1CommandsLeft -= numCommands;
+		m_numCommandsRead += numCommands;
+		m_chunkType = REPLAY_CHUNK_COMMANDS;
+		return true;
+	}
+
+	//Keyframes were tacked on after the commands before there was a header; older files just end here
+	if (m_numV1KeyframesLeft == 0)
+	{
+		m_isFinished = true;
+		return false;
+	}
+
+	uint64_t count;
+	if (!m_hasReadV1KeyframeCount)
+	{
+		m_hasReadV1KeyframeCount = true;
+		if (!ReadV1Count(count))
+			return Fail("Version 1 replay is missing its keyframe count.");
+	}
+
+	if (!ReadV1Count(count) || !ReadRawBytes(&m_keyframeState, sizeof(m_keyframeState)))
+		return Fail("Version 1 replay ends partway through a keyframe.");
+
+	m_keyframeCommandIndex = (size_t)count;
+	m_keyframeTurnsStarted = 0;
+	m_numV1KeyframesLeft--;
+	m_numKeyframesRead++;
+	m_chunkType = REPLAY_CHUNK_KEYFRAME;
+	return true;
+}
+
+bool ReplayFileReader::ReadNextChunkV2()
+{
+	m_chunkCommands.clear();
+
+	uint8_t type = 0;
+	if (!ReadRawBytes(&type, 1))
+		return Fail("Replay ends without an end chunk.");
+
+	uint64_t payloadSize = 0;
+	if (!ReadRawVarint(payloadSize) || payloadSize > MAX_REPLAY_CHUNK_BYTES)
+		return Fail("Replay chunk has a bad size.");
+
+	m_payload.resize((size_t)payloadSize);
+	uint8_t crcBytes[4];
+	if ((payloadSize > 0 && !ReadRawBytes(&m_payload[0], (size_t)payloadSize)) || !ReadRawBytes(crcBytes, sizeof(crcBytes)))
+		return Fail("Replay ends partway through a chunk.");
+
+	ByteReader payload(m_payload.empty() ? nullptr : &m_payload[0], m_payload.size());
+	uint32_t storedCRC = (uint32_t)crcBytes[0] | ((uint32_t)crcBytes[1] << 8) | ((uint32_t)crcBytes[2] << 16) | ((uint32_t)crcBytes[3] << 24);
+	if (storedCRC != CalculateCRC32(payload.GetData(), payload.GetSize()))
+		return Fail("Replay chunk failed its CRC check.");
+
+	switch (type)
+	{
+	case REPLAY_CHUNK_INFO:
+		m_seed = (uint32_t)payload.ReadVarint();
+		m_infoFlags = (payload.GetRemainingBytes() > 0) ? (uint32_t)payload.ReadVarint() : 0;
+		break;
+	case REPLAY_CHUNK_SETUP:
+		if (!ReadSetupState(payload, m_setupState, (uint8_t)m_version))
+			return Fail("Replay setup is malformed.");
+		break;
+	case REPLAY_CHUNK_COMMANDS:
+	{
+		ReplayCommandChunkLayout layout;
+		if (!ReadCommandChunkLayout(payload, layout))
+			return Fail("Replay command chunk has a bad layout.");
+
+		for (size_t commandIndex = 0; commandIndex < layout.m_numCommands; commandIndex++)
+		{
+			m_chunkCommands.push_back(ReadCommandRecord(payload, layout));
+		}
+		m_numCommandsRead += layout.m_numCommands;
+		break;
+	}
+	case REPLAY_CHUNK_KEYFRAME:
+		m_keyframeCommandIndex = (size_t)payload.ReadVarint();
+		if (!ReadKeyframeState(payload, m_keyframeState, (uint8_t)m_version))
+			return Fail("Replay keyframe is malformed.");
+		m_keyframeTurnsStarted = (payload.GetRemainingBytes() > 0) ? (uint32_t)payload.ReadVarint() : 0;
+		m_numKeyframesRead++;
+		break;
+	case REPLAY_CHUNK_END:
+	{
+		size_t numCommands = (size_t)payload.ReadVarint();
+		size_t numKeyframes = (size_t)payload.ReadVarint();
+		if (numCommands != m_numCommandsRead || numKeyframes != m_numKeyframesRead)
+			return Fail("Replay is missing chunks.");
+
+		m_isFinished = true;
+		return false;
+	}
+	default:
+		return Fail("Unknown replay chunk type.");
+	}
+
+	if (payload.HasOverrun())
+		return Fail("Replay chunk is shorter than its contents.");
+
+	m_chunkType = (ReplayChunkType)type;
+	return true;
+}
+
+//Version 1 wrote its counts as size_t, so Win32 builds wrote 4 bytes and x64 builds 8, with nothing in the file to say
+//which. A width is taken when its counts add up to the file's size and every command it lines up has a valid type;
+//read with the wrong width, the commands are misaligned by 4 bytes and pick up actor or target IDs in their type.
+//Keyframes are raw BattleStates, so they're only kept when they're the size this build's BattleState is; they
+//only ever sped up seeking.
+bool ReplayFileReader::DetectV1Layout()
+{
+	if (fseek(m_file, 0, SEEK_END) != 0)
+		return false;
+
+	uint64_t fileSize = (uint64_t)ftell(m_file);
+	const int countWidths[] = { 4, 8 };
+	for (int countBytes : countWidths)
+	{
+		m_v1CountBytes = countBytes;
+		uint64_t numCommands = 0;
+		if (fseek(m_file, 4, SEEK_SET) != 0 || !ReadV1Count(numCommands) || numCommands > fileSize / REPLAY_V1_COMMAND_BYTES)
+			continue;
+
+		uint64_t commandsEnd = 4 + countBytes + numCommands * REPLAY_V1_COMMAND_BYTES;
+		uint64_t numKeyframes = 0;
+		if (commandsEnd != fileSize)
+		{
+			if (commandsEnd + countBytes > fileSize || fseek(m_file, (long)commandsEnd, SEEK_SET) != 0 || !ReadV1Count(numKeyframes))
+				continue;
+
+			uint64_t keyframesSize = fileSize - commandsEnd - countBytes;
+			if (numKeyframes == 0 ? keyframesSize != 0 : (keyframesSize % numKeyframes != 0 || keyframesSize / numKeyframes <= (uint64_t)countBytes))
+				continue;
+
+			if (numKeyframes > 0 && keyframesSize / numKeyframes != countBytes + sizeof(BattleState))
+				numKeyframes = 0;
+		}
+
+		if (fseek(m_file, 4 + countBytes, SEEK_SET) != 0)
+			return false;
+
+		bool hasValidCommands = true;
+		for (uint64_t commandIndex = 0; commandIndex < numCommands && hasValidCommands; commandIndex++)
+		{
+			uint8_t bytes[REPLAY_V1_COMMAND_BYTES];
+			hasValidCommands = ReadRawBytes(bytes, sizeof(bytes)) && bytes[0] <= 3 && bytes[1] == 0 && bytes[2] == 0 && bytes[3] == 0;
+		}
+
+		if (!hasValidCommands || fseek(m_file, 4 + countBytes, SEEK_SET) != 0)
+			continue;
+
+		m_numV1CommandsLeft = (size_t)numCommands;
+		m_numV1KeyframesLeft = (size_t)numKeyframes;
+		return true;
+	}
+
+	return false;
+}
+
+bool ReplayFileReader::ReadV1Count(uint64_t& out_count)
+{
+	uint8_t bytes[8];
+	if (!ReadRawBytes(bytes, m_v1CountBytes))
+		return false;
+
+	out_count = 0;
+	for (int byteIndex = m_v1CountBytes - 1; byteIndex >= 0; byteIndex--)
+	{
+		out_count = (out_count << 8) | bytes[byteIndex];
+	}
+	return true;
+}
+
+bool ReplayFileReader::ReadRawBytes(void* out_data, size_t numBytes)
+{
+	return fread(out_data, 1, numBytes, m_file) == numBytes;
+}
+
+bool ReplayFileReader::ReadRawVarint(uint64_t& out_value)
+{
+	out_value = 0;
+	for (int shift = 0; shift < 64; shift += 7)
+	{
+		uint8_t byte = 0;
+		if (!ReadRawBytes(&byte, 1))
+			return false;
+
+		out_value |= (uint64_t)(byte & 0x7F) << shift;
+		if ((byte & 0x80) == 0)
+			return true;
+	}
+
+	return false;
+}
+
+bool ReplayFileReader::Fail(const std::string& error)
+{
+	m_error = error;
+	Close();
+	return false;
+}
+
+
+ReplayView::ReplayView()
+	: m_version(0)
+	, m_seed(0)
+	, m_infoFlags(0)
+	, m_numTurnsPlayed(0)
+	, m_chunkType(NUM_REPLAY_CHUNK_TYPES)
+	, m_payload()
+	, m_error()
+	, m_file()
+	, m_numCommandsRead(0)
+	, m_numKeyframesRead(0)
+	, m_isFinished(false)
+{
+	memset(&m_commandLayout, 0, sizeof(m_commandLayout));
+}
+
+bool ReplayView::Open(const void* data, size_t numBytes)
+{
+	m_file = ByteReader(data, numBytes);
+	m_error.clear();
+	m_numCommandsRead = 0;
+	m_numKeyframesRead = 0;
+	m_numTurnsPlayed = 0;
+	m_infoFlags = 0;
+	m_isFinished = false;
+
+	if (m_file.ReadUint32() != REPLAY_MAGIC)
+		return Fail("Not a version 2 or later replay.");
+
+	m_version = m_file.ReadByte();
+	if (m_version < 2 || m_version > REPLAY_VERSION)
+		return Fail("Unsupported replay version.");
+
+	if (!ReadNextChunk() || m_chunkType != REPLAY_CHUNK_INFO)
+		return Fail(m_error.empty() ? "Replay doesn't start with an info chunk." : m_error);
+
+	return true;
+}
+
+bool ReplayView::ReadNextChunk()
+{
+	if (m_isFinished || HasError())
+		return false;
+
+	uint8_t type = m_file.ReadByte();
+	uint64_t payloadSize = m_file.ReadVarint();
+	if (m_file.HasOverrun())
+		return Fail("Replay ends without an end chunk.");
+	if (payloadSize > m_file.GetRemainingBytes())
+		return Fail("Replay ends partway through a chunk.");
+
+	const uint8_t* payloadData = m_file.SkipBytes((size_t)payloadSize);
+	uint32_t storedCRC = m_file.ReadUint32();
+	if (m_file.HasOverrun())
+		return Fail("Replay ends partway through a chunk.");
+	if (storedCRC != CalculateCRC32(payloadData, (size_t)payloadSize))
+		return Fail("Replay chunk failed its CRC check.");
+
+	m_payload = ByteReader(payloadData, (size_t)payloadSize);
+	switch (type)
+	{
+	case REPLAY_CHUNK_INFO:
+		m_seed = (uint32_t)m_payload.ReadVarint();
+		m_infoFlags = (m_payload.GetRemainingBytes() > 0) ? (uint32_t)m_payload.ReadVarint() : 0;
+		break;
+	case REPLAY_CHUNK_COMMANDS:
+		if (!ReadCommandChunkLayout(m_payload, m_commandLayout))
+			return Fail("Replay command chunk has a bad layout.");
+		m_numCommandsRead += m_commandLayout.m_numCommands;
+		break;
+	case REPLAY_CHUNK_KEYFRAME:
+		m_numKeyframesRead++;
+		break;
+	case REPLAY_CHUNK_SETUP:
+		break;
+	case REPLAY_CHUNK_END:
+	{
+		size_t numCommands = (size_t)m_payload.ReadVarint();
+		size_t numKeyframes = (size_t)m_payload.ReadVarint();
+		if (m_payload.HasOverrun() || numCommands != m_numCommandsRead || numKeyframes != m_numKeyframesRead)
+			return Fail("Replay is missing chunks.");
+
+		//Files from before the turn count just end here
+		if (m_payload.GetRemainingBytes() > 0)
+			m_numTurnsPlayed = (size_t)m_payload.ReadVarint();
+
+		m_isFinished = true;
+		return false;
+	}
+	default:
+		return Fail("Unknown replay chunk type.");
+	}
+
+	if (m_payload.HasOverrun())
+		return Fail("Replay chunk is shorter than its contents.");
+
+	m_chunkType = (ReplayChunkType)type;
+	return true;
+}
+
+bool ReplayView::Fail(const std::string& error)
+{
+	m_error = error;
+	return false;
+}
+
+
+bool ReadCommandChunkLayout(ByteReader& payload, ReplayCommandChunkLayout& out_layout)
+{
+	out_layout.m_numCommands = (size_t)payload.ReadVarint();
+	out_layout.m_characterIndexBits = payload.ReadByte();
+	out_layout.m_tileXBits = payload.ReadByte();
+	out_layout.m_tileYBits = payload.ReadByte();
+	out_layout.m_abilityIndexBits = payload.ReadByte();
+
+	return !payload.HasOverrun() && out_layout.m_numCommands <= REPLAY_COMMANDS_PER_CHUNK && out_layout.m_characterIndexBits <= 16
+		&& out_layout.m_tileXBits <= 16 && out_layout.m_tileYBits <= 16 && out_layout.m_abilityIndexBits <= 8;
+}
+
+ReplayCommandRecord ReadCommandRecord(ByteReader& payload, const ReplayCommandChunkLayout& layout)
+{
+	ReplayCommandRecord command;
+	command.m_type = (uint8_t)payload.ReadBits(2);
+	command.m_actingCharacterIndex = (CharacterID)payload.ReadBits(layout.m_characterIndexBits);
+	command.m_tileX = (int)payload.ReadBits(layout.m_tileXBits);
+	command.m_tileY = (int)payload.ReadBits(layout.m_tileYBits);
+	command.m_targettedCharacterIndex = (CharacterID)payload.ReadBits(layout.m_characterIndexBits);
+	command.m_abilityIndex = (uint8_t)payload.ReadBits(layout.m_abilityIndexBits);
+	return command;
+}
+
+
+static void WriteCharacterDynamics(ByteBuffer& buffer, const BattleState& state, int slot)
+{
+	bool hasPendingAbility = state.m_pendingAbilities[slot] != INVALID_BATTLE_INDEX;
+	buffer.WriteVarint(state.m_characterIndices[slot]);
+	buffer.WriteByte(state.m_owningPlayers[slot]);
+	buffer.WriteVarint(state.m_tileIndices[slot]);
+	buffer.WriteSignedVarint(state.m_currentHP[slot]);
+	buffer.WriteSignedVarint(state.m_currentCT[slot]);
+	buffer.WriteByte((uint8_t)((state.m_isDead[slot] ? 1 : 0) | (hasPendingAbility ? 2 : 0) | (state.m_statusEffectBits[slot] << 2) | (state.m_isRemoved[slot] ? 0x40 : 0)));
+
+	for (int effectIndex = 0; effectIndex < NUM_STATUS_EFFECTS; effectIndex++)
+	{
+		if (state.HasStatusEffect(slot, (StatusEffectType)effectIndex))
+			buffer.WriteVarint(state.m_statusEffectDurations[effectIndex][slot]);
+	}
+
+	if (hasPendingAbility)
+	{
+		//Character IDs start at 1, so 0 means no target
+		CharacterID targetCharacterIndex = 0;
+		if (state.m_pendingTargetCharacters[slot] != INVALID_BATTLE_INDEX)
+			targetCharacterIndex = state.m_characterIndices[state.m_pendingTargetCharacters[slot]];
+
+		buffer.WriteByte(state.m_pendingAbilities[slot]);
+		buffer.WriteVarint((state.m_pendingTargetTiles[slot] == INVALID_BATTLE_TILE) ? 0 : (uint64_t)state.m_pendingTargetTiles[slot] + 1);
+		buffer.WriteVarint(targetCharacterIndex);
+	}
+}
+
+static CharacterID ReadCharacterIndex(ByteReader& reader, uint8_t version)
+{
+	if (version >= 3)
+		return (CharacterID)reader.ReadVarint();
+
+	return reader.ReadByte();
+}
+
+static bool ReadCharacterDynamics(ByteReader& reader, BattleState& out_state, int slot, uint8_t version, CharacterID& out_pendingTargetCharacterIndex)
+{
+	out_state.m_characterIndices[slot] = ReadCharacterIndex(reader, version);
+	out_state.m_owningPlayers[slot] = reader.ReadByte();
+	out_state.m_tileIndices[slot] = (uint16_t)reader.ReadVarint();
+	out_state.m_currentHP[slot] = (int)reader.ReadSignedVarint();
+	out_state.m_currentCT[slot] = (int)reader.ReadSignedVarint();
+
+	uint8_t flags = reader.ReadByte();
+	out_state.m_isDead[slot] = flags & 1;
+	out_state.m_isRemoved[slot] = (flags & 0x40) ? 1 : 0;
+	out_state.m_statusEffectBits[slot] = (uint8_t)((flags >> 2) & 0xF);
+	for (int effectIndex = 0; effectIndex < NUM_STATUS_EFFECTS; effectIndex++)
+	{
+		if (out_state.HasStatusEffect(slot, (StatusEffectType)effectIndex))
+			out_state.m_statusEffectDurations[effectIndex][slot] = (uint8_t)reader.ReadVarint();
+	}
+
+	out_pendingTargetCharacterIndex = 0;
+	if (flags & 2)
+	{
+		out_state.m_pendingAbilities[slot] = reader.ReadByte();
+		uint64_t targetTile = reader.ReadVarint();
+		out_state.m_pendingTargetTiles[slot] = (targetTile == 0) ? INVALID_BATTLE_TILE : (uint16_t)(targetTile - 1);
+		out_pendingTargetCharacterIndex = ReadCharacterIndex(reader, version);
+		if (version < 3 && out_pendingTargetCharacterIndex == INVALID_BATTLE_INDEX)
+			out_pendingTargetCharacterIndex = 0;
+	}
+
+	if (out_state.m_tileIndices[slot] >= out_state.m_numTiles || reader.HasOverrun())
+		return false;
+
+	//A keyframe doesn't carry the ability table, so there the most a pending ability can be checked against is the cap
+	int numAbilities = (out_state.m_numAbilityDefinitions > 0) ? out_state.m_numAbilityDefinitions : MAX_BATTLE_ABILITIES;
+	if (out_state.m_pendingAbilities[slot] != INVALID_BATTLE_INDEX && out_state.m_pendingAbilities[slot] >= numAbilities)
+		return false;
+	if (out_state.m_pendingTargetTiles[slot] != INVALID_BATTLE_TILE && out_state.m_pendingTargetTiles[slot] >= out_state.m_numTiles)
+		return false;
+
+	if (out_state.IsActive(slot))
+		out_state.m_tileOccupants[out_state.m_tileIndices[slot]] = (uint8_t)slot;
+
+	return true;
+}
+
+static void ResolvePendingTargets(BattleState& out_state, const CharacterID* pendingTargetCharacterIndices)
+{
+	for (int slot = 0; slot < out_state.m_numCharacters; slot++)
+	{
+		if (pendingTargetCharacterIndices[slot] != 0)
+			out_state.m_pendingTargetCharacters[slot] = (uint8_t)out_state.FindCharacterSlot(pendingTargetCharacterIndices[slot]);
+	}
+}
+
+void WriteKeyframeState(ByteBuffer& buffer, const BattleState& state)
+{
+	//Terrain, stats and abilities come back from the seed, so only what changes during a battle is stored
+	buffer.WriteVarint((uint64_t)state.m_mapWidth);
+	buffer.WriteVarint((uint64_t)state.m_mapHeight);
+
+	int numActiveCharacters = 0;
+	for (int slot = 0; slot < state.m_numCharacters; slot++)
+	{
+		if (state.IsActive(slot))
+			numActiveCharacters++;
+	}
+	buffer.WriteVarint((uint64_t)numActiveCharacters);
+
+	for (int slot = 0; slot < state.m_numCharacters; slot++)
+	{
+		if (state.IsActive(slot))
+			WriteCharacterDynamics(buffer, state, slot);
+	}
+}
+
+bool ReadKeyframeState(ByteReader& reader, BattleState& out_state, uint8_t version /*= REPLAY_VERSION*/)
+{
+	out_state.Clear();
+	out_state.m_mapWidth = (int)reader.ReadVarint();
+	out_state.m_mapHeight = (int)reader.ReadVarint();
+	out_state.m_numTiles = out_state.m_mapWidth * out_state.m_mapHeight;
+	out_state.m_numCharacters = (int)reader.ReadVarint();
+	if (out_state.m_numTiles < 0 || out_state.m_numTiles > MAX_BATTLE_TILES || out_state.m_numCharacters > MAX_BATTLE_CHARACTERS || reader.HasOverrun())
+		return false;
+
+	CharacterID pendingTargetCharacterIndices[MAX_BATTLE_CHARACTERS];
+	for (int slot = 0; slot < out_state.m_numCharacters; slot++)
+	{
+		if (!ReadCharacterDynamics(reader, out_state, slot, version, pendingTargetCharacterIndices[slot]))
+			return false;
+	}
+
+	ResolvePendingTargets(out_state, pendingTargetCharacterIndices);
+	return true;
+}
+
+void WriteSetupState(ByteBuffer& buffer, const BattleState& state)
+{
+	buffer.WriteVarint((uint64_t)state.m_mapWidth);
+	buffer.WriteVarint((uint64_t)state.m_mapHeight);
+	for (int tileIndex = 0; tileIndex < state.m_numTiles; tileIndex++)
+	{
+		buffer.WriteSignedVarint(state.m_tileHeights[tileIndex]);
+		buffer.WriteByte(state.m_tileDefinitionIDs[tileIndex]);
+		buffer.WriteByte(state.m_tileFlags[tileIndex]);
+	}
+
+	buffer.WriteVarint((uint64_t)state.m_numAbilityDefinitions);
+	for (int abilityID = 0; abilityID < state.m_numAbilityDefinitions; abilityID++)
+	{
+		const BattleAbility& ability = state.m_abilityDefinitions[abilityID];
+		buffer.WriteSignedVarint(ability.m_range);
+		buffer.WriteSignedVarint(ability.m_radius);
+		buffer.WriteSignedVarint(ability.m_maxHeightDifference);
+		buffer.WriteSignedVarint(ability.m_areaMaxHeightDifference);
+		buffer.WriteSignedVarint(ability.m_power);
+		buffer.WriteSignedVarint(ability.m_speed);
+		buffer.WriteBytes(ability.m_statusEffectDurations, NUM_STATUS_EFFECTS);
+	}
+
+	//Every slot is kept, removed or not, so slot numbers match the original battle
+	buffer.WriteVarint((uint64_t)state.m_numCharacters);
+	for (int slot = 0; slot < state.m_numCharacters; slot++)
+	{
+		WriteCharacterDynamics(buffer, state, slot);
+		buffer.WriteByte(state.m_factions[slot]);
+		buffer.WriteByte(state.m_isAIControlled[slot]);
+		for (int statIndex = 0; statIndex < NUM_STATS; statIndex++)
+		{
+			buffer.WriteSignedVarint(state.m_stats[statIndex][slot]);
+		}
+		buffer.WriteSignedVarint(state.m_attackPower[slot]);
+		buffer.WriteSignedVarint(state.m_attackRanges[slot]);
+		buffer.WriteSignedVarint(state.m_maxAttackHeightDifferences[slot]);
+		for (int defenderSlot = 0; defenderSlot < state.m_numCharacters; defenderSlot++)
+		{
+			uint32_t modifierBits;
+			memcpy(&modifierBits, &state.m_attackDamageModifiers[slot][defenderSlot], sizeof(modifierBits));
+			buffer.WriteUint32(modifierBits);
+		}
+
+		buffer.WriteByte(state.m_numAbilities[slot]);
+		buffer.WriteBytes(state.m_abilities[slot], state.m_numAbilities[slot]);
+		buffer.WriteByte(state.m_numBehaviors[slot]);
+		buffer.WriteBytes(state.m_behaviorKinds[slot], state.m_numBehaviors[slot]);
+	}
+}
+
+bool ReadSetupState(ByteReader& reader, BattleState& out_state, uint8_t version /*= REPLAY_VERSION*/)
+{
+	out_state.Clear();
+	out_state.m_mapWidth = (int)reader.ReadVarint();
+	out_state.m_mapHeight = (int)reader.ReadVarint();
+	out_state.m_numTiles = out_state.m_mapWidth * out_state.m_mapHeight;
+	if (out_state.m_numTiles < 0 || out_state.m_numTiles > MAX_BATTLE_TILES || reader.HasOverrun())
+		return false;
+
+	for (int tileIndex = 0; tileIndex < out_state.m_numTiles; tileIndex++)
+	{
+		out_state.m_tileHeights[tileIndex] = (int16_t)reader.ReadSignedVarint();
+		out_state.m_tileDefinitionIDs[tileIndex] = reader.ReadByte();
+		out_state.m_tileFlags[tileIndex] = reader.ReadByte();
+	}
+
+	out_state.m_numAbilityDefinitions = (int)reader.ReadVarint();
+	if (out_state.m_numAbilityDefinitions > MAX_BATTLE_ABILITIES || reader.HasOverrun())
+		return false;
+
+	for (int abilityID = 0; abilityID < out_state.m_numAbilityDefinitions; abilityID++)
+	{
+		BattleAbility& ability = out_state.m_abilityDefinitions[abilityID];
+		ability.m_range = (int16_t)reader.ReadSignedVarint();
+		ability.m_radius = (int16_t)reader.ReadSignedVarint();
+		ability.m_maxHeightDifference = (int16_t)reader.ReadSignedVarint();
+		ability.m_areaMaxHeightDifference = (int16_t)reader.ReadSignedVarint();
+		ability.m_power = (int)reader.ReadSignedVarint();
+		ability.m_speed = (int)reader.ReadSignedVarint();
+		reader.ReadBytes(ability.m_statusEffectDurations, NUM_STATUS_EFFECTS);
+	}
+
+	out_state.m_numCharacters = (int)reader.ReadVarint();
+	if (out_state.m_numCharacters > MAX_BATTLE_CHARACTERS || reader.HasOverrun())
+		return false;
+
+	CharacterID pendingTargetCharacterIndices[MAX_BATTLE_CHARACTERS];
+	for (int slot = 0; slot < out_state.m_numCharacters; slot++)
+	{
+		if (!ReadCharacterDynamics(reader, out_state, slot, version, pendingTargetCharacterIndices[slot]))
+			return false;
+
+		out_state.m_factions[slot] = reader.ReadByte();
+		out_state.m_isAIControlled[slot] = reader.ReadByte();
+		for (int statIndex = 0; statIndex < NUM_STATS; statIndex++)
+		{
+			out_state.m_stats[statIndex][slot] = (int)reader.ReadSignedVarint();
+		}
+		out_state.m_attackPower[slot] = (int)reader.ReadSignedVarint();
+		out_state.m_attackRanges[slot] = (int)reader.ReadSignedVarint();
+		out_state.m_maxAttackHeightDifferences[slot] = (int)reader.ReadSignedVarint();
+		for (int defenderSlot = 0; defenderSlot < out_state.m_numCharacters; defenderSlot++)
+		{
+			uint32_t modifierBits = reader.ReadUint32();
+			memcpy(&out_state.m_attackDamageModifiers[slot][defenderSlot], &modifierBits, sizeof(modifierBits));
+		}
+
+		out_state.m_numAbilities[slot] = reader.ReadByte();
+		if (out_state.m_numAbilities[slot] > MAX_CHARACTER_ABILITIES)
+			return false;
+		reader.ReadBytes(out_state.m_abilities[slot], out_state.m_numAbilities[slot]);
+
+		out_state.m_numBehaviors[slot] = reader.ReadByte();
+		if (out_state.m_numBehaviors[slot] > MAX_CHARACTER_BEHAVIORS)
+			return false;
+		reader.ReadBytes(out_state.m_behaviorKinds[slot], out_state.m_numBehaviors[slot]);
+
+		if (reader.HasOverrun())
+			return false;
+	}
+
+	ResolvePendingTargets(out_state, pendingTargetCharacterIndices);
+	return true;
+}
@@ -0,0 +1,168 @@
+#pragma once
+#include "Game/BattleState.hpp"
+#include "Game/ByteBuffer.hpp"
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+
+//replay.sav, version 4:
+//  "TRPL" magic, version byte, then chunks of [type byte][payload size varint][payload][CRC-32 of payload, little-endian].
+//  INFO holds the seed, then optionally REPLAY_INFO_* flags (0 or missing for none). COMMANDS holds up to REPLAY_COMMANDS_PER_CHUNK bit-packed commands, with field widths
+//  sized to the largest value in the chunk. KEYFRAME holds a command index and the state that changes turn to turn,
+//  then optionally the number of turns started so far (0 or missing when unknown).
+//  END holds the command and keyframe counts so a truncated file is caught, then optionally the number of turns the
+//  match had run when recording stopped (0 or missing when unknown). SETUP, when present, follows INFO
+//  and holds the whole starting BattleState so a replay can be re-simulated without the game.
+//Version 4 has the same layout as version 3, but the game that recorded it restarted its random stream every turn
+//(see CalculateKeyframeSeed), so its keyframes can be seeked to. Older files rolled one stream from the seed.
+//Version 3 widened character IDs to 16 bits; version 2 stored them in a byte and can still be read.
+//Version 1 is the old raw dump (size_t counts from either Win32 or x64, host byte order, no header) and can still be read.
+const uint32_t REPLAY_MAGIC = 0x4C505254;
+const uint8_t REPLAY_VERSION = 4;
+const uint8_t REPLAY_VERSION_RESEEDS_EVERY_TURN = 4;
+const size_t REPLAY_COMMANDS_PER_CHUNK = 64;
+
+//Every turn that wanted a decision is in the file as a command, AI turns included, so the match can be re-simulated
+//from the setup alone. The game only records the turns its players command, so only TacticsBatch sets this.
+const uint32_t REPLAY_INFO_EVERY_TURN_RECORDED = 1 << 0;
+
+enum ReplayChunkType
+{
+	REPLAY_CHUNK_INFO,
+	REPLAY_CHUNK_COMMANDS,
+	REPLAY_CHUNK_KEYFRAME,
+	REPLAY_CHUNK_END,
+	REPLAY_CHUNK_SETUP,
+	NUM_REPLAY_CHUNK_TYPES
+};
+
+struct ReplayCommandRecord
+{
+	uint8_t m_type;
+	CharacterID m_actingCharacterIndex;
+	int m_tileX;
+	int m_tileY;
+	CharacterID m_targettedCharacterIndex;
+	uint8_t m_abilityIndex;
+};
+
+struct ReplayCommandChunkLayout
+{
+	size_t m_numCommands;
+	int m_characterIndexBits;
+	int m_tileXBits;
+	int m_tileYBits;
+	int m_abilityIndexBits;
+};
+
+
+class ReplayFileWriter
+{
+public:
+	ReplayFileWriter();
+	~ReplayFileWriter();
+
+	bool Open(const std::string& filePath, uint32_t seed, uint32_t infoFlags = 0);
+	void WriteSetup(const BattleState& state);
+	void WriteCommand(const ReplayCommandRecord& command);
+	void WriteKeyframe(size_t commandIndex, uint32_t numTurnsStarted, const BattleState& state);
+	bool Close(size_t numTurnsPlayed = 0);
+
+private:
+	void FlushCommands();
+	void WriteChunk(ReplayChunkType type);
+
+	FILE* m_file;
+	ByteBuffer m_payload;
+	std::vector<ReplayCommandRecord> m_pendingCommands;
+	size_t m_numCommandsWritten;
+	size_t m_numKeyframesWritten;
+	bool m_hasFailed;
+};
+
+
+//Reads one chunk at a time, so a replay never has to be held in memory all at once.
+//Version 1 files come back as the same chunk types: their commands in chunks of REPLAY_COMMANDS_PER_CHUNK, then any keyframes.
+class ReplayFileReader
+{
+public:
+	ReplayFileReader();
+	~ReplayFileReader();
+
+	bool Open(const std::string& filePath);
+	void Close();
+	bool ReadNextChunk();
+	bool HasError() const { return !m_error.empty(); }
+
+public:
+	int m_version;
+	uint32_t m_seed;
+	uint32_t m_infoFlags;
+	ReplayChunkType m_chunkType;
+	std::vector<ReplayCommandRecord> m_chunkCommands;
+	size_t m_keyframeCommandIndex;
+	uint32_t m_keyframeTurnsStarted;
+	BattleState m_keyframeState;
+	BattleState m_setupState;
+	std::string m_error;
+
+private:
+	bool ReadNextChunkV1();
+	bool ReadNextChunkV2();
+	bool DetectV1Layout();
+	bool ReadV1Count(uint64_t& out_count);
+	bool ReadRawBytes(void* out_data, size_t numBytes);
+	bool ReadRawVarint(uint64_t& out_value);
+	bool Fail(const std::string& error);
+
+	FILE* m_file;
+	std::vector<uint8_t> m_payload;
+	size_t m_numCommandsRead;
+	size_t m_numKeyframesRead;
+	size_t m_numV1CommandsLeft;
+	size_t m_numV1KeyframesLeft;
+	int m_v1CountBytes;
+	bool m_hasReadV1KeyframeCount;
+	bool m_isFinished;
+};
+
+
+//Walks a version 2 replay that is already in memory, such as a mapped file, without copying it.
+//Command chunks are left in m_payload for the caller to decode one record at a time.
+class ReplayView
+{
+public:
+	ReplayView();
+
+	bool Open(const void* data, size_t numBytes);
+	bool ReadNextChunk();
+	bool HasError() const { return !m_error.empty(); }
+
+public:
+	uint8_t m_version;
+	uint32_t m_seed;
+	uint32_t m_infoFlags;
+	size_t m_numTurnsPlayed;
+	ReplayChunkType m_chunkType;
+	ByteReader m_payload;
+	ReplayCommandChunkLayout m_commandLayout;
+	std::string m_error;
+
+private:
+	bool Fail(const std::string& error);
+
+	ByteReader m_file;
+	size_t m_numCommandsRead;
+	size_t m_numKeyframesRead;
+	bool m_isFinished;
+};
+
+
+bool ReadCommandChunkLayout(ByteReader& payload, ReplayCommandChunkLayout& out_layout);
+ReplayCommandRecord ReadCommandRecord(ByteReader& payload, const ReplayCommandChunkLayout& layout);
+
+void WriteKeyframeState(ByteBuffer& buffer, const BattleState& state);
+bool ReadKeyframeState(ByteReader& reader, BattleState& out_state, uint8_t version = REPLAY_VERSION);
+void WriteSetupState(ByteBuffer& buffer, const BattleState& state);
+bool ReadSetupState(ByteReader& reader, BattleState& out_state, uint8_t version = REPLAY_VERSION);
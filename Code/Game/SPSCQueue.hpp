@@ -0,0 +1,64 @@
+#pragma once
+#include <atomic>
+#include <stddef.h>
+
+
+const size_t CACHE_LINE_BYTES = 64;
+
+
+//Bounded lock-free queue for exactly one producer thread and one consumer thread. The producer only ever writes
+//m_tail and the consumer only ever writes m_head, each padded out to a cache line of its own; a slot is published by
+//the release store of the index that covers it. Padding rather than alignas keeps the queue to the heap's normal
+//alignment, so anything holding one can still be made with plain new. CAPACITY must be a power of two. Neither side ever blocks: TryPush fails when
+//full and TryPop when empty, and what to do about it is the caller's call.
+template<typename T, size_t CAPACITY>
+class SPSCQueue
+{
+	static_assert(CAPACITY >= 2 && (CAPACITY & (CAPACITY - 1)) == 0, "SPSCQueue capacity must be a power of two.");
+
+public:
+	SPSCQueue()
+		: m_head(0)
+		, m_tail(0)
+	{
+
+	}
+
+	//Producer only
+	bool TryPush(const T& value)
+	{
+		size_t tail = m_tail.load(std::memory_order_relaxed);
+		if (tail - m_head.load(std::memory_order_acquire) == CAPACITY)
+			return false;
+
+		m_slots[tail & (CAPACITY - 1)] = value;
+		m_tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	//Consumer only
+	bool TryPop(T& out_value)
+	{
+		size_t head = m_head.load(std::memory_order_relaxed);
+		if (head == m_tail.load(std::memory_order_acquire))
+			return false;
+
+		out_value = m_slots[head & (CAPACITY - 1)];
+		m_head.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	//Exact from either side's own point of view; from anywhere else, only a snapshot
+	size_t GetSize() const { return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire); }
+
+private:
+	SPSCQueue(const SPSCQueue&) = delete;
+	SPSCQueue& operator=(const SPSCQueue&) = delete;
+
+	char m_padBeforeHead[CACHE_LINE_BYTES];
+	std::atomic<size_t> m_head;
+	char m_padBeforeTail[CACHE_LINE_BYTES - sizeof(std::atomic<size_t>)];
+	std::atomic<size_t> m_tail;
+	char m_padBeforeSlots[CACHE_LINE_BYTES - sizeof(std::atomic<size_t>)];
+	T m_slots[CAPACITY];
+};
@@ -0,0 +1,106 @@
+#include "Game/StateHash.hpp"
+#include <stdio.h>
+
+
+const char* STATE_HASH_FEATURE_NAMES[NUM_HASH_FEATURES] = { "tile", "HP", "CT", "dead", "wall", "charm", "confuse", "poison" };
+
+
+void StateHash::Update(CharacterID characterIndex, StateHashFeature feature, int oldValue, int newValue)
+{
+	if (oldValue == newValue)
+		return;
+
+	m_value ^= CalculateFeatureKey(characterIndex, feature, oldValue) ^ CalculateFeatureKey(characterIndex, feature, newValue);
+}
+
+uint64_t StateHash::CalculateFeatureKey(CharacterID characterIndex, StateHashFeature feature, int value)
+{
+	//SplitMix64 finalizer over the packed feature
+	uint64_t key = ((uint64_t)characterIndex << 40) | ((uint64_t)feature << 32) | (uint64_t)(uint32_t)value;
+	key += 0x9E3779B97F4A7C15ull;
+	key = (key ^ (key >> 30)) * 0xBF58476D1CE4E5B9ull;
+	key = (key ^ (key >> 27)) * 0x94D049BB133111EBull;
+	return key ^ (key >> 31);
+}
+
+
+void ToggleCharacterFeatures(StateHash& hash, const StateHashCharacter& character)
+{
+	hash.Toggle(character.m_characterIndex, HASH_FEATURE_TILE, character.m_tileIndex);
+	hash.Toggle(character.m_characterIndex, HASH_FEATURE_HP, character.m_currentHP);
+	hash.Toggle(character.m_characterIndex, HASH_FEATURE_CT, character.m_currentCT);
+	hash.Toggle(character.m_characterIndex, HASH_FEATURE_DEAD, character.m_isDead);
+	for (int effectIndex = 0; effectIndex < NUM_STATUS_EFFECTS; effectIndex++)
+	{
+		if (character.m_statusEffectDurations[effectIndex] != STATE_HASH_NO_EFFECT)
+			hash.Toggle(character.m_characterIndex, (StateHashFeature)(HASH_FEATURE_FIRST_STATUS_EFFECT + effectIndex), character.m_statusEffectDurations[effectIndex]);
+	}
+}
+
+uint64_t CalculateSnapshotHash(const StateHashSnapshot& snapshot)
+{
+	StateHash hash;
+	for (const StateHashCharacter& character : snapshot.m_characters)
+	{
+		ToggleCharacterFeatures(hash, character);
+	}
+
+	return hash.GetValue();
+}
+
+static const StateHashCharacter* FindSnapshotCharacter(const StateHashSnapshot& snapshot, CharacterID characterIndex)
+{
+	for (const StateHashCharacter& character : snapshot.m_characters)
+	{
+		if (character.m_characterIndex == characterIndex)
+			return &character;
+	}
+
+	return nullptr;
+}
+
+std::string DiffStateHashSnapshots(const StateHashSnapshot& localSnapshot, const StateHashSnapshot& remoteSnapshot)
+{
+	char line[256];
+	snprintf(line, sizeof(line), "Turn %u: local hash %016llx, remote hash %016llx\n", localSnapshot.m_turn, (unsigned long long)localSnapshot.m_hash, (unsigned long long)remoteSnapshot.m_hash);
+	std::string diff = line;
+
+	for (const StateHashCharacter& local : localSnapshot.m_characters)
+	{
+		const StateHashCharacter* remote = FindSnapshotCharacter(remoteSnapshot, local.m_characterIndex);
+		if (nullptr == remote)
+		{
+			snprintf(line, sizeof(line), "  character %d: only exists locally\n", local.m_characterIndex);
+			diff += line;
+			continue;
+		}
+
+		int localValues[NUM_HASH_FEATURES] = { local.m_tileIndex, local.m_currentHP, local.m_currentCT, local.m_isDead };
+		int remoteValues[NUM_HASH_FEATURES] = { remote->m_tileIndex, remote->m_currentHP, remote->m_currentCT, remote->m_isDead };
+		for (int effectIndex = 0; effectIndex < NUM_STATUS_EFFECTS; effectIndex++)
+		{
+			localValues[HASH_FEATURE_FIRST_STATUS_EFFECT + effectIndex] = local.m_statusEffectDurations[effectIndex];
+			remoteValues[HASH_FEATURE_FIRST_STATUS_EFFECT + effectIndex] = remote->m_statusEffectDurations[effectIndex];
+		}
+
+		for (int featureIndex = 0; featureIndex < NUM_HASH_FEATURES; featureIndex++)
+		{
+			if (localValues[featureIndex] == remoteValues[featureIndex])
+				continue;
+
+			snprintf(line, sizeof(line), "  character %d %s: local %d, remote %d\n", local.m_characterIndex, STATE_HASH_FEATURE_NAMES[featureIndex], localValues[featureIndex], remoteValues[featureIndex]);
+			diff += line;
+		}
+	}
+
+	for (const StateHashCharacter& remote : remoteSnapshot.m_characters)
+	{
+		if (nullptr == FindSnapshotCharacter(localSnapshot, remote.m_characterIndex))
+		{
+			snprintf(line, sizeof(line), "  character %d: only exists remotely\n", remote.m_characterIndex);
+			diff += line;
+		}
+	}
+
+	return diff;
+}
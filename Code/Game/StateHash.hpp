@@ -0,0 +1,63 @@
+#pragma once
+#include "Game/StatusEffectType.hpp"
+#include "Game/BattleState.hpp"
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+
+//Everything that feeds the hash, per character. Status effects get one feature each, keyed by type.
+enum StateHashFeature
+{
+	HASH_FEATURE_TILE,
+	HASH_FEATURE_HP,
+	HASH_FEATURE_CT,
+	HASH_FEATURE_DEAD,
+	HASH_FEATURE_FIRST_STATUS_EFFECT,
+	NUM_HASH_FEATURES = HASH_FEATURE_FIRST_STATUS_EFFECT + NUM_STATUS_EFFECTS
+};
+
+
+//Zobrist-style hash of the authoritative battle state: the XOR of one key per (character, feature, value).
+//Every mutation swaps the old value's key for the new one, so the hash is never recomputed during play.
+//Keys come from a mixing function rather than a table, so every peer derives the same ones with no setup.
+class StateHash
+{
+public:
+	StateHash() : m_value(0) {}
+
+	void Clear() { m_value = 0; }
+	void Toggle(CharacterID characterIndex, StateHashFeature feature, int value) { m_value ^= CalculateFeatureKey(characterIndex, feature, value); }
+	void Update(CharacterID characterIndex, StateHashFeature feature, int oldValue, int newValue);
+	uint64_t GetValue() const { return m_value; }
+
+	static uint64_t CalculateFeatureKey(CharacterID characterIndex, StateHashFeature feature, int value);
+
+private:
+	uint64_t m_value;
+};
+
+
+//The hashed values themselves, kept for recent turns so a mismatch can be explained and not just detected
+const int STATE_HASH_NO_EFFECT = -1;
+
+struct StateHashCharacter
+{
+	CharacterID m_characterIndex;
+	uint16_t m_tileIndex;
+	int m_currentHP;
+	int m_currentCT;
+	uint8_t m_isDead;
+	int m_statusEffectDurations[NUM_STATUS_EFFECTS];
+};
+
+struct StateHashSnapshot
+{
+	uint32_t m_turn;
+	uint64_t m_hash;
+	std::vector<StateHashCharacter> m_characters;
+};
+
+void ToggleCharacterFeatures(StateHash& hash, const StateHashCharacter& character);
+uint64_t CalculateSnapshotHash(const StateHashSnapshot& snapshot);
+std::string DiffStateHashSnapshots(const StateHashSnapshot& localSnapshot, const StateHashSnapshot& remoteSnapshot);
@@ -3,6 +3,7 @@
 #include "Engine\Core\Rgba.hpp"
 #include "Engine\Math\Matrix4.hpp"
 #include "Engine\Renderer\RHI\SpriteSheet2D.hpp"
+#include "Game/StatusEffectType.hpp"
 
 
 //Forward Declares
@@ -10,15 +11,6 @@ class Character;
 
 
 //Enums
-enum StatusEffectType
-{
-	STATUS_WALL = 0,
-	STATUS_CHARM,
-	STATUS_CONFUSE,
-	STATUS_POISON,
-	NUM_STATUS_EFFECTS
-};
-
 enum StatusEffectVisualType
 {
 	VISUAL_SPRITE,
@@ -0,0 +1,11 @@
+#pragma once
+
+
+enum StatusEffectType
+{
+	STATUS_WALL = 0,
+	STATUS_CHARM,
+	STATUS_CONFUSE,
+	STATUS_POISON,
+	NUM_STATUS_EFFECTS
+};
@@ -0,0 +1,50 @@
+#include "Game/UtilityMemo.hpp"
+
+
+UtilityMemo::UtilityMemo()
+	: m_entries()
+	, m_numTiles(0)
+	, m_stamp(0)
+	, m_isOpen(false)
+{
+
+}
+
+void UtilityMemo::Open(size_t numBehaviors, size_t numTiles)
+{
+	//Bumping the stamp invalidates every entry without clearing the table
+	m_stamp++;
+	m_numTiles = numTiles;
+	if (m_entries.size() < numBehaviors * numTiles)
+		m_entries.resize(numBehaviors * numTiles);
+
+	m_isOpen = true;
+}
+
+void UtilityMemo::Close()
+{
+	m_isOpen = false;
+}
+
+const UtilityMemoEntry* UtilityMemo::Find(size_t behaviorIndex, int tileIndex) const
+{
+	if (!m_isOpen)
+		return nullptr;
+
+	const UtilityMemoEntry& entry = m_entries[behaviorIndex * m_numTiles + tileIndex];
+	if (entry.m_stamp != m_stamp)
+		return nullptr;
+
+	return &entry;
+}
+
+void UtilityMemo::Store(size_t behaviorIndex, int tileIndex, float utility, Character* bestTarget)
+{
+	if (!m_isOpen)
+		return;
+
+	UtilityMemoEntry& entry = m_entries[behaviorIndex * m_numTiles + tileIndex];
+	entry.m_stamp = m_stamp;
+	entry.m_utility = utility;
+	entry.m_bestTarget = bestTarget;
+}
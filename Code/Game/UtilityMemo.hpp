@@ -0,0 +1,35 @@
+#pragma once
+#include <vector>
+#include <stddef.h>
+
+class Character;
+
+
+struct UtilityMemoEntry
+{
+	int m_stamp = -1;
+	float m_utility = 0.f;
+	Character* m_bestTarget = nullptr;
+};
+
+
+//Behavior utilities scored during one decision, keyed by (behavior index, tile index).
+//Only answers while open; StartPlanning opens it and CommitDecision closes it.
+class UtilityMemo
+{
+public:
+	UtilityMemo();
+
+	void Open(size_t numBehaviors, size_t numTiles);
+	void Close();
+	bool IsOpen() const { return m_isOpen; }
+
+	const UtilityMemoEntry* Find(size_t behaviorIndex, int tileIndex) const;
+	void Store(size_t behaviorIndex, int tileIndex, float utility, Character* bestTarget);
+
+private:
+	std::vector<UtilityMemoEntry> m_entries;
+	size_t m_numTiles;
+	int m_stamp;
+	bool m_isOpen;
+};
@@ -10,18 +10,14 @@
 
 
 
-WaitBehavior::WaitBehavior(XMLNode element)
+WaitBehavior::WaitBehavior()
 {
-}
 
-WaitBehavior::WaitBehavior(WaitBehavior* behaviorToCopy)
-{
-	UNUSED(behaviorToCopy);
 }
 
-WaitBehavior::~WaitBehavior()
+WaitBehavior::WaitBehavior(XMLNode element)
 {
-
+	UNUSED(element);
 }
 
 void WaitBehavior::Act(Character* actingCharacter)
@@ -36,19 +32,8 @@ float WaitBehavior::CalcUtility(Character* actingCharacter, Tile* tileToActFrom
 	return 0.05f;
 }
 
-std::string WaitBehavior::GetName() const
-{
-	return "Wait";
-}
-
 void WaitBehavior::DebugRender(const Character* actingCharacter) const 
 {
 	UNUSED(actingCharacter);
 }
 
-Behavior* WaitBehavior::Clone()
-{
-	WaitBehavior* outBehavior = new WaitBehavior(this);
-	return outBehavior;
-}
-
@@ -0,0 +1,381 @@
+#include "DedicatedServer/LoopbackClient.hpp"
+#include "DedicatedServer/LoopbackTransport.hpp"
+#include "DedicatedServer/ServerMatch.hpp"
+#include "BatchRunner/BattleRoster.hpp"
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+
+
+struct BenchOptions
+{
+	std::string m_dataFolder = "Run_Win32/Data/Gameplay";
+	int m_numMatches = 10;
+	uint32_t m_baseSeed = 1;
+	int m_maxTurns = 1000;
+	MatchSetup m_setup;
+	LinkSettings m_link;
+};
+
+//The server's end of one client's link, routed the way DedicatedServer routes a socket connection
+struct BenchPeer
+{
+	MessageStream* m_stream;
+	ServerMatch* m_match;
+	int m_playerIndex;
+};
+
+struct BenchResult
+{
+	int m_numClients = 0;
+	int m_numFinished = 0;
+	int m_numMismatched = 0;
+	int m_numFailed = 0;
+	size_t m_numCommands = 0;
+	size_t m_numBytes = 0;
+	size_t m_numSegmentsSent = 0;
+	size_t m_numSegmentsLost = 0;
+	std::vector<uint64_t> m_roundTripSamples;
+	std::vector<uint64_t> m_commandIntervalSamples;
+};
+
+
+std::vector<std::string> SplitCommaSeparated(const std::string& text)
+{
+	std::vector<std::string> pieces;
+	size_t start = 0;
+	while (start <= text.size())
+	{
+		size_t comma = text.find(',', start);
+		if (comma == std::string::npos)
+			comma = text.size();
+
+		if (comma > start)
+			pieces.push_back(text.substr(start, comma - start));
+
+		start = comma + 1;
+	}
+
+	return pieces;
+}
+
+void PrintUsage()
+{
+	printf("Usage: TacticsNetBench [options]\n");
+	printf("  Plays matches between loopback clients and in-process server matches over simulated links, on a virtual clock.\n");
+	printf("  --data <folder>      Folder holding Characters.xml and Abilities.xml (default Run_Win32/Data/Gameplay)\n");
+	printf("  --matches <count>    Matches to play at once (default 10)\n");
+	printf("  --seed <seed>        Match N and its links are seeded with seed + N (default 1)\n");
+	printf("  --max-turns <count>  Turns before a match is called a draw (default 1000)\n");
+	printf("  --map <W>x<H>        Map size (default 20x20)\n");
+	printf("  --team1 <a,b,...>    Character names for player 0 (default: the whole roster)\n");
+	printf("  --team2 <a,b,...>    Character names for player 1 (default: the whole roster)\n");
+	printf("  --latency <ms>       One-way latency of every link (default 0)\n");
+	printf("  --jitter <ms>        Extra one-way delay, uniform from 0 to this (default 0)\n");
+	printf("  --bandwidth <KB/s>   Per-direction bandwidth of every link, 0 for unlimited (default 0)\n");
+	printf("  --loss <percent>     Chance each segment is lost and has to be retransmitted (default 0)\n");
+}
+
+bool ParseOptions(int argc, char** argv, BenchOptions& out_options)
+{
+	for (int argIndex = 1; argIndex < argc; argIndex++)
+	{
+		std::string option = argv[argIndex];
+		if (option == "--help" || option == "-h")
+			return false;
+
+		if (argIndex + 1 >= argc)
+		{
+			printf("Missing value for %s\n", option.c_str());
+			return false;
+		}
+
+		std::string value = argv[++argIndex];
+		if (option == "--data")
+			out_options.m_dataFolder = value;
+		else if (option == "--matches")
+			out_options.m_numMatches = atoi(value.c_str());
+		else if (option == "--seed")
+			out_options.m_baseSeed = (uint32_t)strtoul(value.c_str(), nullptr, 10);
+		else if (option == "--max-turns")
+			out_options.m_maxTurns = atoi(value.c_str());
+		else if (option == "--map")
+		{
+			if (sscanf(value.c_str(), "%dx%d", &out_options.m_setup.m_mapWidth, &out_options.m_setup.m_mapHeight) != 2)
+			{
+				printf("Map size must look like 20x20\n");
+				return false;
+			}
+		}
+		else if (option == "--team1")
+			out_options.m_setup.m_teams[0] = SplitCommaSeparated(value);
+		else if (option == "--team2")
+			out_options.m_setup.m_teams[1] = SplitCommaSeparated(value);
+		else if (option == "--latency")
+			out_options.m_link.m_latencyMS = atof(value.c_str());
+		else if (option == "--jitter")
+			out_options.m_link.m_jitterMS = atof(value.c_str());
+		else if (option == "--bandwidth")
+			out_options.m_link.m_bandwidthBytesPerSecond = atof(value.c_str()) * 1024.0;
+		else if (option == "--loss")
+			out_options.m_link.m_lossPercent = atof(value.c_str());
+		else
+		{
+			printf("Unknown option %s\n", option.c_str());
+			return false;
+		}
+	}
+
+	const LinkSettings& link = out_options.m_link;
+	return out_options.m_numMatches > 0 && out_options.m_maxTurns > 0 && link.m_latencyMS >= 0.0 && link.m_jitterMS >= 0.0
+		&& link.m_bandwidthBytesPerSecond >= 0.0 && link.m_lossPercent >= 0.0 && link.m_lossPercent < 100.0;
+}
+
+bool HandlePeerMessages(BenchPeer& peer, const std::map<uint32_t, ServerMatch*>& matches)
+{
+	bool isOpen = peer.m_stream->Receive();
+
+	uint8_t type;
+	ByteReader payload;
+	std::vector<NetCommand> commands;
+	while (peer.m_stream->PopMessage(type, payload))
+	{
+		if (type == SERVER_MESSAGE_JOIN_MATCH)
+		{
+			uint32_t matchID = (uint32_t)payload.ReadVarint();
+			std::map<uint32_t, ServerMatch*>::const_iterator matchIter = matches.find(matchID);
+			if (payload.HasOverrun() || nullptr != peer.m_match || matchIter == matches.end())
+				return false;
+
+			peer.m_playerIndex = matchIter->second->AddPlayer(peer.m_stream);
+			if (peer.m_playerIndex < 0)
+				return false;
+
+			peer.m_match = matchIter->second;
+		}
+		else if (type == SERVER_MESSAGE_COMMAND)
+		{
+			uint16_t sequence;
+			if (!ReadCommandMessage(payload, sequence, commands))
+				return false;
+
+			if (nullptr == peer.m_match)
+				continue;
+
+			for (const NetCommand& command : commands)
+			{
+				peer.m_match->HandleCommand(peer.m_playerIndex, sequence++, command);
+			}
+		}
+		else
+		{
+			return false;
+		}
+	}
+
+	return isOpen;
+}
+
+//Everything runs on one thread against one LinkClock. Each pass lets every client and server peer read whatever
+//has arrived and send whatever it queued; once a pass at the current time has nothing left to read, the clock
+//jumps straight to the next segment due anywhere, so idle link time costs nothing to simulate.
+void RunBench(const BenchOptions& options, const BattleRoster& roster, BenchResult& out_result)
+{
+	LinkClock clock;
+	std::map<uint32_t, ServerMatch*> matches;
+	std::vector<LoopbackLink*> links;
+	std::vector<LoopbackClient*> clients;
+	std::vector<BenchPeer> peers;
+
+	for (int matchIndex = 0; matchIndex < options.m_numMatches; matchIndex++)
+	{
+		uint32_t seed = options.m_baseSeed + (uint32_t)matchIndex;
+		BattleState initialState;
+		std::string error;
+		roster.BuildBattleState(options.m_setup, seed, initialState, error);
+		matches[(uint32_t)matchIndex] = new ServerMatch((uint32_t)matchIndex, initialState, seed, options.m_maxTurns);
+
+		for (int playerIndex = 0; playerIndex < MATCH_NUM_PLAYERS; playerIndex++)
+		{
+			LoopbackLink* link = new LoopbackLink(clock, options.m_link, seed * MATCH_NUM_PLAYERS + (uint32_t)playerIndex);
+			links.push_back(link);
+
+			LoopbackClient* client = new LoopbackClient(link->CreateEnd(0), (uint32_t)matchIndex, &clock);
+			client->JoinMatch();
+			clients.push_back(client);
+
+			BenchPeer peer;
+			peer.m_stream = new MessageStream(link->CreateEnd(1));
+			peer.m_match = nullptr;
+			peer.m_playerIndex = -1;
+			peers.push_back(peer);
+		}
+	}
+
+	std::vector<bool> areClientsDone(clients.size(), false);
+	std::vector<bool> arePeersOpen(peers.size(), true);
+	size_t numClientsDone = 0;
+	while (numClientsDone < clients.size())
+	{
+		for (size_t clientIndex = 0; clientIndex < clients.size(); clientIndex++)
+		{
+			if (areClientsDone[clientIndex])
+				continue;
+
+			LoopbackClient* client = clients[clientIndex];
+			bool failed = !client->Update() || (!client->IsFinished() && !client->GetStream().Send());
+			if (!failed && !client->IsFinished())
+				continue;
+
+			if (failed)
+				out_result.m_numFailed++;
+			else if (client->IsMismatched())
+				out_result.m_numMismatched++;
+			else
+				out_result.m_numFinished++;
+
+			areClientsDone[clientIndex] = true;
+			numClientsDone++;
+		}
+
+		for (size_t peerIndex = 0; peerIndex < peers.size(); peerIndex++)
+		{
+			if (arePeersOpen[peerIndex] && !HandlePeerMessages(peers[peerIndex], matches))
+				arePeersOpen[peerIndex] = false;
+		}
+
+		//Matches queue onto both of their players' streams, so every peer is flushed only once all have been handled
+		bool hasUnsent = false;
+		for (size_t peerIndex = 0; peerIndex < peers.size(); peerIndex++)
+		{
+			if (arePeersOpen[peerIndex] && !peers[peerIndex].m_stream->Send())
+				arePeersOpen[peerIndex] = false;
+
+			hasUnsent = hasUnsent || (arePeersOpen[peerIndex] && peers[peerIndex].m_stream->HasUnsent());
+		}
+		for (size_t clientIndex = 0; clientIndex < clients.size(); clientIndex++)
+		{
+			hasUnsent = hasUnsent || (!areClientsDone[clientIndex] && clients[clientIndex]->GetStream().HasUnsent());
+		}
+
+		uint64_t nextDeliveryTime = LOOPBACK_NEVER;
+		for (LoopbackLink* link : links)
+		{
+			nextDeliveryTime = std::min(nextDeliveryTime, link->GetNextDeliveryTime());
+		}
+
+		if (nextDeliveryTime > clock.m_nowMicroseconds && nextDeliveryTime != LOOPBACK_NEVER)
+			clock.m_nowMicroseconds = nextDeliveryTime;
+		else if (nextDeliveryTime == LOOPBACK_NEVER && !hasUnsent)
+			break;
+	}
+
+	//Anything left had nothing in flight and nothing to send, so it was never going to finish
+	out_result.m_numClients = (int)clients.size();
+	out_result.m_numFailed += (int)(clients.size() - numClientsDone);
+
+	for (std::map<uint32_t, ServerMatch*>::iterator matchIter = matches.begin(); matchIter != matches.end(); ++matchIter)
+	{
+		out_result.m_numCommands += matchIter->second->GetNumCommands();
+		delete matchIter->second;
+	}
+
+	for (LoopbackClient* client : clients)
+	{
+		out_result.m_numBytes += client->GetStream().GetNumBytesSent() + client->GetStream().GetNumBytesReceived();
+		out_result.m_roundTripSamples.insert(out_result.m_roundTripSamples.end(), client->GetRoundTripSamples().begin(), client->GetRoundTripSamples().end());
+		out_result.m_commandIntervalSamples.insert(out_result.m_commandIntervalSamples.end(), client->GetCommandIntervalSamples().begin(), client->GetCommandIntervalSamples().end());
+		delete client;
+	}
+
+	for (BenchPeer& peer : peers)
+	{
+		delete peer.m_stream;
+	}
+
+	for (LoopbackLink* link : links)
+	{
+		out_result.m_numSegmentsSent += link->GetNumSegmentsSent();
+		out_result.m_numSegmentsLost += link->GetNumSegmentsLost();
+		delete link;
+	}
+
+	printf("Simulated %.3f s of link time\n", clock.m_nowMicroseconds / 1000000.0);
+}
+
+void PrintLatencies(const char* name, std::vector<uint64_t>& samples)
+{
+	if (samples.empty())
+	{
+		printf("  %-18s no samples\n", name);
+		return;
+	}
+
+	std::sort(samples.begin(), samples.end());
+	double total = 0.0;
+	for (uint64_t sample : samples)
+	{
+		total += (double)sample;
+	}
+
+	size_t p99Index = std::min(samples.size() - 1, samples.size() * 99 / 100);
+	printf("  %-18s avg %8.2f ms  p50 %8.2f ms  p99 %8.2f ms  max %8.2f ms  (%zu samples)\n", name,
+		total / samples.size() / 1000.0, samples[samples.size() / 2] / 1000.0, samples[p99Index] / 1000.0, samples.back() / 1000.0, samples.size());
+}
+
+
+int main(int argc, char** argv)
+{
+	BenchOptions options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	BattleRoster roster;
+	std::string error;
+	if (!roster.LoadFromDataFolder(options.m_dataFolder, error))
+	{
+		printf("Failed to load roster: %s\n", error.c_str());
+		return 1;
+	}
+
+	for (int teamIndex = 0; teamIndex < 2; teamIndex++)
+	{
+		if (!options.m_setup.m_teams[teamIndex].empty())
+			continue;
+
+		for (const RosterCharacter& character : roster.m_characters)
+		{
+			options.m_setup.m_teams[teamIndex].push_back(character.m_name);
+		}
+	}
+
+	BattleState validationState;
+	if (!roster.BuildBattleState(options.m_setup, options.m_baseSeed, validationState, error))
+	{
+		printf("Invalid match setup: %s\n", error.c_str());
+		return 1;
+	}
+
+	const LinkSettings& link = options.m_link;
+	printf("%d matches over links with %.1f ms latency, %.1f ms jitter, %.0f KB/s bandwidth, %.1f%% loss\n", options.m_numMatches,
+		link.m_latencyMS, link.m_jitterMS, link.m_bandwidthBytesPerSecond / 1024.0, link.m_lossPercent);
+
+	BenchResult result;
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+	RunBench(options, roster, result);
+	double elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+	if (elapsedSeconds <= 0.0)
+		elapsedSeconds = 1e-9;
+
+	PrintLatencies("Command round trip", result.m_roundTripSamples);
+	PrintLatencies("Turn interval", result.m_commandIntervalSamples);
+	printf("  %zu commands, %zu bytes through the clients, %zu segments (%zu lost)\n", result.m_numCommands, result.m_numBytes, result.m_numSegmentsSent, result.m_numSegmentsLost);
+	printf("  %.2f s wall clock, %.0f commands/s\n", elapsedSeconds, result.m_numCommands / elapsedSeconds);
+	printf("Loopback clients: %d of %d agreed with the server, %d mismatched, %d failed\n",
+		result.m_numFinished, result.m_numClients, result.m_numMismatched, result.m_numFailed);
+	return (result.m_numFinished == result.m_numClients) ? 0 : 1;
+}
@@ -0,0 +1,452 @@
+#include "ReplayScanner/MappedFile.hpp"
+#include "BatchRunner/BattleRoster.hpp"
+#include "Game/BattleSimulation.hpp"
+#include "Game/BattleReplay.hpp"
+#include <stdio.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+
+const int NUM_REPLAY_COMMAND_TYPES = 4;
+const char* COMMAND_TYPE_NAMES[NUM_REPLAY_COMMAND_TYPES] = { "attack", "move", "ability", "wait" };
+
+enum ScanStatus
+{
+	SCAN_OK,
+	SCAN_UNREADABLE,
+	SCAN_NO_SETUP,
+	SCAN_PARTIAL,
+	SCAN_DESYNCED,
+	NUM_SCAN_STATUSES
+};
+
+struct ScanOptions
+{
+	std::vector<std::string> m_inputPaths;
+	std::string m_dataFolder;
+	std::string m_outputPath;
+	int m_numThreads = 0;
+};
+
+struct ReplayResult
+{
+	ScanStatus m_status;
+	std::string m_error;
+	uint32_t m_seed;
+	size_t m_numBytes;
+	int m_winningPlayer;
+	int m_numTurns;
+	int m_numCommands;
+	int m_damageDealt[2];
+};
+
+//Per-thread running totals, merged once every worker is done
+struct ScanTotals
+{
+	int m_numReplays[NUM_SCAN_STATUSES];
+	int m_wins[2];
+	int m_draws;
+	long long m_numTurns;
+	int m_minTurns;
+	int m_maxTurns;
+	long long m_numBytes;
+	long long m_commandTypeCounts[NUM_REPLAY_COMMAND_TYPES];
+	long long m_abilityUses[MAX_BATTLE_ABILITIES];
+
+	void Clear();
+	void AddResult(const ReplayResult& result);
+	void Merge(const ScanTotals& other);
+};
+
+
+void ScanTotals::Clear()
+{
+	memset(this, 0, sizeof(*this));
+	m_minTurns = -1;
+}
+
+void ScanTotals::AddResult(const ReplayResult& result)
+{
+	m_numReplays[result.m_status]++;
+	m_numBytes += result.m_numBytes;
+	if (result.m_status != SCAN_OK)
+		return;
+
+	if (result.m_winningPlayer == 0 || result.m_winningPlayer == 1)
+		m_wins[result.m_winningPlayer]++;
+	else
+		m_draws++;
+
+	m_numTurns += result.m_numTurns;
+	m_maxTurns = std::max(m_maxTurns, result.m_numTurns);
+	m_minTurns = (m_minTurns < 0) ? result.m_numTurns : std::min(m_minTurns, result.m_numTurns);
+}
+
+void ScanTotals::Merge(const ScanTotals& other)
+{
+	for (int statusIndex = 0; statusIndex < NUM_SCAN_STATUSES; statusIndex++)
+	{
+		m_numReplays[statusIndex] += other.m_numReplays[statusIndex];
+	}
+	for (int teamIndex = 0; teamIndex < 2; teamIndex++)
+	{
+		m_wins[teamIndex] += other.m_wins[teamIndex];
+	}
+	for (int typeIndex = 0; typeIndex < NUM_REPLAY_COMMAND_TYPES; typeIndex++)
+	{
+		m_commandTypeCounts[typeIndex] += other.m_commandTypeCounts[typeIndex];
+	}
+	for (int abilityID = 0; abilityID < MAX_BATTLE_ABILITIES; abilityID++)
+	{
+		m_abilityUses[abilityID] += other.m_abilityUses[abilityID];
+	}
+
+	m_draws += other.m_draws;
+	m_numTurns += other.m_numTurns;
+	m_numBytes += other.m_numBytes;
+	m_maxTurns = std::max(m_maxTurns, other.m_maxTurns);
+	if (other.m_minTurns >= 0)
+		m_minTurns = (m_minTurns < 0) ? other.m_minTurns : std::min(m_minTurns, other.m_minTurns);
+}
+
+
+void PrintUsage()
+{
+	printf("Usage: TacticsReplayScan [options] <replay or folder>...\n");
+	printf("  Re-simulates every .sav replay given (folders are searched for *.sav) and totals the results.\n");
+	printf("  Only replays recorded by TacticsBatch --replays can be re-simulated. The game's replay.sav leaves out\n");
+	printf("  AI-controlled and charmed or confused turns, so those are reported as partial and skipped.\n");
+	printf("  --threads <count>    Worker threads (default: one per core)\n");
+	printf("  --data <folder>      Folder holding Abilities.xml, to print ability names instead of IDs\n");
+	printf("  --out <file>         CSV of per-replay results\n");
+}
+
+bool ParseOptions(int argc, char** argv, ScanOptions& out_options)
+{
+	for (int argIndex = 1; argIndex < argc; argIndex++)
+	{
+		std::string option = argv[argIndex];
+		if (option == "--help" || option == "-h")
+			return false;
+
+		if (option.compare(0, 2, "--") != 0)
+		{
+			out_options.m_inputPaths.push_back(option);
+			continue;
+		}
+
+		if (argIndex + 1 >= argc)
+		{
+			printf("Missing value for %s\n", option.c_str());
+			return false;
+		}
+
+		std::string value = argv[++argIndex];
+		if (option == "--threads")
+			out_options.m_numThreads = atoi(value.c_str());
+		else if (option == "--data")
+			out_options.m_dataFolder = value;
+		else if (option == "--out")
+			out_options.m_outputPath = value;
+		else
+		{
+			printf("Unknown option %s\n", option.c_str());
+			return false;
+		}
+	}
+
+	return !out_options.m_inputPaths.empty();
+}
+
+ReplayResult ScanReplay(const std::string& filePath, ScanTotals& totals)
+{
+	ReplayResult result;
+	result.m_status = SCAN_UNREADABLE;
+	result.m_seed = 0;
+	result.m_numBytes = 0;
+	result.m_winningPlayer = -1;
+	result.m_numTurns = 0;
+	result.m_numCommands = 0;
+	result.m_damageDealt[0] = 0;
+	result.m_damageDealt[1] = 0;
+
+	MappedFile file;
+	if (!file.Open(filePath))
+	{
+		result.m_error = "Could not map file.";
+		return result;
+	}
+	result.m_numBytes = file.GetSize();
+
+	ReplayView replay;
+	if (!replay.Open(file.GetData(), file.GetSize()))
+	{
+		result.m_error = replay.m_error;
+		return result;
+	}
+	result.m_seed = replay.m_seed;
+
+	if (!replay.ReadNextChunk() || replay.m_chunkType != REPLAY_CHUNK_SETUP)
+	{
+		result.m_status = replay.HasError() ? SCAN_UNREADABLE : SCAN_NO_SETUP;
+		result.m_error = replay.HasError() ? replay.m_error : "Replay has no setup chunk.";
+		return result;
+	}
+
+	//Turns the recording left out can't be made up here, since the game rolled them on its own random stream
+	if ((replay.m_infoFlags & REPLAY_INFO_EVERY_TURN_RECORDED) == 0)
+	{
+		result.m_status = SCAN_PARTIAL;
+		result.m_error = "Replay doesn't record every turn; only TacticsBatch replays can be re-simulated.";
+		return result;
+	}
+
+	BattleState setupState;
+	if (!ReadSetupState(replay.m_payload, setupState, replay.m_version))
+	{
+		result.m_error = "Replay setup is malformed.";
+		return result;
+	}
+
+	long long commandTypeCounts[NUM_REPLAY_COMMAND_TYPES] = { 0 };
+	long long abilityUses[MAX_BATTLE_ABILITIES] = { 0 };
+
+	//Commands are decoded straight out of the mapping, one at a time, as the simulation asks for them
+	BattleSimulation simulation(setupState, replay.m_seed);
+	int readySlot = -1;
+	while (replay.ReadNextChunk())
+	{
+		if (replay.m_chunkType != REPLAY_CHUNK_COMMANDS)
+			continue;
+
+		for (size_t commandIndex = 0; commandIndex < replay.m_commandLayout.m_numCommands; commandIndex++)
+		{
+			ReplayCommandRecord command = ReadCommandRecord(replay.m_payload, replay.m_commandLayout);
+			while (readySlot < 0)
+			{
+				if (!simulation.StartNextTurn(readySlot))
+				{
+					result.m_status = SCAN_DESYNCED;
+					result.m_error = "Battle ended with commands left over.";
+					return result;
+				}
+			}
+
+			if (simulation.m_state.m_characterIndices[readySlot] != command.m_actingCharacterIndex || command.m_type >= NUM_REPLAY_COMMAND_TYPES)
+			{
+				result.m_status = SCAN_DESYNCED;
+				result.m_error = "Command " + std::to_string(result.m_numCommands) + " is for a character whose turn it isn't.";
+				return result;
+			}
+
+			BattleDecision decision = MakeBattleDecision(simulation.m_state, readySlot, command);
+			commandTypeCounts[command.m_type]++;
+			if (decision.m_kind == BEHAVIOR_ABILITY && decision.m_abilityID >= 0)
+				abilityUses[decision.m_abilityID]++;
+
+			simulation.FinishTurn(readySlot, decision);
+			readySlot = -1;
+			result.m_numCommands++;
+		}
+	}
+
+	if (replay.HasError())
+	{
+		result.m_error = replay.m_error;
+		return result;
+	}
+
+	//Play out anything that needs no decision, like abilities still charging, up to the turn the recording stopped at;
+	//a turn that wants one means the match was cut off there
+	int lastTurn = (replay.m_numTurnsPlayed > 0) ? (int)replay.m_numTurnsPlayed : INT_MAX;
+	while (!simulation.IsFinished() && simulation.m_numTurns < lastTurn && simulation.StartNextTurn(readySlot) && readySlot < 0)
+	{
+	}
+
+	result.m_status = SCAN_OK;
+	result.m_winningPlayer = simulation.GetWinningPlayer();
+	result.m_numTurns = simulation.m_numTurns - ((readySlot >= 0) ? 1 : 0);
+	for (int slot = 0; slot < simulation.m_state.m_numCharacters; slot++)
+	{
+		int team = simulation.m_state.m_owningPlayers[slot];
+		if (team == 0 || team == 1)
+			result.m_damageDealt[team] += simulation.m_damageDealt[slot];
+	}
+
+	for (int typeIndex = 0; typeIndex < NUM_REPLAY_COMMAND_TYPES; typeIndex++)
+	{
+		totals.m_commandTypeCounts[typeIndex] += commandTypeCounts[typeIndex];
+	}
+	for (int abilityID = 0; abilityID < MAX_BATTLE_ABILITIES; abilityID++)
+	{
+		totals.m_abilityUses[abilityID] += abilityUses[abilityID];
+	}
+
+	return result;
+}
+
+bool WriteResults(const std::string& outputPath, const std::vector<std::string>& filePaths, const std::vector<ReplayResult>& results)
+{
+	static const char* STATUS_NAMES[NUM_SCAN_STATUSES] = { "ok", "unreadable", "no_setup", "partial", "desynced" };
+
+	FILE* file = fopen(outputPath.c_str(), "w");
+	if (nullptr == file)
+		return false;
+
+	fprintf(file, "file,status,seed,bytes,winner,turns,commands,team1_damage,team2_damage,error\n");
+	for (size_t replayIndex = 0; replayIndex < results.size(); replayIndex++)
+	{
+		const ReplayResult& result = results[replayIndex];
+		fprintf(file, "%s,%s,%u,%u,%d,%d,%d,%d,%d,\"%s\"\n", filePaths[replayIndex].c_str(), STATUS_NAMES[result.m_status], result.m_seed, (unsigned int)result.m_numBytes,
+			result.m_winningPlayer + 1, result.m_numTurns, result.m_numCommands, result.m_damageDealt[0], result.m_damageDealt[1], result.m_error.c_str());
+	}
+
+	fclose(file);
+	return true;
+}
+
+
+int main(int argc, char** argv)
+{
+	ScanOptions options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	std::vector<std::string> filePaths;
+	for (const std::string& inputPath : options.m_inputPaths)
+	{
+		if (!IsFolder(inputPath))
+		{
+			filePaths.push_back(inputPath);
+			continue;
+		}
+
+		std::vector<std::string> folderFiles = ListFilesInFolder(inputPath, ".sav");
+		std::sort(folderFiles.begin(), folderFiles.end());
+		filePaths.insert(filePaths.end(), folderFiles.begin(), folderFiles.end());
+	}
+
+	if (filePaths.empty())
+	{
+		printf("No replays found.\n");
+		return 1;
+	}
+
+	std::vector<std::string> abilityNames;
+	if (!options.m_dataFolder.empty())
+	{
+		BattleRoster roster;
+		std::string error;
+		if (!roster.LoadFromDataFolder(options.m_dataFolder, error))
+		{
+			printf("Failed to load abilities: %s\n", error.c_str());
+			return 1;
+		}
+
+		//Ability IDs are positions in the name-sorted registry
+		for (const std::pair<const std::string, RosterAbility>& ability : roster.m_abilities)
+		{
+			abilityNames.push_back(ability.first);
+		}
+	}
+
+	int numThreads = options.m_numThreads;
+	if (numThreads <= 0)
+		numThreads = (int)std::thread::hardware_concurrency();
+	if (numThreads <= 0)
+		numThreads = 1;
+	if (numThreads > (int)filePaths.size())
+		numThreads = (int)filePaths.size();
+
+	std::vector<ReplayResult> results(filePaths.size());
+	std::vector<ScanTotals> threadTotals(numThreads);
+	std::atomic<size_t> nextReplayIndex(0);
+
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+	std::vector<std::thread> workers;
+	for (int threadIndex = 0; threadIndex < numThreads; threadIndex++)
+	{
+		workers.push_back(std::thread([&, threadIndex]()
+		{
+			ScanTotals& totals = threadTotals[threadIndex];
+			totals.Clear();
+			for (;;)
+			{
+				size_t replayIndex = nextReplayIndex.fetch_add(1);
+				if (replayIndex >= filePaths.size())
+					return;
+
+				results[replayIndex] = ScanReplay(filePaths[replayIndex], totals);
+				totals.AddResult(results[replayIndex]);
+			}
+		}));
+	}
+
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+
+	double elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+	if (elapsedSeconds <= 0.0)
+		elapsedSeconds = 1e-9;
+
+	ScanTotals totals;
+	totals.Clear();
+	for (const ScanTotals& threadTotal : threadTotals)
+	{
+		totals.Merge(threadTotal);
+	}
+
+	if (!options.m_outputPath.empty() && !WriteResults(options.m_outputPath, filePaths, results))
+	{
+		printf("Failed to write %s\n", options.m_outputPath.c_str());
+		return 1;
+	}
+
+	int numScanned = totals.m_numReplays[SCAN_OK];
+	printf("%d replays (%.2f MB) on %d threads in %.3f s: %.1f replays/s, %.1f MB/s\n", (int)filePaths.size(), totals.m_numBytes / (1024.0 * 1024.0), numThreads,
+		elapsedSeconds, filePaths.size() / elapsedSeconds, totals.m_numBytes / (1024.0 * 1024.0) / elapsedSeconds);
+	printf("Re-simulated: %d, unreadable: %d, no setup: %d, partial recordings: %d, desynced: %d\n", numScanned, totals.m_numReplays[SCAN_UNREADABLE],
+		totals.m_numReplays[SCAN_NO_SETUP], totals.m_numReplays[SCAN_PARTIAL], totals.m_numReplays[SCAN_DESYNCED]);
+	if (numScanned == 0)
+		return 0;
+
+	printf("Team 1 wins: %d (%.1f%%), team 2 wins: %d (%.1f%%), draws: %d (%.1f%%)\n", totals.m_wins[0], 100.0 * totals.m_wins[0] / numScanned,
+		totals.m_wins[1], 100.0 * totals.m_wins[1] / numScanned, totals.m_draws, 100.0 * totals.m_draws / numScanned);
+	printf("Turns per match: avg %.1f, min %d, max %d\n", (double)totals.m_numTurns / numScanned, totals.m_minTurns, totals.m_maxTurns);
+
+	long long numCommands = 0;
+	for (int typeIndex = 0; typeIndex < NUM_REPLAY_COMMAND_TYPES; typeIndex++)
+	{
+		numCommands += totals.m_commandTypeCounts[typeIndex];
+	}
+
+	printf("Commands: %lld (%.1f per match)\n", numCommands, (double)numCommands / numScanned);
+	for (int typeIndex = 0; typeIndex < NUM_REPLAY_COMMAND_TYPES && numCommands > 0; typeIndex++)
+	{
+		printf("  %-8s %10lld  %5.1f%%\n", COMMAND_TYPE_NAMES[typeIndex], totals.m_commandTypeCounts[typeIndex], 100.0 * totals.m_commandTypeCounts[typeIndex] / numCommands);
+	}
+
+	printf("Ability usage:\n");
+	for (int abilityID = 0; abilityID < MAX_BATTLE_ABILITIES; abilityID++)
+	{
+		if (totals.m_abilityUses[abilityID] == 0)
+			continue;
+
+		std::string abilityName = (abilityID < (int)abilityNames.size()) ? abilityNames[abilityID] : "ability " + std::to_string(abilityID);
+		printf("  %-16s %10lld  %.2f per match\n", abilityName.c_str(), totals.m_abilityUses[abilityID], (double)totals.m_abilityUses[abilityID] / numScanned);
+	}
+
+	return 0;
+}
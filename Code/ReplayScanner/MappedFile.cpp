@@ -0,0 +1,174 @@
+#include "ReplayScanner/MappedFile.hpp"
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+MappedFile::MappedFile()
+	: m_data(nullptr)
+	, m_size(0)
+#ifdef _WIN32
+	, m_fileHandle(INVALID_HANDLE_VALUE)
+	, m_mappingHandle(nullptr)
+#endif
+{
+
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+#ifdef _WIN32
+bool MappedFile::Open(const std::string& filePath)
+{
+	Close();
+
+	m_fileHandle = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (m_fileHandle == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(m_fileHandle, &fileSize))
+	{
+		Close();
+		return false;
+	}
+
+	//Windows can't map an empty file, and an empty file is just an empty view
+	m_size = (size_t)fileSize.QuadPart;
+	if (m_size == 0)
+		return true;
+
+	m_mappingHandle = CreateFileMappingA(m_fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (nullptr != m_mappingHandle)
+		m_data = (const uint8_t*)MapViewOfFile(m_mappingHandle, FILE_MAP_READ, 0, 0, 0);
+
+	if (nullptr == m_data)
+	{
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (nullptr != m_data)
+		UnmapViewOfFile(m_data);
+	if (nullptr != m_mappingHandle)
+		CloseHandle(m_mappingHandle);
+	if (m_fileHandle != INVALID_HANDLE_VALUE)
+		CloseHandle(m_fileHandle);
+
+	m_data = nullptr;
+	m_size = 0;
+	m_mappingHandle = nullptr;
+	m_fileHandle = INVALID_HANDLE_VALUE;
+}
+
+bool IsFolder(const std::string& path)
+{
+	DWORD attributes = GetFileAttributesA(path.c_str());
+	return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+}
+
+std::vector<std::string> ListFilesInFolder(const std::string& folder, const std::string& extension)
+{
+	std::vector<std::string> filePaths;
+	WIN32_FIND_DATAA findData;
+	HANDLE findHandle = FindFirstFileA((folder + "\\*" + extension).c_str(), &findData);
+	if (findHandle == INVALID_HANDLE_VALUE)
+		return filePaths;
+
+	do
+	{
+		if ((findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0)
+			filePaths.push_back(folder + "\\" + findData.cFileName);
+	} while (FindNextFileA(findHandle, &findData));
+
+	FindClose(findHandle);
+	return filePaths;
+}
+#else
+bool MappedFile::Open(const std::string& filePath)
+{
+	Close();
+
+	int fileDescriptor = open(filePath.c_str(), O_RDONLY);
+	if (fileDescriptor < 0)
+		return false;
+
+	struct stat fileInfo;
+	if (fstat(fileDescriptor, &fileInfo) != 0)
+	{
+		close(fileDescriptor);
+		return false;
+	}
+
+	m_size = (size_t)fileInfo.st_size;
+	if (m_size > 0)
+	{
+		void* mapping = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+		if (mapping == MAP_FAILED)
+		{
+			close(fileDescriptor);
+			m_size = 0;
+			return false;
+		}
+
+		madvise(mapping, m_size, MADV_SEQUENTIAL);
+		m_data = (const uint8_t*)mapping;
+	}
+
+	//The mapping keeps the file alive on its own
+	close(fileDescriptor);
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (nullptr != m_data)
+		munmap((void*)m_data, m_size);
+
+	m_data = nullptr;
+	m_size = 0;
+}
+
+bool IsFolder(const std::string& path)
+{
+	struct stat pathInfo;
+	return stat(path.c_str(), &pathInfo) == 0 && S_ISDIR(pathInfo.st_mode);
+}
+
+std::vector<std::string> ListFilesInFolder(const std::string& folder, const std::string& extension)
+{
+	std::vector<std::string> filePaths;
+	DIR* directory = opendir(folder.c_str());
+	if (nullptr == directory)
+		return filePaths;
+
+	while (dirent* entry = readdir(directory))
+	{
+		std::string fileName = entry->d_name;
+		if (fileName.size() < extension.size() || fileName.compare(fileName.size() - extension.size(), extension.size(), extension) != 0)
+			continue;
+
+		std::string filePath = folder + "/" + fileName;
+		if (!IsFolder(filePath))
+			filePaths.push_back(filePath);
+	}
+
+	closedir(directory);
+	return filePaths;
+}
+#endif